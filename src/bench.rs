@@ -0,0 +1,204 @@
+use std::env;
+use std::process;
+use std::time::{Duration, Instant};
+
+use colored::Colorize;
+
+use crate::codegen::codegen::IRGenerator;
+use crate::parser::parser::{ExecutionTechnique, Parser};
+use crate::runtime::interpreter::Interpreter;
+use crate::runtime::source_environment::source_environment::SourceEnv;
+use crate::runtime::vm::{compiler::BytecodeCompiler, machine::VirtualMachine};
+use crate::stdlib_interp::io::discard_stdout;
+use crate::tokenizer::tokenizer::tokenize;
+use crate::typecheck::typecheck::TypeChecker;
+
+/// The last stages a benchmark runs, after tokenizing, parsing and typechecking.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum BenchBackend {
+    Interpreter,
+    /// Bytecode compilation, then the VM.
+    Vm,
+    /// LLVM IR generation; the optimizer, object emission and linking are left out.
+    Compiler,
+}
+
+impl BenchBackend {
+    fn technique(self) -> ExecutionTechnique {
+        match self {
+            Self::Interpreter => ExecutionTechnique::Interpretation,
+            Self::Vm => ExecutionTechnique::Bytecode,
+            Self::Compiler => ExecutionTechnique::Compilation,
+        }
+    }
+}
+
+#[derive(Debug, Clone)]
+pub struct BenchOptions {
+    pub runs: usize,
+    pub inject_stdlib_snippets: bool,
+    pub sandboxed: bool,
+    pub backend: BenchBackend,
+}
+
+/// The time one pipeline stage took on every run.
+#[derive(Debug, Clone)]
+pub struct StageTimes {
+    pub name: &'static str,
+    pub samples: Vec<Duration>,
+}
+
+impl StageTimes {
+    fn new(name: &'static str) -> Self {
+        Self {
+            name,
+            samples: Vec::new(),
+        }
+    }
+
+    /// The nearest-rank percentile `p` (from 0 to 100) of the samples, or zero without any.
+    pub fn percentile(&self, p: f64) -> Duration {
+        let mut sorted = self.samples.clone();
+        sorted.sort_unstable();
+        let rank = (p / 100.0 * sorted.len() as f64).ceil() as usize;
+        sorted
+            .get(rank.clamp(1, sorted.len().max(1)) - 1)
+            .copied()
+            .unwrap_or_default()
+    }
+
+    pub fn mean(&self) -> Duration {
+        if self.samples.is_empty() {
+            return Duration::ZERO;
+        }
+        self.samples.iter().sum::<Duration>() / self.samples.len() as u32
+    }
+}
+
+/// Runs `source` through the whole pipeline `options.runs` times from scratch, timing every stage on its own. The
+/// program's output is thrown away while it runs, so a benchmark measures the program rather than the terminal.
+/// A program with type errors is refused before its first run, as running it would be.
+pub fn run_bench(source: &str, file_path: &str, options: &BenchOptions) -> Vec<StageTimes> {
+    let technique = options.backend.technique();
+    let mut tokenize_times = StageTimes::new("tokenize");
+    let mut parse_times = StageTimes::new("parse");
+    let mut typecheck_times = StageTimes::new("typecheck");
+    let mut backend_times = match options.backend {
+        BenchBackend::Interpreter => vec![StageTimes::new("interpret")],
+        BenchBackend::Vm => vec![StageTimes::new("bytecode"), StageTimes::new("vm")],
+        BenchBackend::Compiler => vec![StageTimes::new("irgen")],
+    };
+    let current_dir = env::current_dir().unwrap().to_str().unwrap().to_string();
+
+    discard_stdout(true);
+    for _ in 0..options.runs {
+        let started = Instant::now();
+        let tokens = tokenize(source, false, technique.clone()).real_tokens;
+        tokenize_times.samples.push(started.elapsed());
+
+        let started = Instant::now();
+        let mut ast =
+            Parser::with_tokens(tokens, options.inject_stdlib_snippets, technique.clone())
+                .produce_ast();
+        ast.fold_constants();
+        parse_times.samples.push(started.elapsed());
+
+        let started = Instant::now();
+        let mut checker =
+            TypeChecker::new(&ast.externals_used, current_dir.clone(), technique.clone());
+        checker.enter_scope();
+        checker.load_externs();
+        for node in &ast.nodes {
+            checker.check_expr(node, None, false, 0);
+        }
+        checker.check_all_type_resolutions();
+        typecheck_times.samples.push(started.elapsed());
+        if !checker.errors.is_empty() {
+            discard_stdout(false);
+            println!("Typechecking failed");
+            println!("Typecheck errors;");
+            for err in &checker.errors {
+                eprintln!(
+                    "{}: {}",
+                    String::from("tc-err").red().bold(),
+                    err.message.bold()
+                )
+            }
+            process::exit(1);
+        }
+
+        match options.backend {
+            BenchBackend::Interpreter => {
+                let global_env = SourceEnv::create_global(options.sandboxed);
+                let started = Instant::now();
+                Interpreter::new(ast.nodes).evaluate_body(global_env);
+                backend_times[0].samples.push(started.elapsed());
+            }
+            BenchBackend::Vm => {
+                let global_env = SourceEnv::create_global(options.sandboxed);
+                let started = Instant::now();
+                let program =
+                    BytecodeCompiler::new(&global_env.borrow()).compile_program(&ast.nodes);
+                backend_times[0].samples.push(started.elapsed());
+
+                let started = Instant::now();
+                VirtualMachine::new(global_env).run(program);
+                backend_times[1].samples.push(started.elapsed());
+            }
+            BenchBackend::Compiler => {
+                let context = inkwell::context::Context::create();
+                let compile_time_checker =
+                    TypeChecker::new(&ast.externals_used, current_dir.clone(), technique.clone());
+                let mut generator = IRGenerator::new(
+                    &context,
+                    file_path,
+                    false,
+                    compile_time_checker,
+                    checker.type_table,
+                    &ast.externals_used,
+                );
+                generator.build_external_archives = false;
+                let started = Instant::now();
+                if !generator.generate_ir_for_nodes(ast.nodes) {
+                    discard_stdout(false);
+                    process::exit(1);
+                }
+                backend_times[0].samples.push(started.elapsed());
+            }
+        }
+    }
+    discard_stdout(false);
+
+    let mut stages = vec![tokenize_times, parse_times, typecheck_times];
+    stages.extend(backend_times);
+    stages
+}
+
+/// Prints the percentiles of every stage, and of the runs as a whole, in milliseconds.
+pub fn print_bench_report(stages: &[StageTimes]) {
+    let runs = stages.first().map_or(0, |stage| stage.samples.len());
+    let total = StageTimes {
+        name: "total",
+        samples: (0..runs)
+            .map(|run| stages.iter().map(|stage| stage.samples[run]).sum())
+            .collect(),
+    };
+    println!("[Bench] {} run(s)", runs);
+    println!(
+        "    {:<10}  {:>10}  {:>10}  {:>10}  {:>10}  {:>10}  {:>10}",
+        "stage", "min", "p50", "p90", "p99", "max", "mean"
+    );
+    for stage in stages.iter().chain([&total]) {
+        let ms = |duration: Duration| duration.as_secs_f64() * 1000.0;
+        println!(
+            "    {:<10}  {:>10.3}  {:>10.3}  {:>10.3}  {:>10.3}  {:>10.3}  {:>10.3}",
+            stage.name,
+            ms(stage.percentile(0.0)),
+            ms(stage.percentile(50.0)),
+            ms(stage.percentile(90.0)),
+            ms(stage.percentile(99.0)),
+            ms(stage.percentile(100.0)),
+            ms(stage.mean())
+        );
+    }
+}
@@ -0,0 +1,90 @@
+use std::{
+    fs,
+    path::{Path, PathBuf},
+};
+
+use crate::{
+    parser::parser::ExecutionTechnique,
+    tokenizer::tokenizer::snippet_sources,
+    typecheck::typecheck::{SubmoduleFetchResult, try_fetch_submodule},
+};
+
+pub const CACHE_DIR: &str = "./velvet_tmp/cache";
+
+/// 64-bit FNV-1a. Unlike `DefaultHasher`, its output is stable across Rust releases, so keys stay valid on disk.
+pub struct Fnv64(pub u64);
+
+impl Fnv64 {
+    pub fn new() -> Self {
+        Self(0xcbf29ce484222325)
+    }
+
+    /// Hashes `bytes` prefixed by their length, so adjacent fields cannot run into each other.
+    pub fn field(&mut self, bytes: &[u8]) {
+        for byte in (bytes.len() as u64).to_le_bytes().iter().chain(bytes) {
+            self.0 ^= *byte as u64;
+            self.0 = self.0.wrapping_mul(0x100000001b3);
+        }
+    }
+}
+
+/// A content-addressed store of linked executables under `velvet_tmp/cache`.
+///
+/// The key covers everything the `compile` pipeline reads: the Velvet version, the source, the flags and
+/// `CodegenOptions` that change code generation, the standard library snippets and the sources of every external.
+/// An unchanged input can then skip IR generation, optimization and linking.
+pub struct CompileCache {
+    pub key: u64,
+    path: PathBuf,
+}
+
+impl CompileCache {
+    pub fn new(
+        source: &str,
+        do_coerce: bool,
+        inject_stdlib_snippets: bool,
+        codegen_tag: &str,
+        externals: &[String],
+        importer_path: &Path,
+    ) -> Self {
+        let mut hasher = Fnv64::new();
+        hasher.field(env!("CARGO_PKG_VERSION").as_bytes());
+        hasher.field(source.as_bytes());
+        hasher.field(&[do_coerce as u8, inject_stdlib_snippets as u8]);
+        hasher.field(codegen_tag.as_bytes());
+        if inject_stdlib_snippets {
+            for snippet in snippet_sources(&ExecutionTechnique::Compilation) {
+                hasher.field(snippet.as_bytes());
+            }
+        }
+        for external in externals {
+            hasher.field(external.as_bytes());
+            // Externals are rebuilt from their sources on every compile, so a changed external must miss as well
+            if let Ok(SubmoduleFetchResult::Valid { entry, .. }) =
+                try_fetch_submodule(external, importer_path)
+            {
+                for file in [entry.with_file_name("meta.toml"), entry] {
+                    hasher.field(&fs::read(file).unwrap_or_default());
+                }
+            }
+        }
+
+        let key = hasher.0;
+        Self {
+            key,
+            path: Path::new(CACHE_DIR).join(format!("{:016x}", key)),
+        }
+    }
+
+    /// Copies the executable cached under this key to `output`. Returns `false` if there is none.
+    pub fn restore(&self, output: &str) -> bool {
+        self.path.is_file() && fs::copy(&self.path, output).is_ok()
+    }
+
+    /// Keeps a copy of the executable at `output` under this key. A failed store only costs a rebuild next time.
+    pub fn store(&self, output: &str) {
+        if let Err(err) = fs::create_dir_all(CACHE_DIR).and_then(|_| fs::copy(output, &self.path)) {
+            eprintln!("Failed to cache the compiled executable: {}", err);
+        }
+    }
+}
@@ -1,25 +1,41 @@
 use std::{
     collections::HashMap,
     env, fs,
+    path::Path,
     process::{self, Command},
 };
 
 use colored::Colorize;
 use inkwell::{
-    AddressSpace, Either, IntPredicate,
+    AddressSpace, Either, FloatPredicate, IntPredicate,
     builder::Builder,
     context::Context,
-    module::{Linkage, Module},
-    types::{BasicMetadataTypeEnum, BasicType, BasicTypeEnum, IntType},
+    debug_info::{
+        AsDIScope, DICompileUnit, DIFlags, DIFlagsConstants, DWARFEmissionKind,
+        DWARFSourceLanguage, DebugInfoBuilder,
+    },
+    intrinsics::Intrinsic,
+    OptimizationLevel,
+    module::{FlagBehavior, Linkage, Module},
+    passes::PassBuilderOptions,
+    targets::{CodeModel, FileType, InitializationConfig, RelocMode, Target, TargetMachine},
+    types::{ArrayType, BasicMetadataTypeEnum, BasicType, BasicTypeEnum, IntType},
     values::{
-        BasicValue, BasicValueEnum, GlobalValue, InstructionOpcode, InstructionValue, IntValue,
-        PointerValue,
+        BasicValue, BasicValueEnum, FunctionValue, GlobalValue, InstructionOpcode,
+        InstructionValue, IntValue, PointerValue,
     },
 };
 
 use crate::{
-    parser::nodetypes::Node,
-    typecheck::typecheck::{SubmoduleFetchResult, T, TypeChecker, try_fetch_submodule},
+    codegen::jit::in_process_externals,
+    parser::nodetypes::{CallExpr, Node},
+    typecheck::{
+        escape::{ArrayPlan, ArrayStorage},
+        table::TypeTable,
+        typecheck::{
+            SubmoduleFetchResult, T, TypeChecker, array_reduction, range_call, try_fetch_submodule,
+        },
+    },
 };
 
 // TODO ideally move these constants to compiler flags;
@@ -27,6 +43,49 @@ use crate::{
 //      so this will work for development, but should be altered once out of a beta state.
 const CF_DEBUG_MODE: bool = false;
 
+/// How `compile` turns the generated module into machine code.
+pub struct CodegenOptions {
+    /// 0 through 3, as for `opt -O{n}`.
+    pub opt_level: u8,
+    /// Tunes code for the host CPU (`target-cpu=native`) rather than a generic one.
+    pub native_cpu: bool,
+    /// Instruments every call to maintain `__CALL_STACK`; see `IRGenerator::trace_calls`.
+    pub trace_calls: bool,
+    /// Emits DWARF debug info; see `IRGenerator::emit_debug_info`.
+    pub debug_info: bool,
+}
+
+impl CodegenOptions {
+    fn optimization_level(&self) -> OptimizationLevel {
+        match self.opt_level {
+            0 => OptimizationLevel::None,
+            1 => OptimizationLevel::Less,
+            2 => OptimizationLevel::Default,
+            _ => OptimizationLevel::Aggressive,
+        }
+    }
+
+    /// Identifies the options in compile cache keys. A native build also depends on the CPU it was built on.
+    pub fn cache_tag(&self) -> String {
+        let mut tag = if self.native_cpu {
+            format!(
+                "O{} native {}",
+                self.opt_level,
+                TargetMachine::get_host_cpu_name()
+            )
+        } else {
+            format!("O{}", self.opt_level)
+        };
+        if self.trace_calls {
+            tag.push_str(" trace");
+        }
+        if self.debug_info {
+            tag.push_str(" debug");
+        }
+        tag
+    }
+}
+
 #[derive(Clone)]
 struct IRVar<'ctx> {
     pub ptr: PointerValue<'ctx>,
@@ -61,7 +120,7 @@ pub struct IRGenerator<'ctx> {
     pub context: &'ctx Context,
     pub builder: Builder<'ctx>,
     pub module: Module<'ctx>,
-    pub type_table: HashMap<usize, T>,
+    pub type_table: TypeTable,
     checker: TypeChecker,
     variables: Vec<HashMap<String, IRVar<'ctx>>>,
     format_str_int: Option<PointerValue<'ctx>>,
@@ -70,6 +129,16 @@ pub struct IRGenerator<'ctx> {
     externals: Vec<String>,
     external_names_individual: Vec<String>,
     pub external_files: Vec<String>,
+    /// Whether each external is compiled to a `lib*.a` archive for linking. The JIT resolves them in-process instead.
+    pub build_external_archives: bool,
+    /// Whether every call pushes and pops a frame on the `__CALL_STACK` globals, so a program can print its own
+    /// Velvet-level trace. The loads and stores around each call keep LLVM from inlining or register-allocating
+    /// across it, so this is off unless asked for.
+    pub trace_calls: bool,
+    /// Whether the module carries DWARF debug info, which lets native debuggers and profilers symbolize compiled
+    /// frames without any cost at runtime.
+    pub emit_debug_info: bool,
+    debug_info: Option<(DebugInfoBuilder<'ctx>, DICompileUnit<'ctx>)>,
     ext_name_mirrors: HashMap<String, String>,
 
     // call stack stuff
@@ -82,6 +151,12 @@ pub struct IRGenerator<'ctx> {
 
     // analysis stuff
     scope_stack: Vec<ScopeUsage>,
+
+    // array allocation
+    array_plan: ArrayPlan,
+    /// The arena buffer slots of the function being generated, by literal. A slot holds null until its literal first
+    /// runs in a call.
+    arena_slots: Vec<(usize, PointerValue<'ctx>)>,
 }
 
 fn ret_has_value<'ctx>(ret_inst: InstructionValue<'ctx>) -> Option<BasicValueEnum<'ctx>> {
@@ -113,7 +188,7 @@ impl<'ctx> IRGenerator<'ctx> {
         module_name: &str,
         coerce_types: bool,
         checker: TypeChecker,
-        type_table: HashMap<usize, T>,
+        type_table: TypeTable,
         externals: &Vec<String>,
     ) -> Self {
         let module = context.create_module(module_name);
@@ -137,7 +212,13 @@ impl<'ctx> IRGenerator<'ctx> {
             externals: externals.clone(),
             external_names_individual: Vec::new(),
             external_files: Vec::new(),
+            build_external_archives: true,
+            trace_calls: false,
+            emit_debug_info: false,
+            debug_info: None,
             ext_name_mirrors: HashMap::new(),
+            array_plan: ArrayPlan::default(),
+            arena_slots: Vec::new(),
         }
     }
 
@@ -266,30 +347,86 @@ impl<'ctx> IRGenerator<'ctx> {
         None
     }
 
-    /*
-    pub fn emit_object_file(&mut self, output_path: &str) {
-        use inkwell::targets::{FileType, InitializationConfig, Target};
-
-        Target::initialize_all(&InitializationConfig::default());
+    /// Creates a machine for the host's target triple, tuned for a generic CPU or, if `options` ask for it, the
+    /// host's own.
+    pub fn create_target_machine(options: &CodegenOptions) -> TargetMachine {
+        Target::initialize_native(&InitializationConfig::default())
+            .unwrap_or_else(|err| panic!("Failed to initialize the native target: {}", err));
 
         let target_triple = TargetMachine::get_default_triple();
-        let target = Target::from_triple(&target_triple).unwrap();
-        let target_machine = target
+        let target = Target::from_triple(&target_triple).expect("Failed to look up native target");
+        let (cpu, features) = if options.native_cpu {
+            (
+                TargetMachine::get_host_cpu_name().to_string(),
+                TargetMachine::get_host_cpu_features().to_string(),
+            )
+        } else {
+            (String::from("generic"), String::new())
+        };
+
+        target
             .create_target_machine(
                 &target_triple,
-                "generic",
-                "",
-                inkwell::OptimizationLevel::Aggressive,
-                inkwell::targets::RelocMode::Default,
-                inkwell::targets::CodeModel::Default,
+                &cpu,
+                &features,
+                options.optimization_level(),
+                RelocMode::Default,
+                CodeModel::Default,
             )
-            .expect("Failed to create target machine");
+            .expect("Failed to create target machine")
+    }
+
+    /// Runs LLVM's `default<O{n}>` pass pipeline over the module in-process, as `opt -O{n}` would.
+    pub fn optimize(
+        &self,
+        target_machine: &TargetMachine,
+        options: &CodegenOptions,
+    ) -> Result<(), String> {
+        self.module.set_triple(&target_machine.get_triple());
+        self.module
+            .set_data_layout(&target_machine.get_target_data().get_data_layout());
+
+        let pass_options = PassBuilderOptions::create();
+        pass_options.set_verify_each(CF_DEBUG_MODE);
+        self.module
+            .run_passes(
+                &format!("default<O{}>", options.opt_level),
+                target_machine,
+                pass_options,
+            )
+            .map_err(|err| err.to_string())
+    }
 
+    /// Runs the module's `main` on LLVM's MCJIT and returns its result. Externals are bound to their in-process
+    /// builds in `jit.rs`; anything else the module declares, such as `printf`, resolves against the running process.
+    pub fn run_jit(&self, options: &CodegenOptions) -> Result<i32, String> {
+        let engine = self
+            .module
+            .create_jit_execution_engine(options.optimization_level())
+            .map_err(|err| err.to_string())?;
+        for (name, address) in in_process_externals() {
+            if let Some(function) = self.module.get_function(name) {
+                engine.add_global_mapping(&function, address);
+            }
+        }
+
+        unsafe {
+            let main = engine
+                .get_function::<unsafe extern "C" fn() -> i32>("main")
+                .map_err(|err| err.to_string())?;
+            Ok(main.call())
+        }
+    }
+
+    pub fn emit_object_file(
+        &self,
+        target_machine: &TargetMachine,
+        output_path: &str,
+    ) -> Result<(), String> {
         target_machine
             .write_to_file(&self.module, FileType::Object, Path::new(output_path))
-            .expect("Failed to write object file");
+            .map_err(|err| err.to_string())
     }
-    */
 
     fn build_global_string(&mut self, value: &str, name: &str) -> PointerValue<'ctx> {
         let global_str = self
@@ -351,6 +488,150 @@ impl<'ctx> IRGenerator<'ctx> {
         }
     }
 
+    /// `malloc` or `free`, declared on first use.
+    fn get_or_declare_allocator(&mut self, name: &str) -> FunctionValue<'ctx> {
+        if let Some(func) = self.module.get_function(name) {
+            return func;
+        }
+        let ptr_type = self.context.ptr_type(AddressSpace::default());
+        let fn_type = match name {
+            "malloc" => ptr_type.fn_type(&[self.context.i64_type().into()], false),
+            "free" => self.context.void_type().fn_type(&[ptr_type.into()], false),
+            _ => unreachable!(),
+        };
+        self.module.add_function(name, fn_type, None)
+    }
+
+    /// An alloca at the top of the current function's entry block, so one reached by every iteration of a loop
+    /// takes its stack space once rather than on each iteration.
+    fn build_entry_alloca(&self, ty: BasicTypeEnum<'ctx>, name: &str) -> PointerValue<'ctx> {
+        let entry = self
+            .builder
+            .get_insert_block()
+            .unwrap()
+            .get_parent()
+            .unwrap()
+            .get_first_basic_block()
+            .unwrap();
+        let entry_builder = self.context.create_builder();
+        match entry.get_first_instruction() {
+            Some(first) => entry_builder.position_before(&first),
+            None => entry_builder.position_at_end(entry),
+        }
+        entry_builder.build_alloca(ty, name).unwrap()
+    }
+
+    fn build_array_malloc(&mut self, array_type: ArrayType<'ctx>) -> PointerValue<'ctx> {
+        let malloc = self.get_or_declare_allocator("malloc");
+        let size = array_type.size_of().unwrap();
+        self.builder
+            .build_call(malloc, &[size.into()], "heap_arr")
+            .unwrap()
+            .try_as_basic_value()
+            .left()
+            .unwrap()
+            .into_pointer_value()
+    }
+
+    /// Gives each arena literal of `function` (the top level for `None`) a null buffer slot in the entry block of
+    /// the function being generated.
+    fn begin_arenas(&mut self, function: Option<usize>) {
+        let ptr_type = self.context.ptr_type(AddressSpace::default());
+        self.arena_slots = Vec::new();
+        for literal in self.array_plan.arenas(function).to_vec() {
+            let slot = self.build_entry_alloca(ptr_type.into(), "arena_slot");
+            self.builder.build_store(slot, ptr_type.const_null()).unwrap();
+            self.arena_slots.push((literal, slot));
+        }
+    }
+
+    /// Frees the arena buffers of the function being generated, ahead of one of its returns. `free` ignores the null
+    /// slots of literals the call never reached.
+    fn free_arenas(&mut self) {
+        if self.arena_slots.is_empty() {
+            return;
+        }
+        let free = self.get_or_declare_allocator("free");
+        let ptr_type = self.context.ptr_type(AddressSpace::default());
+        for (_, slot) in self.arena_slots.clone() {
+            let buffer = self
+                .builder
+                .build_load(ptr_type, slot, "arena_buf")
+                .unwrap();
+            self.builder
+                .build_call(free, &[buffer.into()], "")
+                .unwrap();
+        }
+    }
+
+    /// Starts the module's DWARF compile unit, for the source file the module is named after.
+    fn begin_debug_info(&mut self) {
+        let module_name = self.module.get_name().to_str().unwrap().to_string();
+        let source_path = Path::new(&module_name);
+        let file_name = source_path
+            .file_name()
+            .map_or(module_name.clone(), |name| name.to_string_lossy().to_string());
+        let directory = source_path
+            .parent()
+            .filter(|dir| !dir.as_os_str().is_empty())
+            .map_or_else(|| env::current_dir().unwrap(), Path::to_path_buf);
+
+        self.module.add_basic_value_flag(
+            "Debug Info Version",
+            FlagBehavior::Warning,
+            self.context.i32_type().const_int(3, false),
+        );
+        self.debug_info = Some(self.module.create_debug_info_builder(
+            true,
+            DWARFSourceLanguage::C,
+            &file_name,
+            directory.to_str().unwrap(),
+            "velvet",
+            false,
+            "",
+            0,
+            "",
+            DWARFEmissionKind::Full,
+            0,
+            false,
+            false,
+            "",
+            "",
+        ));
+    }
+
+    /// Gives `function` a DWARF subprogram and points the builder's debug location into it. Nodes don't carry source
+    /// positions, so every instruction of a function is attributed to the line it is defined on.
+    fn attach_debug_info(&self, function: FunctionValue<'ctx>, line: usize) {
+        let Some((dibuilder, compile_unit)) = &self.debug_info else {
+            return;
+        };
+        let file = compile_unit.get_file();
+        let subroutine_type = dibuilder.create_subroutine_type(file, None, &[], DIFlags::PUBLIC);
+        let subprogram = dibuilder.create_function(
+            compile_unit.as_debug_info_scope(),
+            function.get_name().to_str().unwrap(),
+            None,
+            file,
+            line as u32,
+            subroutine_type,
+            function.get_linkage() == Linkage::Internal,
+            true,
+            line as u32,
+            DIFlags::PUBLIC,
+            false,
+        );
+        function.set_subprogram(subprogram);
+        let location = dibuilder.create_debug_location(
+            self.context,
+            line as u32,
+            0,
+            subprogram.as_debug_info_scope(),
+            None,
+        );
+        self.builder.set_current_debug_location(location);
+    }
+
     fn get_or_declare_external(
         &mut self,
         external: String,
@@ -456,6 +737,7 @@ impl<'ctx> IRGenerator<'ctx> {
             T::Integer32 => self.context.i32_type().into(),
             T::Integer64 => self.context.i64_type().into(),
             T::Integer128 => self.context.i128_type().into(),
+            T::Float64 => self.context.f64_type().into(),
             T::Boolean => self.context.bool_type().into(),
             T::String => self.context.ptr_type(AddressSpace::default()).into(),
             T::Array {
@@ -485,7 +767,11 @@ impl<'ctx> IRGenerator<'ctx> {
         self.format_str_int = Some(self.build_global_format_string("format_str_int", "%lld\n"));
         self.format_str_str = Some(self.build_global_format_string("format_str_str", "%s\n"));
 
-        if CF_DEBUG_MODE {
+        if self.emit_debug_info {
+            self.begin_debug_info();
+        }
+
+        if self.trace_calls {
             // Call stack
             // %CallFrame
             let i32_type = self.context.i32_type();
@@ -522,26 +808,28 @@ impl<'ctx> IRGenerator<'ctx> {
             match bound {
                 SubmoduleFetchResult::Valid { meta, entry } => {
                     self.external_files.push(meta.name.clone());
-                    // compile Rust file to staticlib (.a)
-                    let output_archive_path = format!("velvet_tmp/std/lib{}.a", meta.name);
-                    let status = Command::new("rustc")
-                        .arg("-Awarnings")
-                        .arg("--crate-type=staticlib")
-                        .arg("-C")
-                        .arg("link-dead-code")
-                        .arg("-C")
-                        .arg("codegen-units=1")
-                        .arg(entry.to_str().unwrap())
-                        .arg("-o")
-                        .arg(&output_archive_path)
-                        .status()
-                        .expect("Failed to compile Rust external to staticlib");
-
-                    if !status.success() {
-                        panic!("rustc failed to compile external function: {}", meta.name);
-                    }
+                    if self.build_external_archives {
+                        // compile Rust file to staticlib (.a)
+                        let output_archive_path = format!("velvet_tmp/std/lib{}.a", meta.name);
+                        let status = Command::new("rustc")
+                            .arg("-Awarnings")
+                            .arg("--crate-type=staticlib")
+                            .arg("-C")
+                            .arg("link-dead-code")
+                            .arg("-C")
+                            .arg("codegen-units=1")
+                            .arg(entry.to_str().unwrap())
+                            .arg("-o")
+                            .arg(&output_archive_path)
+                            .status()
+                            .expect("Failed to compile Rust external to staticlib");
+
+                        if !status.success() {
+                            panic!("rustc failed to compile external function: {}", meta.name);
+                        }
 
-                    println!("write -> {}", output_archive_path);
+                        println!("write -> {}", output_archive_path);
+                    }
                     for sub_module in &meta.submod {
                         let mut name_to_use = sub_module.name.clone();
                         if sub_module.name_mirror.is_some() {
@@ -566,6 +854,9 @@ impl<'ctx> IRGenerator<'ctx> {
         let function = self.module.add_function("main", fn_type, None);
         let entry_block = self.context.append_basic_block(function, "entry");
         self.builder.position_at_end(entry_block);
+        self.attach_debug_info(function, 0);
+        self.array_plan = ArrayPlan::analyze(&nodes, &mut self.type_table);
+        self.begin_arenas(None);
 
         let mut last_val = Some(i64_type.const_int(0, false).into());
 
@@ -574,6 +865,7 @@ impl<'ctx> IRGenerator<'ctx> {
         }
 
         self.exit_scope();
+        self.free_arenas();
 
         let return_type = self.context.i32_type();
 
@@ -603,6 +895,10 @@ impl<'ctx> IRGenerator<'ctx> {
             self.builder.build_return(Some(&zero)).unwrap();
         }
 
+        if let Some((dibuilder, _)) = &self.debug_info {
+            dibuilder.finalize();
+        }
+
         self.unwind_warning_stack();
         if !self.error_stack.is_empty() {
             self.unwind_error_stack();
@@ -611,6 +907,67 @@ impl<'ctx> IRGenerator<'ctx> {
         true
     }
 
+    /// One of `ARRAY_REDUCTIONS`. The array's length is known from its type, so its elements load as a single
+    /// `<N x iK>` vector and reduce with the `llvm.vector.reduce.*` intrinsics, which the backend lowers to SIMD.
+    fn generate_array_reduction(&mut self, cexpr: &CallExpr) -> Option<BasicValueEnum<'ctx>> {
+        let (method, receiver) = array_reduction(cexpr).unwrap();
+        let Node::MemberExpr(callee) = cexpr.caller.as_ref() else {
+            unreachable!();
+        };
+        let Some(T::Array {
+            array_t,
+            element_count,
+            ..
+        }) = self.type_table.get(&callee.id.unwrap()).cloned()
+        else {
+            panic!("`{}` called on a non-array value", method);
+        };
+        let element_type = self.t_to_llvm_type(&array_t).into_int_type();
+        let vector_type = element_type.vec_type(element_count as u32);
+
+        let load_vector = |this: &mut Self, array: &Node| {
+            let array_ptr = this
+                .generate_ir_for_expr(array)
+                .unwrap()
+                .into_pointer_value();
+            let vector = this
+                .builder
+                .build_load(vector_type, array_ptr, "array_vec")
+                .unwrap();
+            // The array is only aligned to its elements, not to the whole vector
+            vector
+                .as_instruction_value()
+                .unwrap()
+                .set_alignment(element_type.get_bit_width() / 8)
+                .unwrap();
+            vector.into_vector_value()
+        };
+        let mut vector = load_vector(self, receiver);
+        if method == "dot" {
+            let other = load_vector(self, &cexpr.args[0]);
+            vector = self
+                .builder
+                .build_int_mul(vector, other, "dot_products")
+                .unwrap();
+        }
+
+        let intrinsic = match method {
+            "sum" | "dot" => "llvm.vector.reduce.add",
+            "min" => "llvm.vector.reduce.smin",
+            "max" => "llvm.vector.reduce.smax",
+            _ => unreachable!(),
+        };
+        let reduce = Intrinsic::find(intrinsic)
+            .unwrap()
+            .get_declaration(&self.module, &[vector_type.into()])
+            .unwrap();
+        self.builder
+            .build_call(reduce, &[vector.into()], method)
+            .unwrap()
+            .try_as_basic_value()
+            .left()
+    }
+
     pub fn generate_ir_for_expr(&mut self, node: &Node) -> Option<BasicValueEnum<'ctx>> {
         // println!("Generating IR for {:?}", node);
         match node {
@@ -622,8 +979,12 @@ impl<'ctx> IRGenerator<'ctx> {
             Node::NumericLiteral(n) => {
                 let inferred_ty = self.type_table.get(&n.id.unwrap()).unwrap().clone();
 
-                let parsed_val = n.literal_value.parse::<u64>().unwrap();
+                // Folded constants may be negative; `const_int` truncates the two's complement to the type's width.
+                let parsed_val = n.value as u64;
                 let base_type = self.t_to_llvm_type(&inferred_ty);
+                if inferred_ty == T::Float64 {
+                    return Some(base_type.into_float_type().const_float(n.value as f64).into());
+                }
                 Some(
                     base_type
                         .into_int_type()
@@ -631,6 +992,7 @@ impl<'ctx> IRGenerator<'ctx> {
                         .into(),
                 )
             }
+            Node::FloatLiteral(f) => Some(self.context.f64_type().const_float(f.value).into()),
             Node::BoolLiteral(b) => Some(
                 self.context
                     .bool_type()
@@ -646,20 +1008,17 @@ impl<'ctx> IRGenerator<'ctx> {
                     .generate_ir_for_expr(&mem.property)
                     .unwrap()
                     .into_int_value();
+                let element_t = self.type_table.get(&mem.id.unwrap()).unwrap().clone();
+                let element_type = self.t_to_llvm_type(&element_t);
 
                 let ptr = unsafe {
                     self.builder
-                        .build_gep(
-                            self.context.i32_type().array_type(3),
-                            array_ptr,
-                            &[self.context.i32_type().const_int(0, false), index_val],
-                            "elem_ptr",
-                        )
+                        .build_gep(element_type, array_ptr, &[index_val], "elem_ptr")
                         .unwrap()
                 };
 
                 self.builder
-                    .build_load(self.context.i32_type(), ptr, "elem_val")
+                    .build_load(element_type, ptr, "elem_val")
                     .unwrap()
                     .into()
             }
@@ -710,6 +1069,17 @@ impl<'ctx> IRGenerator<'ctx> {
 
                         if target_llvm_type == src_type.into() {
                             Some(int_val.into())
+                        } else if target_llvm_type.is_float_type() {
+                            Some(
+                                self.builder
+                                    .build_signed_int_to_float(
+                                        int_val,
+                                        target_llvm_type.into_float_type(),
+                                        "sitofp_cast",
+                                    )
+                                    .unwrap()
+                                    .into(),
+                            )
                         } else if target_llvm_type.is_int_type() {
                             let dst_int_type = target_llvm_type.into_int_type();
 
@@ -733,6 +1103,28 @@ impl<'ctx> IRGenerator<'ctx> {
                             Some(expr_val)
                         }
                     }
+                    BasicValueEnum::FloatValue(float_val) => {
+                        if target_llvm_type.is_float_type() {
+                            Some(float_val.into())
+                        } else if target_llvm_type.is_int_type() {
+                            Some(
+                                self.builder
+                                    .build_float_to_signed_int(
+                                        float_val,
+                                        target_llvm_type.into_int_type(),
+                                        "fptosi_cast",
+                                    )
+                                    .unwrap()
+                                    .into(),
+                            )
+                        } else {
+                            self.compiler_error(
+                                &format!("Cannot cast float to non-numeric type {:?}", target_type_str),
+                                false,
+                            );
+                            Some(expr_val)
+                        }
+                    }
                     _ => {
                         self.compiler_error(
                             "Typecasting is only supported for int values during compilation at the moment\n-> help: maybe use the interpreter instead?",
@@ -746,6 +1138,7 @@ impl<'ctx> IRGenerator<'ctx> {
                 let sub = self
                     .generate_ir_for_expr(&r.return_statement)
                     .expect("Expeted return statement to return a value.");
+                self.free_arenas();
                 self.builder.build_return(Some(&sub)).unwrap();
                 None
             }
@@ -764,6 +1157,10 @@ impl<'ctx> IRGenerator<'ctx> {
                 let entry_block = self.context.append_basic_block(func, "entry");
 
                 self.builder.position_at_end(entry_block);
+                let outer_debug_location = self.builder.get_current_debug_location();
+                self.attach_debug_info(func, fd.line);
+                let outer_arena_slots = std::mem::take(&mut self.arena_slots);
+                self.begin_arenas(fd.id);
 
                 // Set params
                 for (i, (name, ty)) in fd.params.iter().enumerate() {
@@ -814,6 +1211,10 @@ impl<'ctx> IRGenerator<'ctx> {
                     self.builder.build_unreachable().unwrap();
                 }
                 self.exit_scope();
+                self.arena_slots = outer_arena_slots;
+                if let Some(location) = outer_debug_location {
+                    self.builder.set_current_debug_location(location);
+                }
 
                 let main_fn = self.module.get_function("main").unwrap();
                 let main_entry = main_fn.get_first_basic_block().unwrap();
@@ -918,6 +1319,16 @@ impl<'ctx> IRGenerator<'ctx> {
                         };
                         Some(val.unwrap().into())
                     }
+                    (Some(BasicValueEnum::FloatValue(l)), Some(BasicValueEnum::FloatValue(r))) => {
+                        let val = match bin_op.op.as_str() {
+                            "+" => self.builder.build_float_add(l, r, "faddtmp"),
+                            "-" => self.builder.build_float_sub(l, r, "fsubtmp"),
+                            "*" => self.builder.build_float_mul(l, r, "fmultmp"),
+                            "/" => self.builder.build_float_div(l, r, "fdivtmp"),
+                            _ => unimplemented!(),
+                        };
+                        Some(val.unwrap().into())
+                    }
                     _ => {
                         self.compiler_error(
                             &format!(
@@ -968,7 +1379,7 @@ impl<'ctx> IRGenerator<'ctx> {
                     // Yes I know it's weird
                     match ident.identifier_name.as_str() {
                         "__CALL_STACK" => {
-                            if !CF_DEBUG_MODE {
+                            if !self.trace_calls {
                                 // Call stack doesn't exist if this branch is reached
                                 return None;
                             }
@@ -1094,6 +1505,9 @@ impl<'ctx> IRGenerator<'ctx> {
                 }
             }
 
+            Node::CallExpr(cexpr) if array_reduction(cexpr).is_some() => {
+                self.generate_array_reduction(cexpr)
+            }
             Node::CallExpr(cexpr) => {
                 let function_name = match *cexpr.caller {
                     Node::Identifier(ref ident) => ident.identifier_name.clone(),
@@ -1103,7 +1517,7 @@ impl<'ctx> IRGenerator<'ctx> {
                     ),
                 };
 
-                if CF_DEBUG_MODE {
+                if self.trace_calls {
                     let csp = self.call_stack_ptr.expect("CSP not initialized correctly");
                     let cs = self.call_stack.expect("CS not initialized correctly");
 
@@ -1201,7 +1615,7 @@ impl<'ctx> IRGenerator<'ctx> {
                     let call_site = self.builder.build_call(func, &args, "calltmp").unwrap();
 
                     // Pop call stack
-                    if CF_DEBUG_MODE {
+                    if self.trace_calls {
                         let csp = self.call_stack_ptr.expect("CSP not initialized correctly");
 
                         let curr_ptr_val = self
@@ -1299,6 +1713,95 @@ impl<'ctx> IRGenerator<'ctx> {
 
                 None
             }
+            Node::Iterator(it) => {
+                // `for i of range(start, end, step)` as a counted loop over an i32 counter; nothing is allocated
+                let bounds = range_call(&it.right)
+                    .expect("compiled `for` loops can only iterate over `range(...)`");
+                let i32_type = self.context.i32_type();
+                let mut bound_vals = vec![];
+                for bound in bounds {
+                    bound_vals.push(self.generate_ir_for_expr(bound).unwrap().into_int_value());
+                }
+                let (start, end, step) = match bound_vals[..] {
+                    [end] => (i32_type.const_zero(), end, i32_type.const_int(1, false)),
+                    [start, end] => (start, end, i32_type.const_int(1, false)),
+                    [start, end, step] => (start, end, step),
+                    _ => unreachable!(),
+                };
+
+                let parent_func = self
+                    .builder
+                    .get_insert_block()
+                    .unwrap()
+                    .get_parent()
+                    .unwrap();
+
+                let cond_block = self.context.append_basic_block(parent_func, "rcnd");
+                let body_block = self.context.append_basic_block(parent_func, "rbdy");
+                let step_block = self.context.append_basic_block(parent_func, "rstp");
+                let end_block = self.context.append_basic_block(parent_func, "rend");
+
+                let counter = self
+                    .builder
+                    .build_alloca(i32_type, &it.left.literal_value)
+                    .unwrap();
+                self.builder.build_store(counter, start).unwrap();
+                self.builder.build_unconditional_branch(cond_block).unwrap();
+
+                // Counting up stops at `end` from below, counting down from above; LLVM folds the select away
+                // for a constant step
+                self.builder.position_at_end(cond_block);
+                let current = self
+                    .builder
+                    .build_load(i32_type, counter, "rcur")
+                    .unwrap()
+                    .into_int_value();
+                let counts_up = self
+                    .builder
+                    .build_int_compare(IntPredicate::SGT, step, i32_type.const_zero(), "rup")
+                    .unwrap();
+                let below_end = self
+                    .builder
+                    .build_int_compare(IntPredicate::SLT, current, end, "rblw")
+                    .unwrap();
+                let above_end = self
+                    .builder
+                    .build_int_compare(IntPredicate::SGT, current, end, "rabv")
+                    .unwrap();
+                let condition = self
+                    .builder
+                    .build_select(counts_up, below_end, above_end, "rcnd_cmp")
+                    .unwrap();
+                self.builder
+                    .build_conditional_branch(condition.into_int_value(), body_block, end_block)
+                    .unwrap();
+
+                self.builder.position_at_end(body_block);
+                self.enter_scope();
+                self.declare_variable(&it.left.literal_value, counter, i32_type.into(), false);
+                for stmt in &it.body {
+                    self.generate_ir_for_expr(stmt);
+                }
+                self.exit_scope();
+                self.builder.build_unconditional_branch(step_block).unwrap();
+
+                self.builder.position_at_end(step_block);
+                let current = self
+                    .builder
+                    .build_load(i32_type, counter, "rcur")
+                    .unwrap()
+                    .into_int_value();
+                let next = self
+                    .builder
+                    .build_int_add(current, step, "rnxt")
+                    .unwrap();
+                self.builder.build_store(counter, next).unwrap();
+                self.builder.build_unconditional_branch(cond_block).unwrap();
+
+                self.builder.position_at_end(end_block);
+
+                None
+            }
             Node::Comparator(comp) => {
                 let left = self.generate_ir_for_expr(&comp.lhs);
                 let right = self.generate_ir_for_expr(&comp.rhs);
@@ -1339,6 +1842,22 @@ impl<'ctx> IRGenerator<'ctx> {
 
                         Some(val.into())
                     }
+                    (Some(BasicValueEnum::FloatValue(l)), Some(BasicValueEnum::FloatValue(r))) => {
+                        // Ordered predicates, so comparisons with NaN are false except `!=`
+                        let predicate = match comp.op.as_str() {
+                            "==" => FloatPredicate::OEQ,
+                            "!=" => FloatPredicate::UNE,
+                            ">" => FloatPredicate::OGT,
+                            "<" => FloatPredicate::OLT,
+                            _ => unimplemented!(),
+                        };
+                        Some(
+                            self.builder
+                                .build_float_compare(predicate, l, r, "fcmptmp")
+                                .unwrap()
+                                .into(),
+                        )
+                    }
                     _ => panic!(
                         "Cannot perform operation `{}` on `{:?}` and `{:?}`",
                         comp.op, left, right
@@ -1346,34 +1865,107 @@ impl<'ctx> IRGenerator<'ctx> {
                 }
             }
             Node::ListLiteral(llit) => {
-                let i32_type = self.context.i32_type();
-
-                let mut const_vals = vec![];
+                let id = llit.id.unwrap();
+                let Some(T::Array { array_t, .. }) = self.type_table.get(&id).cloned() else {
+                    panic!("List literal was not typed as an array");
+                };
+                let element_type = self.t_to_llvm_type(&array_t);
+                let array_type = element_type.array_type(llit.props.len() as u32);
 
+                let mut vals = vec![];
                 for elem in &llit.props {
-                    let val = self.generate_ir_for_expr(elem)?;
-                    match val {
-                        BasicValueEnum::IntValue(int_val) => const_vals.push(int_val),
-                        _ => panic!("Only int arrays are supported for now"),
-                    }
+                    vals.push(self.generate_ir_for_expr(elem)?);
                 }
 
-                let llvm_array = i32_type.const_array(&const_vals);
-                let global = self.module.add_global(llvm_array.get_type(), None, "arr");
-                global.set_initializer(&llvm_array);
-                global.set_constant(true);
-
-                let gep = unsafe {
-                    global.as_pointer_value().const_gep(
-                        self.context.i64_type(),
-                        &[
-                            self.context.i64_type().const_zero(),
-                            self.context.i64_type().const_zero(),
-                        ],
-                    )
+                let array_ptr = match self.array_plan.storage(id) {
+                    ArrayStorage::Stack => self.build_entry_alloca(array_type.into(), "arr"),
+                    ArrayStorage::Global => {
+                        let global = self.module.add_global(array_type, None, "arr");
+                        global.set_initializer(&array_type.const_zero());
+                        global.as_pointer_value()
+                    }
+                    ArrayStorage::Escaping => {
+                        self.compiler_error(
+                            "Cannot compile an array literal that outlives the function building it, which compiled code could never free.\nhelp: only index or reduce the array, pass it to functions that do the same or to externals, build it once at the top level, or make its elements constants",
+                            true,
+                        );
+                        panic!();
+                    }
+                    ArrayStorage::Constant => {
+                        let constant = match element_type {
+                            BasicTypeEnum::IntType(int_type) => int_type.const_array(
+                                &vals.iter().map(|val| val.into_int_value()).collect::<Vec<_>>(),
+                            ),
+                            BasicTypeEnum::FloatType(float_type) => float_type.const_array(
+                                &vals
+                                    .iter()
+                                    .map(|val| val.into_float_value())
+                                    .collect::<Vec<_>>(),
+                            ),
+                            _ => panic!("Constant arrays hold numbers or booleans"),
+                        };
+                        let global = self.module.add_global(array_type, None, "arr");
+                        global.set_initializer(&constant);
+                        global.set_constant(true);
+                        return Some(global.as_pointer_value().into());
+                    }
+                    ArrayStorage::Arena => {
+                        // The buffer is allocated by the first run of a call and reused by the runs after it
+                        let slot = self
+                            .arena_slots
+                            .iter()
+                            .find(|(literal, _)| *literal == id)
+                            .unwrap()
+                            .1;
+                        let ptr_type = self.context.ptr_type(AddressSpace::default());
+                        let parent_func = self
+                            .builder
+                            .get_insert_block()
+                            .unwrap()
+                            .get_parent()
+                            .unwrap();
+                        let alloc_block = self.context.append_basic_block(parent_func, "arena_alloc");
+                        let ready_block = self.context.append_basic_block(parent_func, "arena_ready");
+
+                        let buffer = self
+                            .builder
+                            .build_load(ptr_type, slot, "arena_buf")
+                            .unwrap()
+                            .into_pointer_value();
+                        let unset = self.builder.build_is_null(buffer, "arena_unset").unwrap();
+                        self.builder
+                            .build_conditional_branch(unset, alloc_block, ready_block)
+                            .unwrap();
+
+                        self.builder.position_at_end(alloc_block);
+                        let fresh = self.build_array_malloc(array_type);
+                        self.builder.build_store(slot, fresh).unwrap();
+                        self.builder.build_unconditional_branch(ready_block).unwrap();
+
+                        self.builder.position_at_end(ready_block);
+                        self.builder
+                            .build_load(ptr_type, slot, "arena_arr")
+                            .unwrap()
+                            .into_pointer_value()
+                    }
                 };
 
-                Some(gep.into())
+                let i64_type = self.context.i64_type();
+                for (index, val) in vals.into_iter().enumerate() {
+                    let elem_ptr = unsafe {
+                        self.builder
+                            .build_in_bounds_gep(
+                                array_type,
+                                array_ptr,
+                                &[i64_type.const_zero(), i64_type.const_int(index as u64, false)],
+                                "arr_elem",
+                            )
+                            .unwrap()
+                    };
+                    self.builder.build_store(elem_ptr, val).unwrap();
+                }
+
+                Some(array_ptr.into())
             }
             Node::AssignmentExpr(a) => {
                 let var = match a.left.as_ref() {
@@ -1401,7 +1993,11 @@ impl<'ctx> IRGenerator<'ctx> {
             }
 
             Node::MatchExpr(mexpr) => {
-                let target_val = self.generate_ir_for_expr(&mexpr.target).unwrap();
+                let target_val = self
+                    .generate_ir_for_expr(&mexpr.target)
+                    .unwrap()
+                    .into_int_value();
+                let target_type = target_val.get_type();
                 let parent_func = self
                     .builder
                     .get_insert_block()
@@ -1411,61 +2007,60 @@ impl<'ctx> IRGenerator<'ctx> {
 
                 let end_block = self.context.append_basic_block(parent_func, "match_end");
 
+                // The arms become the cases of a single `switch`, which LLVM lowers to a jump table, a binary
+                // search or a bit test as the values allow. A repeated value would make the switch invalid, and its
+                // later arms could never be taken anyway.
+                let mut seen = Vec::new();
                 let mut cases = vec![];
-                let mut case_blocks = vec![];
-
-                for (i, (pat, _)) in mexpr.arms.iter().enumerate() {
-                    let const_val = match pat {
-                        Node::NumericLiteral(i) => self
-                            .context
-                            .i32_type()
-                            .const_int(i.literal_value.parse::<u64>().unwrap(), false),
-                        _ => panic!("Only integer patterns are supported in match"),
+                let mut case_arms = vec![];
+                for (i, (pat, body)) in mexpr.arms.iter().enumerate() {
+                    let value = match pat {
+                        Node::NumericLiteral(nl) => nl.value,
+                        Node::BoolLiteral(b) => b.literal_value as i128,
+                        _ => panic!("Only integer and bool literal patterns are supported in match"),
                     };
+                    if seen.contains(&value) {
+                        continue;
+                    }
+                    seen.push(value);
 
                     let block_name = format!("match_case_{}", i);
                     let case_block = self.context.append_basic_block(parent_func, &block_name);
 
-                    cases.push((const_val, case_block));
-                    case_blocks.push(case_block);
+                    cases.push((target_type.const_int(value as u64, false), case_block));
+                    case_arms.push((body, case_block));
                 }
-                let mut incoming_vals = vec![];
 
                 let default_block = self
                     .context
                     .append_basic_block(parent_func, "match_default");
 
                 self.builder
-                    .build_switch(target_val.into_int_value(), default_block, &cases)
+                    .build_switch(target_val, default_block, &cases)
                     .unwrap();
 
-                self.builder.position_at_end(default_block);
-                self.builder.build_unconditional_branch(end_block).unwrap();
-                incoming_vals.push((
-                    Some(self.context.i32_type().const_zero().as_basic_value_enum()),
-                    default_block,
-                ));
-
-                for ((_, body), case_block) in mexpr.arms.iter().zip(case_blocks) {
+                let mut incoming_vals = vec![];
+                for (body, case_block) in case_arms {
                     self.builder.position_at_end(case_block);
                     self.enter_scope();
-                    let val = self.generate_ir_for_expr(body);
+                    let val = self.generate_ir_for_expr(body).unwrap();
                     self.exit_scope();
 
+                    // The body may have branched into blocks of its own
+                    let exit_block = self.builder.get_insert_block().unwrap();
                     self.builder.build_unconditional_branch(end_block).unwrap();
-                    incoming_vals.push((val, case_block));
+                    incoming_vals.push((val, exit_block));
                 }
 
-                self.builder.position_at_end(end_block);
+                let phi_type = incoming_vals[0].0.get_type();
+                self.builder.position_at_end(default_block);
+                self.builder.build_unconditional_branch(end_block).unwrap();
+                incoming_vals.push((phi_type.const_zero(), default_block));
 
-                let phi_type = self
-                    .generate_ir_for_expr(&mexpr.arms[0].1)
-                    .unwrap()
-                    .get_type();
+                self.builder.position_at_end(end_block);
                 let phi = self.builder.build_phi(phi_type, "match_result").unwrap();
-
                 for (val, block) in incoming_vals {
-                    phi.add_incoming(&[(&val.unwrap(), block)]);
+                    phi.add_incoming(&[(&val, block)]);
                 }
 
                 Some(phi.as_basic_value())
@@ -0,0 +1,90 @@
+use std::{
+    ffi::{CStr, c_char},
+    io::{self, IsTerminal, Write},
+    sync::{
+        Mutex, Once,
+        atomic::{AtomicBool, Ordering},
+    },
+};
+
+// In-process builds of the externals in `src/stdlib_comp/externals`, for programs run with `jit`. They mirror the
+// versions compiled into `lib*.a` archives for `compile`, which the JIT has no linker to pull in, output buffer
+// included: it is written out at the end of every line on a terminal, once `BUFFER_SIZE` bytes have built up
+// otherwise, on `write`, and at exit.
+
+const BUFFER_SIZE: usize = 64 * 1024;
+
+static BUFFER: Mutex<Vec<u8>> = Mutex::new(Vec::new());
+static LINE_BUFFERED: AtomicBool = AtomicBool::new(false);
+static SETUP: Once = Once::new();
+
+unsafe extern "C" {
+    fn atexit(callback: extern "C" fn()) -> i32;
+}
+
+extern "C" fn flush_at_exit() {
+    let mut buffer = BUFFER
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    let _ = flush(&mut buffer);
+}
+
+fn flush(buffer: &mut Vec<u8>) -> io::Result<()> {
+    let mut out = io::stdout().lock();
+    let written = out.write_all(buffer).and_then(|_| out.flush());
+    buffer.clear();
+    written
+}
+
+fn write_out(text: &[u8], newline: bool, flush_now: bool) {
+    SETUP.call_once(|| {
+        LINE_BUFFERED.store(io::stdout().is_terminal(), Ordering::Relaxed);
+        unsafe {
+            atexit(flush_at_exit);
+        }
+    });
+    let mut buffer = BUFFER.lock().unwrap();
+    let start = buffer.len();
+    buffer.extend_from_slice(text);
+    if newline {
+        buffer.push(b'\n');
+    }
+    let due = if LINE_BUFFERED.load(Ordering::Relaxed) {
+        buffer[start..].contains(&b'\n')
+    } else {
+        buffer.len() >= BUFFER_SIZE
+    };
+    if flush_now || due {
+        flush(&mut buffer).unwrap();
+    }
+}
+
+unsafe extern "C" fn vel_write(a: *const c_char) {
+    if a.is_null() {
+        return;
+    }
+    write_out(unsafe { CStr::from_ptr(a) }.to_bytes(), false, true);
+}
+
+unsafe extern "C" fn vel_write_no_flush(a: *const c_char) {
+    if a.is_null() {
+        return;
+    }
+    write_out(unsafe { CStr::from_ptr(a) }.to_bytes(), false, false);
+}
+
+unsafe extern "C" fn vel_print(a: *const c_char) {
+    if a.is_null() {
+        return;
+    }
+    write_out(unsafe { CStr::from_ptr(a) }.to_bytes(), true, false);
+}
+
+/// The symbol names the IR generator declares for externals, with the address of their in-process build.
+pub fn in_process_externals() -> [(&'static str, usize); 3] {
+    [
+        ("vel_write", vel_write as usize),
+        ("vel_write_no_flush", vel_write_no_flush as usize),
+        ("vel_print", vel_print as usize),
+    ]
+}
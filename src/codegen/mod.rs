@@ -1 +1,3 @@
+pub mod cache;
 pub mod codegen;
+pub mod jit;
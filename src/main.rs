@@ -1,8 +1,16 @@
 use colored::Colorize;
 
+use crate::bench::{BenchBackend, BenchOptions};
+use crate::serve::{ServeOptions, Server};
 use crate::parser::parser::ExecutionTechnique;
+use crate::runtime::profiler::CountingAllocator;
 use crate::runtime::source_environment::source_environment::SourceEnv;
+use crate::runtime::vm::{compiler::BytecodeCompiler, machine::VirtualMachine};
+use crate::codegen::codegen::CodegenOptions;
+use crate::typecheck::cache::TypecheckCache;
 use crate::typecheck::typecheck::TypeChecker;
+use crate::stdlib_interp::io::flush_output;
+use crate::stdlib_interp::task;
 use crate::{
     parser::{nodetypes::Node, parser::Parser},
     runtime::interpreter::Interpreter,
@@ -12,17 +20,22 @@ use std::fs::{self};
 use std::path::Path;
 use std::process::Command;
 use std::time::Instant;
-use std::{env, process};
+use std::{env, panic, process};
 
+mod bench;
 mod codegen;
 mod parser;
 mod runtime;
+mod serve;
 mod tokenizer;
 mod typecheck;
 #[macro_use]
 mod stdlib_interp;
 mod tests;
 
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
 fn print_node(node: &Node, depth: usize) {
     let indent = "    ".repeat(depth);
 
@@ -35,6 +48,9 @@ fn print_node(node: &Node, depth: usize) {
         Node::NumericLiteral(n) => {
             println!("{}->NumericLiteral: {}", indent, n.literal_value);
         }
+        Node::FloatLiteral(n) => {
+            println!("{}->FloatLiteral: {}", indent, n.literal_value);
+        }
         Node::BinaryExpr(b) => {
             println!("{}->BinaryExpr: op '{}'", indent, b.op);
             println!("{}  left:", indent);
@@ -98,10 +114,45 @@ fn print_node(node: &Node, depth: usize) {
 }
 
 fn main() {
+    // Internal functions raise errors by panicking; what the program printed before one still belongs on stdout
+    let default_hook = panic::take_hook();
+    panic::set_hook(Box::new(move |info| {
+        flush_output();
+        default_hook(info);
+    }));
+
     let args: Vec<String> = env::args().collect();
 
     if args.len() == 1 {
-        panic!("The Velvet REPL is not released yet! Please provide a file to execute.")
+        panic!("The Velvet REPL is not released yet! Please provide a file to execute, or `serve` to run scripts sent over stdin.")
+    }
+
+    // Keeps the standard library warm and runs the scripts sent to it, until its input ends
+    if args[1].to_lowercase() == "serve" {
+        // Scripts' panics are reported in their responses
+        serve::quiet_script_panics();
+        let mut server = Server::new(ServeOptions {
+            inject_stdlib_snippets: !args
+                .iter()
+                .any(|p| *p.to_lowercase() == *"no_stdlib_snippets"),
+            sandboxed: args.iter().any(|p| *p.to_lowercase() == *"sandbox"),
+            use_vm: args.iter().any(|p| *p.to_lowercase() == *"vm"),
+        });
+        let socket_path = args
+            .iter()
+            .find_map(|p| p.strip_prefix("serve-socket=").map(str::to_string));
+        let served = match socket_path {
+            #[cfg(unix)]
+            Some(path) => server.serve_socket(&path),
+            #[cfg(not(unix))]
+            Some(_) => panic!("`serve-socket` needs Unix domain sockets, which this platform lacks"),
+            None => server.serve(std::io::stdin(), std::io::stdout()),
+        };
+        if let Err(err) = served {
+            eprintln!("serve: {}", err);
+            process::exit(1);
+        }
+        return;
     }
 
     let file_path = args[1].clone();
@@ -118,19 +169,78 @@ fn main() {
 
     let do_coerce = args.iter().any(|p| *p.to_lowercase() == *"cmp-do-coerce");
 
+    let use_compile_cache = !args.iter().any(|p| *p.to_lowercase() == *"cmp-no-cache");
+
+    let emit_ir = args.iter().any(|p| *p.to_lowercase() == *"cmp-emit-ir");
+
+    let codegen_options = CodegenOptions {
+        opt_level: args
+            .iter()
+            .find_map(|p| {
+                let level = p.to_lowercase().strip_prefix("cmp-opt=")?.to_string();
+                Some(level.parse::<u8>().ok().filter(|l| *l <= 3).unwrap_or_else(|| {
+                    panic!("`cmp-opt` expects a level from 0 to 3, received `{}`", level)
+                }))
+            })
+            .unwrap_or(3),
+        native_cpu: args.iter().any(|p| *p.to_lowercase() == *"cmp-native"),
+        trace_calls: args.iter().any(|p| *p.to_lowercase() == *"cmp-trace"),
+        debug_info: args.iter().any(|p| *p.to_lowercase() == *"cmp-debug"),
+    };
+
+    let use_vm = args.iter().any(|p| *p.to_lowercase() == *"vm");
+
+    let use_jit = args.iter().any(|p| *p.to_lowercase() == *"jit");
+
+    let collapsed_stacks_path = args
+        .iter()
+        .find_map(|p| p.strip_prefix("profile-out=").map(str::to_string));
+
+    let use_profiler =
+        collapsed_stacks_path.is_some() || args.iter().any(|p| *p.to_lowercase() == *"profile");
+
     let contents = fs::read_to_string(&file_path)
         .unwrap_or_else(|err| panic!("Unable to execute Velvet file: {:#?}", err));
 
-    let mut parser = Parser::new(
-        &contents,
-        inject_stdlib_snippets,
-        if compile_ir {
-            ExecutionTechnique::Compilation
-        } else {
-            ExecutionTechnique::Interpretation
-        },
-    );
-    let ast = parser.produce_ast();
+    // Runs the whole pipeline repeatedly and reports how long each stage took, instead of running the program once
+    if args.iter().any(|p| *p.to_lowercase() == *"bench") {
+        let runs = args
+            .iter()
+            .find_map(|p| {
+                let runs = p.to_lowercase().strip_prefix("bench-runs=")?.to_string();
+                Some(runs.parse::<usize>().ok().filter(|r| *r > 0).unwrap_or_else(|| {
+                    panic!("`bench-runs` expects a positive number of runs, received `{}`", runs)
+                }))
+            })
+            .unwrap_or(10);
+        let options = BenchOptions {
+            runs,
+            inject_stdlib_snippets,
+            sandboxed: is_sandboxed,
+            backend: if compile_ir || use_jit {
+                BenchBackend::Compiler
+            } else if use_vm {
+                BenchBackend::Vm
+            } else {
+                BenchBackend::Interpreter
+            },
+        };
+        task::set_program(&contents, inject_stdlib_snippets, is_sandboxed);
+        let stages = bench::run_bench(&contents, &file_path, &options);
+        bench::print_bench_report(&stages);
+        return;
+    }
+
+    let technique = if compile_ir || use_jit {
+        ExecutionTechnique::Compilation
+    } else if use_vm {
+        ExecutionTechnique::Bytecode
+    } else {
+        ExecutionTechnique::Interpretation
+    };
+    let mut parser = Parser::new(&contents, inject_stdlib_snippets, technique.clone());
+    let mut ast = parser.produce_ast();
+    ast.fold_constants();
     // println!("{:#?}", ast);
     let mut checker = TypeChecker::new(
         &ast.externals_used,
@@ -139,19 +249,36 @@ fn main() {
             .to_str()
             .unwrap()
             .to_string(),
+        technique,
     );
-    checker.enter_scope();
-    checker.load_externs();
-    if tc_verbose {
-        println!(
-            "┌ {}",
-            String::from("Start Typechecker Output").on_yellow().bold()
-        );
-    }
-    for node in &ast.nodes {
-        checker.check_expr(node, None, tc_verbose, 0);
+    // Only the compiled backends read the type table, so only they keep it between runs
+    let typecheck_cache = (use_compile_cache && (compile_ir || use_jit) && !tc_verbose).then(|| {
+        TypecheckCache::new(
+            &contents,
+            inject_stdlib_snippets,
+            &ExecutionTechnique::Compilation,
+            &ast.externals_used,
+            std::env::current_dir().unwrap().as_path(),
+        )
+    });
+    let cached_type_table = typecheck_cache.as_ref().and_then(TypecheckCache::restore);
+    let type_table_cached = cached_type_table.is_some();
+    if let Some(type_table) = cached_type_table {
+        checker.type_table = type_table;
+    } else {
+        checker.enter_scope();
+        checker.load_externs();
+        if tc_verbose {
+            println!(
+                "┌ {}",
+                String::from("Start Typechecker Output").on_yellow().bold()
+            );
+        }
+        for node in &ast.nodes {
+            checker.check_expr(node, None, tc_verbose, 0);
+        }
+        checker.check_all_type_resolutions();
     }
-    checker.check_all_type_resolutions();
     // println!("{:#?}", checker.type_table);
     if !checker.errors.is_empty() {
         println!("Typechecking failed");
@@ -165,10 +292,55 @@ fn main() {
         }
         process::exit(1);
     }
+    if let (Some(cache), false) = (&typecheck_cache, type_table_cached) {
+        cache.store(&checker.type_table);
+    }
+
+    // Runs the compiled backend's output in-process: no temporary files, archives or linking
+    if use_jit {
+        use crate::codegen::codegen::IRGenerator;
+        let context = inkwell::context::Context::create();
+        let compile_time_checker = TypeChecker::new(
+            &ast.externals_used,
+            std::env::current_dir()
+                .unwrap()
+                .to_str()
+                .unwrap()
+                .to_string(),
+            ExecutionTechnique::Compilation,
+        );
+        let mut generator = IRGenerator::new(
+            &context,
+            &file_path,
+            do_coerce,
+            compile_time_checker,
+            checker.type_table,
+            &ast.externals_used,
+        );
+        generator.build_external_archives = false;
+        generator.trace_calls = codegen_options.trace_calls;
+        generator.emit_debug_info = codegen_options.debug_info;
+        if !generator.generate_ir_for_nodes(ast.nodes) {
+            process::exit(1);
+        }
+
+        let target_machine = IRGenerator::create_target_machine(&codegen_options);
+        if let Err(err) = generator.optimize(&target_machine, &codegen_options) {
+            eprintln!("LLVM optimizer error: {}", err);
+            process::exit(1);
+        }
+        match generator.run_jit(&codegen_options) {
+            Ok(exit_code) => process::exit(exit_code),
+            Err(err) => {
+                eprintln!("JIT error: {}", err);
+                process::exit(1);
+            }
+        }
+    }
 
     if compile_ir {
         println!("{}\n  {}", "Notice!".on_red(), "The `compile` flag is present, so Velvet will attempt to compile your input rather than interpret it.\n  The compiler is still in beta, and behavior may not be uniform between interpretation and compilation methods.".yellow());
-        use crate::codegen::codegen::IRGenerator;
+        use crate::codegen::{cache::CompileCache, codegen::IRGenerator};
         let file_name = args.get(1).unwrap();
         let context = inkwell::context::Context::create();
 
@@ -182,6 +354,23 @@ fn main() {
             println!("write_dir -> velet_tmp/std");
         }
 
+        let compile_cache = CompileCache::new(
+            &contents,
+            do_coerce,
+            inject_stdlib_snippets,
+            &codegen_options.cache_tag(),
+            &ast.externals_used,
+            std::env::current_dir().unwrap().as_path(),
+        );
+        if use_compile_cache && compile_cache.restore("out") {
+            println!(
+                "Inputs unchanged since a previous compile (cache key {:016x}); skipped generation, optimization and linking",
+                compile_cache.key
+            );
+            println!("Executable generated to `./out`");
+            std::process::exit(0);
+        }
+
         let compile_time_checker = TypeChecker::new(
             &ast.externals_used,
             std::env::current_dir()
@@ -189,6 +378,7 @@ fn main() {
                 .to_str()
                 .unwrap()
                 .to_string(),
+            ExecutionTechnique::Compilation,
         );
 
         println!(
@@ -203,6 +393,8 @@ fn main() {
             checker.type_table,
             &ast.externals_used,
         );
+        generator.trace_calls = codegen_options.trace_calls;
+        generator.emit_debug_info = codegen_options.debug_info;
         let start = Instant::now();
         println!("Compiling `{}`...", file_name);
 
@@ -215,43 +407,40 @@ fn main() {
 
         // let mut rng = rand::rng();
         let name = format!("velvet_raw_{}", "IR"); //rng.random_range(481..194801));
-        let unoptimized_path = format!("./velvet_tmp/{}-unop.ll", name);
-
-        generator
-            .module
-            .print_to_file(format!("./velvet_tmp/{}-unop.ll", name))
-            .expect("Failed to generate LLVM IR file.");
-
-        let finish_codegen = finished_irgen_t.elapsed();
-        let finished_codegen_t = Instant::now();
-
-        println!("write -> velvet_tmp/{}-unop.ll", name);
-        let output = Command::new("opt")
-            .args([
-                "-O3",
-                unoptimized_path.as_str(),
-                "-S",
-                "-o",
-                format!("./velvet_tmp/{}-op.ll", name).as_str(),
-            ])
-            .output()
-            .expect("Failed to run `opt`. Do you have LLVM installed?");
-        let finish_optimizer = finished_codegen_t.elapsed();
-        let finished_optimizer_t = Instant::now();
-        println!("write -> velvet_tmp/{}-op.ll", name);
+        let object_path = format!("./velvet_tmp/{}.o", name);
+
+        // Textual IR is only written on request; optimization and object emission happen in-process
+        if emit_ir {
+            generator
+                .module
+                .print_to_file(format!("./velvet_tmp/{}-unop.ll", name))
+                .expect("Failed to generate LLVM IR file.");
+            println!("write -> velvet_tmp/{}-unop.ll", name);
+        }
 
-        if !output.status.success() {
-            eprintln!(
-                "`opt` [LLVM IR optimizer] error: {}",
-                String::from_utf8_lossy(&output.stderr)
-            );
+        let target_machine = IRGenerator::create_target_machine(&codegen_options);
+        if let Err(err) = generator.optimize(&target_machine, &codegen_options) {
+            eprintln!("LLVM optimizer error: {}", err);
             std::process::exit(1);
         }
+        let finish_optimizer = finished_irgen_t.elapsed();
+        let finished_optimizer_t = Instant::now();
 
-        // generator.module.print_to_stderr();
+        if emit_ir {
+            generator
+                .module
+                .print_to_file(format!("./velvet_tmp/{}-op.ll", name))
+                .expect("Failed to generate LLVM IR file.");
+            println!("write -> velvet_tmp/{}-op.ll", name);
+        }
 
-        // generator.emit_object_file("./velvet_tmp/ir.o");
-        let optimized_path = format!("./velvet_tmp/{}-op.ll", name);
+        if let Err(err) = generator.emit_object_file(&target_machine, &object_path) {
+            eprintln!("Failed to emit object file: {}", err);
+            std::process::exit(1);
+        }
+        println!("write -> velvet_tmp/{}.o", name);
+        let finish_codegen = finished_optimizer_t.elapsed();
+        let finished_codegen_t = Instant::now();
 
         let mut external_archive_paths = vec![];
         for external in &generator.external_files {
@@ -273,7 +462,7 @@ fn main() {
 
         let mut clang_cmd = Command::new("clang");
         clang_cmd.args(["-Wno-override-module", "-no-pie"]);
-        clang_cmd.arg(&optimized_path);
+        clang_cmd.arg(&object_path);
         for archive in &external_archive_paths {
             clang_cmd.arg(&format!("-Wl,-force_load,{}", archive));
         }
@@ -284,13 +473,17 @@ fn main() {
             .output()
             .expect("Failed to link your Velvet program! You may have to manually link the object file under `./velvet_tmp`.");
 
-        let finish_linking = finished_optimizer_t.elapsed();
+        let finish_linking = finished_codegen_t.elapsed();
 
         if !output.status.success() {
             eprintln!("Linker error:\n{}", String::from_utf8_lossy(&output.stderr));
             std::process::exit(1);
         }
 
+        if use_compile_cache {
+            compile_cache.store("out");
+        }
+
         /*
         fs::remove_dir_all("./velvet_tmp/std")
             .expect("Failed to remove temporary standard lib Velvet dir at `./velvet_tmp/std`.");
@@ -400,8 +593,35 @@ fn main() {
         }
     }
 
+    let global_env = SourceEnv::create_global(is_sandboxed);
+    task::set_program(&contents, inject_stdlib_snippets, is_sandboxed);
+
+    if use_vm {
+        let program = BytecodeCompiler::new(&global_env.borrow()).compile_program(&ast.nodes);
+        if args
+            .iter()
+            .any(|p| *p.to_lowercase() == *"do_dump_bytecode")
+        {
+            println!("[Bytecode Dump]\n{}", program);
+        }
+        VirtualMachine::new(global_env).run(program);
+        flush_output();
+        return;
+    }
+
     let mut interp = Interpreter::new(ast.nodes);
-    interp.evaluate_body(SourceEnv::create_global(is_sandboxed));
+    if use_profiler {
+        interp.enable_profiling();
+    }
+    interp.evaluate_body(global_env);
+    flush_output();
+
+    if let Some(profiler) = interp.profiler() {
+        profiler.print_report();
+        if let Some(path) = &collapsed_stacks_path {
+            profiler.write_collapsed_stacks(path);
+        }
+    }
 }
 
 /*
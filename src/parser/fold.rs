@@ -0,0 +1,166 @@
+use std::rc::Rc;
+
+use crate::parser::nodetypes::{BoolLiteral, Node, NumericLiteral, StringLiteral};
+
+/// Replaces `BinaryExpr` and `Comparator` trees whose operands are all literals with the literal they evaluate to,
+/// so constant expressions cost nothing at runtime under any execution technique.
+///
+/// Folding follows the interpreter's semantics exactly and gives up whenever evaluating the expression could fail
+/// or depend on a platform: division by zero, results outside of a Velvet number, and operators or operand types
+/// the interpreter would reject are all left for the runtime to report. A folded literal keeps the id of the
+/// expression it replaces. Computed member properties are never folded, since a literal property would be looked up
+/// by its spelling instead, and neither are the comparators of `if` and `while` conditions.
+pub fn fold_constants(nodes: &mut [Node]) {
+    for node in nodes {
+        fold(node);
+    }
+}
+
+fn fold_box(node: &mut Box<Node>) {
+    fold(node.as_mut());
+}
+
+/// `if` and `while` conditions must stay comparators, so only their operands are folded.
+fn fold_condition(node: &mut Box<Node>) {
+    match node.as_mut() {
+        Node::Comparator(comp) => {
+            fold_box(&mut comp.lhs);
+            fold_box(&mut comp.rhs);
+        }
+        other => fold(other),
+    }
+}
+
+fn fold(node: &mut Node) {
+    match node {
+        Node::BinaryExpr(binop) => {
+            fold_box(&mut binop.left);
+            fold_box(&mut binop.right);
+            if let Some(folded) = fold_binary(binop.id, &binop.op, &binop.left, &binop.right) {
+                *node = folded;
+            }
+        }
+        Node::Comparator(comp) => {
+            fold_box(&mut comp.lhs);
+            fold_box(&mut comp.rhs);
+            if let Some(value) = fold_comparison(&comp.op, &comp.lhs, &comp.rhs) {
+                *node = Node::BoolLiteral(BoolLiteral {
+                    id: comp.id,
+                    literal_value: value,
+                });
+            }
+        }
+        Node::VarDeclaration(decl) => fold_box(&mut decl.var_value),
+        Node::AssignmentExpr(asexp) => fold_box(&mut asexp.value),
+        Node::ListLiteral(ll) => fold_constants(&mut ll.props),
+        Node::ObjectLiteral(ol) => {
+            for value in ol.props.values_mut() {
+                fold(value);
+            }
+        }
+        Node::FunctionDefinition(def) => {
+            let body: &mut Vec<Node> = Rc::make_mut(&mut def.body);
+            fold_constants(body);
+        }
+        Node::Return(ret) => fold_box(&mut ret.return_statement),
+        Node::CallExpr(cexpr) => {
+            fold_box(&mut cexpr.caller);
+            fold_constants(&mut cexpr.args);
+        }
+        Node::MemberExpr(mem) => fold_box(&mut mem.object),
+        Node::WhileStmt(while_loop) => {
+            fold_condition(&mut while_loop.condition);
+            fold_constants(&mut while_loop.body);
+        }
+        Node::IfStmt(if_stmt) => {
+            fold_condition(&mut if_stmt.condition);
+            fold_constants(&mut if_stmt.body);
+        }
+        Node::Iterator(it) => {
+            fold_box(&mut it.right);
+            fold_constants(&mut it.body);
+        }
+        Node::MatchExpr(mexpr) => {
+            fold_box(&mut mexpr.target);
+            for (pattern, body) in &mut mexpr.arms {
+                fold(pattern);
+                fold(body);
+            }
+        }
+        Node::OptionalArg(opt) => fold_box(&mut opt.arg),
+        Node::NullishCoalescing(nc) => {
+            fold_box(&mut nc.left);
+            fold_box(&mut nc.right);
+        }
+        Node::Block(block) => fold_constants(&mut block.body),
+        Node::InterpreterBlock(iblock) => {
+            for inner in &mut iblock.body {
+                fold_box(inner);
+            }
+        }
+        Node::TypeCast(cast) => fold_box(&mut cast.left),
+        _ => {}
+    }
+}
+
+fn fold_binary(id: Option<usize>, op: &str, left: &Node, right: &Node) -> Option<Node> {
+    match (left, right) {
+        (Node::NumericLiteral(l), Node::NumericLiteral(r)) => {
+            let (l, r) = (
+                isize::try_from(l.value).ok()?,
+                isize::try_from(r.value).ok()?,
+            );
+            let value = match op {
+                "+" => l.checked_add(r)?,
+                "-" => l.checked_sub(r)?,
+                "*" => l.checked_mul(r)?,
+                "/" => l.checked_div(r)?,
+                _ => return None,
+            };
+            Some(Node::NumericLiteral(NumericLiteral {
+                id,
+                literal_value: value.to_string(),
+                value: value as i128,
+            }))
+        }
+        (Node::StringLiteral(l), Node::StringLiteral(r)) if op == "+" => {
+            let literal_value = l.literal_value.clone() + &r.literal_value;
+            Some(Node::StringLiteral(StringLiteral {
+                id,
+                value: literal_value.as_str().into(),
+                literal_value,
+            }))
+        }
+        _ => None,
+    }
+}
+
+/// Mirrors `RuntimeVal::compare` for the literal types that support `op`.
+fn fold_comparison(op: &str, lhs: &Node, rhs: &Node) -> Option<bool> {
+    match (lhs, rhs) {
+        (Node::NumericLiteral(l), Node::NumericLiteral(r)) => {
+            let (l, r) = (
+                isize::try_from(l.value).ok()?,
+                isize::try_from(r.value).ok()?,
+            );
+            match op {
+                "==" => Some(l == r),
+                "!=" => Some(l != r),
+                "<" => Some(l < r),
+                "<=" => Some(l <= r),
+                ">" => Some(l > r),
+                ">=" => Some(l >= r),
+                _ => None,
+            }
+        }
+        (Node::BoolLiteral(l), Node::BoolLiteral(r)) => match op {
+            "==" => Some(l.literal_value == r.literal_value),
+            "!=" => Some(l.literal_value != r.literal_value),
+            _ => None,
+        },
+        (Node::StringLiteral(l), Node::StringLiteral(r)) if op == "==" => {
+            Some(l.literal_value == r.literal_value)
+        }
+        _ => None,
+    }
+}
@@ -1,2 +1,3 @@
+pub mod fold;
 pub mod parser;
 pub mod nodetypes;
\ No newline at end of file
@@ -1,12 +1,13 @@
 use core::fmt;
 use std::{collections::HashMap, fmt::Display, rc::Rc};
 
-use crate::{tokenizer::token::VelvetToken, typecheck::typecheck::T};
+use crate::{runtime::strings::SharedStr, tokenizer::token::VelvetToken, typecheck::typecheck::T};
 
 #[derive(Debug, Clone)]
 pub enum Node {
     BinaryExpr(BinaryExpr),
     NumericLiteral(NumericLiteral),
+    FloatLiteral(FloatLiteral),
     VarDeclaration(VarDeclaration),
     AssignmentExpr(AssignmentExpr),
     Comparator(Comparator),
@@ -139,6 +140,8 @@ pub struct FunctionDefinition {
     pub name: String,
     pub body: Rc<Vec<Node>>,
     pub return_type: T,
+    /// The source line of the definition's `->`.
+    pub line: usize,
 }
 
 #[derive(Debug, Clone)]
@@ -197,6 +200,15 @@ pub struct MemberExpr {
 pub struct NumericLiteral {
     pub id: Option<usize>,
     pub literal_value: String,
+    /// `literal_value` decoded by the parser, so evaluating the literal does not parse it again.
+    pub value: i128,
+}
+
+#[derive(Debug, Clone)]
+pub struct FloatLiteral {
+    pub id: Option<usize>,
+    pub literal_value: String,
+    pub value: f64,
 }
 
 #[derive(Debug, Clone)]
@@ -221,6 +233,43 @@ pub struct ObjectLiteral {
 pub struct StringLiteral {
     pub id: Option<usize>,
     pub literal_value: String,
+    /// The runtime string, shared by every evaluation of the literal.
+    pub value: SharedStr,
+}
+
+impl Node {
+    /// The variant's name, as reported by the profiler.
+    pub fn kind_name(&self) -> &'static str {
+        match self {
+            Node::BinaryExpr(_) => "BinaryExpr",
+            Node::NumericLiteral(_) => "NumericLiteral",
+            Node::FloatLiteral(_) => "FloatLiteral",
+            Node::VarDeclaration(_) => "VarDeclaration",
+            Node::AssignmentExpr(_) => "AssignmentExpr",
+            Node::Comparator(_) => "Comparator",
+            Node::ListLiteral(_) => "ListLiteral",
+            Node::ObjectLiteral(_) => "ObjectLiteral",
+            Node::FunctionDefinition(_) => "FunctionDefinition",
+            Node::Identifier(_) => "Identifier",
+            Node::Return(_) => "Return",
+            Node::CallExpr(_) => "CallExpr",
+            Node::MemberExpr(_) => "MemberExpr",
+            Node::Eof(_) => "Eof",
+            Node::WhileStmt(_) => "WhileStmt",
+            Node::StringLiteral(_) => "StringLiteral",
+            Node::IfStmt(_) => "IfStmt",
+            Node::Iterator(_) => "Iterator",
+            Node::MatchExpr(_) => "MatchExpr",
+            Node::BoolLiteral(_) => "BoolLiteral",
+            Node::OptionalArg(_) => "OptionalArg",
+            Node::NoOpNode(_) => "NoOpNode",
+            Node::NullishCoalescing(_) => "NullishCoalescing",
+            Node::Block(_) => "Block",
+            Node::NullLiteral(_) => "NullLiteral",
+            Node::InterpreterBlock(_) => "InterpreterBlock",
+            Node::TypeCast(_) => "TypeCast",
+        }
+    }
 }
 
 impl Display for Node {
@@ -228,6 +277,7 @@ impl Display for Node {
         match self {
             Node::BinaryExpr(expr) => write!(f, "{} {} {}", expr.left, expr.op, expr.right),
             Node::NumericLiteral(n) => write!(f, "{}", n.literal_value),
+            Node::FloatLiteral(n) => write!(f, "{}", n.literal_value),
             Node::StringLiteral(s) => write!(f, "\"{}\"", s.literal_value),
             Node::BoolLiteral(b) => write!(f, "{}", b.literal_value),
             Node::NullLiteral(_) => write!(f, "null"),
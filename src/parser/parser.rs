@@ -1,15 +1,19 @@
-use std::{collections::HashMap, rc::Rc};
+use std::{cell::OnceCell, collections::HashMap, rc::Rc};
 
 use crate::{
-    parser::nodetypes::{
-        AssignmentExpr, AstSnippet, BinaryExpr, Block, BoolLiteral, CallExpr, Comparator,
-        FunctionDefinition, Identifier, IfStmt, InterpreterBlock, Iterator, ListLiteral, MatchExpr,
-        MemberExpr, NoOpNode, Node, NullLiteral, NullishCoalescing, NumericLiteral, ObjectLiteral,
-        OptionalArg, Return, SnippetParam, StringLiteral, TypeCast, VarDeclaration, WhileStmt,
+    parser::{
+        fold,
+        nodetypes::{
+            AssignmentExpr, AstSnippet, BinaryExpr, Block, BoolLiteral, CallExpr, Comparator,
+            FloatLiteral, FunctionDefinition, Identifier, IfStmt, InterpreterBlock, Iterator,
+            ListLiteral, MatchExpr, MemberExpr, NoOpNode, Node, NullLiteral, NullishCoalescing,
+            NumericLiteral, ObjectLiteral, OptionalArg, Return, SnippetParam, StringLiteral,
+            TypeCast, VarDeclaration, WhileStmt,
+        },
     },
     tokenizer::{
         token::{VelvetToken, VelvetTokenType},
-        tokenizer::{join_tokenizer_output, tokenize},
+        tokenizer::{SymbolTable, snippet_sources, tokenize, tokenize_source},
     },
     typecheck::typecheck::T,
 };
@@ -17,17 +21,30 @@ use crate::{
 pub struct Parser {
     tokens: Vec<VelvetToken>,
     token_pointer: usize,
-    tkn_chain: Vec<VelvetToken>,
     ast_snippets: Vec<AstSnippet>,
     etech: ExecutionTechnique,
     cur_node: usize,
     externals: Vec<String>,
 }
 
+/// The standard library snippets, parsed once per thread and shared by every parser that injects them.
+struct StdlibSnippets {
+    snippets: Vec<AstSnippet>,
+    /// Parsing the snippets used up the node ids below this one.
+    next_node_id: usize,
+}
+
+thread_local! {
+    /// Indexed by `Parser::stdlib_slot`.
+    static STDLIB_SNIPPETS: [OnceCell<Rc<StdlibSnippets>>; 2] = [OnceCell::new(), OnceCell::new()];
+}
+
 #[derive(Clone, PartialEq)]
 pub enum ExecutionTechnique {
     Interpretation,
     Compilation,
+    /// Lowered to bytecode and run on the VM; shares the interpreter's runtime and standard library.
+    Bytecode,
 }
 
 #[derive(Clone, Debug)]
@@ -43,15 +60,40 @@ impl Ast {
             externals_used,
         }
     }
+
+    /// Runs `fold::fold_constants` over the program.
+    pub fn fold_constants(&mut self) {
+        fold::fold_constants(&mut self.nodes);
+    }
 }
 
 impl Parser {
+    /// Standard library snippets are parsed as if their sources preceded `input`, so the snippets and the node ids
+    /// given to `input` are the same whether or not they came from the cache.
     pub fn new(input: &str, inject_stdlib_snippets: bool, etech: ExecutionTechnique) -> Self {
-        let tokenized_result = tokenize(input, inject_stdlib_snippets, etech.clone());
+        let tokens = tokenize(input, false, etech.clone()).real_tokens;
+        Self::with_tokens(tokens, inject_stdlib_snippets, etech)
+    }
+
+    /// A parser over tokens already produced by `tokenize`, without the standard library's snippets among them.
+    pub fn with_tokens(
+        tokens: Vec<VelvetToken>,
+        inject_stdlib_snippets: bool,
+        etech: ExecutionTechnique,
+    ) -> Self {
+        let mut parser = Self::from_tokens(tokens, etech);
+        if inject_stdlib_snippets {
+            let stdlib = Self::stdlib_snippets(&parser.etech);
+            parser.ast_snippets = stdlib.snippets.clone();
+            parser.cur_node = stdlib.next_node_id;
+        }
+        parser
+    }
+
+    fn from_tokens(tokens: Vec<VelvetToken>, etech: ExecutionTechnique) -> Self {
         Self {
-            tokens: join_tokenizer_output(tokenized_result),
+            tokens,
             token_pointer: 0,
-            tkn_chain: Vec::new(),
             ast_snippets: Vec::new(),
             etech,
             cur_node: 0,
@@ -59,6 +101,35 @@ impl Parser {
         }
     }
 
+    /// Interpretation and bytecode share their snippets.
+    fn stdlib_slot(etech: &ExecutionTechnique) -> usize {
+        match etech {
+            ExecutionTechnique::Interpretation | ExecutionTechnique::Bytecode => 0,
+            ExecutionTechnique::Compilation => 1,
+        }
+    }
+
+    /// Parses the embedded standard library snippets for `etech` the first time a parser on this thread needs them.
+    fn stdlib_snippets(etech: &ExecutionTechnique) -> Rc<StdlibSnippets> {
+        STDLIB_SNIPPETS.with(|cache| {
+            let snippets = cache[Self::stdlib_slot(etech)].get_or_init(|| {
+                let mut symbols = SymbolTable::default();
+                let tokens = snippet_sources(etech)
+                    .iter()
+                    .flat_map(|source| tokenize_source(source, &mut symbols))
+                    .collect();
+                let mut snippet_parser = Self::from_tokens(tokens, etech.clone());
+                // Snippet sources only define snippets; the program they produce holds nothing else
+                snippet_parser.produce_ast();
+                Rc::new(StdlibSnippets {
+                    snippets: snippet_parser.ast_snippets,
+                    next_node_id: snippet_parser.cur_node,
+                })
+            });
+            Rc::clone(snippets)
+        })
+    }
+
     fn current(&mut self) -> &VelvetToken {
         (&self.tokens[self.token_pointer]) as _
     }
@@ -69,7 +140,6 @@ impl Parser {
 
     fn eat(&mut self) -> VelvetToken {
         let current_token = self.tokens[self.token_pointer].clone();
-        self.tkn_chain.push(self.tokens[self.token_pointer].clone());
         self.token_pointer += 1;
 
         current_token
@@ -97,6 +167,7 @@ impl Parser {
             "i32" | "number" => T::Integer32,
             "i64" => T::Integer64,
             "i128" => T::Integer128,
+            "f64" | "float" => T::Float64,
             "bool" => T::Boolean,
             "string" => T::String,
             "inferred" => T::Infer,
@@ -135,8 +206,6 @@ impl Parser {
                 break;
             }
 
-            self.tkn_chain.clear();
-
             program.push(*self.parse_stmt());
         }
 
@@ -169,18 +238,13 @@ impl Parser {
     pub fn parse_external_include(&mut self) -> Box<Node> {
         self.eat(); // eat `external` ident
         let extern_str = self.expect_token(VelvetTokenType::Str, "Expected external string");
-        self.externals.push(extern_str.literal_value);
+        self.externals.push(extern_str.literal_value.to_string());
         Box::new(Node::NoOpNode(NoOpNode {
             id: Some(self.alloc_node_id()),
         }))
     }
 
     pub fn parse_type_cast(&mut self, left: Box<Node>, right: T) -> Box<Node> {
-        if self.etech == ExecutionTechnique::Interpretation {
-            let current_token = self.current().clone();
-            self.error(&current_token, "You can only typecast in compilation mode.");
-        }
-
         Box::new(Node::TypeCast(TypeCast {
             id: Some(self.alloc_node_id()),
             left,
@@ -192,7 +256,8 @@ impl Parser {
         self.eat(); // eat `$` token
         let feature = self
             .expect_token(VelvetTokenType::Identifier, "Expected interpreter feature")
-            .literal_value;
+            .literal_value
+            .to_string();
 
         self.expect_token(
             VelvetTokenType::LBrace,
@@ -275,12 +340,12 @@ impl Parser {
     }
 
     pub fn parse_fn_declaration(&mut self) -> Box<Node> {
-        self.eat(); // eat `->` token
+        let line = self.eat().line; // eat `->` token
 
         let function_name = self
             .expect_token(VelvetTokenType::Identifier, "Function name expected")
             .literal_value
-            .clone();
+            .to_string();
         let args = self.parse_fdef_args(); // self.parse_args();
         let mut parameter_names: Vec<(String, T)> = Vec::new();
         for arg in args {
@@ -317,6 +382,7 @@ impl Parser {
             name: function_name,
             body: rc_body,
             return_type: self.identifier_to_type(&return_type),
+            line,
         }));
     }
 
@@ -433,7 +499,7 @@ impl Parser {
                 VelvetTokenType::Gt | VelvetTokenType::Lt | VelvetTokenType::DoubleEq
             )
         {
-            let operator = self.eat().literal_value.clone();
+            let operator = self.eat().literal_value.to_string();
 
             let rhs = self.parse_list_expr();
 
@@ -493,7 +559,7 @@ impl Parser {
             let right = self.parse_expr();
             match field_name.kind {
                 VelvetTokenType::Identifier => {
-                    props.insert(field_name.literal_value, *right);
+                    props.insert(field_name.literal_value.to_string(), *right);
                 }
                 _ => {
                     panic!("");
@@ -518,7 +584,7 @@ impl Parser {
         let identifier = self
             .expect_token(VelvetTokenType::Identifier, "Variable name required")
             .literal_value
-            .clone();
+            .to_string();
 
         self.expect_token(
             VelvetTokenType::Keywrd_As,
@@ -557,7 +623,7 @@ impl Parser {
                 break;
             }
 
-            let operator = self.eat().literal_value.clone();
+            let operator = self.eat().literal_value.to_string();
             let right = self.parse_multiplicative_expr();
             left = Box::new(Node::BinaryExpr(BinaryExpr {
                 id: Some(self.alloc_node_id()),
@@ -593,7 +659,7 @@ impl Parser {
                     break;
                 }
 
-                let operator = self.eat().literal_value.clone();
+                let operator = self.eat().literal_value.to_string();
 
                 // MARKER: Bugx001 fix, `self.parse_primary_expr()` -> `self.parse_additive_expr()`
                 // Putting a marker here because this is such a volatile change that future possible bugs relating to this change may be hard to deduce.
@@ -1090,17 +1156,41 @@ impl Parser {
         let tk = self.eat();
 
         match tk.kind {
-            VelvetTokenType::Number => Box::new(Node::NumericLiteral(NumericLiteral {
-                id: Some(self.alloc_node_id()),
-                literal_value: tk.literal_value.clone(),
-            })),
+            VelvetTokenType::Number if tk.literal_value.contains('.') => {
+                let value = match tk.literal_value.parse::<f64>() {
+                    Ok(value) => value,
+                    Err(_) => {
+                        self.error(&tk, "Numeric literal is not a valid float");
+                        unreachable!()
+                    }
+                };
+                Box::new(Node::FloatLiteral(FloatLiteral {
+                    id: Some(self.alloc_node_id()),
+                    literal_value: tk.literal_value.to_string(),
+                    value,
+                }))
+            }
+            VelvetTokenType::Number => {
+                let value = match tk.literal_value.parse::<i128>() {
+                    Ok(value) => value,
+                    Err(_) => {
+                        self.error(&tk, "Numeric literal is not a valid integer");
+                        unreachable!()
+                    }
+                };
+                Box::new(Node::NumericLiteral(NumericLiteral {
+                    id: Some(self.alloc_node_id()),
+                    literal_value: tk.literal_value.to_string(),
+                    value,
+                }))
+            }
             VelvetTokenType::Identifier => {
-                if tk.literal_value == "true" {
+                if &*tk.literal_value == "true" {
                     Box::new(Node::BoolLiteral(BoolLiteral {
                         id: Some(self.alloc_node_id()),
                         literal_value: true,
                     }))
-                } else if tk.literal_value == "false" {
+                } else if &*tk.literal_value == "false" {
                     Box::new(Node::BoolLiteral(BoolLiteral {
                         id: Some(self.alloc_node_id()),
                         literal_value: false,
@@ -1108,13 +1198,14 @@ impl Parser {
                 } else {
                     Box::new(Node::Identifier(Identifier {
                         id: Some(self.alloc_node_id()),
-                        identifier_name: tk.literal_value.clone(),
+                        identifier_name: tk.literal_value.to_string(),
                     }))
                 }
             }
             VelvetTokenType::Str => Box::new(Node::StringLiteral(StringLiteral {
                 id: Some(self.alloc_node_id()),
-                literal_value: tk.literal_value.clone(),
+                literal_value: tk.literal_value.to_string(),
+                value: (&*tk.literal_value).into(),
             })),
             VelvetTokenType::Keywrd_While => self.parse_while_stmt(),
             VelvetTokenType::LParen => {
@@ -1,20 +1,25 @@
 use colored::*;
 use core::fmt;
-use std::{cell::RefCell, collections::HashMap, rc::Rc};
+use std::{cell::RefCell, rc::Rc};
 
 use crate::{
     parser::nodetypes::{
         AssignmentExpr, BinaryExpr, CallExpr, Comparator, FunctionDefinition, Identifier, IfStmt,
-        Iterator, MatchExpr, MemberExpr, Node, NullishCoalescing, ObjectLiteral, VarDeclaration,
-        WhileStmt,
+        Iterator, MatchExpr, MemberExpr, Node, NullishCoalescing, ObjectLiteral, TypeCast,
+        VarDeclaration, WhileStmt,
     },
     runtime::{
-        source_environment::source_environment::SourceEnv,
+        numeric::{self, NumericType},
+        profiler::Profiler,
+        resolver::{Resolution, Resolver},
+        shapes::{ObjectLayout, PropertyCaches},
+        source_environment::source_environment::{EnvironmentPool, SourceEnv},
         values::{
-            BoolVal, FunctionVal, InternalFunctionVal, ListVal, NullVal, NumberVal, ObjectVal,
-            ReturnVal, RuntimeVal, StringVal,
+            BoolVal, FloatVal, FunctionVal, IteratorVal, ListVal, MethodContext, NativeMethodVal,
+            NullVal, NumberVal, ReturnVal, RuntimeVal, StringVal,
         },
     },
+    stdlib_interp::process::exit_program,
 };
 
 #[macro_export]
@@ -27,116 +32,288 @@ macro_rules! velvet_error {
 #[derive(Clone, Debug)]
 pub struct UserDefinedFn {
     function: FunctionVal,
-    display: String,
+    /// The callee's environment, once its arguments are bound to it.
+    frame: Option<Rc<RefCell<SourceEnv>>>,
 }
 
+impl UserDefinedFn {
+    /// The call with its bound arguments, or with the function's parameters while they are still being evaluated.
+    fn display(&self) -> String {
+        let Some(frame) = &self.frame else {
+            return format!("{}({:?})", self.function.fn_name, self.function.params);
+        };
+        let frame = frame.borrow();
+        let args: Vec<String> = self
+            .function
+            .params
+            .iter()
+            .enumerate()
+            .map(|(i, (name, _))| {
+                let value = frame
+                    .fetch_at(0, i)
+                    .or_else(|| frame.fetch(name).map(|var| var.value));
+                format!(
+                    "{} = {:#?}",
+                    name,
+                    value.unwrap_or(RuntimeVal::NullVal(NullVal {}))
+                )
+            })
+            .collect();
+        format!("{}({})", self.function.fn_name, args.join(", "))
+    }
+}
+
+/// An entry of the interpreter's call stack. Entries hold only shared handles, so pushing one is cheap; their text
+/// is rendered when a stack trace is actually requested.
 #[derive(Clone, Debug)]
 pub enum CallTarget {
-    Internal(String),
+    Internal(&'static str),
+    InternalFunction(Rc<str>),
+    NativeMethod(&'static str),
+    IllegalCall(String),
     UserDefined(UserDefinedFn),
 }
 
+impl CallTarget {
+    /// The entry without its `% ` (Rust thread) or indentation prefix, shown by `__CALL_STACK`.
+    fn display(&self) -> String {
+        match self {
+            CallTarget::Internal(i) => i.to_string(),
+            CallTarget::InternalFunction(name) => {
+                format!("velvet::internal_functions::{}(...)", name)
+            }
+            CallTarget::NativeMethod(name) => {
+                format!("velvet::internal_functions::{}(...)", name)
+            }
+            CallTarget::IllegalCall(i) => i.clone(),
+            CallTarget::UserDefined(u) => u.display(),
+        }
+    }
+
+    fn trace_line(&self) -> String {
+        match self {
+            CallTarget::UserDefined(u) => {
+                format!("  {}({:?})", u.function.fn_name, u.function.params)
+            }
+            internal => "% ".to_owned() + &internal.display(),
+        }
+    }
+}
+
+/// Prints a Velvet runtime error along with the call stack (oldest call first, already rendered), then exits.
+/// Shared by every execution technique so runtime errors look the same regardless of how a program is run.
+pub fn report_runtime_error(args: fmt::Arguments<'_>, call_stack: &[String]) -> ! {
+    let mut call_stack = call_stack.to_vec();
+    call_stack.push(String::from(
+        "% velvet::runtime_error::interpreter_error(...)",
+    ));
+    let mut report = format!(
+        "Velvet Runtime Error\n- {}\n",
+        format!("{}", args).red().bold()
+    );
+    call_stack.push(String::from(
+        "% velvet::internal_identifier_exceptions::call_stack_getter",
+    ));
+
+    report += &format!(
+        "\n0 = latest call; {} = first call; % = Rust thread\n{}",
+        call_stack.len() - 1,
+        format!("{}", "velvet call stack").blue().bold().underline(),
+    );
+
+    for (index, call) in call_stack.iter().rev().enumerate() {
+        report += &format!(
+            "\n {} → {}",
+            format!("{}", index).blue().underline().bold(),
+            call
+        );
+    }
+
+    // The program's buffered output is flushed ahead of the report, as it was printed before the error
+    exit_program(-1, Some(report))
+}
+
+/// How a statement in tail position of a function body completed.
+enum Completion {
+    Normal(Box<RuntimeVal>),
+    /// A `;` statement returned this value.
+    Return(Box<RuntimeVal>),
+    /// A `;` statement called the function itself, with these arguments; `call_value` makes the call in place of
+    /// the current one.
+    TailCall(Vec<RuntimeVal>),
+}
+
 pub struct Interpreter {
-    ast: Vec<Node>,
+    /// Walked by reference; evaluation never copies the tree.
+    ast: Rc<Vec<Node>>,
     call_stack: Vec<CallTarget>,
+    resolution: Resolution,
+    profiler: Option<Profiler>,
+    environments: EnvironmentPool,
+    property_caches: PropertyCaches,
+    /// The layout of each object literal, by node id, resolved the first time it is evaluated.
+    object_layouts: Vec<Option<Rc<ObjectLayout>>>,
+    /// Object literal values awaiting their object, innermost literal last.
+    object_fields: Vec<RuntimeVal>,
 }
 
-pub struct ProfilerItem {
-    name: String,
+/// Lets native methods called from `env` call back into the interpreter.
+struct MethodCall<'a> {
+    interpreter: &'a mut Interpreter,
+    env: &'a Rc<RefCell<SourceEnv>>,
+}
+
+impl MethodContext for MethodCall<'_> {
+    fn call_function(&mut self, function: &RuntimeVal, args: Vec<RuntimeVal>) -> RuntimeVal {
+        self.interpreter.call_function(function, args, self.env)
+    }
+
+    fn interpreter_error(&mut self, args: fmt::Arguments<'_>) -> ! {
+        self.interpreter.interpreter_error(args)
+    }
 }
 
 impl Interpreter {
     pub fn new(ast: Vec<Node>) -> Self {
         Self {
-            ast,
+            ast: Rc::new(ast),
             call_stack: Vec::new(),
+            resolution: Resolution::default(),
+            profiler: None,
+            environments: EnvironmentPool::default(),
+            property_caches: PropertyCaches::default(),
+            object_layouts: Vec::new(),
+            object_fields: Vec::new(),
         }
     }
 
-    fn auto_reassign_methods() -> &'static [&'static str] {
-        &["push"]
+    /// Calls `function` with already evaluated `args`, as a call expression evaluated in `env` would.
+    pub fn call_function(
+        &mut self,
+        function: &RuntimeVal,
+        args: Vec<RuntimeVal>,
+        env: &Rc<RefCell<SourceEnv>>,
+    ) -> RuntimeVal {
+        self.push_call_target(function, args.len());
+        self.check_call(function, args.len());
+        let result = self.call_value(function, args, env);
+        self.call_stack.pop();
+        *result
+    }
+
+    /// Records per-function and per-node-kind statistics from now on, see `Profiler`.
+    pub fn enable_profiling(&mut self) {
+        self.profiler = Some(Profiler::new());
+    }
+
+    pub fn profiler(&self) -> Option<&Profiler> {
+        self.profiler.as_ref()
     }
 
     pub fn evaluate_body(&mut self, env: Rc<RefCell<SourceEnv>>) -> Box<RuntimeVal> {
-        self.call_stack.push(CallTarget::Internal(String::from(
+        self.call_stack.push(CallTarget::Internal(
             "velvet::entry_point::evaluate_body(...)",
-        )));
-        let ast = self.ast.clone();
+        ));
+        self.resolution = Resolver::resolve_program(&self.ast, &mut env.borrow_mut());
+        let ast = Rc::clone(&self.ast);
+        if let Some(profiler) = &mut self.profiler {
+            profiler.enter_function(&"<program>".into());
+        }
         let mut last_result: Box<RuntimeVal> = Box::new(RuntimeVal::NullVal(NullVal {}));
-        for node in ast {
-            last_result = self.evaluate(Box::new(node), Rc::clone(&env));
+        for node in ast.iter() {
+            *last_result = RuntimeVal::NullVal(NullVal {});
+            last_result = self.evaluate(node, Rc::clone(&env));
+        }
+        if let Some(profiler) = &mut self.profiler {
+            profiler.exit_function();
         }
         self.call_stack.pop();
         last_result
     }
 
-    pub fn interpreter_error(&mut self, args: fmt::Arguments<'_>) -> ! {
-        self.call_stack.push(CallTarget::Internal(String::from(
-            "velvet::runtime_error::interpreter_error(...)",
-        )));
-        println!(
-            "Velvet Runtime Error\n- {}",
-            format!("{}", args).red().bold()
-        );
-        self.call_stack.push(CallTarget::Internal(String::from(
-            "velvet::internal_identifier_exceptions::call_stack_getter",
-        )));
-
-        let mut end_stack_string = format!(
-            "\n0 = latest call; {} = first call; % = Rust thread\n{}",
-            self.call_stack.len() - 1,
-            format!("{}", "velvet call stack").blue().bold().underline(),
-        );
+    /// Creates the environment for a scope opened by the node `owner`, laid out as the resolver placed it. Hand it
+    /// to `release_environment` once the scope is left.
+    fn sub_environment(
+        &mut self,
+        owner: Option<usize>,
+        env: &Rc<RefCell<SourceEnv>>,
+    ) -> Rc<RefCell<SourceEnv>> {
+        let layout = self.resolution.layout(owner);
+        self.environments.acquire(Rc::clone(env), layout)
+    }
 
-        for (index, call) in self.call_stack.iter().rev().enumerate() {
-            let end_str: String = match call {
-                CallTarget::Internal(i) => "% ".to_owned() + &i.clone(),
-                CallTarget::UserDefined(u) => {
-                    "  ".to_owned()
-                        + &u.function.fn_name.clone()
-                        + "("
-                        + &format!("{:?}", u.function.params)
-                        + ")"
-                }
-            };
-            end_stack_string += &format!(
-                "\n {} → {}",
-                format!("{}", index).blue().underline().bold(),
-                end_str
-            );
+    fn release_environment(&mut self, env: Rc<RefCell<SourceEnv>>) {
+        self.environments.release(env);
+    }
+
+    /// Declares the binding introduced by the node `id` into `env`, at its resolved slot when there is one.
+    fn declare_binding(
+        &self,
+        id: Option<usize>,
+        env: &Rc<RefCell<SourceEnv>>,
+        name: &str,
+        value: RuntimeVal,
+        is_mutable: bool,
+    ) {
+        match self.resolution.address(id) {
+            Some(address) => env.borrow_mut().declare_at(address.slot, value, is_mutable),
+            None => env
+                .borrow_mut()
+                .declare_var(name.to_string(), value, is_mutable),
         }
+    }
 
-        println!("{}", end_stack_string);
-        self.call_stack.pop();
-        std::process::exit(-1);
+    pub fn interpreter_error(&mut self, args: fmt::Arguments<'_>) -> ! {
+        let call_stack: Vec<String> = self.call_stack.iter().map(CallTarget::trace_line).collect();
+        report_runtime_error(args, &call_stack)
+    }
+
+    pub fn evaluate(&mut self, node: &Node, env: Rc<RefCell<SourceEnv>>) -> Box<RuntimeVal> {
+        self.profile_node(node, |interpreter| interpreter.evaluate_node(node, env))
     }
 
-    pub fn evaluate(&mut self, node: Box<Node>, env: Rc<RefCell<SourceEnv>>) -> Box<RuntimeVal> {
-        match node.as_ref() {
+    fn profile_node<R>(&mut self, node: &Node, evaluate: impl FnOnce(&mut Self) -> R) -> R {
+        let Some(profiler) = &mut self.profiler else {
+            return evaluate(self);
+        };
+        profiler.enter_node(node.kind_name());
+        let result = evaluate(self);
+        self.profiler.as_mut().unwrap().exit_node();
+        result
+    }
+
+    fn evaluate_node(&mut self, node: &Node, env: Rc<RefCell<SourceEnv>>) -> Box<RuntimeVal> {
+        match node {
             Node::NumericLiteral(nl) => {
-                let numeric_value: isize = nl.literal_value.parse().unwrap();
+                let numeric_value = isize::try_from(nl.value).unwrap_or_else(|_| {
+                    velvet_error!(self, "Numeric literal {} is too large", nl.literal_value)
+                });
                 Box::new(RuntimeVal::NumberVal(NumberVal {
                     value: numeric_value,
                 }))
             }
+            Node::FloatLiteral(fl) => Box::new(RuntimeVal::FloatVal(FloatVal { value: fl.value })),
             Node::StringLiteral(slit) => Box::new(RuntimeVal::StringVal(StringVal {
-                value: slit.literal_value.clone(),
+                value: slit.value.clone(),
             })),
             Node::BoolLiteral(bl) => Box::new(RuntimeVal::BoolVal(BoolVal {
                 value: bl.literal_value,
             })),
             Node::Return(ret) => Box::new(RuntimeVal::ReturnVal(ReturnVal {
-                value: ret.return_statement.clone(),
+                value: self.evaluate(&ret.return_statement, env),
             })),
             Node::ListLiteral(ll) => {
                 let mut results: Vec<RuntimeVal> = Vec::new();
                 for inner_node in &ll.props {
-                    results.push(*self.evaluate(Box::new(inner_node.clone()), Rc::clone(&env)));
+                    results.push(*self.evaluate(inner_node, Rc::clone(&env)));
                 }
-                Box::new(RuntimeVal::ListVal(ListVal { values: results }))
+                Box::new(RuntimeVal::ListVal(ListVal {
+                    values: results.into(),
+                }))
             }
             Node::NullLiteral(_) => Box::new(RuntimeVal::NullVal(NullVal {})),
             Node::BinaryExpr(binop) => self.evaluate_binary_expr(binop, env),
+            Node::TypeCast(cast) => self.evaluate_type_cast(cast, env),
             Node::VarDeclaration(decl) => self.evaluate_var_declaration(decl, env),
             Node::Identifier(ident) => self.evaluate_identifier(ident, env),
             Node::WhileStmt(while_loop) => self.evaluate_while_stmt(while_loop, env),
@@ -153,17 +330,17 @@ impl Interpreter {
             Node::NullishCoalescing(n) => self.evaluate_nullish_coalescing(n, env),
             Node::Block(block) => {
                 let mut last = Box::new(RuntimeVal::NullVal(NullVal {}));
-                let sub_environment = Rc::new(RefCell::new(SourceEnv::new(Some(Rc::clone(&env)))));
+                let sub_environment = self.sub_environment(block.id, &env);
                 for sub_node in &block.body {
-                    last = self.evaluate(Box::new(sub_node.clone()), Rc::clone(&sub_environment));
-                    match *last {
-                        RuntimeVal::ReturnVal(r) => {
-                            last = self.evaluate(r.value, Rc::clone(&sub_environment));
-                            break;
-                        }
-                        _ => {}
+                    // Drop the previous result first so values it shares are not copied on write.
+                    *last = RuntimeVal::NullVal(NullVal {});
+                    last = self.evaluate(sub_node, Rc::clone(&sub_environment));
+                    if let RuntimeVal::ReturnVal(r) = *last {
+                        last = r.value;
+                        break;
                     }
                 }
+                self.release_environment(sub_environment);
                 last
             }
             _ => {
@@ -181,10 +358,10 @@ impl Interpreter {
         nc: &NullishCoalescing,
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
-        let left = self.evaluate(nc.left.clone(), Rc::clone(&env));
+        let left = self.evaluate(&nc.left, Rc::clone(&env));
 
         if left.is_null() {
-            self.evaluate(nc.right.clone(), Rc::clone(&env))
+            self.evaluate(&nc.right, Rc::clone(&env))
         } else {
             left
         }
@@ -196,56 +373,53 @@ impl Interpreter {
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
         // Target is the LHS of the match expr, or the expression directly after the `match` keyword and before the match body.
-        let target = self.evaluate(mexpr.target.clone(), Rc::clone(&env));
-
-        for arm in &mexpr.arms {
-            let left = self.evaluate(Box::new(arm.0.clone()), Rc::clone(&env));
-
-            match left.as_ref() {
-                RuntimeVal::FunctionVal(_) => {
-                    let left_result = self.evaluate_call_expr(
-                        &CallExpr {
-                            id: None,
-                            args: Vec::from([*mexpr.target.clone()]),
-                            caller: Box::new(arm.0.clone()),
-                        },
-                        Rc::clone(&env),
-                    );
-                    if left_result
-                        .compare(&RuntimeVal::BoolVal(BoolVal { value: true }), "==")
-                        .unwrap()
-                    {
-                        return self.evaluate(Box::new(arm.1.clone()), Rc::clone(&env));
-                    }
-                }
-                RuntimeVal::InternalFunctionVal(_) => {
-                    let left_result = self.evaluate_call_expr(
-                        &CallExpr {
-                            id: None,
-                            args: Vec::from([*mexpr.target.clone()]),
-                            caller: Box::new(arm.0.clone()),
-                        },
-                        Rc::clone(&env),
-                    );
-                    if left_result
-                        .compare(&RuntimeVal::BoolVal(BoolVal { value: true }), "==")
-                        .unwrap()
-                    {
-                        return self.evaluate(Box::new(arm.1.clone()), Rc::clone(&env));
-                    }
-                }
-                _ => {
-                    let comparison = target.compare(&left, "==");
-                    if comparison.is_ok() && comparison.unwrap() == true {
-                        return self.evaluate(Box::new(arm.1.clone()), Rc::clone(&env));
+        let target = self.evaluate(&mexpr.target, Rc::clone(&env));
+
+        if let Some(table) = self.resolution.match_table(mexpr.id) {
+            if let Some(candidates) = table.candidates(&target) {
+                for &arm in candidates.fallbacks {
+                    if self.arm_matches(mexpr, arm, &target, &env) {
+                        return self.evaluate(&mexpr.arms[arm].1, Rc::clone(&env));
                     }
                 }
+                return match candidates.literal {
+                    Some(arm) => self.evaluate(&mexpr.arms[arm].1, Rc::clone(&env)),
+                    None => Box::new(RuntimeVal::NullVal(NullVal {})),
+                };
+            }
+        }
+
+        for arm in 0..mexpr.arms.len() {
+            if self.arm_matches(mexpr, arm, &target, &env) {
+                return self.evaluate(&mexpr.arms[arm].1, Rc::clone(&env));
             }
         }
 
         return Box::new(RuntimeVal::NullVal(NullVal {}));
     }
 
+    fn arm_matches(
+        &mut self,
+        mexpr: &MatchExpr,
+        arm: usize,
+        target: &RuntimeVal,
+        env: &Rc<RefCell<SourceEnv>>,
+    ) -> bool {
+        let left = self.evaluate(&mexpr.arms[arm].0, Rc::clone(env));
+
+        match left.as_ref() {
+            // A predicate arm is called with the target expression as its argument.
+            RuntimeVal::FunctionVal(_) | RuntimeVal::InternalFunctionVal(_) => {
+                let left_result =
+                    self.evaluate_call(&left, std::slice::from_ref(mexpr.target.as_ref()), env);
+                left_result
+                    .compare(&RuntimeVal::BoolVal(BoolVal { value: true }), "==")
+                    .unwrap()
+            }
+            _ => target.compare(&left, "==").unwrap_or(false),
+        }
+    }
+
     fn evaluate_member_expr(
         &mut self,
         mem: &MemberExpr,
@@ -259,85 +433,54 @@ impl Interpreter {
             }
         };
 
-        let property_key = match *mem.property {
-            Node::Identifier(ref ident) => ident.identifier_name.clone(),
-            Node::NumericLiteral(ref numlit) => numlit.literal_value.clone(),
-            _ => "".into(),
+        let property_key: &str = match *mem.property {
+            Node::Identifier(ref ident) => &ident.identifier_name,
+            Node::NumericLiteral(ref numlit) => &numlit.literal_value,
+            _ => "",
         };
 
         match *base_val {
-            RuntimeVal::ObjectVal(ref obj) => {
-                if let Some(val) = obj.values.get(&property_key) {
-                    return Box::new(val.clone());
-                } else {
-                    return Box::new(RuntimeVal::NullVal(NullVal {}));
+            RuntimeVal::ObjectVal(ref obj) => Box::new(
+                self.property_caches
+                    .get(mem.id, obj, property_key)
+                    .unwrap_or(RuntimeVal::NullVal(NullVal {})),
+            ),
+            RuntimeVal::ListVal(_) | RuntimeVal::NumberArrayVal(_) => {
+                if let Some(method) = base_val.get_method(&property_key) {
+                    return Box::new(RuntimeVal::NativeMethodVal(NativeMethodVal {
+                        receiver: base_val.clone(),
+                        method,
+                    }));
                 }
-            }
-            RuntimeVal::ListVal(ref list) => {
-                let list_rc = Rc::new(RefCell::new(list.clone()));
-
-                let list_for_closure = Rc::clone(&list_rc);
 
-                match property_key.as_str() {
-                    "push" => {
-                        let list_ref = Rc::clone(&list_rc);
-
-                        return Box::new(RuntimeVal::InternalFunctionVal(InternalFunctionVal {
-                            fn_name: "push".into(),
-                            internal_callback: Rc::new(move |args, _| {
-                                let mut borrowed = list_ref.borrow_mut();
-                                borrowed.values.extend(args);
-                                RuntimeVal::ListVal(ListVal {
-                                    values: borrowed.to_owned().values,
-                                })
-                            }),
-                        }));
-                    }
-                    "len" => {
-                        return Box::new(RuntimeVal::InternalFunctionVal(InternalFunctionVal {
-                            fn_name: "len".into(),
-                            internal_callback: Rc::new(move |_, _| {
-                                RuntimeVal::NumberVal(NumberVal {
-                                    value: list_for_closure.borrow().len(),
-                                })
-                            }),
-                        }));
+                if let Ok(idx) = property_key.parse::<usize>() {
+                    if let Some(val) = base_val.list_element(idx) {
+                        return Box::new(val);
+                    } else {
+                        velvet_error!(self, "Index {} is out of bounds!", idx);
                     }
-                    _ => {
-                        if let Ok(idx) = property_key.parse::<usize>() {
-                            if let Some(val) = list.values.get(idx) {
-                                return Box::new(val.clone());
-                            } else {
-                                velvet_error!(self, "Index {} is out of bounds!", idx);
-                            }
-                        } else if mem.is_computed {
-                            let computed_property =
-                                self.evaluate(mem.property.clone(), Rc::clone(&env));
-
-                            let index = match *computed_property {
-                                RuntimeVal::NumberVal(n) => {
-                                    if n.value < 0 {
-                                        velvet_error!(
-                                            self,
-                                            "List index must be a non-negative integer."
-                                        );
-                                    }
-                                    n.value as usize
-                                }
-                                _ => {
-                                    velvet_error!(self, "Computed index must be a number.");
-                                }
-                            };
+                } else if mem.is_computed {
+                    let computed_property = self.evaluate(&mem.property, Rc::clone(&env));
 
-                            if let Some(val) = list.values.get(index) {
-                                return Box::new(val.clone());
-                            } else {
-                                velvet_error!(self, "Index {} is out of bounds!", index);
+                    let index = match *computed_property {
+                        RuntimeVal::NumberVal(n) => {
+                            if n.value < 0 {
+                                velvet_error!(self, "List index must be a non-negative integer.");
                             }
-                        } else {
-                            velvet_error!(self, "Invalid index access on list: {}", property_key);
+                            n.value as usize
+                        }
+                        _ => {
+                            velvet_error!(self, "Computed index must be a number.");
                         }
+                    };
+
+                    if let Some(val) = base_val.list_element(index) {
+                        return Box::new(val);
+                    } else {
+                        velvet_error!(self, "Index {} is out of bounds!", index);
                     }
+                } else {
+                    velvet_error!(self, "Invalid index access on list: {}", property_key);
                 }
             }
             RuntimeVal::StringVal(ref strvl) => {
@@ -346,13 +489,20 @@ impl Interpreter {
                         velvet_error!(self, "Index out-of-bounds on string");
                     } else {
                         return Box::new(RuntimeVal::StringVal(StringVal {
-                            value: strvl.value.chars().nth(idx).unwrap().try_into().unwrap(),
+                            value: strvl.value.chars().nth(idx).unwrap().to_string().into(),
                         }));
                     }
                 } else {
                     velvet_error!(self, "Invalid index access on string: {}", property_key);
                 }
             }
+            RuntimeVal::IteratorVal(_) => match base_val.get_method(&property_key) {
+                Some(method) => Box::new(RuntimeVal::NativeMethodVal(NativeMethodVal {
+                    receiver: base_val.clone(),
+                    method,
+                })),
+                None => velvet_error!(self, "Invalid member access on iterator: {}", property_key),
+            },
             _ => {
                 velvet_error!(
                     self,
@@ -368,16 +518,31 @@ impl Interpreter {
         ov: &ObjectLiteral,
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
-        let mut runtime_props: HashMap<String, RuntimeVal> = HashMap::new();
-        for inner_prop in &ov.props {
-            runtime_props.insert(
-                inner_prop.0.to_string(),
-                *self.evaluate(Box::new(inner_prop.1.clone()), Rc::clone(&env)),
-            );
+        let layout = self.object_layout(ov);
+        let start = self.object_fields.len();
+        for value in ov.props.values() {
+            let value = *self.evaluate(value, Rc::clone(&env));
+            self.object_fields.push(value);
         }
-        Box::new(RuntimeVal::ObjectVal(ObjectVal {
-            values: runtime_props,
-        }))
+        let object = layout.build(&mut self.object_fields[start..]);
+        self.object_fields.truncate(start);
+        Box::new(RuntimeVal::ObjectVal(object))
+    }
+
+    /// The layout of `ov`'s values, which are evaluated in the iteration order of its props. Snippet expansion can
+    /// give several literals one id, but only by cloning a literal, and a cloned map iterates in the same order.
+    fn object_layout(&mut self, ov: &ObjectLiteral) -> Rc<ObjectLayout> {
+        let Some(id) = ov.id else {
+            return Rc::new(ObjectLayout::new(ov.props.keys().map(String::as_str)));
+        };
+        if id >= self.object_layouts.len() {
+            self.object_layouts.resize(id + 1, None);
+        }
+        Rc::clone(
+            self.object_layouts[id].get_or_insert_with(|| {
+                Rc::new(ObjectLayout::new(ov.props.keys().map(String::as_str)))
+            }),
+        )
     }
 
     fn evaluate_iterator_expr(
@@ -385,37 +550,36 @@ impl Interpreter {
         it: &Iterator,
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
-        let loop_through = self.evaluate(it.right.clone(), Rc::clone(&env));
-
-        match loop_through.as_ref() {
-            RuntimeVal::ListVal(lv) => {
-                let mut last_result: Box<RuntimeVal> = Box::new(RuntimeVal::NullVal(NullVal {}));
-                for v in &lv.values {
-                    let sub_environment =
-                        Rc::new(RefCell::new(SourceEnv::new(Some(Rc::clone(&env)))));
-                    sub_environment.borrow_mut().declare_var(
-                        it.left.literal_value.clone(),
-                        v.clone(),
-                        false,
-                    );
-                    for sub_expr in &it.body {
-                        last_result =
-                            self.evaluate(Box::new(sub_expr.clone()), Rc::clone(&sub_environment));
-                        match last_result.as_ref() {
-                            RuntimeVal::ReturnVal(rt) => {
-                                return self
-                                    .evaluate(rt.clone().value, Rc::clone(&sub_environment));
-                            }
-                            _ => {}
-                        }
-                    }
-                }
-                last_result
-            }
+        let mut iterator = match *self.evaluate(&it.right, Rc::clone(&env)) {
+            RuntimeVal::IteratorVal(iterator) => iterator,
+            list if list.is_list() => IteratorVal::over_list(list),
             _ => {
                 velvet_error!(self, "Cannot loop through non-list type");
             }
+        };
+
+        let mut last_result: Box<RuntimeVal> = Box::new(RuntimeVal::NullVal(NullVal {}));
+        loop {
+            let next = iterator.next(&mut MethodCall {
+                interpreter: self,
+                env: &env,
+            });
+            let Some(v) = next else {
+                break;
+            };
+            let sub_environment = self.sub_environment(it.id, &env);
+            self.declare_binding(it.id, &sub_environment, &it.left.literal_value, v, false);
+            for sub_expr in &it.body {
+                *last_result = RuntimeVal::NullVal(NullVal {});
+                last_result = self.evaluate(sub_expr, Rc::clone(&sub_environment));
+                if let RuntimeVal::ReturnVal(rt) = *last_result {
+                    self.release_environment(sub_environment);
+                    return rt.value;
+                }
+            }
+            self.release_environment(sub_environment);
         }
+        last_result
     }
 
     fn evaluate_call_expr(
@@ -423,132 +587,343 @@ impl Interpreter {
         cexpr: &CallExpr,
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
-        let caller = self.evaluate(cexpr.caller.clone(), Rc::clone(&env));
-        let callstack_push = match &*caller {
+        if let Some(result) = self.try_call_method(cexpr, &env) {
+            return result;
+        }
+
+        let caller = self.evaluate(&cexpr.caller, Rc::clone(&env));
+        self.evaluate_call(&caller, &cexpr.args, &env)
+    }
+
+    /// Calls `callee` with the values of the argument expressions `args`.
+    fn evaluate_call(
+        &mut self,
+        callee: &RuntimeVal,
+        args: &[Node],
+        env: &Rc<RefCell<SourceEnv>>,
+    ) -> Box<RuntimeVal> {
+        self.push_call_target(callee, args.len());
+        self.check_call(callee, args.len());
+        let args = self.evaluate_args(args, env);
+        let res = self.call_value(callee, args, env);
+        self.call_stack.pop();
+        res
+    }
+
+    fn evaluate_args(&mut self, args: &[Node], env: &Rc<RefCell<SourceEnv>>) -> Vec<RuntimeVal> {
+        let mut evaluated: Vec<RuntimeVal> = Vec::with_capacity(args.len());
+        for arg in args {
+            evaluated.push(*self.evaluate(arg, Rc::clone(env)));
+        }
+        evaluated
+    }
+
+    fn push_call_target(&mut self, callee: &RuntimeVal, argc: usize) {
+        let callstack_push = match callee {
             RuntimeVal::FunctionVal(f) => CallTarget::UserDefined(UserDefinedFn {
                 function: f.clone(),
-                display: format!("{}({:?})", f.fn_name.clone(), f.params),
+                frame: None,
             }),
             RuntimeVal::InternalFunctionVal(f) => {
-                CallTarget::Internal(format!("velvet::internal_functions::{}(...)", f.fn_name))
+                CallTarget::InternalFunction(Rc::clone(&f.fn_name))
             }
-            _ => CallTarget::Internal(format!(
+            RuntimeVal::NativeMethodVal(m) => CallTarget::NativeMethod(m.method.name),
+            _ => CallTarget::IllegalCall(format!(
                 ">>> ILLEGAL CALL -> Caller = \"{:?}\", arglen = {} arg(s)",
-                caller,
-                cexpr.args.len()
+                callee, argc
             )),
         };
         self.call_stack.push(callstack_push);
-        if self.call_stack.len() > 100 {
-            self.call_stack.remove(0);
-        }
-        let res = match caller.as_ref() {
-            RuntimeVal::FunctionVal(r#fn) => {
-                // create sub-environment
-                let sub_environment = Rc::new(RefCell::new(SourceEnv::new(Some(Rc::clone(&env)))));
+    }
 
-                if cexpr.args.len() < r#fn.params.len() {
+    /// Rejects a call before its arguments are evaluated.
+    fn check_call(&mut self, callee: &RuntimeVal, argc: usize) {
+        match callee {
+            RuntimeVal::FunctionVal(r#fn) => {
+                if argc < r#fn.params.len() {
                     velvet_error!(
                         self,
                         "Invalid call expression: expected {} arg{} for function '{}', received {}",
                         r#fn.params.len(),
                         if r#fn.params.len() != 1 { "s" } else { "" },
                         r#fn.fn_name,
-                        cexpr.args.len()
-                    );
-                }
-
-                // set all the args for the sub environment that were supplied in the CallExpr
-                let mut i = 0;
-                let mut post_evaluate_args: Vec<String> = Vec::new();
-                for arg in &cexpr.args {
-                    let evaluated = self.evaluate(Box::new(arg.clone()), Rc::clone(&env));
-                    post_evaluate_args.push(format!(
-                        "{} = {:#?}",
-                        r#fn.params.get(i).unwrap().0,
-                        evaluated
-                    ));
-                    sub_environment.borrow_mut().declare_var(
-                        r#fn.params[i].0.clone(),
-                        *evaluated,
-                        false,
+                        argc
                     );
-                    i = i + 1;
                 }
-                let old = self.call_stack.pop().unwrap();
-                self.call_stack.push(match old {
-                    CallTarget::Internal(_) => CallTarget::Internal(format!(
-                        "{}({})",
-                        r#fn.fn_name,
-                        post_evaluate_args.join(", ")
-                    )),
-                    CallTarget::UserDefined(_) => CallTarget::UserDefined(UserDefinedFn {
-                        function: r#fn.clone(),
-                        display: format!("{}({})", r#fn.fn_name, post_evaluate_args.join(", ")),
-                    }),
-                });
+            }
+            RuntimeVal::InternalFunctionVal(_) | RuntimeVal::NativeMethodVal(_) => {}
+            _ => {
+                velvet_error!(self, "Cannot call type \"{:#?}\"", callee)
+            }
+        }
+    }
 
-                let mut last_result: Box<RuntimeVal> = Box::new(RuntimeVal::NullVal(NullVal {}));
-                for sub_expr in r#fn.execution_body.as_ref() {
-                    last_result =
-                        self.evaluate(Box::new(sub_expr.clone()), Rc::clone(&sub_environment));
-                    match last_result.as_ref() {
-                        RuntimeVal::ReturnVal(rt) => {
-                            let result =
-                                self.evaluate(rt.clone().value, Rc::clone(&sub_environment));
-                            self.call_stack.pop();
-                            return result;
+    /// Calls a value that passed `check_call`, whose call target is on top of the call stack.
+    fn call_value(
+        &mut self,
+        callee: &RuntimeVal,
+        args: Vec<RuntimeVal>,
+        env: &Rc<RefCell<SourceEnv>>,
+    ) -> Box<RuntimeVal> {
+        match callee {
+            RuntimeVal::FunctionVal(r#fn) => {
+                let is_resolved = self.resolution.layout(r#fn.definition_id).is_some();
+                let mut args = args;
+                // Frames replaced by tail calls that are still visible to the calls below them
+                let mut kept_frames = Vec::new();
+                let mut parent = Rc::clone(env);
+                loop {
+                    // create sub-environment; parameters occupy the first slots of a resolved function's frame
+                    let sub_environment = self.sub_environment(r#fn.definition_id, &parent);
+
+                    // set all the args for the sub environment that were supplied in the CallExpr
+                    for (i, evaluated) in args.into_iter().enumerate() {
+                        let evaluated = numeric::adopt_declared_type(evaluated, &r#fn.params[i].1);
+                        if is_resolved {
+                            sub_environment.borrow_mut().declare_at(i, evaluated, false);
+                        } else {
+                            sub_environment.borrow_mut().declare_var(
+                                r#fn.params[i].0.clone(),
+                                evaluated,
+                                false,
+                            );
                         }
-                        _ => {}
                     }
-                }
-                last_result
-            }
-            RuntimeVal::InternalFunctionVal(r#fn) => {
-                let mut new_args: Vec<RuntimeVal> = Vec::new();
-                let mut post_evaluate_args: Vec<String> = Vec::new();
-                for (index, arg) in cexpr.args.iter().enumerate() {
-                    let evaluated_arg = self.evaluate(Box::new(arg.clone()), Rc::clone(&env));
-                    post_evaluate_args.push(format!("param{} = {}", index, "unknown"));
-                    new_args.push(*evaluated_arg);
-                }
-                let internal_result = (r#fn.internal_callback)(new_args, Rc::clone(&env));
-                if Self::auto_reassign_methods().contains(&r#fn.fn_name.as_str()) {
-                    match *cexpr.caller.clone() {
-                        Node::Identifier(ident) => {
-                            env.borrow_mut()
-                                .attempt_assignment(ident.identifier_name, internal_result.clone());
+                    // the call's trace shows the bound arguments from now on
+                    if let Some(CallTarget::UserDefined(target)) = self.call_stack.last_mut() {
+                        target.frame = Some(Rc::clone(&sub_environment));
+                    }
+
+                    if let Some(profiler) = &mut self.profiler {
+                        profiler.enter_function(&r#fn.fn_name);
+                    }
+                    let completion =
+                        self.evaluate_tail_body(&r#fn.execution_body, r#fn, &sub_environment);
+                    if let Some(profiler) = &mut self.profiler {
+                        profiler.exit_function();
+                    }
+                    if let Some(CallTarget::UserDefined(target)) = self.call_stack.last_mut() {
+                        target.frame = None;
+                    }
+
+                    match completion {
+                        Completion::Normal(value) | Completion::Return(value) => {
+                            drop(parent);
+                            self.release_environment(sub_environment);
+                            for frame in kept_frames.into_iter().rev() {
+                                self.release_environment(frame);
+                            }
+                            return value;
                         }
-                        Node::MemberExpr(member_expr) => {
-                            if let Node::Identifier(obj_ident) = *member_expr.object {
-                                env.borrow_mut().attempt_assignment(
-                                    obj_ident.identifier_name,
-                                    internal_result.clone(),
-                                );
+                        // A self call in tail position replaces this call instead of nesting in it, so tail
+                        // recursion neither grows the Rust stack nor the call stack.
+                        Completion::TailCall(tail_args) => {
+                            // Velvet is dynamically scoped, so a frame that declared more than the parameters (which
+                            // the next call's parameters shadow) must stay reachable: it becomes the next frame's
+                            // parent instead of being released.
+                            if sub_environment.borrow().bound_count() > r#fn.params.len() {
+                                parent = Rc::clone(&sub_environment);
+                                // A kept frame that this one shadows entirely can no longer be seen, so recursion
+                                // that declares the same bindings every time still runs in constant space.
+                                let hidden = kept_frames.last().filter(|previous| {
+                                    sub_environment.borrow().shadows(&previous.borrow())
+                                });
+                                if hidden.is_some() {
+                                    let previous = kept_frames.pop().unwrap();
+                                    let grandparent = previous.borrow_mut().parent.take();
+                                    sub_environment.borrow_mut().parent = grandparent;
+                                    self.release_environment(previous);
+                                }
+                                kept_frames.push(sub_environment);
                             } else {
-                                velvet_error!(
-                                    self,
-                                    "Auto-reassign for complex member expressions not implemented"
-                                );
+                                self.release_environment(sub_environment);
                             }
-                        }
-                        _ => {
-                            velvet_error!(
-                                self,
-                                "Auto-reassign is only supported on identifiers or member expressions"
-                            );
+                            args = tail_args;
                         }
                     }
                 }
-                self.call_stack.pop();
-                return Box::new(internal_result);
             }
-            _ => {
-                velvet_error!(self, "Cannot call type \"{:#?}\"", caller)
+            RuntimeVal::InternalFunctionVal(r#fn) => {
+                Box::new((r#fn.internal_callback)(args, Rc::clone(env)))
+            }
+            RuntimeVal::NativeMethodVal(bound) => {
+                let mut receiver = (*bound.receiver).clone();
+                Box::new((bound.method.call)(
+                    &mut receiver,
+                    args,
+                    &mut MethodCall {
+                        interpreter: self,
+                        env,
+                    },
+                ))
+            }
+            _ => unreachable!("call_value on a value rejected by check_call"),
+        }
+    }
+
+    /// Evaluates statements in tail position of `r#fn`: its body, and the bodies of `if` statements in tail position.
+    fn evaluate_tail_body(
+        &mut self,
+        body: &[Node],
+        r#fn: &FunctionVal,
+        env: &Rc<RefCell<SourceEnv>>,
+    ) -> Completion {
+        let mut last_result: Box<RuntimeVal> = Box::new(RuntimeVal::NullVal(NullVal {}));
+        for sub_expr in body {
+            *last_result = RuntimeVal::NullVal(NullVal {});
+            let completion = match sub_expr {
+                Node::Return(ret) => self.profile_node(sub_expr, |interpreter| {
+                    match interpreter.self_tail_call_args(&ret.return_statement, r#fn, env) {
+                        Some(args) => Completion::TailCall(args),
+                        None => Completion::Return(
+                            interpreter.evaluate(&ret.return_statement, Rc::clone(env)),
+                        ),
+                    }
+                }),
+                Node::IfStmt(if_stmt) => self.profile_node(sub_expr, |interpreter| {
+                    if interpreter.if_condition_holds(if_stmt, env) {
+                        interpreter.evaluate_tail_body(&if_stmt.body, r#fn, env)
+                    } else {
+                        Completion::Normal(Box::new(RuntimeVal::NullVal(NullVal {})))
+                    }
+                }),
+                _ => match *self.evaluate(sub_expr, Rc::clone(env)) {
+                    RuntimeVal::ReturnVal(rt) => Completion::Return(rt.value),
+                    value => Completion::Normal(Box::new(value)),
+                },
+            };
+            match completion {
+                Completion::Normal(value) => last_result = value,
+                returned => return returned,
+            }
+        }
+        Completion::Normal(last_result)
+    }
+
+    /// The arguments of `return_statement` when it calls `r#fn` itself by name.
+    fn self_tail_call_args(
+        &mut self,
+        return_statement: &Node,
+        r#fn: &FunctionVal,
+        env: &Rc<RefCell<SourceEnv>>,
+    ) -> Option<Vec<RuntimeVal>> {
+        let Node::CallExpr(cexpr) = return_statement else {
+            return None;
+        };
+        let Node::Identifier(caller) = cexpr.caller.as_ref() else {
+            return None;
+        };
+        let callee = self.evaluate_identifier(caller, Rc::clone(env));
+        match callee.as_ref() {
+            RuntimeVal::FunctionVal(target)
+                if Rc::ptr_eq(&target.execution_body, &r#fn.execution_body) =>
+            {
+                self.check_call(&callee, cexpr.args.len());
+                Some(self.evaluate_args(&cexpr.args, env))
+            }
+            _ => None,
+        }
+    }
+
+    /// Dispatches `receiver.method(...)` straight to a built-in method, without creating a bound method value.
+    /// Mutating methods work on the receiver's binding itself, so its storage is neither copied nor reassigned.
+    fn try_call_method(
+        &mut self,
+        cexpr: &CallExpr,
+        env: &Rc<RefCell<SourceEnv>>,
+    ) -> Option<Box<RuntimeVal>> {
+        let Node::MemberExpr(mem) = cexpr.caller.as_ref() else {
+            return None;
+        };
+        let (false, Node::Identifier(property)) = (mem.is_computed, mem.property.as_ref()) else {
+            return None;
+        };
+        let method_name = &property.identifier_name;
+
+        let (method, member_value) = match mem.object.as_ref() {
+            Node::Identifier(receiver) => {
+                let address = self.resolution.address(receiver.id);
+                let method = env
+                    .borrow_mut()
+                    .binding_mut(&receiver.identifier_name, address, |var| {
+                        var.value.get_method(method_name)
+                    })
+                    .flatten()?;
+                (method, None)
+            }
+            Node::MemberExpr(inner) => {
+                let value = self.evaluate_member_expr(inner, Rc::clone(env));
+                (value.get_method(method_name)?, Some(*value))
+            }
+            _ => return None,
+        };
+
+        self.call_stack.push(CallTarget::NativeMethod(method.name));
+        let result = match (mem.object.as_ref(), member_value) {
+            (_, Some(_)) if method.mutates => {
+                velvet_error!(
+                    self,
+                    "Auto-reassign for complex member expressions not implemented"
+                );
+            }
+            (_, Some(mut value)) => {
+                let args = self.evaluate_args(&cexpr.args, env);
+                (method.call)(
+                    &mut value,
+                    args,
+                    &mut MethodCall {
+                        interpreter: self,
+                        env,
+                    },
+                )
             }
+            (Node::Identifier(receiver), None) if method.mutates => {
+                let name = &receiver.identifier_name;
+                let address = self.resolution.address(receiver.id);
+                let args = self.evaluate_args(&cexpr.args, env);
+                // Take the value out of its binding for the call, so the method holds the only reference to it.
+                let taken = env.borrow_mut().binding_mut(name, address, |var| {
+                    if !var.is_mutable {
+                        panic!("Cannot assign to immutable variable '{}'", name);
+                    }
+                    std::mem::replace(&mut var.value, RuntimeVal::NullVal(NullVal {}))
+                });
+                let Some(mut value) = taken else {
+                    velvet_error!(
+                        self,
+                        "Binding \"{}\" changed while calling {} on it",
+                        name,
+                        method.name
+                    );
+                };
+                let result = (method.call)(
+                    &mut value,
+                    args,
+                    &mut MethodCall {
+                        interpreter: self,
+                        env,
+                    },
+                );
+                env.borrow_mut()
+                    .binding_mut(name, address, |var| var.value = value);
+                result
+            }
+            (Node::Identifier(receiver), None) => {
+                let args = self.evaluate_args(&cexpr.args, env);
+                let mut value = *self.evaluate_identifier(receiver, Rc::clone(env));
+                (method.call)(
+                    &mut value,
+                    args,
+                    &mut MethodCall {
+                        interpreter: self,
+                        env,
+                    },
+                )
+            }
+            _ => unreachable!(),
         };
         self.call_stack.pop();
-        res
+        Some(Box::new(result))
     }
 
     fn evaluate_function_definition(
@@ -557,15 +932,15 @@ impl Interpreter {
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
         let this_function_val = RuntimeVal::FunctionVal(FunctionVal {
-            params: def.params.clone(),
-            fn_name: def.name.clone(),
+            params: def.params.clone().into(),
+            fn_name: def.name.as_str().into(),
             execution_body: Rc::clone(&def.body), // Reference counter clone because deep cloning nodes is not cheap
             is_internal: false,
+            definition_id: def.id,
         });
 
         // Add to env
-        env.borrow_mut()
-            .declare_var(def.name.clone(), this_function_val, false);
+        self.declare_binding(def.id, &env, &def.name, this_function_val, false);
 
         // Definitions do not return anything; it is automatically added by name to the env
         Box::new(RuntimeVal::NullVal(NullVal {}))
@@ -577,13 +952,20 @@ impl Interpreter {
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
         let assign_to = &asexp.left;
-        let assign_value = self.evaluate(asexp.value.clone(), Rc::clone(&env));
+        let assign_value = self.evaluate(&asexp.value, Rc::clone(&env));
 
         match assign_to.as_ref() {
-            Node::Identifier(ident) => {
-                env.borrow_mut()
-                    .attempt_assignment(ident.identifier_name.clone(), *assign_value);
-            }
+            Node::Identifier(ident) => match self.resolution.address(ident.id) {
+                Some(address) => env.borrow_mut().assign_at(
+                    address.depth,
+                    address.slot,
+                    &ident.identifier_name,
+                    *assign_value,
+                ),
+                None => env
+                    .borrow_mut()
+                    .attempt_assignment(ident.identifier_name.clone(), *assign_value),
+            },
             _ => {
                 velvet_error!(self, "Cannot assign to left-hand non-identifier");
             }
@@ -597,8 +979,8 @@ impl Interpreter {
         comp: &Comparator,
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
-        let lhs = self.evaluate(comp.lhs.clone(), Rc::clone(&env));
-        let rhs = self.evaluate(comp.rhs.clone(), Rc::clone(&env));
+        let lhs = self.evaluate(&comp.lhs, Rc::clone(&env));
+        let rhs = self.evaluate(&comp.rhs, Rc::clone(&env));
         //println!("COMPARE {:#?}, {:#?}", lhs, rhs);
         let result = lhs
             .compare(&rhs, &comp.op)
@@ -611,13 +993,18 @@ impl Interpreter {
         match rtv {
             RuntimeVal::NullVal(_nv) => false,
             RuntimeVal::NumberVal(n) => n.value != 0,
+            RuntimeVal::IntegerVal(i) => i.value != 0,
+            RuntimeVal::FloatVal(n) => n.value != 0.0,
             RuntimeVal::BoolVal(b) => b.value == true,
             RuntimeVal::StringVal(_) => true,
             RuntimeVal::FunctionVal(_) => true, // because why tf not
+            RuntimeVal::BytecodeFunctionVal(_) => true,
             RuntimeVal::ReturnVal(_) => true,
             RuntimeVal::InternalFunctionVal(_) => true, // because why tf not x2??
+            RuntimeVal::NativeMethodVal(_) => true,
             RuntimeVal::IteratorVal(_) => true,
             RuntimeVal::ListVal(_) => true,
+            RuntimeVal::NumberArrayVal(_) => true,
             RuntimeVal::ObjectVal(_) => true,
         }
     }
@@ -627,6 +1014,22 @@ impl Interpreter {
         if_stmt: &IfStmt,
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
+        if self.if_condition_holds(if_stmt, &env) {
+            let mut last_result: Box<RuntimeVal> = Box::new(RuntimeVal::NullVal(NullVal {}));
+            for sub_node in &if_stmt.body {
+                *last_result = RuntimeVal::NullVal(NullVal {});
+                last_result = self.evaluate(sub_node, Rc::clone(&env));
+                // A return leaves the body, and is caught by the enclosing block, loop or function
+                if matches!(*last_result, RuntimeVal::ReturnVal(_)) {
+                    break;
+                }
+            }
+            return last_result;
+        }
+        Box::new(RuntimeVal::NullVal(NullVal {}))
+    }
+
+    fn if_condition_holds(&mut self, if_stmt: &IfStmt, env: &Rc<RefCell<SourceEnv>>) -> bool {
         let condition_node = if_stmt.condition.as_ref();
 
         // TODO: see about using self.is_truthy instead; add case to is_truthy to run itself on Comparators
@@ -636,16 +1039,8 @@ impl Interpreter {
             _ => velvet_error!(self, "If condition must be a comparator expression"),
         };
 
-        let condition_result = self.evaluate_comparator_expr(comparator, Rc::clone(&env));
-
-        if self.is_truthy(&*condition_result, Rc::clone(&env)) {
-            let mut last_result: Box<RuntimeVal> = Box::new(RuntimeVal::NullVal(NullVal {}));
-            for sub_node in &if_stmt.body {
-                last_result = self.evaluate(Box::new(sub_node.clone()), Rc::clone(&env));
-            }
-            return last_result;
-        }
-        Box::new(RuntimeVal::NullVal(NullVal {}))
+        let condition_result = self.evaluate_comparator_expr(comparator, Rc::clone(env));
+        self.is_truthy(&*condition_result, Rc::clone(env))
     }
 
     fn evaluate_while_stmt(
@@ -664,10 +1059,15 @@ impl Interpreter {
             let condition_result = self.evaluate_comparator_expr(comparator, Rc::clone(&env));
             self.is_truthy(&*condition_result, Rc::clone(&env))
         } {
-            let sub_environment = Rc::new(RefCell::new(SourceEnv::new(Some(Rc::clone(&env)))));
+            let sub_environment = self.sub_environment(while_loop.id, &env);
             for sub_node in &while_loop.body {
-                self.evaluate(Box::new(sub_node.clone()), Rc::clone(&sub_environment));
+                let result = self.evaluate(sub_node, Rc::clone(&sub_environment));
+                if matches!(*result, RuntimeVal::ReturnVal(_)) {
+                    self.release_environment(sub_environment);
+                    return result;
+                }
             }
+            self.release_environment(sub_environment);
         }
 
         Box::new(RuntimeVal::NullVal(NullVal {}))
@@ -679,9 +1079,9 @@ impl Interpreter {
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
         if &identifier.identifier_name == "__CALL_STACK" {
-            self.call_stack.push(CallTarget::Internal(String::from(
+            self.call_stack.push(CallTarget::Internal(
                 "velvet::internal_identifier_exceptions::call_stack_getter",
-            )));
+            ));
             let mut end_stack_string = format!(
                 "\n0 = latest call; {} = first call; % = Rust thread\nvelvet call stack:",
                 self.call_stack.len() - 1
@@ -689,13 +1089,13 @@ impl Interpreter {
             let mut index = 0;
             for call in self.call_stack.iter().rev() {
                 match call {
-                    CallTarget::Internal(i) => {
-                        end_stack_string =
-                            end_stack_string + format!("\n {} → % {}", index, i).as_str();
+                    CallTarget::UserDefined(_) => {
+                        end_stack_string = end_stack_string
+                            + format!("\n {} →   {}", index, call.display()).as_str();
                     }
-                    CallTarget::UserDefined(u) => {
-                        end_stack_string =
-                            end_stack_string + format!("\n {} →   {}", index, u.display).as_str();
+                    _ => {
+                        end_stack_string = end_stack_string
+                            + format!("\n {} → % {}", index, call.display()).as_str();
                     }
                 }
                 index = index + 1
@@ -703,14 +1103,17 @@ impl Interpreter {
             self.call_stack.pop();
 
             return Box::new(RuntimeVal::StringVal(StringVal {
-                value: end_stack_string,
+                value: end_stack_string.into(),
             }));
         }
         let value = {
             let borrowed = env.borrow();
-            borrowed
-                .fetch(&identifier.identifier_name)
-                .map(|v| v.value.clone())
+            // A resolved slot is unbound only when its declaration was skipped (e.g. inside an `if`), in which case
+            // the name is visible from further out, as it would have been without resolution.
+            self.resolution
+                .address(identifier.id)
+                .and_then(|address| borrowed.fetch_at(address.depth, address.slot))
+                .or_else(|| borrowed.fetch(&identifier.identifier_name).map(|v| v.value))
         };
 
         match value {
@@ -730,11 +1133,14 @@ impl Interpreter {
         declaration: &VarDeclaration,
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
-        if env
-            .borrow()
-            .fetch_local(&declaration.var_identifier)
-            .is_some()
-        {
+        let is_declared = match self.resolution.address(declaration.id) {
+            Some(address) => env.borrow().is_bound(address.slot),
+            None => env
+                .borrow()
+                .fetch_local(&declaration.var_identifier)
+                .is_some(),
+        };
+        if is_declared {
             velvet_error!(
                 self,
                 "Attempt to redeclare local binding \"{}\"",
@@ -742,11 +1148,13 @@ impl Interpreter {
             );
         }
 
-        let rhs = self.evaluate(declaration.var_value.clone(), Rc::clone(&env));
+        let rhs = self.evaluate(&declaration.var_value, Rc::clone(&env));
 
-        env.borrow_mut().declare_var(
-            declaration.var_identifier.clone(),
-            *rhs,
+        self.declare_binding(
+            declaration.id,
+            &env,
+            &declaration.var_identifier,
+            numeric::adopt_declared_type(*rhs, &declaration.var_type),
             declaration.is_mutable,
         );
 
@@ -758,8 +1166,8 @@ impl Interpreter {
         binop: &BinaryExpr,
         env: Rc<RefCell<SourceEnv>>,
     ) -> Box<RuntimeVal> {
-        let left_result = self.evaluate(binop.left.clone(), Rc::clone(&env));
-        let right_result = self.evaluate(binop.right.clone(), Rc::clone(&env));
+        let left_result = self.evaluate(&binop.left, Rc::clone(&env));
+        let right_result = self.evaluate(&binop.right, Rc::clone(&env));
 
         match (&*left_result, &*right_result) {
             (RuntimeVal::NumberVal(left_num), RuntimeVal::NumberVal(right_num)) => {
@@ -776,9 +1184,10 @@ impl Interpreter {
                 return Box::new(RuntimeVal::NumberVal(NumberVal { value: end_result }));
             }
             (RuntimeVal::StringVal(left_str), RuntimeVal::StringVal(right_str)) => {
-                let end_result: String;
+                let end_result;
                 match binop.op.as_str() {
-                    "+" => end_result = left_str.value.clone() + &right_str.value,
+                    // Appends into the left string's buffer when it has room, instead of copying both sides
+                    "+" => end_result = left_str.value.concat(&right_str.value),
                     _ => {
                         velvet_error!(
                             self,
@@ -788,19 +1197,35 @@ impl Interpreter {
                     }
                 };
 
-                return Box::new(RuntimeVal::StringVal(StringVal {
-                    value: end_result.to_string(),
-                }));
+                return Box::new(RuntimeVal::StringVal(StringVal { value: end_result }));
             }
-            _ => {
-                velvet_error!(
+            (left, right) => match numeric::arithmetic(left, &binop.op, right) {
+                Some(Ok(result)) => Box::new(result),
+                Some(Err(err)) => velvet_error!(self, "Binary expression error: {}", err),
+                None => velvet_error!(
                     self,
                     "Binary expression operands must be numbers, received {} and {} with operator {}.",
                     left_result,
                     right_result,
                     binop.op
-                );
-            }
+                ),
+            },
+        }
+    }
+
+    fn evaluate_type_cast(
+        &mut self,
+        cast: &TypeCast,
+        env: Rc<RefCell<SourceEnv>>,
+    ) -> Box<RuntimeVal> {
+        let value = self.evaluate(&cast.left, env);
+        // Casts to other types are checked by the typechecker and leave the value as it is
+        let Some(target) = NumericType::from_type(&cast.target_type) else {
+            return value;
+        };
+        match numeric::convert(&value, target) {
+            Ok(converted) => Box::new(converted),
+            Err(err) => velvet_error!(self, "Type cast error: {}", err),
         }
     }
 }
@@ -0,0 +1,223 @@
+use std::{
+    cell::RefCell,
+    fmt,
+    io::BufRead,
+    rc::Rc,
+    sync::{Mutex, PoisonError},
+};
+
+use crate::runtime::{
+    methods::is_true,
+    strings::{self, SharedStr},
+    values::{IteratorVal, MethodContext, NumberVal, RuntimeVal, StringVal},
+};
+
+/// Where an iterator's elements come from. Every source holds only its position, so pulling the next element never
+/// materializes the rest, and an iterator costs the same memory however many elements it yields.
+#[derive(Debug, Clone)]
+pub enum IterSource {
+    /// The numbers from `next` up to, but not including, `end`.
+    Range {
+        next: isize,
+        end: isize,
+        step: isize,
+    },
+    /// The pieces of `input` between occurrences of `delimiter`, from byte `offset` on; `None` once the last piece
+    /// has been yielded.
+    Split {
+        input: SharedStr,
+        delimiter: SharedStr,
+        offset: Option<usize>,
+    },
+    /// The elements of a list (in either representation) from `index` on.
+    List { list: Box<RuntimeVal>, index: usize },
+    Map {
+        inner: IteratorVal,
+        function: Box<RuntimeVal>,
+    },
+    Filter {
+        inner: IteratorVal,
+        predicate: Box<RuntimeVal>,
+    },
+    Take {
+        inner: IteratorVal,
+        remaining: usize,
+    },
+    /// The lines of a file or of stdin. Copies of the iterator share the reader, and so advance the same stream.
+    Lines { reader: Rc<LineReader> },
+}
+
+/// A buffered text stream read a line at a time, for `io.lines` and `io.stdin_lines`.
+pub struct LineReader {
+    reader: LineSource,
+    /// Reused for every line, so a line costs only the allocation of its string.
+    buffer: RefCell<Vec<u8>>,
+}
+
+enum LineSource {
+    Owned(RefCell<Box<dyn BufRead>>),
+    /// A stream read from every thread, such as stdin, whose buffered input must not be split between readers.
+    Shared(&'static Mutex<dyn BufRead + Send>),
+}
+
+impl fmt::Debug for LineReader {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str("LineReader")
+    }
+}
+
+impl LineReader {
+    pub fn new(reader: impl BufRead + 'static) -> Self {
+        Self {
+            reader: LineSource::Owned(RefCell::new(Box::new(reader))),
+            buffer: RefCell::new(Vec::new()),
+        }
+    }
+
+    /// Reads lines from `reader`, which every `LineReader` made from it shares, on any thread.
+    pub fn shared(reader: &'static Mutex<dyn BufRead + Send>) -> Self {
+        Self {
+            reader: LineSource::Shared(reader),
+            buffer: RefCell::new(Vec::new()),
+        }
+    }
+
+    /// The next line without its `\n` or `\r\n`, with invalid UTF-8 replaced; `None` at the end of the stream.
+    pub fn read_line(&self) -> Option<SharedStr> {
+        let mut buffer = self.buffer.borrow_mut();
+        buffer.clear();
+        let read = match &self.reader {
+            LineSource::Owned(reader) => reader.borrow_mut().read_until(b'\n', &mut buffer),
+            // A panic while reading leaves no partial line behind worth refusing later reads for
+            LineSource::Shared(reader) => reader
+                .lock()
+                .unwrap_or_else(PoisonError::into_inner)
+                .read_until(b'\n', &mut buffer),
+        }
+        .unwrap_or_else(|err| panic!("Failed to read line: {}", err));
+        if read == 0 {
+            return None;
+        }
+        let line = buffer.strip_suffix(b"\n").unwrap_or(&buffer);
+        let line = line.strip_suffix(b"\r").unwrap_or(line);
+        Some(String::from_utf8_lossy(line).into_owned().into())
+    }
+}
+
+impl IteratorVal {
+    pub fn new(source: IterSource) -> Self {
+        Self {
+            source: Box::new(source),
+        }
+    }
+
+    /// Errors if `step` is zero, which would never reach `end`.
+    pub fn range(start: isize, end: isize, step: isize) -> Result<Self, String> {
+        if step == 0 {
+            return Err(String::from("range step cannot be zero"));
+        }
+        Ok(Self::new(IterSource::Range {
+            next: start,
+            end,
+            step,
+        }))
+    }
+
+    /// Splits like `string.split`. An empty delimiter yields the characters of `input`.
+    pub fn split(input: SharedStr, delimiter: SharedStr) -> Self {
+        Self::new(IterSource::Split {
+            input,
+            delimiter,
+            offset: Some(0),
+        })
+    }
+
+    pub fn lines(reader: Rc<LineReader>) -> Self {
+        Self::new(IterSource::Lines { reader })
+    }
+
+    pub fn over_list(list: RuntimeVal) -> Self {
+        Self::new(IterSource::List {
+            list: Box::new(list),
+            index: 0,
+        })
+    }
+
+    pub fn name(&self) -> &'static str {
+        match *self.source {
+            IterSource::Range { .. } => "range",
+            IterSource::Split { .. } => "split",
+            IterSource::List { .. } => "list",
+            IterSource::Map { .. } => "map",
+            IterSource::Filter { .. } => "filter",
+            IterSource::Take { .. } => "take",
+            IterSource::Lines { .. } => "lines",
+        }
+    }
+
+    /// Advances the iterator, calling back through `ctx` for the functions of `map` and `filter`.
+    pub fn next(&mut self, ctx: &mut dyn MethodContext) -> Option<RuntimeVal> {
+        match self.source.as_mut() {
+            IterSource::Range { next, end, step } => {
+                let done = if *step > 0 {
+                    *next >= *end
+                } else {
+                    *next <= *end
+                };
+                if done {
+                    return None;
+                }
+                let value = *next;
+                *next = next.saturating_add(*step);
+                Some(RuntimeVal::NumberVal(NumberVal { value }))
+            }
+            IterSource::Split {
+                input,
+                delimiter,
+                offset,
+            } => {
+                let start = (*offset)?;
+                let rest = &input[start..];
+                // Pieces are slices of the input, not copies
+                let (end, next) = if delimiter.is_empty() {
+                    let c = rest.chars().next()?;
+                    (start + c.len_utf8(), Some(start + c.len_utf8()))
+                } else {
+                    match strings::find(rest, delimiter) {
+                        Some(at) => (start + at, Some(start + at + delimiter.len())),
+                        None => (input.len(), None),
+                    }
+                };
+                *offset = next;
+                Some(RuntimeVal::StringVal(StringVal {
+                    value: input.slice(start..end),
+                }))
+            }
+            IterSource::List { list, index } => {
+                let element = list.list_element(*index)?;
+                *index += 1;
+                Some(element)
+            }
+            IterSource::Map { inner, function } => {
+                let element = inner.next(ctx)?;
+                Some(ctx.call_function(function, vec![element]))
+            }
+            IterSource::Filter { inner, predicate } => loop {
+                let element = inner.next(ctx)?;
+                if is_true(&ctx.call_function(predicate, vec![element.clone()])) {
+                    return Some(element);
+                }
+            },
+            IterSource::Take { inner, remaining } => {
+                if *remaining == 0 {
+                    return None;
+                }
+                *remaining -= 1;
+                inner.next(ctx)
+            }
+            IterSource::Lines { reader } => reader
+                .read_line()
+                .map(|value| RuntimeVal::StringVal(StringVal { value })),
+        }
+    }
+}
@@ -0,0 +1,168 @@
+use crate::{
+    parser::nodetypes::Node,
+    runtime::{
+        numeric::NumericType,
+        values::{FunctionVal, RuntimeVal},
+        vm::bytecode::{FunctionProto, Op},
+    },
+};
+
+// Bulk operations over unboxed `number`s, for the methods of `NumberArrayVal`. Each loop is a plain fold or map over
+// slices with wrapping arithmetic, no early exits and zipped rather than indexed operands, which leaves no bounds
+// checks or overflow branches in the loop body for LLVM's vectorizer to trip over.
+
+pub fn sum(values: &[isize]) -> isize {
+    values.iter().fold(0, |acc, &x| acc.wrapping_add(x))
+}
+
+pub fn min(values: &[isize]) -> Option<isize> {
+    values.iter().copied().reduce(isize::min)
+}
+
+pub fn max(values: &[isize]) -> Option<isize> {
+    values.iter().copied().reduce(isize::max)
+}
+
+/// Callers check that both slices have the same length.
+pub fn dot(left: &[isize], right: &[isize]) -> isize {
+    left.iter()
+        .zip(right)
+        .fold(0, |acc, (&l, &r)| acc.wrapping_add(l.wrapping_mul(r)))
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum ArithOp {
+    Add,
+    Sub,
+    Mul,
+    Div,
+}
+
+impl ArithOp {
+    fn from_symbol(symbol: &str) -> Option<Self> {
+        match symbol {
+            "+" => Some(Self::Add),
+            "-" => Some(Self::Sub),
+            "*" => Some(Self::Mul),
+            "/" => Some(Self::Div),
+            _ => None,
+        }
+    }
+
+    fn from_op(op: Op) -> Option<Self> {
+        match op {
+            Op::Add => Some(Self::Add),
+            Op::Sub => Some(Self::Sub),
+            Op::Mul => Some(Self::Mul),
+            Op::Div => Some(Self::Div),
+            _ => None,
+        }
+    }
+
+    fn apply(self, l: isize, r: isize) -> isize {
+        match self {
+            Self::Add => l.wrapping_add(r),
+            Self::Sub => l.wrapping_sub(r),
+            Self::Mul => l.wrapping_mul(r),
+            Self::Div => l.wrapping_div(r),
+        }
+    }
+}
+
+/// Element-wise `left op right`. Callers check that both slices have the same length, and that no divisor is zero.
+pub fn zip_with(left: &[isize], op: ArithOp, right: &[isize]) -> Vec<isize> {
+    left.iter()
+        .zip(right)
+        .map(|(&l, &r)| op.apply(l, r))
+        .collect()
+}
+
+/// The `map` callbacks that can run as a single loop: a `number` parameter combined with a constant by one arithmetic
+/// operator, as in `-> double(x as number) => number { ; x * 2 }`.
+#[derive(Debug, Clone, Copy)]
+pub struct MapKernel {
+    op: ArithOp,
+    constant: isize,
+    /// `constant op x` rather than `x op constant`.
+    constant_first: bool,
+}
+
+impl MapKernel {
+    pub fn from_function(function: &RuntimeVal) -> Option<Self> {
+        match function {
+            RuntimeVal::FunctionVal(function) => Self::from_definition(function),
+            RuntimeVal::BytecodeFunctionVal(function) => Self::from_proto(&function.proto),
+            _ => None,
+        }
+    }
+
+    fn from_definition(function: &FunctionVal) -> Option<Self> {
+        let [(param, declared)] = &function.params[..] else {
+            return None;
+        };
+        if NumericType::adopted_by(declared).is_some() {
+            return None;
+        }
+        let mut body = function
+            .execution_body
+            .iter()
+            .filter(|node| !matches!(node, Node::NoOpNode(_)));
+        let (Some(Node::Return(ret)), None) = (body.next(), body.next()) else {
+            return None;
+        };
+        let Node::BinaryExpr(bin) = ret.return_statement.as_ref() else {
+            return None;
+        };
+        let is_param =
+            |node: &Node| matches!(node, Node::Identifier(i) if i.identifier_name == *param);
+        let (constant, constant_first) = match (bin.left.as_ref(), bin.right.as_ref()) {
+            (l, Node::NumericLiteral(r)) if is_param(l) => (r.value, false),
+            (Node::NumericLiteral(l), r) if is_param(r) => (l.value, true),
+            _ => return None,
+        };
+        Self::new(
+            ArithOp::from_symbol(&bin.op)?,
+            isize::try_from(constant).ok()?,
+            constant_first,
+        )
+    }
+
+    fn from_proto(proto: &FunctionProto) -> Option<Self> {
+        let [(_, declared)] = &proto.params[..] else {
+            return None;
+        };
+        if NumericType::adopted_by(declared).is_some() {
+            return None;
+        }
+        let (constant, constant_first, op) = match proto.chunk.code[..] {
+            [Op::LoadLocal(0), Op::Constant(c), op, Op::Return, ..] => (c, false, op),
+            [Op::Constant(c), Op::LoadLocal(0), op, Op::Return, ..] => (c, true, op),
+            _ => return None,
+        };
+        let RuntimeVal::NumberVal(constant) = &proto.chunk.constants[constant as usize] else {
+            return None;
+        };
+        Self::new(ArithOp::from_op(op)?, constant.value, constant_first)
+    }
+
+    /// Divisions that could divide by zero stay calls, so the error is raised where the program would raise it.
+    fn new(op: ArithOp, constant: isize, constant_first: bool) -> Option<Self> {
+        if op == ArithOp::Div && (constant_first || constant == 0) {
+            return None;
+        }
+        Some(Self {
+            op,
+            constant,
+            constant_first,
+        })
+    }
+
+    pub fn apply(&self, values: &[isize]) -> Vec<isize> {
+        let (op, constant) = (self.op, self.constant);
+        if self.constant_first {
+            values.iter().map(|&x| op.apply(constant, x)).collect()
+        } else {
+            values.iter().map(|&x| op.apply(x, constant)).collect()
+        }
+    }
+}
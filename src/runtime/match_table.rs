@@ -0,0 +1,142 @@
+use std::collections::HashMap;
+
+use crate::{
+    parser::nodetypes::Node,
+    runtime::{strings::SharedStr, values::RuntimeVal},
+};
+
+/// The numbers of a match's number arms, mapped to the first arm with each.
+#[derive(Debug, Clone, PartialEq)]
+enum NumberArms {
+    /// A jump table indexed by `number - min`, used while the numbers are close together.
+    Dense {
+        min: isize,
+        arms: Box<[Option<usize>]>,
+    },
+    Hashed(HashMap<isize, usize>),
+}
+
+impl NumberArms {
+    fn new(numbers: HashMap<isize, usize>) -> Self {
+        let (Some(&min), Some(&max)) = (numbers.keys().min(), numbers.keys().max()) else {
+            return Self::Hashed(numbers);
+        };
+        let span = max.abs_diff(min);
+        if span >= numbers.len().saturating_mul(4) {
+            return Self::Hashed(numbers);
+        }
+        let mut arms = vec![None; span + 1];
+        for (number, arm) in numbers {
+            arms[number.abs_diff(min)] = Some(arm);
+        }
+        Self::Dense {
+            min,
+            arms: arms.into(),
+        }
+    }
+
+    fn get(&self, number: isize) -> Option<usize> {
+        match self {
+            Self::Dense { min, arms } => {
+                let index = number.checked_sub(*min)?;
+                *arms.get(usize::try_from(index).ok()?)?
+            }
+            Self::Hashed(numbers) => numbers.get(&number).copied(),
+        }
+    }
+}
+
+/// The arms a match target still has to be tried against, in order: `fallbacks`, then `literal`.
+#[derive(Debug, Clone, Copy)]
+pub struct Candidates<'a> {
+    /// The arms that cannot be looked up by value and come before `literal`.
+    pub fallbacks: &'a [usize],
+    /// The first number, string or bool literal arm equal to the target; it matches if no fallback does.
+    pub literal: Option<usize>,
+}
+
+/// A match expression lowered to a lookup: its number, string and bool literal arms are found by the target's value
+/// instead of being compared against it one by one. Every other arm (predicates, bindings, float and null literals)
+/// is a fallback, still tried in source order ahead of any literal arm that follows it, so the arm taken and the
+/// patterns evaluated are the same as trying every arm in turn.
+#[derive(Debug, Clone, PartialEq)]
+pub struct MatchTable {
+    numbers: NumberArms,
+    strings: HashMap<SharedStr, usize>,
+    bools: [Option<usize>; 2],
+    /// The literal arms the lookup can select, in order.
+    dispatched: Box<[usize]>,
+    fallbacks: Box<[usize]>,
+}
+
+impl MatchTable {
+    /// `None` if fewer than two arms could be looked up, where trying the arms in turn costs no more.
+    pub fn new(arms: &[(Node, Node)]) -> Option<Self> {
+        let mut numbers = HashMap::new();
+        let mut strings = HashMap::new();
+        let mut bools = [None; 2];
+        let mut dispatched = Vec::new();
+        let mut fallbacks = Vec::new();
+        for (arm, (pattern, _)) in arms.iter().enumerate() {
+            // Literals too large for a number stay fallbacks, so they fail as they would when evaluated in turn
+            let first = match pattern {
+                Node::NumericLiteral(nl) => match isize::try_from(nl.value) {
+                    Ok(value) => *numbers.entry(value).or_insert(arm) == arm,
+                    Err(_) => {
+                        fallbacks.push(arm);
+                        continue;
+                    }
+                },
+                Node::StringLiteral(sl) => *strings.entry(sl.value.clone()).or_insert(arm) == arm,
+                Node::BoolLiteral(bl) => {
+                    *bools[bl.literal_value as usize].get_or_insert(arm) == arm
+                }
+                _ => {
+                    fallbacks.push(arm);
+                    continue;
+                }
+            };
+            // A repeated literal is never reached: the first arm with it always matches first
+            if first {
+                dispatched.push(arm);
+            }
+        }
+        if dispatched.len() < 2 {
+            return None;
+        }
+        Some(Self {
+            numbers: NumberArms::new(numbers),
+            strings,
+            bools,
+            dispatched: dispatched.into(),
+            fallbacks: fallbacks.into(),
+        })
+    }
+
+    /// `None` for targets other than numbers, strings and bools. Sized integers and floats can equal number literals,
+    /// so matches on them try every arm in turn.
+    pub fn candidates(&self, target: &RuntimeVal) -> Option<Candidates<'_>> {
+        let literal = match target {
+            RuntimeVal::NumberVal(n) => self.numbers.get(n.value),
+            RuntimeVal::StringVal(s) => self.strings.get(&*s.value).copied(),
+            RuntimeVal::BoolVal(b) => self.bools[b.value as usize],
+            _ => return None,
+        };
+        Some(Candidates {
+            fallbacks: self.fallbacks_before(literal),
+            literal,
+        })
+    }
+
+    pub fn dispatched(&self) -> &[usize] {
+        &self.dispatched
+    }
+
+    /// The fallback arms ahead of `arm`, or all of them for `None`.
+    pub fn fallbacks_before(&self, arm: Option<usize>) -> &[usize] {
+        match arm {
+            Some(arm) => &self.fallbacks[..self.fallbacks.partition_point(|&f| f < arm)],
+            None => &self.fallbacks,
+        }
+    }
+}
@@ -0,0 +1,822 @@
+use std::{borrow::Cow, cmp::Ordering, rc::Rc};
+
+use crate::{
+    runtime::{
+        iterators::IterSource,
+        kernels::{self, ArithOp, MapKernel},
+        values::{
+            HasMethods, IteratorVal, ListVal, MethodContext, NativeMethod, NullVal, NumberArrayVal,
+            NumberVal, RuntimeVal,
+        },
+    },
+    velvet_error,
+};
+
+/// The built-in methods of lists. `push`, `pop`, `insert` and `sort` modify the list they are called on; the others
+/// leave it untouched and return a new value.
+const LIST_METHODS: &[NativeMethod] = &[
+    NativeMethod {
+        name: "push",
+        mutates: true,
+        call: list_push,
+    },
+    NativeMethod {
+        name: "pop",
+        mutates: true,
+        call: list_pop,
+    },
+    NativeMethod {
+        name: "insert",
+        mutates: true,
+        call: list_insert,
+    },
+    NativeMethod {
+        name: "sort",
+        mutates: true,
+        call: list_sort,
+    },
+    NativeMethod {
+        name: "len",
+        mutates: false,
+        call: list_len,
+    },
+    NativeMethod {
+        name: "slice",
+        mutates: false,
+        call: list_slice,
+    },
+    NativeMethod {
+        name: "map",
+        mutates: false,
+        call: list_map,
+    },
+    NativeMethod {
+        name: "filter",
+        mutates: false,
+        call: list_filter,
+    },
+    NativeMethod {
+        name: "reduce",
+        mutates: false,
+        call: list_reduce,
+    },
+    NativeMethod {
+        name: "iter",
+        mutates: false,
+        call: list_iter,
+    },
+    NativeMethod {
+        name: "sum",
+        mutates: false,
+        call: numbers_sum,
+    },
+    NativeMethod {
+        name: "min",
+        mutates: false,
+        call: numbers_min,
+    },
+    NativeMethod {
+        name: "max",
+        mutates: false,
+        call: numbers_max,
+    },
+    NativeMethod {
+        name: "dot",
+        mutates: false,
+        call: numbers_dot,
+    },
+    NativeMethod {
+        name: "add",
+        mutates: false,
+        call: numbers_add,
+    },
+    NativeMethod {
+        name: "mul",
+        mutates: false,
+        call: numbers_mul,
+    },
+];
+
+/// The methods of `number[]` lists: the list methods, with the numeric ones running over the unboxed elements.
+const NUMBER_ARRAY_METHODS: &[NativeMethod] = &[
+    NativeMethod {
+        name: "push",
+        mutates: true,
+        call: array_push,
+    },
+    NativeMethod {
+        name: "pop",
+        mutates: true,
+        call: array_pop,
+    },
+    NativeMethod {
+        name: "insert",
+        mutates: true,
+        call: array_insert,
+    },
+    NativeMethod {
+        name: "sort",
+        mutates: true,
+        call: array_sort,
+    },
+    NativeMethod {
+        name: "len",
+        mutates: false,
+        call: array_len,
+    },
+    NativeMethod {
+        name: "slice",
+        mutates: false,
+        call: array_slice,
+    },
+    NativeMethod {
+        name: "map",
+        mutates: false,
+        call: array_map,
+    },
+    NativeMethod {
+        name: "filter",
+        mutates: false,
+        call: array_filter,
+    },
+    NativeMethod {
+        name: "reduce",
+        mutates: false,
+        call: array_reduce,
+    },
+    NativeMethod {
+        name: "iter",
+        mutates: false,
+        call: list_iter,
+    },
+    NativeMethod {
+        name: "sum",
+        mutates: false,
+        call: numbers_sum,
+    },
+    NativeMethod {
+        name: "min",
+        mutates: false,
+        call: numbers_min,
+    },
+    NativeMethod {
+        name: "max",
+        mutates: false,
+        call: numbers_max,
+    },
+    NativeMethod {
+        name: "dot",
+        mutates: false,
+        call: numbers_dot,
+    },
+    NativeMethod {
+        name: "add",
+        mutates: false,
+        call: numbers_add,
+    },
+    NativeMethod {
+        name: "mul",
+        mutates: false,
+        call: numbers_mul,
+    },
+];
+
+impl HasMethods for ListVal {
+    fn get_methods(&self) -> &'static [NativeMethod] {
+        LIST_METHODS
+    }
+}
+
+impl HasMethods for NumberArrayVal {
+    fn get_methods(&self) -> &'static [NativeMethod] {
+        NUMBER_ARRAY_METHODS
+    }
+}
+
+/// The adapters of iterators, which wrap the iterator in a new lazy one, and `collect`, which drains it into a list.
+const ITERATOR_METHODS: &[NativeMethod] = &[
+    NativeMethod {
+        name: "map",
+        mutates: false,
+        call: iterator_map,
+    },
+    NativeMethod {
+        name: "filter",
+        mutates: false,
+        call: iterator_filter,
+    },
+    NativeMethod {
+        name: "take",
+        mutates: false,
+        call: iterator_take,
+    },
+    NativeMethod {
+        name: "collect",
+        mutates: false,
+        call: iterator_collect,
+    },
+];
+
+impl HasMethods for IteratorVal {
+    fn get_methods(&self) -> &'static [NativeMethod] {
+        ITERATOR_METHODS
+    }
+}
+
+fn receiver<'a>(value: &'a mut RuntimeVal, ctx: &mut dyn MethodContext) -> &'a mut ListVal {
+    match value {
+        RuntimeVal::ListVal(list) => list,
+        other => velvet_error!(ctx, "Expected a list receiver, received {:?}", other),
+    }
+}
+
+fn array_receiver<'a>(
+    value: &'a mut RuntimeVal,
+    ctx: &mut dyn MethodContext,
+) -> &'a mut NumberArrayVal {
+    match value {
+        RuntimeVal::NumberArrayVal(array) => array,
+        other => velvet_error!(ctx, "Expected a number[] receiver, received {:?}", other),
+    }
+}
+
+/// The numbers held by a list, borrowed from a `number[]` and copied out of any other list. `None` if the value is
+/// not a list, or holds something other than numbers.
+fn as_numbers(value: &RuntimeVal) -> Option<Cow<'_, [isize]>> {
+    match value {
+        RuntimeVal::NumberArrayVal(array) => Some(Cow::Borrowed(&array.values[..])),
+        RuntimeVal::ListVal(list) => list
+            .to_number_array()
+            .map(|array| Cow::Owned(Rc::unwrap_or_clone(array.values))),
+        _ => None,
+    }
+}
+
+fn numbers_arg<'a>(
+    ctx: &mut dyn MethodContext,
+    method: &str,
+    value: &'a RuntimeVal,
+) -> Cow<'a, [isize]> {
+    match as_numbers(value) {
+        Some(numbers) => numbers,
+        None => velvet_error!(
+            ctx,
+            "Method '{}' expects a list of numbers, received {:?}",
+            method,
+            value
+        ),
+    }
+}
+
+/// Wraps the numbers a method produced in the receiver's representation.
+fn numbers_like(receiver: &RuntimeVal, values: Vec<isize>) -> RuntimeVal {
+    let array = NumberArrayVal {
+        values: values.into(),
+    };
+    match receiver {
+        RuntimeVal::NumberArrayVal(_) => RuntimeVal::NumberArrayVal(array),
+        _ => RuntimeVal::ListVal(array.to_list()),
+    }
+}
+
+fn number_or_null(value: Option<isize>) -> RuntimeVal {
+    match value {
+        Some(value) => RuntimeVal::NumberVal(NumberVal { value }),
+        None => RuntimeVal::NullVal(NullVal {}),
+    }
+}
+
+fn expect_args(
+    ctx: &mut dyn MethodContext,
+    method: &str,
+    args: &[RuntimeVal],
+    min: usize,
+    max: usize,
+) {
+    if args.len() < min || args.len() > max {
+        let expected = if min == max {
+            min.to_string()
+        } else {
+            format!("{} to {}", min, max)
+        };
+        velvet_error!(
+            ctx,
+            "Invalid call expression: expected {} arg{} for method '{}', received {}",
+            expected,
+            if max != 1 { "s" } else { "" },
+            method,
+            args.len()
+        );
+    }
+}
+
+fn index_arg(ctx: &mut dyn MethodContext, method: &str, value: &RuntimeVal) -> usize {
+    match value {
+        RuntimeVal::NumberVal(n) if n.value >= 0 => n.value as usize,
+        _ => velvet_error!(
+            ctx,
+            "Method '{}' expects a non-negative integer index, received {:?}",
+            method,
+            value
+        ),
+    }
+}
+
+pub fn is_true(value: &RuntimeVal) -> bool {
+    matches!(value, RuntimeVal::BoolVal(b) if b.value)
+}
+
+fn list_push(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    receiver(value, ctx).extend(args);
+    value.clone()
+}
+
+fn list_pop(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "pop", &args, 0, 0);
+    let list = receiver(value, ctx);
+    if list.values.is_empty() {
+        return RuntimeVal::NullVal(NullVal {});
+    }
+    list.values_mut().pop().unwrap()
+}
+
+fn list_insert(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "insert", &args, 2, 2);
+    let index = index_arg(ctx, "insert", &args[0]);
+    let list = receiver(value, ctx);
+    if index > list.values.len() {
+        velvet_error!(ctx, "Index {} is out of bounds!", index);
+    }
+    let [_, element] = <[RuntimeVal; 2]>::try_from(args).unwrap();
+    list.values_mut().insert(index, element);
+    value.clone()
+}
+
+/// Sorts numbers or strings in ascending order; lists mixing the two (or holding anything else) cannot be sorted.
+fn list_sort(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "sort", &args, 0, 0);
+    let list = receiver(value, ctx);
+    let sortable = list
+        .values
+        .iter()
+        .all(|v| matches!(v, RuntimeVal::NumberVal(_)))
+        || list
+            .values
+            .iter()
+            .all(|v| matches!(v, RuntimeVal::StringVal(_)));
+    if !sortable {
+        velvet_error!(
+            ctx,
+            "Cannot sort a list unless it holds only numbers or only strings."
+        );
+    }
+    list.values_mut().sort_by(|a, b| match (a, b) {
+        (RuntimeVal::NumberVal(l), RuntimeVal::NumberVal(r)) => l.value.cmp(&r.value),
+        (RuntimeVal::StringVal(l), RuntimeVal::StringVal(r)) => l.value.cmp(&r.value),
+        _ => Ordering::Equal,
+    });
+    value.clone()
+}
+
+fn list_len(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "len", &args, 0, 0);
+    RuntimeVal::NumberVal(NumberVal {
+        value: receiver(value, ctx).len(),
+    })
+}
+
+/// `slice(start)` or `slice(start, end)`: the elements from `start` up to, but excluding, `end`.
+fn list_slice(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "slice", &args, 1, 2);
+    let start = index_arg(ctx, "slice", &args[0]);
+    let list = receiver(value, ctx);
+    let len = list.values.len();
+    let end = match args.get(1) {
+        Some(end) => index_arg(ctx, "slice", end),
+        None => len,
+    };
+    if start > end || end > len {
+        velvet_error!(
+            ctx,
+            "Invalid slice {}..{} of a list of length {}",
+            start,
+            end,
+            len
+        );
+    }
+    RuntimeVal::ListVal(ListVal {
+        values: list.values[start..end].to_vec().into(),
+    })
+}
+
+fn list_map(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "map", &args, 1, 1);
+    let list = receiver(value, ctx).clone();
+    let mapped: Vec<RuntimeVal> = list
+        .values
+        .iter()
+        .map(|element| ctx.call_function(&args[0], vec![element.clone()]))
+        .collect();
+    RuntimeVal::ListVal(ListVal {
+        values: mapped.into(),
+    })
+}
+
+/// Keeps the elements for which the predicate returns `true`, the same test match arms apply to predicates.
+fn list_filter(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "filter", &args, 1, 1);
+    let list = receiver(value, ctx).clone();
+    let kept: Vec<RuntimeVal> = list
+        .values
+        .iter()
+        .filter(|element| is_true(&ctx.call_function(&args[0], vec![(*element).clone()])))
+        .cloned()
+        .collect();
+    RuntimeVal::ListVal(ListVal {
+        values: kept.into(),
+    })
+}
+
+/// `reduce(fn, initial)` folds the list from the left with `fn(accumulator, element)`. Without `initial`, the first
+/// element starts the fold, and reducing an empty list is an error.
+fn list_reduce(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "reduce", &args, 1, 2);
+    let list = receiver(value, ctx).clone();
+    let mut elements = list.values.iter();
+    let mut accumulator = match args.get(1) {
+        Some(initial) => initial.clone(),
+        None => match elements.next() {
+            Some(first) => first.clone(),
+            None => velvet_error!(ctx, "Cannot reduce an empty list without an initial value."),
+        },
+    };
+    for element in elements {
+        accumulator = ctx.call_function(&args[0], vec![accumulator, element.clone()]);
+    }
+    accumulator
+}
+
+fn array_push(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    let mut numbers = Vec::with_capacity(args.len());
+    for arg in &args {
+        match arg {
+            RuntimeVal::NumberVal(n) => numbers.push(n.value),
+            other => velvet_error!(ctx, "Cannot push {:?} to a number[] list", other),
+        }
+    }
+    array_receiver(value, ctx).values_mut().extend(numbers);
+    value.clone()
+}
+
+fn array_pop(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "pop", &args, 0, 0);
+    let array = array_receiver(value, ctx);
+    if array.values.is_empty() {
+        return RuntimeVal::NullVal(NullVal {});
+    }
+    number_or_null(array.values_mut().pop())
+}
+
+fn array_insert(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "insert", &args, 2, 2);
+    let index = index_arg(ctx, "insert", &args[0]);
+    let RuntimeVal::NumberVal(element) = &args[1] else {
+        velvet_error!(ctx, "Cannot insert {:?} into a number[] list", args[1]);
+    };
+    let array = array_receiver(value, ctx);
+    if index > array.values.len() {
+        velvet_error!(ctx, "Index {} is out of bounds!", index);
+    }
+    array.values_mut().insert(index, element.value);
+    value.clone()
+}
+
+fn array_sort(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "sort", &args, 0, 0);
+    array_receiver(value, ctx).values_mut().sort_unstable();
+    value.clone()
+}
+
+fn array_len(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "len", &args, 0, 0);
+    RuntimeVal::NumberVal(NumberVal {
+        value: array_receiver(value, ctx).values.len() as isize,
+    })
+}
+
+fn array_slice(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "slice", &args, 1, 2);
+    let start = index_arg(ctx, "slice", &args[0]);
+    let array = array_receiver(value, ctx);
+    let len = array.values.len();
+    let end = match args.get(1) {
+        Some(end) => index_arg(ctx, "slice", end),
+        None => len,
+    };
+    if start > end || end > len {
+        velvet_error!(
+            ctx,
+            "Invalid slice {}..{} of a list of length {}",
+            start,
+            end,
+            len
+        );
+    }
+    RuntimeVal::NumberArrayVal(NumberArrayVal {
+        values: array.values[start..end].to_vec().into(),
+    })
+}
+
+/// Runs simple arithmetic callbacks (see `MapKernel`) as one loop; others are called per element, and the result
+/// stays unboxed as long as they return numbers.
+fn array_map(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "map", &args, 1, 1);
+    let array = array_receiver(value, ctx).clone();
+    if let Some(kernel) = MapKernel::from_function(&args[0]) {
+        return RuntimeVal::NumberArrayVal(NumberArrayVal {
+            values: kernel.apply(&array.values).into(),
+        });
+    }
+    let mapped = ListVal {
+        values: Rc::new(
+            array
+                .values
+                .iter()
+                .map(|&element| {
+                    ctx.call_function(
+                        &args[0],
+                        vec![RuntimeVal::NumberVal(NumberVal { value: element })],
+                    )
+                })
+                .collect(),
+        ),
+    };
+    match mapped.to_number_array() {
+        Some(numbers) => RuntimeVal::NumberArrayVal(numbers),
+        None => RuntimeVal::ListVal(mapped),
+    }
+}
+
+fn array_filter(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "filter", &args, 1, 1);
+    let array = array_receiver(value, ctx).clone();
+    let kept: Vec<isize> = array
+        .values
+        .iter()
+        .copied()
+        .filter(|&element| {
+            is_true(&ctx.call_function(
+                &args[0],
+                vec![RuntimeVal::NumberVal(NumberVal { value: element })],
+            ))
+        })
+        .collect();
+    RuntimeVal::NumberArrayVal(NumberArrayVal {
+        values: kept.into(),
+    })
+}
+
+fn array_reduce(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    let mut list = RuntimeVal::ListVal(array_receiver(value, ctx).to_list());
+    list_reduce(&mut list, args, ctx)
+}
+
+fn numbers_sum(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "sum", &args, 0, 0);
+    let numbers = numbers_arg(ctx, "sum", value);
+    RuntimeVal::NumberVal(NumberVal {
+        value: kernels::sum(&numbers),
+    })
+}
+
+/// The smallest element, or `null` for an empty list.
+fn numbers_min(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "min", &args, 0, 0);
+    number_or_null(kernels::min(&numbers_arg(ctx, "min", value)))
+}
+
+/// The largest element, or `null` for an empty list.
+fn numbers_max(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "max", &args, 0, 0);
+    number_or_null(kernels::max(&numbers_arg(ctx, "max", value)))
+}
+
+fn numbers_dot(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "dot", &args, 1, 1);
+    let left = numbers_arg(ctx, "dot", value);
+    let right = numbers_arg(ctx, "dot", &args[0]);
+    if left.len() != right.len() {
+        velvet_error!(
+            ctx,
+            "Cannot take the dot product of lists of length {} and {}",
+            left.len(),
+            right.len()
+        );
+    }
+    RuntimeVal::NumberVal(NumberVal {
+        value: kernels::dot(&left, &right),
+    })
+}
+
+/// `add(other)` and `mul(other)`: element-wise with a list of the same length, or with every element for a number.
+fn numbers_zip_with(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+    method: &str,
+    op: ArithOp,
+) -> RuntimeVal {
+    expect_args(ctx, method, &args, 1, 1);
+    let left = numbers_arg(ctx, method, value);
+    let result = match &args[0] {
+        RuntimeVal::NumberVal(n) => kernels::zip_with(&left, op, &vec![n.value; left.len()]),
+        other => {
+            let right = numbers_arg(ctx, method, other);
+            if left.len() != right.len() {
+                velvet_error!(
+                    ctx,
+                    "Method '{}' expects lists of the same length, received {} and {}",
+                    method,
+                    left.len(),
+                    right.len()
+                );
+            }
+            kernels::zip_with(&left, op, &right)
+        }
+    };
+    numbers_like(value, result)
+}
+
+fn numbers_add(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    numbers_zip_with(value, args, ctx, "add", ArithOp::Add)
+}
+
+fn numbers_mul(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    numbers_zip_with(value, args, ctx, "mul", ArithOp::Mul)
+}
+
+fn list_iter(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "iter", &args, 0, 0);
+    RuntimeVal::IteratorVal(IteratorVal::over_list(value.clone()))
+}
+
+fn iterator_receiver(value: &RuntimeVal, ctx: &mut dyn MethodContext) -> IteratorVal {
+    match value {
+        RuntimeVal::IteratorVal(iterator) => iterator.clone(),
+        other => velvet_error!(ctx, "Expected an iterator receiver, received {:?}", other),
+    }
+}
+
+fn iterator_map(
+    value: &mut RuntimeVal,
+    mut args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "map", &args, 1, 1);
+    RuntimeVal::IteratorVal(IteratorVal::new(IterSource::Map {
+        inner: iterator_receiver(value, ctx),
+        function: Box::new(args.remove(0)),
+    }))
+}
+
+fn iterator_filter(
+    value: &mut RuntimeVal,
+    mut args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "filter", &args, 1, 1);
+    RuntimeVal::IteratorVal(IteratorVal::new(IterSource::Filter {
+        inner: iterator_receiver(value, ctx),
+        predicate: Box::new(args.remove(0)),
+    }))
+}
+
+fn iterator_take(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "take", &args, 1, 1);
+    let remaining = index_arg(ctx, "take", &args[0]);
+    RuntimeVal::IteratorVal(IteratorVal::new(IterSource::Take {
+        inner: iterator_receiver(value, ctx),
+        remaining,
+    }))
+}
+
+/// Drains the iterator into a list; binding the list as `number[]` unboxes it as usual.
+fn iterator_collect(
+    value: &mut RuntimeVal,
+    args: Vec<RuntimeVal>,
+    ctx: &mut dyn MethodContext,
+) -> RuntimeVal {
+    expect_args(ctx, "collect", &args, 0, 0);
+    let mut iterator = iterator_receiver(value, ctx);
+    let mut values = Vec::new();
+    while let Some(element) = iterator.next(ctx) {
+        values.push(element);
+    }
+    RuntimeVal::ListVal(ListVal {
+        values: Rc::new(values),
+    })
+}
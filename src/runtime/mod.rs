@@ -1,3 +1,13 @@
 pub mod interpreter;
+pub mod iterators;
+pub mod kernels;
+pub mod match_table;
+pub mod methods;
+pub mod numeric;
+pub mod profiler;
+pub mod resolver;
+pub mod shapes;
+pub mod strings;
 pub mod values;
-pub mod source_environment;
\ No newline at end of file
+pub mod source_environment;
+pub mod vm;
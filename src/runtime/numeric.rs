@@ -0,0 +1,240 @@
+use crate::{
+    runtime::values::{FloatVal, IntegerVal, NumberVal, RuntimeVal},
+    typecheck::typecheck::T,
+};
+
+/// The sized integer types with a runtime representation of their own. `number`, the type `i32` also parses to,
+/// is the machine-word `NumberVal` instead, which every integer literal evaluates to.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum IntWidth {
+    I8,
+    I16,
+    I64,
+    I128,
+}
+
+impl IntWidth {
+    /// Truncates `value` to this width, as LLVM does for the compiled types.
+    pub fn wrap(self, value: i128) -> i128 {
+        match self {
+            IntWidth::I8 => value as i8 as i128,
+            IntWidth::I16 => value as i16 as i128,
+            IntWidth::I64 => value as i64 as i128,
+            IntWidth::I128 => value,
+        }
+    }
+
+    pub fn name(self) -> &'static str {
+        match self {
+            IntWidth::I8 => "i8",
+            IntWidth::I16 => "i16",
+            IntWidth::I64 => "i64",
+            IntWidth::I128 => "i128",
+        }
+    }
+}
+
+/// A numeric type that values are converted to by `as` casts and by declared types.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum NumericType {
+    Number,
+    Integer(IntWidth),
+    Float,
+}
+
+impl NumericType {
+    pub fn from_type(t: &T) -> Option<Self> {
+        match t {
+            T::Integer8 => Some(NumericType::Integer(IntWidth::I8)),
+            T::Integer16 => Some(NumericType::Integer(IntWidth::I16)),
+            T::Integer32 => Some(NumericType::Number),
+            T::Integer64 => Some(NumericType::Integer(IntWidth::I64)),
+            T::Integer128 => Some(NumericType::Integer(IntWidth::I128)),
+            T::Float64 => Some(NumericType::Float),
+            _ => None,
+        }
+    }
+
+    /// The type an untyped number takes when it is bound as `declared`; `None` if it stays a `NumberVal`.
+    pub fn adopted_by(declared: &T) -> Option<Self> {
+        Self::from_type(declared).filter(|to| *to != NumericType::Number)
+    }
+}
+
+/// The operands of a numeric operation, converted to the type it runs in.
+enum Operands {
+    Number(isize, isize),
+    Integer(i128, i128, IntWidth),
+    Float(f64, f64),
+}
+
+fn numeric_name(value: &RuntimeVal) -> &'static str {
+    match value {
+        RuntimeVal::NumberVal(_) => "number",
+        RuntimeVal::IntegerVal(i) => i.width.name(),
+        RuntimeVal::FloatVal(_) => "f64",
+        _ => "non-number",
+    }
+}
+
+/// Untyped numbers take the type of the other operand, like integer literals do in the typechecker. Two different
+/// sized types must be cast to a common one first. `None` if either operand is not a number.
+fn operands(left: &RuntimeVal, right: &RuntimeVal) -> Option<Result<Operands, String>> {
+    use RuntimeVal::{FloatVal, IntegerVal, NumberVal};
+
+    let operands = match (left, right) {
+        (NumberVal(l), NumberVal(r)) => Operands::Number(l.value, r.value),
+        (IntegerVal(l), IntegerVal(r)) if l.width == r.width => {
+            Operands::Integer(l.value, r.value, l.width)
+        }
+        (IntegerVal(l), NumberVal(r)) => {
+            Operands::Integer(l.value, l.width.wrap(r.value as i128), l.width)
+        }
+        (NumberVal(l), IntegerVal(r)) => {
+            Operands::Integer(r.width.wrap(l.value as i128), r.value, r.width)
+        }
+        (FloatVal(l), FloatVal(r)) => Operands::Float(l.value, r.value),
+        (FloatVal(l), NumberVal(r)) => Operands::Float(l.value, r.value as f64),
+        (NumberVal(l), FloatVal(r)) => Operands::Float(l.value as f64, r.value),
+        (IntegerVal(_) | FloatVal(_), IntegerVal(_) | FloatVal(_)) => {
+            return Some(Err(format!(
+                "Cannot mix {} and {} without a cast",
+                numeric_name(left),
+                numeric_name(right)
+            )));
+        }
+        _ => return None,
+    };
+    Some(Ok(operands))
+}
+
+/// Evaluates the arithmetic operator `op` on two numbers. `None` if either operand is not a number.
+///
+/// Sized integers wrap at their width and floats follow IEEE 754, as in compiled code. Two `NumberVal`s keep the
+/// interpreter's machine-word arithmetic; callers usually handle them on a fast path before getting here.
+pub fn arithmetic(
+    left: &RuntimeVal,
+    op: &str,
+    right: &RuntimeVal,
+) -> Option<Result<RuntimeVal, String>> {
+    let operands = match operands(left, right)? {
+        Ok(operands) => operands,
+        Err(err) => return Some(Err(err)),
+    };
+    let result = match (operands, op) {
+        (Operands::Number(l, r), "+") => number(l + r),
+        (Operands::Number(l, r), "-") => number(l - r),
+        (Operands::Number(l, r), "*") => number(l * r),
+        (Operands::Number(_, 0) | Operands::Integer(_, 0, _), "/") => {
+            return Some(Err(String::from("Division by zero")));
+        }
+        (Operands::Number(l, r), "/") => number(l / r),
+        (Operands::Integer(l, r, width), "+") => integer(l.wrapping_add(r), width),
+        (Operands::Integer(l, r, width), "-") => integer(l.wrapping_sub(r), width),
+        (Operands::Integer(l, r, width), "*") => integer(l.wrapping_mul(r), width),
+        (Operands::Integer(l, r, width), "/") => integer(l.wrapping_div(r), width),
+        (Operands::Float(l, r), "+") => float(l + r),
+        (Operands::Float(l, r), "-") => float(l - r),
+        (Operands::Float(l, r), "*") => float(l * r),
+        (Operands::Float(l, r), "/") => float(l / r),
+        _ => return Some(Err(format!("Unknown operator: {}", op))),
+    };
+    Some(Ok(result))
+}
+
+/// Evaluates the comparison operator `op` on two numbers. `None` if either operand is not a number.
+pub fn compare(left: &RuntimeVal, op: &str, right: &RuntimeVal) -> Option<Result<bool, String>> {
+    let operands = match operands(left, right)? {
+        Ok(operands) => operands,
+        Err(err) => return Some(Err(err)),
+    };
+    let ordering = match operands {
+        Operands::Number(l, r) => l.partial_cmp(&r),
+        Operands::Integer(l, r, _) => l.partial_cmp(&r),
+        Operands::Float(l, r) => l.partial_cmp(&r),
+    };
+    // NaN is unordered, so it only compares unequal
+    let result = match op {
+        "==" => ordering == Some(std::cmp::Ordering::Equal),
+        "!=" => ordering != Some(std::cmp::Ordering::Equal),
+        "<" => ordering == Some(std::cmp::Ordering::Less),
+        "<=" => matches!(ordering, Some(o) if o.is_le()),
+        ">" => ordering == Some(std::cmp::Ordering::Greater),
+        ">=" => matches!(ordering, Some(o) if o.is_ge()),
+        _ => return Some(Err(format!("Unknown operator: {}", op))),
+    };
+    Some(Ok(result))
+}
+
+/// Converts a number to `to`, for an `as` cast. Integers are truncated to narrower widths, and floats are rounded
+/// toward zero (saturating at the bounds of `i128`) when converted to integers.
+pub fn convert(value: &RuntimeVal, to: NumericType) -> Result<RuntimeVal, String> {
+    let (as_integer, as_float) = match value {
+        RuntimeVal::NumberVal(n) => (n.value as i128, n.value as f64),
+        RuntimeVal::IntegerVal(i) => (i.value, i.value as f64),
+        RuntimeVal::FloatVal(f) => (f.value as i128, f.value),
+        _ => return Err(format!("Cannot cast {} to a number", value)),
+    };
+    Ok(match to {
+        // `number` is `i32` to the typechecker, so a cast truncates to 32 bits like compiled code does
+        NumericType::Number => number(as_integer as i32 as isize),
+        NumericType::Integer(width) => integer_val(width.wrap(as_integer), width),
+        NumericType::Float => float(as_float),
+    })
+}
+
+/// Gives an untyped number the sized type `declared` it is bound as, and unboxes a list bound as `number[]`. Other
+/// values are left as they are.
+pub fn adopt_declared_type(value: RuntimeVal, declared: &T) -> RuntimeVal {
+    match value {
+        RuntimeVal::NumberVal(_) => match NumericType::adopted_by(declared) {
+            Some(to) => adopt(value, to),
+            None => value,
+        },
+        RuntimeVal::ListVal(_) if packs_numbers(declared) => pack_numbers(value),
+        _ => value,
+    }
+}
+
+/// Whether values bound as `declared` are stored as a `NumberArrayVal`.
+pub fn packs_numbers(declared: &T) -> bool {
+    matches!(declared, T::Array { array_t, .. } if **array_t == T::Integer32)
+}
+
+/// Unboxes a list of numbers into a `NumberArrayVal`. Lists holding anything else are left as they are.
+pub fn pack_numbers(value: RuntimeVal) -> RuntimeVal {
+    match &value {
+        RuntimeVal::ListVal(list) => match list.to_number_array() {
+            Some(array) => RuntimeVal::NumberArrayVal(array),
+            None => value,
+        },
+        _ => value,
+    }
+}
+
+/// `adopt_declared_type` for a type already resolved by the bytecode compiler.
+pub fn adopt(value: RuntimeVal, to: NumericType) -> RuntimeVal {
+    match (&value, to) {
+        (RuntimeVal::NumberVal(n), NumericType::Integer(width)) => {
+            integer_val(width.wrap(n.value as i128), width)
+        }
+        (RuntimeVal::NumberVal(n), NumericType::Float) => float(n.value as f64),
+        _ => value,
+    }
+}
+
+fn number(value: isize) -> RuntimeVal {
+    RuntimeVal::NumberVal(NumberVal { value })
+}
+
+fn integer(value: i128, width: IntWidth) -> RuntimeVal {
+    integer_val(width.wrap(value), width)
+}
+
+fn integer_val(value: i128, width: IntWidth) -> RuntimeVal {
+    RuntimeVal::IntegerVal(IntegerVal { value, width })
+}
+
+fn float(value: f64) -> RuntimeVal {
+    RuntimeVal::FloatVal(FloatVal { value })
+}
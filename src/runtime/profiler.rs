@@ -0,0 +1,223 @@
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    collections::HashMap,
+    fs,
+    hash::Hash,
+    rc::Rc,
+    sync::atomic::{AtomicBool, AtomicU64, Ordering},
+    time::{Duration, Instant},
+};
+
+static COUNT_ALLOCATIONS: AtomicBool = AtomicBool::new(false);
+static ALLOCATIONS: AtomicU64 = AtomicU64::new(0);
+
+/// The system allocator, counting allocations while a `Profiler` is running. Outside of profiling it only adds a
+/// relaxed load to each allocation.
+pub struct CountingAllocator;
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        if COUNT_ALLOCATIONS.load(Ordering::Relaxed) {
+            ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        }
+        unsafe { System.alloc(layout) }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        unsafe { System.dealloc(ptr, layout) }
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        if COUNT_ALLOCATIONS.load(Ordering::Relaxed) {
+            ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        }
+        unsafe { System.realloc(ptr, layout, new_size) }
+    }
+}
+
+fn allocations() -> u64 {
+    ALLOCATIONS.load(Ordering::Relaxed)
+}
+
+#[derive(Clone, Debug, Default)]
+pub struct ProfileEntry {
+    pub calls: u64,
+    /// Time from entering to leaving, children included. Recursive entries count only their outermost frame.
+    pub inclusive: Duration,
+    /// Time spent outside of any child entry.
+    pub exclusive: Duration,
+    /// Allocations made outside of any child entry.
+    pub allocations: u64,
+    active: usize,
+}
+
+struct Frame<K> {
+    key: K,
+    started: Instant,
+    allocations_at_start: u64,
+    child_time: Duration,
+    child_allocations: u64,
+}
+
+/// Call counts, times and allocations for one kind of entry (functions or node kinds), kept with a stack of the
+/// entries currently open so that children can be subtracted from their parents.
+struct ProfileTable<K> {
+    entries: HashMap<K, ProfileEntry>,
+    stack: Vec<Frame<K>>,
+}
+
+impl<K: Clone + Eq + Hash> ProfileTable<K> {
+    fn new() -> Self {
+        Self {
+            entries: HashMap::new(),
+            stack: Vec::new(),
+        }
+    }
+
+    fn enter(&mut self, key: K) {
+        let entry = self.entries.entry(key.clone()).or_default();
+        entry.calls += 1;
+        entry.active += 1;
+        self.stack.push(Frame {
+            key,
+            started: Instant::now(),
+            allocations_at_start: allocations(),
+            child_time: Duration::ZERO,
+            child_allocations: 0,
+        });
+    }
+
+    /// Closes the innermost open entry, returning its exclusive time.
+    fn exit(&mut self) -> Duration {
+        let frame = self
+            .stack
+            .pop()
+            .expect("profiler exit without a matching enter");
+        let elapsed = frame.started.elapsed();
+        let allocated = allocations() - frame.allocations_at_start;
+        let exclusive = elapsed.saturating_sub(frame.child_time);
+
+        let entry = self.entries.get_mut(&frame.key).unwrap();
+        entry.active -= 1;
+        if entry.active == 0 {
+            entry.inclusive += elapsed;
+        }
+        entry.exclusive += exclusive;
+        entry.allocations += allocated - frame.child_allocations;
+
+        if let Some(parent) = self.stack.last_mut() {
+            parent.child_time += elapsed;
+            parent.child_allocations += allocated;
+        }
+        exclusive
+    }
+
+    /// The entries, most exclusive time first.
+    fn sorted(&self) -> Vec<(&K, &ProfileEntry)> {
+        let mut sorted: Vec<_> = self.entries.iter().collect();
+        sorted.sort_by(|a, b| b.1.exclusive.cmp(&a.1.exclusive));
+        sorted
+    }
+}
+
+/// Records where an interpreted program spends its time, per user function and per `Node` kind.
+///
+/// Function frames also accumulate exclusive time under their full stack, which `write_collapsed_stacks` writes in
+/// the collapsed format read by flamegraph tools.
+pub struct Profiler {
+    functions: ProfileTable<Rc<str>>,
+    nodes: ProfileTable<&'static str>,
+    collapsed_stacks: HashMap<String, Duration>,
+}
+
+impl Profiler {
+    pub fn new() -> Self {
+        COUNT_ALLOCATIONS.store(true, Ordering::Relaxed);
+        Self {
+            functions: ProfileTable::new(),
+            nodes: ProfileTable::new(),
+            collapsed_stacks: HashMap::new(),
+        }
+    }
+
+    pub fn enter_function(&mut self, name: &Rc<str>) {
+        self.functions.enter(Rc::clone(name));
+    }
+
+    pub fn exit_function(&mut self) {
+        let stack = self
+            .functions
+            .stack
+            .iter()
+            .map(|frame| frame.key.as_ref())
+            .collect::<Vec<_>>()
+            .join(";");
+        let exclusive = self.functions.exit();
+        *self.collapsed_stacks.entry(stack).or_default() += exclusive;
+    }
+
+    pub fn enter_node(&mut self, kind: &'static str) {
+        self.nodes.enter(kind);
+    }
+
+    pub fn exit_node(&mut self) {
+        self.nodes.exit();
+    }
+
+    pub fn function(&self, name: &str) -> Option<&ProfileEntry> {
+        self.functions.entries.get(name)
+    }
+
+    pub fn node_kind(&self, kind: &str) -> Option<&ProfileEntry> {
+        self.nodes.entries.get(kind)
+    }
+
+    /// Prints the functions and node kinds, most exclusive time first.
+    pub fn print_report(&self) {
+        println!("[Profile]");
+        Self::print_table("function", &self.functions.sorted());
+        Self::print_table("node kind", &self.nodes.sorted());
+    }
+
+    fn print_table<K: AsRef<str>>(title: &str, rows: &[(&K, &ProfileEntry)]) {
+        let name_width = rows
+            .iter()
+            .map(|(name, _)| name.as_ref().len())
+            .max()
+            .unwrap_or(0)
+            .max(title.len());
+        println!(
+            "    {:<name_width$}  {:>10}  {:>12}  {:>12}  {:>10}",
+            title, "calls", "incl ms", "excl ms", "allocs"
+        );
+        for (name, entry) in rows {
+            println!(
+                "    {:<name_width$}  {:>10}  {:>12.3}  {:>12.3}  {:>10}",
+                name.as_ref(),
+                entry.calls,
+                entry.inclusive.as_secs_f64() * 1000.0,
+                entry.exclusive.as_secs_f64() * 1000.0,
+                entry.allocations
+            );
+        }
+    }
+
+    /// Writes one `outer;inner microseconds` line per function stack, the exclusive time spent in it.
+    pub fn write_collapsed_stacks(&self, path: &str) {
+        let mut lines: Vec<String> = self
+            .collapsed_stacks
+            .iter()
+            .map(|(stack, time)| format!("{} {}", stack, time.as_micros()))
+            .collect();
+        lines.sort();
+        if let Err(err) = fs::write(path, lines.join("\n") + "\n") {
+            eprintln!("Failed to write collapsed stacks to {}: {}", path, err);
+        }
+    }
+}
+
+impl Drop for Profiler {
+    fn drop(&mut self) {
+        COUNT_ALLOCATIONS.store(false, Ordering::Relaxed);
+    }
+}
@@ -0,0 +1,269 @@
+use std::{
+    collections::{HashMap, hash_map::Entry},
+    rc::Rc,
+};
+
+use crate::{
+    parser::nodetypes::{MatchExpr, Node},
+    runtime::{
+        match_table::MatchTable,
+        source_environment::source_environment::{SlotLayout, SourceEnv},
+    },
+};
+
+/// Where a binding lives at runtime: `depth` environments up from the one a node is evaluated in, at `slot`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct SlotAddress {
+    pub depth: usize,
+    pub slot: usize,
+}
+
+/// The result of resolving a program, indexed by node id.
+///
+/// `addresses` holds the binding location of identifiers, assignments and declarations. Nodes that resolve to
+/// nothing are looked up by name at runtime. `layouts` holds the slot layout of the scope opened by a block, loop or
+/// function definition. `match_tables` holds the lookup of each match expression that has one.
+#[derive(Debug, Default)]
+pub struct Resolution {
+    addresses: Vec<Option<SlotAddress>>,
+    layouts: Vec<Option<Rc<SlotLayout>>>,
+    match_tables: Vec<Option<Rc<MatchTable>>>,
+}
+
+impl Resolution {
+    pub fn address(&self, id: Option<usize>) -> Option<SlotAddress> {
+        *self.addresses.get(id?)?
+    }
+
+    pub fn layout(&self, id: Option<usize>) -> Option<Rc<SlotLayout>> {
+        self.layouts.get(id?)?.clone()
+    }
+
+    pub fn match_table(&self, id: Option<usize>) -> Option<Rc<MatchTable>> {
+        self.match_tables.get(id?)?.clone()
+    }
+}
+
+struct Scope {
+    owner: Option<usize>,
+    layout: SlotLayout,
+}
+
+/// Assigns every binding a slot in the environment that will hold it, and every reference the (depth, slot) of the
+/// binding it reads, so the interpreter can index frames directly instead of hashing names up the scope chain.
+///
+/// Scopes mirror the interpreter exactly: blocks, `while` iterations, `for` iterations and calls each get a fresh
+/// environment, while `if` bodies and match arms share the enclosing one. Because callers' environments are the
+/// parents of a call (dynamic scoping), references inside a function are only resolved to bindings of that same
+/// function; anything else is left to the runtime lookup by name.
+///
+/// Snippet expansion copies node ids, so a node may be reached more than once. Declarations always land on the same
+/// slot of their (copied) scope, but references can disagree about depth; those fall back to the lookup by name.
+/// Likewise a match expression whose copies have different literal arms gets no `MatchTable`.
+pub struct Resolver {
+    scopes: Vec<Scope>,
+    function_base: usize,
+    addresses: HashMap<usize, Option<SlotAddress>>,
+    layouts: HashMap<usize, SlotLayout>,
+    match_tables: HashMap<usize, Option<MatchTable>>,
+}
+
+impl Resolver {
+    /// Resolves `nodes` as the top level of `root`, extending the layout of `root` with the top-level bindings.
+    pub fn resolve_program(nodes: &[Node], root: &mut SourceEnv) -> Resolution {
+        let mut resolver = Self {
+            scopes: vec![Scope {
+                owner: None,
+                layout: root.layout().clone(),
+            }],
+            function_base: 0,
+            addresses: HashMap::new(),
+            layouts: HashMap::new(),
+            match_tables: HashMap::new(),
+        };
+        resolver.resolve_body(nodes);
+        root.extend_layout(&resolver.scopes[0].layout);
+        resolver.finish()
+    }
+
+    fn finish(self) -> Resolution {
+        let mut resolution = Resolution::default();
+        if let Some(max) = self.addresses.keys().max() {
+            resolution.addresses.resize(max + 1, None);
+        }
+        for (id, address) in self.addresses {
+            resolution.addresses[id] = address;
+        }
+        if let Some(max) = self.layouts.keys().max() {
+            resolution.layouts.resize(max + 1, None);
+        }
+        for (id, layout) in self.layouts {
+            resolution.layouts[id] = Some(Rc::new(layout));
+        }
+        if let Some(max) = self.match_tables.keys().max() {
+            resolution.match_tables.resize(max + 1, None);
+        }
+        for (id, table) in self.match_tables {
+            resolution.match_tables[id] = table.map(Rc::new);
+        }
+        resolution
+    }
+
+    fn enter_scope(&mut self, owner: Option<usize>) {
+        self.scopes.push(Scope {
+            owner,
+            layout: SlotLayout::new(),
+        });
+    }
+
+    fn exit_scope(&mut self) {
+        let scope = self.scopes.pop().expect("No scope to pop off");
+        if let Some(owner) = scope.owner {
+            self.layouts.insert(owner, scope.layout);
+        }
+    }
+
+    fn record(&mut self, id: Option<usize>, address: Option<SlotAddress>) {
+        let Some(id) = id else { return };
+        match self.addresses.entry(id) {
+            Entry::Vacant(entry) => {
+                entry.insert(address);
+            }
+            Entry::Occupied(mut entry) => {
+                if *entry.get() != address {
+                    entry.insert(None);
+                }
+            }
+        }
+    }
+
+    fn record_match_table(&mut self, mexpr: &MatchExpr) {
+        let Some(id) = mexpr.id else { return };
+        let table = MatchTable::new(&mexpr.arms);
+        match self.match_tables.entry(id) {
+            Entry::Vacant(entry) => {
+                entry.insert(table);
+            }
+            Entry::Occupied(mut entry) => {
+                if *entry.get() != table {
+                    entry.insert(None);
+                }
+            }
+        }
+    }
+
+    /// Gives `name` a slot in the innermost scope; redeclarations in the same scope share the slot, so the runtime
+    /// still sees (and rejects) them.
+    fn declare(&mut self, id: Option<usize>, name: &str) {
+        let layout = &mut self.scopes.last_mut().unwrap().layout;
+        let next = layout.len();
+        let slot = *layout.entry(name.to_string()).or_insert(next);
+        self.record(id, Some(SlotAddress { depth: 0, slot }));
+    }
+
+    fn reference(&mut self, id: Option<usize>, name: &str) {
+        let top = self.scopes.len() - 1;
+        let address = (self.function_base..=top).rev().find_map(|index| {
+            self.scopes[index].layout.get(name).map(|slot| SlotAddress {
+                depth: top - index,
+                slot: *slot,
+            })
+        });
+        self.record(id, address);
+    }
+
+    fn resolve_body(&mut self, nodes: &[Node]) {
+        for node in nodes {
+            self.resolve(node);
+        }
+    }
+
+    fn resolve(&mut self, node: &Node) {
+        match node {
+            Node::Identifier(ident) => self.reference(ident.id, &ident.identifier_name),
+            Node::VarDeclaration(decl) => {
+                self.resolve(&decl.var_value);
+                self.declare(decl.id, &decl.var_identifier);
+            }
+            Node::AssignmentExpr(asexp) => {
+                self.resolve(&asexp.value);
+                self.resolve(&asexp.left);
+            }
+            Node::FunctionDefinition(def) => {
+                self.declare(def.id, &def.name);
+
+                let enclosing_base = self.function_base;
+                self.enter_scope(def.id);
+                self.function_base = self.scopes.len() - 1;
+                for (param, _) in &def.params {
+                    self.declare(None, param);
+                }
+                self.resolve_body(&def.body);
+                self.exit_scope();
+                self.function_base = enclosing_base;
+            }
+            Node::Block(block) => {
+                self.enter_scope(block.id);
+                self.resolve_body(&block.body);
+                self.exit_scope();
+            }
+            Node::WhileStmt(while_loop) => {
+                self.resolve(&while_loop.condition);
+                self.enter_scope(while_loop.id);
+                self.resolve_body(&while_loop.body);
+                self.exit_scope();
+            }
+            Node::Iterator(it) => {
+                self.resolve(&it.right);
+                self.enter_scope(it.id);
+                self.declare(it.id, &it.left.literal_value);
+                self.resolve_body(&it.body);
+                self.exit_scope();
+            }
+            Node::IfStmt(if_stmt) => {
+                self.resolve(&if_stmt.condition);
+                self.resolve_body(&if_stmt.body);
+            }
+            Node::MatchExpr(mexpr) => {
+                self.record_match_table(mexpr);
+                self.resolve(&mexpr.target);
+                for (pattern, body) in &mexpr.arms {
+                    self.resolve(pattern);
+                    self.resolve(body);
+                }
+            }
+            Node::CallExpr(cexpr) => {
+                self.resolve(&cexpr.caller);
+                self.resolve_body(&cexpr.args);
+            }
+            Node::MemberExpr(mem) => {
+                self.resolve(&mem.object);
+                if mem.is_computed {
+                    self.resolve(&mem.property);
+                }
+            }
+            Node::BinaryExpr(binop) => {
+                self.resolve(&binop.left);
+                self.resolve(&binop.right);
+            }
+            Node::Comparator(comp) => {
+                self.resolve(&comp.lhs);
+                self.resolve(&comp.rhs);
+            }
+            Node::NullishCoalescing(nc) => {
+                self.resolve(&nc.left);
+                self.resolve(&nc.right);
+            }
+            Node::ListLiteral(ll) => self.resolve_body(&ll.props),
+            Node::ObjectLiteral(ol) => {
+                for (_, value) in &ol.props {
+                    self.resolve(value);
+                }
+            }
+            // A return is evaluated by whichever block, loop or call catches it, which is always the environment it
+            // appears in since `if` bodies open no scope.
+            Node::Return(ret) => self.resolve(&ret.return_statement),
+            _ => {}
+        }
+    }
+}
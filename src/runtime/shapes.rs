@@ -0,0 +1,186 @@
+use std::{
+    cell::{Cell, RefCell},
+    collections::HashMap,
+    mem,
+    rc::{Rc, Weak},
+};
+
+use crate::runtime::values::{NullVal, ObjectVal, RuntimeVal};
+
+/// The key set of an object: its keys in sorted order, each stored at the slot of the same index in the object's
+/// values. Shapes are interned, so every object with the same keys shares one, however it was built.
+#[derive(Debug)]
+pub struct Shape {
+    /// Unique for the rest of the run, unlike the shape's address once it is freed, so `PropertyCache` can remember a
+    /// shape by it.
+    id: usize,
+    keys: Box<[Rc<str>]>,
+    slots: HashMap<Rc<str>, usize>,
+}
+
+thread_local! {
+    /// Every shape still held by an object or a layout. A shape leaves the table when the last of them is dropped,
+    /// so a long `serve` session only keeps the shapes of what its scripts still hold.
+    static SHAPES: RefCell<HashMap<Box<[Rc<str>]>, Weak<Shape>>> = RefCell::new(HashMap::new());
+    static NEXT_SHAPE_ID: Cell<usize> = const { Cell::new(0) };
+}
+
+impl Shape {
+    /// The shape of `keys`, which must be sorted and free of duplicates.
+    fn intern(keys: Box<[Rc<str>]>) -> Rc<Shape> {
+        SHAPES.with(|shapes| {
+            let mut shapes = shapes.borrow_mut();
+            if let Some(shape) = shapes.get(&keys).and_then(Weak::upgrade) {
+                return shape;
+            }
+            let slots = keys
+                .iter()
+                .enumerate()
+                .map(|(slot, key)| (Rc::clone(key), slot))
+                .collect();
+            let id = NEXT_SHAPE_ID.with(|next| next.replace(next.get() + 1));
+            let shape = Rc::new(Shape {
+                id,
+                keys: keys.clone(),
+                slots,
+            });
+            shapes.insert(keys, Rc::downgrade(&shape));
+            shape
+        })
+    }
+
+    pub fn keys(&self) -> &[Rc<str>] {
+        &self.keys
+    }
+
+    pub fn slot(&self, key: &str) -> Option<usize> {
+        self.slots.get(key).copied()
+    }
+
+    /// The number of shapes alive on this thread.
+    pub fn interned_count() -> usize {
+        SHAPES.with(|shapes| shapes.borrow().len())
+    }
+}
+
+impl Drop for Shape {
+    fn drop(&mut self) {
+        // The table may already be gone when shapes are dropped at thread exit
+        let _ = SHAPES.try_with(|shapes| {
+            if let Ok(mut shapes) = shapes.try_borrow_mut() {
+                if shapes
+                    .get(&self.keys)
+                    .is_some_and(|shape| shape.strong_count() == 0)
+                {
+                    shapes.remove(&self.keys);
+                }
+            }
+        });
+    }
+}
+
+/// How an object literal's values, in the order they are evaluated, become an object: resolved once per literal so
+/// that building an object moves its values into place without hashing any key.
+#[derive(Debug, Clone)]
+pub struct ObjectLayout {
+    shape: Rc<Shape>,
+    /// For each slot, the position of its value in evaluation order.
+    order: Box<[usize]>,
+}
+
+impl ObjectLayout {
+    /// The layout of a literal whose values are evaluated in the order of `keys`, which hold no duplicates.
+    pub fn new<'a>(keys: impl IntoIterator<Item = &'a str>) -> Self {
+        let mut keys: Vec<(&str, usize)> = keys.into_iter().zip(0..).collect();
+        keys.sort_unstable_by_key(|(key, _)| *key);
+        Self {
+            shape: Shape::intern(keys.iter().map(|(key, _)| Rc::from(*key)).collect()),
+            order: keys.iter().map(|(_, position)| *position).collect(),
+        }
+    }
+
+    pub fn shape(&self) -> &Rc<Shape> {
+        &self.shape
+    }
+
+    /// Moves `values`, in evaluation order, into a new object, leaving nulls behind.
+    pub fn build(&self, values: &mut [RuntimeVal]) -> ObjectVal {
+        ObjectVal {
+            shape: Rc::clone(&self.shape),
+            values: self
+                .order
+                .iter()
+                .map(|&position| {
+                    mem::replace(&mut values[position], RuntimeVal::NullVal(NullVal {}))
+                })
+                .collect(),
+        }
+    }
+}
+
+/// What one member access site last looked up: the shape of the object and the slot its key was found at. While
+/// objects of that shape keep arriving, a lookup is a comparison and an index instead of a hash of the key.
+#[derive(Debug, Clone, Default)]
+pub struct PropertyCache {
+    entry: Cell<Option<(usize, usize)>>,
+}
+
+/// The `PropertyCache` of every member expression, indexed by node id and grown as sites are first reached.
+#[derive(Debug, Default)]
+pub struct PropertyCaches {
+    sites: Vec<PropertyCache>,
+}
+
+impl PropertyCaches {
+    pub fn get(&mut self, id: Option<usize>, object: &ObjectVal, key: &str) -> Option<RuntimeVal> {
+        let Some(id) = id else {
+            return object.get(key).cloned();
+        };
+        if id >= self.sites.len() {
+            self.sites.resize_with(id + 1, PropertyCache::default);
+        }
+        object.get_cached(key, &self.sites[id]).cloned()
+    }
+}
+
+impl ObjectVal {
+    /// An object of `fields`, in any order. A key given more than once keeps its last value.
+    pub fn new(fields: impl IntoIterator<Item = (impl Into<Rc<str>>, RuntimeVal)>) -> Self {
+        let mut fields: Vec<(Rc<str>, RuntimeVal)> = fields
+            .into_iter()
+            .map(|(key, value)| (key.into(), value))
+            .collect();
+        // Stable, so that the last of several values for a key ends up last among them
+        fields.sort_by(|(a, _), (b, _)| a.cmp(b));
+        fields.reverse();
+        fields.dedup_by(|(a, _), (b, _)| a == b);
+        fields.reverse();
+        let (keys, values): (Vec<_>, Vec<_>) = fields.into_iter().unzip();
+        Self {
+            shape: Shape::intern(keys.into()),
+            values: values.into(),
+        }
+    }
+
+    pub fn get(&self, key: &str) -> Option<&RuntimeVal> {
+        self.values.get(self.shape.slot(key)?)
+    }
+
+    /// `get`, remembering the result in `cache`. The slot's key is compared too, since snippet expansion can give
+    /// several sites, with different keys, the same node id.
+    pub fn get_cached(&self, key: &str, cache: &PropertyCache) -> Option<&RuntimeVal> {
+        if let Some((shape, slot)) = cache.entry.get() {
+            if shape == self.shape.id && &*self.shape.keys[slot] == key {
+                return Some(&self.values[slot]);
+            }
+        }
+        let slot = self.shape.slot(key)?;
+        cache.entry.set(Some((self.shape.id, slot)));
+        Some(&self.values[slot])
+    }
+
+    /// The object's keys and values, in key order.
+    pub fn iter(&self) -> impl Iterator<Item = (&Rc<str>, &RuntimeVal)> {
+        self.shape.keys.iter().zip(self.values.iter())
+    }
+}
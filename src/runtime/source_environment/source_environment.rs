@@ -1,6 +1,6 @@
 use std::{cell::RefCell, collections::HashMap, rc::Rc};
 
-use crate::runtime::values::RuntimeVal;
+use crate::runtime::{resolver::SlotAddress, values::RuntimeVal};
 
 use crate::stdlib_interp::standard_library_values;
 
@@ -10,67 +10,212 @@ pub struct EnvVar {
     pub is_mutable: bool,
 }
 
+/// Maps every binding name of a scope to its slot in that scope's frame.
+pub type SlotLayout = HashMap<String, usize>;
+
 #[derive(Debug, Clone)]
 pub struct SourceEnv {
     pub parent: Option<Rc<RefCell<SourceEnv>>>,
-    pub variables: HashMap<String, EnvVar>,
+    /// Shared by every environment created for the same resolved scope. Slots are dense: a layout of `n` names maps
+    /// them onto `0..n`. The layout is only copied if a binding the resolver did not see is declared by name.
+    names: Rc<SlotLayout>,
+    /// A slot is `None` until its binding is declared.
+    slots: Vec<Option<EnvVar>>,
+}
+
+/// The most environments an `EnvironmentPool` keeps; frames beyond it (released by deep recursion unwinding) are
+/// freed.
+const POOLED_ENVIRONMENTS: usize = 256;
+
+/// Environments of scopes that have been left, kept for the next scope to be entered so that blocks, loop iterations
+/// and calls do not allocate their frames. A loop's iterations run in the one frame each hands back to the next.
+#[derive(Default)]
+pub struct EnvironmentPool {
+    free: Vec<Rc<RefCell<SourceEnv>>>,
+}
+
+impl EnvironmentPool {
+    /// An empty environment under `parent`, laid out as `layout` when the resolver placed the scope.
+    pub fn acquire(
+        &mut self,
+        parent: Rc<RefCell<SourceEnv>>,
+        layout: Option<Rc<SlotLayout>>,
+    ) -> Rc<RefCell<SourceEnv>> {
+        match self.free.pop() {
+            Some(env) => {
+                env.borrow_mut().reset(parent, layout);
+                env
+            }
+            None => Rc::new(RefCell::new(match layout {
+                Some(layout) => SourceEnv::with_layout(Some(parent), layout),
+                None => SourceEnv::new(Some(parent)),
+            })),
+        }
+    }
+
+    /// Takes back an environment whose scope has been left, dropping its bindings. It is only reused if nothing
+    /// else still refers to it.
+    pub fn release(&mut self, env: Rc<RefCell<SourceEnv>>) {
+        if Rc::strong_count(&env) != 1 || self.free.len() >= POOLED_ENVIRONMENTS {
+            return;
+        }
+        {
+            let mut frame = env.borrow_mut();
+            frame.slots.clear();
+            frame.parent = None;
+        }
+        self.free.push(env);
+    }
 }
 
 /// An entity that facilitates the declaration, reassignment, and lookup of variables.
 ///
+/// Bindings live in a flat frame of slots. The interpreter addresses them by the (depth, slot) pairs computed by the
+/// resolver; lookups by name are kept for bindings the resolver could not place (Velvet is dynamically scoped across
+/// calls) and for embedders.
+///
 /// To create a sub-environment manually, you must `Rc::clone()` the current env, which you can pass into the `parent` of SourceEnv::new.
 impl SourceEnv {
     pub fn new(parent: Option<Rc<RefCell<SourceEnv>>>) -> Self {
         Self {
-            variables: HashMap::new(),
+            names: Rc::new(SlotLayout::new()),
+            slots: Vec::new(),
+            parent,
+        }
+    }
+
+    /// Creates an environment whose slots follow a layout produced by the resolver.
+    pub fn with_layout(parent: Option<Rc<RefCell<SourceEnv>>>, layout: Rc<SlotLayout>) -> Self {
+        Self {
+            slots: Vec::with_capacity(layout.len()),
+            names: layout,
             parent,
         }
     }
 
+    /// Empties this environment for reuse as a scope under `parent`, keeping the allocation of its slots.
+    fn reset(&mut self, parent: Rc<RefCell<SourceEnv>>, layout: Option<Rc<SlotLayout>>) {
+        self.slots.clear();
+        match layout {
+            Some(layout) => {
+                self.slots.reserve(layout.len());
+                self.names = layout;
+            }
+            None => match Rc::get_mut(&mut self.names) {
+                Some(names) => names.clear(),
+                None => self.names = Rc::new(SlotLayout::new()),
+            },
+        }
+        self.parent = Some(parent);
+    }
+
     /// Creates an environment with default Velvet standard library values pre-defined.
     pub fn create_global(do_sandbox_safety: bool) -> Rc<RefCell<Self>> {
-        let mut this_env = Self {
-            variables: HashMap::new(),
-            parent: None,
-        };
-        this_env.variables = standard_library_values(do_sandbox_safety)
-            .into_iter()
-            .map(|(k, v)| {
-                (
-                    k,
-                    EnvVar {
-                        value: v.clone(),
-                        is_mutable: false,
-                    },
-                )
-            })
-            .collect();
+        let mut this_env = Self::new(None);
+        for (k, v) in standard_library_values(do_sandbox_safety) {
+            this_env.declare_var(k, v, false);
+        }
         Rc::new(RefCell::new(this_env))
     }
 
+    pub fn layout(&self) -> &SlotLayout {
+        &self.names
+    }
+
+    /// Adds the names of `layout` that this environment does not know yet, keeping their slots. Used to prepare the
+    /// global environment for a program whose top level was resolved against it.
+    pub fn extend_layout(&mut self, layout: &SlotLayout) {
+        if layout.len() == self.names.len() {
+            return;
+        }
+        let names = Rc::make_mut(&mut self.names);
+        for (name, slot) in layout {
+            names.entry(name.clone()).or_insert(*slot);
+        }
+    }
+
+    /// Iterates over every declared binding.
+    pub fn bindings(&self) -> impl std::iter::Iterator<Item = (&String, &EnvVar)> {
+        self.names
+            .iter()
+            .filter_map(|(name, slot)| Some((name, self.slots.get(*slot)?.as_ref()?)))
+    }
+
     pub fn declare_var(&mut self, var_name: String, var_value: RuntimeVal, var_is_mutable: bool) {
-        if self.variables.contains_key(&var_name) {
+        let slot = match self.names.get(&var_name) {
+            Some(slot) => *slot,
+            None => {
+                let slot = self.names.len();
+                Rc::make_mut(&mut self.names).insert(var_name, slot);
+                slot
+            }
+        };
+        self.declare_at(slot, var_value, var_is_mutable);
+    }
+
+    /// Declares the binding that the resolver placed at `slot`.
+    pub fn declare_at(&mut self, slot: usize, var_value: RuntimeVal, var_is_mutable: bool) {
+        if self.slots.len() <= slot {
+            self.slots.resize(slot + 1, None);
+        }
+        if self.slots[slot].is_some() {
             panic!(
                 "Attempt to redeclare binding {} to {:#?} (non-assignment)",
-                var_name, var_value
+                self.slot_name(slot),
+                var_value
             );
         }
-        self.variables.insert(
-            var_name,
-            EnvVar {
-                value: var_value,
-                is_mutable: var_is_mutable,
-            },
-        );
+        self.slots[slot] = Some(EnvVar {
+            value: var_value,
+            is_mutable: var_is_mutable,
+        });
+    }
+
+    /// How many bindings have been declared in this environment itself.
+    pub fn bound_count(&self) -> usize {
+        self.slots.iter().filter(|slot| slot.is_some()).count()
+    }
+
+    /// Whether every binding declared in `other` is declared here too, so a lookup by name that reaches this
+    /// environment never gets as far as `other`.
+    pub fn shadows(&self, other: &SourceEnv) -> bool {
+        if Rc::ptr_eq(&self.names, &other.names) {
+            return (0..other.slots.len()).all(|slot| !other.is_bound(slot) || self.is_bound(slot));
+        }
+        other
+            .bindings()
+            .all(|(name, _)| self.fetch_local(name).is_some())
+    }
+
+    pub fn is_bound(&self, slot: usize) -> bool {
+        matches!(self.slots.get(slot), Some(Some(_)))
+    }
+
+    pub fn is_bound_at(&self, depth: usize, slot: usize) -> bool {
+        match (depth, &self.parent) {
+            (0, _) => self.is_bound(slot),
+            (_, Some(parent)) => parent.borrow().is_bound_at(depth - 1, slot),
+            (_, None) => false,
+        }
+    }
+
+    fn slot_name(&self, slot: usize) -> &str {
+        self.names
+            .iter()
+            .find(|(_, s)| **s == slot)
+            .map(|(name, _)| name.as_str())
+            .unwrap_or("<unnamed>")
     }
 
     pub fn attempt_assignment(&mut self, var_name: String, var_new_value: RuntimeVal) {
-        if let Some(local_var) = self.variables.get_mut(&var_name) {
-            if local_var.is_mutable {
-                local_var.value = var_new_value;
-                return;
-            } else {
-                panic!("Cannot assign to immutable variable '{}'", var_name);
+        if let Some(slot) = self.names.get(&var_name) {
+            if let Some(Some(local_var)) = self.slots.get_mut(*slot) {
+                if local_var.is_mutable {
+                    local_var.value = var_new_value;
+                    return;
+                } else {
+                    panic!("Cannot assign to immutable variable '{}'", var_name);
+                }
             }
         }
 
@@ -86,10 +231,54 @@ impl SourceEnv {
         }
     }
 
+    /// Assigns to the binding `depth` environments up at `slot`. If that slot has not been declared at runtime (its
+    /// declaration was skipped), the assignment falls back to a lookup by name from this environment.
+    pub fn assign_at(
+        &mut self,
+        depth: usize,
+        slot: usize,
+        var_name: &str,
+        var_new_value: RuntimeVal,
+    ) {
+        if let Err(value) = self.try_assign_at(depth, slot, var_name, var_new_value) {
+            self.attempt_assignment(var_name.to_string(), value);
+        }
+    }
+
+    fn try_assign_at(
+        &mut self,
+        depth: usize,
+        slot: usize,
+        var_name: &str,
+        var_new_value: RuntimeVal,
+    ) -> Result<(), RuntimeVal> {
+        if depth > 0 {
+            return match &self.parent {
+                Some(parent_rc) => {
+                    parent_rc
+                        .borrow_mut()
+                        .try_assign_at(depth - 1, slot, var_name, var_new_value)
+                }
+                None => Err(var_new_value),
+            };
+        }
+
+        match self.slots.get_mut(slot) {
+            Some(Some(local_var)) => {
+                if local_var.is_mutable {
+                    local_var.value = var_new_value;
+                    Ok(())
+                } else {
+                    panic!("Cannot assign to immutable variable '{}'", var_name);
+                }
+            }
+            _ => Err(var_new_value),
+        }
+    }
+
     pub fn fetch_local(&self, var_name: &String) -> Option<&EnvVar> {
-        let res = self.variables.get(var_name);
-        // println!("FINDING {}: {:#?}", var_name, res);
-        res
+        let slot = self.names.get(var_name)?;
+        self.slots.get(*slot)?.as_ref()
     }
 
     pub fn fetch(&self, var_name: &String) -> Option<EnvVar> {
@@ -102,4 +291,60 @@ impl SourceEnv {
             None => None,
         }
     }
+
+    /// Hands `f` the binding of `var_name` for in-place modification, at `address` when it is resolved and bound and
+    /// by name otherwise. Returns `None` if there is no such binding.
+    pub fn binding_mut<R>(
+        &mut self,
+        var_name: &str,
+        address: Option<SlotAddress>,
+        f: impl FnOnce(&mut EnvVar) -> R,
+    ) -> Option<R> {
+        match address {
+            Some(address) if self.is_bound_at(address.depth, address.slot) => {
+                self.binding_at_mut(address.depth, address.slot, f)
+            }
+            _ => self.binding_named_mut(var_name, f),
+        }
+    }
+
+    fn binding_at_mut<R>(
+        &mut self,
+        depth: usize,
+        slot: usize,
+        f: impl FnOnce(&mut EnvVar) -> R,
+    ) -> Option<R> {
+        if depth > 0 {
+            return self
+                .parent
+                .as_ref()?
+                .borrow_mut()
+                .binding_at_mut(depth - 1, slot, f);
+        }
+        self.slots.get_mut(slot)?.as_mut().map(f)
+    }
+
+    fn binding_named_mut<R>(
+        &mut self,
+        var_name: &str,
+        f: impl FnOnce(&mut EnvVar) -> R,
+    ) -> Option<R> {
+        if let Some(slot) = self.names.get(var_name) {
+            if let Some(Some(local_var)) = self.slots.get_mut(*slot) {
+                return Some(f(local_var));
+            }
+        }
+        self.parent
+            .as_ref()?
+            .borrow_mut()
+            .binding_named_mut(var_name, f)
+    }
+
+    /// Fetches the value `depth` environments up at `slot`, or `None` if that slot has not been declared.
+    pub fn fetch_at(&self, depth: usize, slot: usize) -> Option<RuntimeVal> {
+        if depth > 0 {
+            return self.parent.as_ref()?.borrow().fetch_at(depth - 1, slot);
+        }
+        self.slots.get(slot)?.as_ref().map(|v| v.value.clone())
+    }
 }
@@ -0,0 +1,230 @@
+use std::{
+    borrow::Borrow,
+    cell::Cell,
+    cmp::Ordering,
+    fmt,
+    hash::{Hash, Hasher},
+    mem::ManuallyDrop,
+    ops::{Deref, Range},
+    rc::Rc,
+};
+
+/// Append-only UTF-8 bytes in an allocation that never moves. Bytes below `len` are written once and never again, so
+/// every `&str` into them stays valid while more is appended after them.
+struct StrBuf {
+    ptr: *mut u8,
+    capacity: usize,
+    len: Cell<usize>,
+}
+
+impl StrBuf {
+    fn with_capacity(capacity: usize) -> Self {
+        Self::from_bytes(Vec::with_capacity(capacity))
+    }
+
+    fn from_bytes(bytes: Vec<u8>) -> Self {
+        let mut bytes = ManuallyDrop::new(bytes);
+        Self {
+            ptr: bytes.as_mut_ptr(),
+            capacity: bytes.capacity(),
+            len: Cell::new(bytes.len()),
+        }
+    }
+
+    fn room(&self) -> usize {
+        self.capacity - self.len.get()
+    }
+
+    /// Writes `bytes` after the end. The caller makes sure there is room.
+    fn push(&self, bytes: &[u8]) {
+        assert!(bytes.len() <= self.room());
+        // `bytes` may be part of this buffer, but only of its written bytes, which are below where it is copied to
+        unsafe {
+            std::ptr::copy_nonoverlapping(
+                bytes.as_ptr(),
+                self.ptr.add(self.len.get()),
+                bytes.len(),
+            );
+        }
+        self.len.set(self.len.get() + bytes.len());
+    }
+}
+
+impl Drop for StrBuf {
+    fn drop(&mut self) {
+        unsafe { drop(Vec::from_raw_parts(self.ptr, 0, self.capacity)) }
+    }
+}
+
+/// The text of a Velvet string: a range of a shared, append-only buffer.
+///
+/// Copies and slices (`string.split`'s pieces, say) share their buffer instead of copying it. Concatenating onto the
+/// string that ends a buffer writes into the buffer's spare room, so building a string with `s = s + piece` in a loop
+/// copies each piece once rather than the whole string every time. The flip side is that a small slice keeps its
+/// whole buffer alive.
+#[derive(Clone)]
+pub struct SharedStr {
+    buf: Rc<StrBuf>,
+    start: usize,
+    end: usize,
+}
+
+impl SharedStr {
+    /// `self` followed by `other`.
+    pub fn concat(&self, other: &str) -> Self {
+        if self.end == self.buf.len.get() && other.len() <= self.buf.room() {
+            self.buf.push(other.as_bytes());
+            return Self {
+                buf: Rc::clone(&self.buf),
+                start: self.start,
+                end: self.end + other.len(),
+            };
+        }
+
+        // Leaves as much room again, so the next concatenation onto the result can append in place
+        let len = self.len() + other.len();
+        let buf = StrBuf::with_capacity((len * 2).max(16));
+        buf.push(self.as_bytes());
+        buf.push(other.as_bytes());
+        Self {
+            buf: Rc::new(buf),
+            start: 0,
+            end: len,
+        }
+    }
+
+    /// The bytes in `range` of this string, sharing its buffer. Both ends must be on character boundaries.
+    pub fn slice(&self, range: Range<usize>) -> Self {
+        assert!(self.is_char_boundary(range.start) && self.is_char_boundary(range.end));
+        assert!(range.start <= range.end && range.end <= self.len());
+        Self {
+            buf: Rc::clone(&self.buf),
+            start: self.start + range.start,
+            end: self.start + range.end,
+        }
+    }
+}
+
+impl Deref for SharedStr {
+    type Target = str;
+
+    fn deref(&self) -> &str {
+        unsafe {
+            let bytes =
+                std::slice::from_raw_parts(self.buf.ptr.add(self.start), self.end - self.start);
+            std::str::from_utf8_unchecked(bytes)
+        }
+    }
+}
+
+impl From<String> for SharedStr {
+    fn from(value: String) -> Self {
+        let end = value.len();
+        Self {
+            buf: Rc::new(StrBuf::from_bytes(value.into_bytes())),
+            start: 0,
+            end,
+        }
+    }
+}
+
+impl From<&str> for SharedStr {
+    fn from(value: &str) -> Self {
+        let buf = StrBuf::with_capacity(value.len());
+        buf.push(value.as_bytes());
+        Self {
+            buf: Rc::new(buf),
+            start: 0,
+            end: value.len(),
+        }
+    }
+}
+
+impl Borrow<str> for SharedStr {
+    fn borrow(&self) -> &str {
+        self
+    }
+}
+
+impl PartialEq for SharedStr {
+    fn eq(&self, other: &Self) -> bool {
+        **self == **other
+    }
+}
+
+impl Eq for SharedStr {}
+
+impl PartialOrd for SharedStr {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for SharedStr {
+    fn cmp(&self, other: &Self) -> Ordering {
+        (**self).cmp(&**other)
+    }
+}
+
+impl Hash for SharedStr {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        (**self).hash(state)
+    }
+}
+
+impl fmt::Display for SharedStr {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt::Display::fmt(&**self, f)
+    }
+}
+
+impl fmt::Debug for SharedStr {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt::Debug::fmt(&**self, f)
+    }
+}
+
+const LOW_BITS: u64 = 0x0101_0101_0101_0101;
+const HIGH_BITS: u64 = 0x8080_8080_8080_8080;
+
+/// The high bit of every zero byte of `word` set. Bytes above a zero byte may be flagged too, which costs a spare
+/// comparison but never misses a match.
+fn zero_bytes(word: u64) -> u64 {
+    word.wrapping_sub(LOW_BITS) & !word & HIGH_BITS
+}
+
+fn load_word(bytes: &[u8], at: usize) -> u64 {
+    u64::from_le_bytes(bytes[at..at + 8].try_into().unwrap())
+}
+
+/// The byte offset of the first `needle` in `haystack`. Eight starting positions are filtered at once, SIMD within a
+/// register: a position is only compared in full when the haystack has the needle's first byte there and its last
+/// byte at the matching distance, which all but rules out the compares a byte-at-a-time search makes.
+pub fn find(haystack: &str, needle: &str) -> Option<usize> {
+    let (haystack, needle) = (haystack.as_bytes(), needle.as_bytes());
+    if needle.len() > haystack.len() {
+        return None;
+    }
+    if needle.is_empty() {
+        return Some(0);
+    }
+    let last = needle.len() - 1;
+    let firsts = LOW_BITS * needle[0] as u64;
+    let lasts = LOW_BITS * needle[last] as u64;
+    let starts = haystack.len() - needle.len() + 1;
+
+    let mut at = 0;
+    while at + 8 <= starts {
+        let mut candidates = zero_bytes(load_word(haystack, at) ^ firsts)
+            & zero_bytes(load_word(haystack, at + last) ^ lasts);
+        while candidates != 0 {
+            let start = at + (candidates.trailing_zeros() / 8) as usize;
+            if haystack[start..start + needle.len()] == *needle {
+                return Some(start);
+            }
+            candidates &= candidates - 1;
+        }
+        at += 8;
+    }
+    (at..starts).find(|&start| haystack[start..start + needle.len()] == *needle)
+}
@@ -1,27 +1,65 @@
-use std::{cell::RefCell, collections::HashMap, fmt, rc::Rc};
+use std::{cell::RefCell, fmt, rc::Rc};
 
 use crate::{
-    parser::nodetypes::Node, runtime::source_environment::source_environment::SourceEnv,
+    parser::nodetypes::Node,
+    runtime::{
+        iterators::IterSource,
+        numeric::{self, IntWidth},
+        shapes::Shape,
+        source_environment::source_environment::SourceEnv,
+        strings::SharedStr,
+        vm::bytecode::FunctionProto,
+    },
     typecheck::typecheck::T,
 };
 
-pub type NativeMethod = fn(&RuntimeVal, Vec<RuntimeVal>) -> RuntimeVal;
+/// What a native method may ask of the execution technique that called it.
+pub trait MethodContext {
+    /// Calls a Velvet function value, as `map`, `filter` and `reduce` do with their callbacks.
+    fn call_function(&mut self, function: &RuntimeVal, args: Vec<RuntimeVal>) -> RuntimeVal;
+    fn interpreter_error(&mut self, args: fmt::Arguments<'_>) -> !;
+}
+
+/// A built-in method implemented in Rust. `call` receives the receiver itself: for mutating methods that is the
+/// value held by the receiver's binding, which is written to in place; other methods are handed a copy.
+#[derive(Clone, Copy)]
+pub struct NativeMethod {
+    pub name: &'static str,
+    pub mutates: bool,
+    pub call: fn(&mut RuntimeVal, Vec<RuntimeVal>, &mut dyn MethodContext) -> RuntimeVal,
+}
+
+impl fmt::Debug for NativeMethod {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "NativeMethod {{ name: {} }}", self.name)
+    }
+}
 
+/// Values with a table of built-in methods. The tables are static, so looking a method up allocates nothing.
 pub trait HasMethods {
-    fn get_methods(&self) -> HashMap<String, NativeMethod>;
+    fn get_methods(&self) -> &'static [NativeMethod];
+
+    fn get_method(&self, name: &str) -> Option<&'static NativeMethod> {
+        self.get_methods().iter().find(|method| method.name == name)
+    }
 }
 
 #[derive(Clone)]
 pub enum RuntimeVal {
     NumberVal(NumberVal),
+    IntegerVal(IntegerVal),
+    FloatVal(FloatVal),
     NullVal(NullVal),
     FunctionVal(FunctionVal),
+    BytecodeFunctionVal(BytecodeFunctionVal),
     InternalFunctionVal(InternalFunctionVal),
+    NativeMethodVal(NativeMethodVal),
     BoolVal(BoolVal),
     StringVal(StringVal),
     ReturnVal(ReturnVal),
     IteratorVal(IteratorVal),
     ListVal(ListVal),
+    NumberArrayVal(NumberArrayVal),
     ObjectVal(ObjectVal),
 }
 
@@ -30,6 +68,33 @@ impl RuntimeVal {
         matches!(self, RuntimeVal::NullVal(_))
     }
 
+    /// Looks up a built-in method of this value.
+    pub fn get_method(&self, name: &str) -> Option<&'static NativeMethod> {
+        match self {
+            RuntimeVal::ListVal(list) => list.get_method(name),
+            RuntimeVal::NumberArrayVal(array) => array.get_method(name),
+            RuntimeVal::IteratorVal(iterator) => iterator.get_method(name),
+            _ => None,
+        }
+    }
+
+    /// Whether this is a list, in either representation.
+    pub fn is_list(&self) -> bool {
+        matches!(self, RuntimeVal::ListVal(_) | RuntimeVal::NumberArrayVal(_))
+    }
+
+    /// The element at `index` of a list, in either representation.
+    pub fn list_element(&self, index: usize) -> Option<RuntimeVal> {
+        match self {
+            RuntimeVal::ListVal(list) => list.values.get(index).cloned(),
+            RuntimeVal::NumberArrayVal(array) => array
+                .values
+                .get(index)
+                .map(|&value| RuntimeVal::NumberVal(NumberVal { value })),
+            _ => None,
+        }
+    }
+
     pub fn compare(&self, other: &RuntimeVal, op: &str) -> Result<bool, String> {
         match (self, other) {
             (RuntimeVal::NumberVal(l), RuntimeVal::NumberVal(r)) => {
@@ -60,10 +125,12 @@ impl RuntimeVal {
                 Ok(result)
             }
             (RuntimeVal::NullVal(_), RuntimeVal::BoolVal(_)) => Ok(false),
-            _ => Err(format!(
-                "Unsupported comparison between {:?} and {:?}",
-                self, other
-            )),
+            _ => numeric::compare(self, op, other).unwrap_or_else(|| {
+                Err(format!(
+                    "Unsupported comparison between {:?} and {:?}",
+                    self, other
+                ))
+            }),
         }
     }
 }
@@ -73,6 +140,18 @@ pub struct NumberVal {
     pub value: isize,
 }
 
+/// A value of one of the sized integer types, already wrapped to `width`.
+#[derive(Debug, Clone)]
+pub struct IntegerVal {
+    pub value: i128,
+    pub width: IntWidth,
+}
+
+#[derive(Debug, Clone)]
+pub struct FloatVal {
+    pub value: f64,
+}
+
 #[derive(Debug, Clone)]
 pub struct NullVal {}
 
@@ -83,21 +162,29 @@ pub struct BoolVal {
 
 #[derive(Debug, Clone)]
 pub struct FunctionVal {
-    pub params: Vec<(String, T)>,
-    pub fn_name: String,
+    pub params: Rc<[(String, T)]>,
+    pub fn_name: Rc<str>,
     pub execution_body: Rc<Vec<Node>>,
     pub is_internal: bool,
+    /// Id of the defining node, which keys the resolved slot layout of the function's frame.
+    pub definition_id: Option<usize>,
 }
 
+/// A function compiled for the bytecode VM.
 #[derive(Debug, Clone)]
+pub struct BytecodeFunctionVal {
+    pub proto: Rc<FunctionProto>,
+}
+
+#[derive(Debug, Clone)]
+/// A lazy sequence, advanced in place by `for` loops; see `IterSource`. Binding it elsewhere copies its position.
 pub struct IteratorVal {
-    pub to_name: String,
-    pub target: Box<RuntimeVal>,
+    pub source: Box<IterSource>,
 }
 
 #[derive(Clone)]
 pub struct InternalFunctionVal {
-    pub fn_name: String,
+    pub fn_name: Rc<str>,
     pub internal_callback: Rc<dyn Fn(Vec<RuntimeVal>, Rc<RefCell<SourceEnv>>) -> RuntimeVal>,
 }
 
@@ -107,47 +194,125 @@ impl fmt::Debug for InternalFunctionVal {
     }
 }
 
+/// A built-in method taken as a value (`bind len = xs.len`), bound to a copy of the value it was looked up on.
+/// Method calls (`xs.len()`) dispatch directly and never create one.
+#[derive(Debug, Clone)]
+pub struct NativeMethodVal {
+    pub receiver: Box<RuntimeVal>,
+    pub method: &'static NativeMethod,
+}
+
+/// Strings are immutable in Velvet, so copies and slices share one buffer; see `SharedStr`.
 #[derive(Debug, Clone)]
 pub struct StringVal {
-    pub value: String,
+    pub value: SharedStr,
 }
 
 #[derive(Debug, Clone)]
 pub struct ReturnVal {
-    pub value: Box<Node>,
+    /// The returned value, evaluated where the `;` statement ran.
+    pub value: Box<RuntimeVal>,
 }
 
+/// Copying a list (binding it, passing it, reading it out of an environment) shares its storage; the elements are
+/// only copied when a shared list is written to.
 #[derive(Debug, Clone)]
 pub struct ListVal {
-    pub values: Vec<RuntimeVal>,
+    pub values: Rc<Vec<RuntimeVal>>,
 }
 
 impl ListVal {
+    /// The elements for writing, copied first if they are shared.
+    pub fn values_mut(&mut self) -> &mut Vec<RuntimeVal> {
+        Rc::make_mut(&mut self.values)
+    }
+
     pub fn push(&mut self, value: RuntimeVal) {
-        self.values.push(value);
+        self.values_mut().push(value);
+    }
+
+    pub fn extend(&mut self, values: Vec<RuntimeVal>) {
+        self.values_mut().extend(values);
     }
 
     pub fn len(&self) -> isize {
         self.values.len().try_into().unwrap()
     }
+
+    /// The list stored unboxed, if every element is a `number`.
+    pub fn to_number_array(&self) -> Option<NumberArrayVal> {
+        let numbers = self
+            .values
+            .iter()
+            .map(|value| match value {
+                RuntimeVal::NumberVal(n) => Some(n.value),
+                _ => None,
+            })
+            .collect::<Option<Vec<isize>>>()?;
+        Some(NumberArrayVal {
+            values: numbers.into(),
+        })
+    }
+}
+
+/// A list of `number`s stored unboxed, as a binding declared `number[]` holds it. It behaves like a `ListVal` of
+/// `NumberVal`s, and its bulk numeric methods run as loops over plain integers (see `runtime::kernels`).
+#[derive(Debug, Clone)]
+pub struct NumberArrayVal {
+    pub values: Rc<Vec<isize>>,
+}
+
+impl NumberArrayVal {
+    /// The elements for writing, copied first if they are shared.
+    pub fn values_mut(&mut self) -> &mut Vec<isize> {
+        Rc::make_mut(&mut self.values)
+    }
+
+    pub fn to_list(&self) -> ListVal {
+        ListVal {
+            values: Rc::new(
+                self.values
+                    .iter()
+                    .map(|&value| RuntimeVal::NumberVal(NumberVal { value }))
+                    .collect(),
+            ),
+        }
+    }
+
+    fn fmt_elements(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "[")?;
+        for (i, value) in self.values.iter().enumerate() {
+            if i > 0 {
+                write!(f, ", ")?;
+            }
+            write!(f, "{}", value)?;
+        }
+        write!(f, "]")
+    }
 }
 
+/// Shares its properties between copies like `ListVal`. `values[slot]` is the value of the shape's key at `slot`.
 #[derive(Debug, Clone)]
 pub struct ObjectVal {
-    pub values: HashMap<String, RuntimeVal>,
+    pub shape: Rc<Shape>,
+    pub values: Rc<[RuntimeVal]>,
 }
 
 impl RuntimeVal {
     pub fn fmt_nondebug(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         match self {
             RuntimeVal::NumberVal(n) => write!(f, "{}", n.value),
+            RuntimeVal::IntegerVal(i) => write!(f, "{}", i.value),
+            RuntimeVal::FloatVal(n) => write!(f, "{:?}", n.value),
             RuntimeVal::StringVal(s) => write!(f, "{}", s.value),
             RuntimeVal::BoolVal(b) => write!(f, "{}", b.value),
             RuntimeVal::NullVal(_) => write!(f, "null"),
             RuntimeVal::FunctionVal(func) => write!(f, "<function {}>", func.fn_name),
+            RuntimeVal::BytecodeFunctionVal(func) => write!(f, "<function {}>", func.proto.name),
             RuntimeVal::InternalFunctionVal(func) => write!(f, "<function {}>", func.fn_name),
+            RuntimeVal::NativeMethodVal(method) => write!(f, "<function {}>", method.method.name),
             RuntimeVal::ReturnVal(r) => write!(f, "{:#?}", r.value),
-            RuntimeVal::IteratorVal(i) => write!(f, "<iterator {}>", i.to_name),
+            RuntimeVal::IteratorVal(i) => write!(f, "<iterator {}>", i.name()),
             RuntimeVal::ListVal(lv) => {
                 write!(f, "[")?;
                 for (i, val) in lv.values.iter().enumerate() {
@@ -158,9 +323,10 @@ impl RuntimeVal {
                 }
                 write!(f, "]")
             }
+            RuntimeVal::NumberArrayVal(array) => array.fmt_elements(f),
             RuntimeVal::ObjectVal(ov) => {
                 write!(f, "{{\n")?;
-                for (i, (key, val)) in ov.values.iter().enumerate() {
+                for (i, (key, val)) in ov.iter().enumerate() {
                     if i > 0 {
                         write!(f, ",\n")?;
                     }
@@ -175,17 +341,29 @@ impl RuntimeVal {
     pub fn fmt_debug(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         match self {
             RuntimeVal::NumberVal(n) => write!(f, "{}", n.value),
+            RuntimeVal::IntegerVal(i) => write!(f, "{}", i.value),
+            RuntimeVal::FloatVal(n) => write!(f, "{:?}", n.value),
             RuntimeVal::StringVal(s) => write!(f, "\"{}\"", s.value),
             RuntimeVal::BoolVal(b) => write!(f, "{}", b.value),
             RuntimeVal::NullVal(_) => write!(f, "null"),
             RuntimeVal::FunctionVal(func) => {
                 write!(f, "<function {} ({:?})>", func.fn_name, func.params)
             }
+            RuntimeVal::BytecodeFunctionVal(func) => {
+                write!(
+                    f,
+                    "<function {} ({:?})>",
+                    func.proto.name, func.proto.params
+                )
+            }
             RuntimeVal::InternalFunctionVal(func) => {
                 write!(f, "<function::internal {}>", func.fn_name)
             }
+            RuntimeVal::NativeMethodVal(method) => {
+                write!(f, "<function::internal {}>", method.method.name)
+            }
             RuntimeVal::ReturnVal(r) => write!(f, "{:#?}", r.value),
-            RuntimeVal::IteratorVal(i) => write!(f, "<iterator {}>", i.to_name),
+            RuntimeVal::IteratorVal(i) => write!(f, "<iterator {}>", i.name()),
             RuntimeVal::ListVal(lv) => {
                 write!(f, "[")?;
                 for (i, val) in lv.values.iter().enumerate() {
@@ -196,9 +374,10 @@ impl RuntimeVal {
                 }
                 write!(f, "]")
             }
+            RuntimeVal::NumberArrayVal(array) => array.fmt_elements(f),
             RuntimeVal::ObjectVal(ov) => {
                 write!(f, "{{\n")?;
-                for (i, (key, val)) in ov.values.iter().enumerate() {
+                for (i, (key, val)) in ov.iter().enumerate() {
                     if i > 0 {
                         write!(f, ",\n")?;
                     }
@@ -215,11 +394,17 @@ impl RuntimeVal {
 
         match self {
             RuntimeVal::NumberVal(n) => write!(f, "{}", n.value),
+            RuntimeVal::IntegerVal(i) => write!(f, "{}", i.value),
+            RuntimeVal::FloatVal(n) => write!(f, "{:?}", n.value),
             RuntimeVal::StringVal(s) => write!(f, "{}", s.value),
             RuntimeVal::BoolVal(b) => write!(f, "{}", b.value),
             RuntimeVal::NullVal(_) => write!(f, "null"),
             RuntimeVal::FunctionVal(func) => write!(f, "<function {}>", func.fn_name),
+            RuntimeVal::BytecodeFunctionVal(func) => write!(f, "<function {}>", func.proto.name),
             RuntimeVal::InternalFunctionVal(func) => write!(f, "<internal fn {}>", func.fn_name),
+            RuntimeVal::NativeMethodVal(method) => {
+                write!(f, "<internal fn {}>", method.method.name)
+            }
             RuntimeVal::ReturnVal(_) => write!(f, "return"),
             RuntimeVal::IteratorVal(_) => write!(f, "iterator"),
             RuntimeVal::ListVal(lv) => {
@@ -232,9 +417,10 @@ impl RuntimeVal {
                 }
                 write!(f, "]")
             }
+            RuntimeVal::NumberArrayVal(array) => array.fmt_elements(f),
             RuntimeVal::ObjectVal(ov) => {
                 write!(f, "{{\n")?;
-                for (i, (key, val)) in ov.values.iter().enumerate() {
+                for (i, (key, val)) in ov.iter().enumerate() {
                     if i > 0 {
                         write!(f, ",\n")?;
                     }
@@ -0,0 +1,236 @@
+use core::fmt;
+use std::rc::Rc;
+
+use crate::{
+    runtime::{
+        match_table::MatchTable,
+        numeric::NumericType,
+        shapes::{ObjectLayout, PropertyCache},
+        values::RuntimeVal,
+    },
+    typecheck::typecheck::T,
+};
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum CompareOp {
+    Eq,
+    NotEq,
+    Lt,
+    LtEq,
+    Gt,
+    GtEq,
+}
+
+impl CompareOp {
+    pub fn from_str(op: &str) -> Option<Self> {
+        match op {
+            "==" => Some(Self::Eq),
+            "!=" => Some(Self::NotEq),
+            "<" => Some(Self::Lt),
+            "<=" => Some(Self::LtEq),
+            ">" => Some(Self::Gt),
+            ">=" => Some(Self::GtEq),
+            _ => None,
+        }
+    }
+
+    pub fn as_str(&self) -> &'static str {
+        match self {
+            Self::Eq => "==",
+            Self::NotEq => "!=",
+            Self::Lt => "<",
+            Self::LtEq => "<=",
+            Self::Gt => ">",
+            Self::GtEq => ">=",
+        }
+    }
+}
+
+/// A single VM instruction.
+///
+/// Jump operands are absolute offsets into the owning chunk's code; `u32` operands otherwise index into the
+/// chunk's pools (constants, names, object layouts, property caches, match tables, functions) or into the current frame's local
+/// slots.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum Op {
+    Constant(u32),
+    Null,
+    Pop,
+    Dup,
+
+    LoadLocal(u32),
+    StoreLocal(u32),
+    /// `LoadLocal` for a named binding. A slot whose declaration was skipped (e.g. in an `if` that did not run) is
+    /// unbound, so the name is resolved through the dynamic scope chain instead, as the interpreter's `fetch_at` does.
+    LoadLocalOrName(u32),
+    /// `StoreLocal` for a named binding, falling back to assignment by name like `LoadLocalOrName`.
+    StoreLocalOrName(u32),
+    /// Faults if the slot is already bound; emitted for bindings that shadow one in the same scope.
+    CheckUnbound(u32),
+    /// Unbinds `count` slots starting at `start` when a scope is left.
+    ClearLocals(u32, u32),
+    /// Resolves a name that was not statically visible through the dynamic scope chain (callers, then globals).
+    LoadName(u32),
+    StoreName(u32),
+    LoadCallStack,
+
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Compare(CompareOp),
+    /// Pops a number and pushes it converted to the type, for `as` casts.
+    Convert(NumericType),
+    /// Gives the untyped number on top of the stack the sized type of the binding it is about to be stored in.
+    Adopt(NumericType),
+    /// Unboxes the list on top of the stack into a `number[]` for the binding it is about to be stored in.
+    PackNumbers,
+    /// Pops `target`, `pattern`; pushes whether they compare equal, treating comparison errors as a miss.
+    MatchEq,
+    /// Pops a match predicate's result and pushes whether it is `true`.
+    TestTrue,
+    /// Pops a match target and jumps to where the chunk's `MatchJumps` at this index sends it. Targets the table
+    /// cannot look up continue with the next instruction, which tries every arm in turn.
+    MatchJump(u32),
+
+    Jump(u32),
+    JumpIfFalse(u32),
+    /// Keeps the top of the stack and jumps if it is not null; otherwise pops it.
+    JumpIfNotNull(u32),
+    JumpIfNotCallable(u32),
+    JumpIfNotList(u32),
+
+    MakeList(u32),
+    MakeObject(u32),
+    MakeFunction(u32),
+    /// Property lookup by the constant key `name` (`a.b`, `a[0]`, and `a[b]` on objects), remembering where objects
+    /// keep it in the chunk's property cache `cache`.
+    GetKey {
+        name: u32,
+        cache: u32,
+    },
+    /// Computed list index with an evaluated index (`a[b]`).
+    GetIndex,
+
+    Call(u32),
+    /// Fused `GetKey(name)` + `Call(argc)` for `a.b(...)` on a receiver that is not a binding. Built-in methods are
+    /// dispatched directly; mutating ones fault, since there is nothing to write the result back to.
+    CallMethod(u32, u32),
+    /// `CallMethod` on the binding in `slot`. Mutating built-in methods modify the slot's value in place.
+    CallMethodLocal {
+        slot: u32,
+        method: u32,
+        argc: u32,
+    },
+    /// `CallMethodLocal` on a binding resolved by name through the dynamic scope chain.
+    CallMethodName {
+        name: u32,
+        method: u32,
+        argc: u32,
+    },
+    Return,
+
+    /// Pops an iterator, or a list to iterate over, and stores it into `slot`.
+    IterPrepare(u32),
+    /// Pushes the next element of the iterator held in `slot`, or jumps to `exit` once it is exhausted.
+    IterNext {
+        slot: u32,
+        exit: u32,
+    },
+
+    /// Raises a Velvet runtime error with a constant message.
+    Fault(u32),
+    /// Panics with a constant message, mirroring the panics raised by `SourceEnv`.
+    Panic(u32),
+}
+
+#[derive(Debug, Clone)]
+pub struct LocalInfo {
+    pub name: String,
+    pub is_mutable: bool,
+}
+
+#[derive(Debug, Clone, Default)]
+pub struct Chunk {
+    pub code: Vec<Op>,
+    pub constants: Vec<RuntimeVal>,
+    pub names: Vec<String>,
+    pub layouts: Vec<ObjectLayout>,
+    /// One per `GetKey` instruction.
+    pub property_caches: Vec<PropertyCache>,
+    pub match_jumps: Vec<MatchJumps>,
+    pub functions: Vec<Rc<FunctionProto>>,
+}
+
+/// A `match` lowered to a `MatchTable`, with the code offsets its lookups lead to.
+#[derive(Debug, Clone)]
+pub struct MatchJumps {
+    pub table: MatchTable,
+    /// For each arm in `table.dispatched()`, indexed by arm, where taking it starts: the tests of the fallback arms
+    /// ahead of it, then its body.
+    pub entries: Vec<u32>,
+    /// Where the fallback arms are tried when no literal arm equals the target.
+    pub miss: u32,
+}
+
+/// A compiled Velvet function. The program's top level is compiled into a parameterless proto as well.
+#[derive(Debug, Clone)]
+pub struct FunctionProto {
+    pub name: String,
+    pub params: Vec<(String, T)>,
+    pub chunk: Chunk,
+    pub locals: Vec<LocalInfo>,
+}
+
+impl FunctionProto {
+    fn fmt_with_indent(&self, f: &mut fmt::Formatter<'_>, depth: usize) -> fmt::Result {
+        let indent = "    ".repeat(depth);
+        writeln!(
+            f,
+            "{}fn {} ({:?}), {} local(s)",
+            indent,
+            self.name,
+            self.params,
+            self.locals.len()
+        )?;
+        for (offset, op) in self.chunk.code.iter().enumerate() {
+            let detail = match op {
+                Op::Constant(i) => format!("{:?}", self.chunk.constants[*i as usize]),
+                Op::LoadLocal(i)
+                | Op::StoreLocal(i)
+                | Op::LoadLocalOrName(i)
+                | Op::StoreLocalOrName(i)
+                | Op::CheckUnbound(i) => self.locals[*i as usize].name.clone(),
+                Op::LoadName(i)
+                | Op::StoreName(i)
+                | Op::GetKey { name: i, .. }
+                | Op::CallMethod(i, _) => self.chunk.names[*i as usize].clone(),
+                Op::CallMethodLocal { slot, method, .. } => format!(
+                    "{}.{}",
+                    self.locals[*slot as usize].name, self.chunk.names[*method as usize]
+                ),
+                Op::CallMethodName { name, method, .. } => format!(
+                    "{}.{}",
+                    self.chunk.names[*name as usize], self.chunk.names[*method as usize]
+                ),
+                Op::MakeObject(i) => {
+                    format!("{:?}", self.chunk.layouts[*i as usize].shape().keys())
+                }
+                Op::MakeFunction(i) => self.chunk.functions[*i as usize].name.clone(),
+                Op::Fault(i) | Op::Panic(i) => format!("{}", self.chunk.constants[*i as usize]),
+                _ => String::new(),
+            };
+            writeln!(f, "{}  {:04} {:?} {}", indent, offset, op, detail)?;
+        }
+        for function in &self.chunk.functions {
+            function.fmt_with_indent(f, depth + 1)?;
+        }
+        Ok(())
+    }
+}
+
+impl fmt::Display for FunctionProto {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        self.fmt_with_indent(f, 0)
+    }
+}
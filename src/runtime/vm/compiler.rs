@@ -0,0 +1,795 @@
+use std::{collections::HashMap, rc::Rc};
+
+use crate::{
+    parser::nodetypes::{
+        AssignmentExpr, CallExpr, FunctionDefinition, IfStmt, Iterator, MatchExpr, MemberExpr,
+        Node, VarDeclaration, WhileStmt,
+    },
+    runtime::{
+        match_table::MatchTable,
+        numeric::{self, NumericType},
+        shapes::{ObjectLayout, PropertyCache},
+        source_environment::source_environment::SourceEnv,
+        values::{BoolVal, FloatVal, NumberVal, RuntimeVal, StringVal},
+        vm::bytecode::{Chunk, CompareOp, FunctionProto, LocalInfo, MatchJumps, Op},
+    },
+    typecheck::typecheck::T,
+};
+
+struct Binding {
+    name: String,
+    slot: u32,
+    is_mutable: bool,
+}
+
+struct Scope {
+    first_slot: u32,
+    bindings: Vec<Binding>,
+}
+
+/// Where a `;` (return) statement transfers control to. Statements directly inside a function body return from the
+/// function, matching the interpreter, which unwinds returns at the nearest block, `for` loop or function body.
+enum ReturnTarget {
+    Block { exits: Vec<usize> },
+    Loop { result_slot: u32, exits: Vec<usize> },
+}
+
+struct FunctionState {
+    name: String,
+    params: Vec<(String, T)>,
+    chunk: Chunk,
+    locals: Vec<LocalInfo>,
+    scopes: Vec<Scope>,
+    return_targets: Vec<ReturnTarget>,
+    is_entry: bool,
+}
+
+/// Lowers a parsed Velvet program into bytecode for the `VirtualMachine`.
+///
+/// Bindings that are statically visible inside the function being compiled are resolved to frame slots. Everything
+/// else keeps Velvet's dynamic scoping and is looked up by name at runtime, through the calling frames and then the
+/// global environment. Global (standard library) bindings referenced from the top level are folded into constants,
+/// since nothing can shadow them there.
+pub struct BytecodeCompiler {
+    globals: HashMap<String, RuntimeVal>,
+    states: Vec<FunctionState>,
+}
+
+impl BytecodeCompiler {
+    pub fn new(globals: &SourceEnv) -> Self {
+        Self {
+            globals: globals
+                .bindings()
+                .map(|(k, v)| (k.clone(), v.value.clone()))
+                .collect(),
+            states: Vec::new(),
+        }
+    }
+
+    pub fn compile_program(mut self, nodes: &[Node]) -> Rc<FunctionProto> {
+        self.begin_function(String::from("velvet::entry_point"), Vec::new(), true);
+        self.compile_body(nodes, true);
+        self.emit(Op::Return);
+        Rc::new(self.end_function())
+    }
+
+    fn state(&mut self) -> &mut FunctionState {
+        self.states.last_mut().unwrap()
+    }
+
+    fn begin_function(&mut self, name: String, params: Vec<(String, T)>, is_entry: bool) {
+        self.states.push(FunctionState {
+            name,
+            params,
+            chunk: Chunk::default(),
+            locals: Vec::new(),
+            scopes: vec![Scope {
+                first_slot: 0,
+                bindings: Vec::new(),
+            }],
+            return_targets: Vec::new(),
+            is_entry,
+        });
+    }
+
+    fn end_function(&mut self) -> FunctionProto {
+        let state = self.states.pop().unwrap();
+        FunctionProto {
+            name: state.name,
+            params: state.params,
+            chunk: state.chunk,
+            locals: state.locals,
+        }
+    }
+
+    fn emit(&mut self, op: Op) -> usize {
+        let code = &mut self.state().chunk.code;
+        code.push(op);
+        code.len() - 1
+    }
+
+    fn offset(&mut self) -> u32 {
+        self.state().chunk.code.len() as u32
+    }
+
+    /// Points the jump emitted at `at` to the current end of the chunk.
+    fn patch_jump(&mut self, at: usize) {
+        let target = self.offset();
+        self.patch_jump_to(at, target);
+    }
+
+    fn patch_jump_to(&mut self, at: usize, target: u32) {
+        let op = &mut self.state().chunk.code[at];
+        *op = match *op {
+            Op::Jump(_) => Op::Jump(target),
+            Op::JumpIfFalse(_) => Op::JumpIfFalse(target),
+            Op::JumpIfNotNull(_) => Op::JumpIfNotNull(target),
+            Op::JumpIfNotCallable(_) => Op::JumpIfNotCallable(target),
+            Op::JumpIfNotList(_) => Op::JumpIfNotList(target),
+            Op::IterNext { slot, .. } => Op::IterNext { slot, exit: target },
+            other => panic!("Cannot patch non-jump instruction {:?}", other),
+        };
+    }
+
+    fn constant(&mut self, value: RuntimeVal) -> u32 {
+        let constants = &mut self.state().chunk.constants;
+        constants.push(value);
+        (constants.len() - 1) as u32
+    }
+
+    fn string_constant(&mut self, value: String) -> u32 {
+        self.constant(RuntimeVal::StringVal(StringVal {
+            value: value.into(),
+        }))
+    }
+
+    fn name(&mut self, name: &str) -> u32 {
+        let names = &mut self.state().chunk.names;
+        if let Some(index) = names.iter().position(|n| n == name) {
+            return index as u32;
+        }
+        names.push(name.to_string());
+        (names.len() - 1) as u32
+    }
+
+    fn fault(&mut self, message: String) {
+        let index = self.string_constant(message);
+        self.emit(Op::Fault(index));
+    }
+
+    fn panic(&mut self, message: String) {
+        let index = self.string_constant(message);
+        self.emit(Op::Panic(index));
+    }
+
+    fn begin_scope(&mut self) {
+        let first_slot = self.state().locals.len() as u32;
+        self.state().scopes.push(Scope {
+            first_slot,
+            bindings: Vec::new(),
+        });
+    }
+
+    fn end_scope(&mut self) {
+        let scope = self.state().scopes.pop().unwrap();
+        let count = self.state().locals.len() as u32 - scope.first_slot;
+        if count > 0 {
+            self.emit(Op::ClearLocals(scope.first_slot, count));
+        }
+    }
+
+    fn add_local(&mut self, name: &str, is_mutable: bool) -> u32 {
+        let locals = &mut self.state().locals;
+        locals.push(LocalInfo {
+            name: name.to_string(),
+            is_mutable,
+        });
+        (locals.len() - 1) as u32
+    }
+
+    /// A slot the compiler uses for its own bookkeeping; it can never be looked up by name.
+    fn hidden_local(&mut self) -> u32 {
+        self.add_local("", false)
+    }
+
+    /// Binds `name` in the innermost scope. A binding that already exists in that scope keeps its slot, so that
+    /// redeclaring it is only reported if the earlier declaration actually ran.
+    fn declare_local(&mut self, name: &str, is_mutable: bool) -> (u32, bool) {
+        let scope = self.state().scopes.last_mut().unwrap();
+        if let Some(binding) = scope.bindings.iter_mut().find(|b| b.name == name) {
+            binding.is_mutable = is_mutable;
+            let slot = binding.slot;
+            self.state().locals[slot as usize].is_mutable = is_mutable;
+            return (slot, true);
+        }
+        let slot = self.add_local(name, is_mutable);
+        self.state()
+            .scopes
+            .last_mut()
+            .unwrap()
+            .bindings
+            .push(Binding {
+                name: name.to_string(),
+                slot,
+                is_mutable,
+            });
+        (slot, false)
+    }
+
+    fn resolve_local(&mut self, name: &str) -> Option<(u32, bool)> {
+        for scope in self.state().scopes.iter().rev() {
+            if let Some(binding) = scope.bindings.iter().find(|b| b.name == name) {
+                return Some((binding.slot, binding.is_mutable));
+            }
+        }
+        None
+    }
+
+    /// Whether `name` is a global the current code cannot see shadowed, i.e. one referenced from the top level.
+    fn is_visible_global(&mut self, name: &str) -> bool {
+        self.state().is_entry && self.globals.contains_key(name)
+    }
+
+    fn in_global_scope(&mut self) -> bool {
+        let state = self.state();
+        state.is_entry && state.scopes.len() == 1
+    }
+
+    /// Compiles a statement list. Every statement leaves exactly one value; all but the last are discarded, and the
+    /// last is kept if `keep_last` is set (null for an empty list).
+    fn compile_body(&mut self, nodes: &[Node], keep_last: bool) {
+        for (index, node) in nodes.iter().enumerate() {
+            self.compile_expr(node);
+            if !keep_last || index + 1 != nodes.len() {
+                self.emit(Op::Pop);
+            }
+        }
+        if keep_last && nodes.is_empty() {
+            self.emit(Op::Null);
+        }
+    }
+
+    fn compile_expr(&mut self, node: &Node) {
+        match node {
+            Node::NumericLiteral(nl) => {
+                let Ok(numeric_value) = isize::try_from(nl.value) else {
+                    self.fault(format!("Numeric literal {} is too large", nl.literal_value));
+                    self.emit(Op::Null);
+                    return;
+                };
+                let index = self.constant(RuntimeVal::NumberVal(NumberVal {
+                    value: numeric_value,
+                }));
+                self.emit(Op::Constant(index));
+            }
+            Node::FloatLiteral(fl) => {
+                let index = self.constant(RuntimeVal::FloatVal(FloatVal { value: fl.value }));
+                self.emit(Op::Constant(index));
+            }
+            Node::StringLiteral(slit) => {
+                let index = self.constant(RuntimeVal::StringVal(StringVal {
+                    value: slit.value.clone(),
+                }));
+                self.emit(Op::Constant(index));
+            }
+            Node::BoolLiteral(bl) => {
+                let index = self.constant(RuntimeVal::BoolVal(BoolVal {
+                    value: bl.literal_value,
+                }));
+                self.emit(Op::Constant(index));
+            }
+            Node::NullLiteral(_) | Node::NoOpNode(_) => {
+                self.emit(Op::Null);
+            }
+            Node::ListLiteral(ll) => {
+                for prop in &ll.props {
+                    self.compile_expr(prop);
+                }
+                self.emit(Op::MakeList(ll.props.len() as u32));
+            }
+            Node::ObjectLiteral(ol) => {
+                for value in ol.props.values() {
+                    self.compile_expr(value);
+                }
+                let layouts = &mut self.state().chunk.layouts;
+                layouts.push(ObjectLayout::new(ol.props.keys().map(String::as_str)));
+                let index = (layouts.len() - 1) as u32;
+                self.emit(Op::MakeObject(index));
+            }
+            Node::BinaryExpr(binop) => {
+                self.compile_expr(&binop.left);
+                self.compile_expr(&binop.right);
+                self.emit(match binop.op.as_str() {
+                    "+" => Op::Add,
+                    "-" => Op::Sub,
+                    "*" => Op::Mul,
+                    "/" => Op::Div,
+                    other => panic!("Unknown binary operator {}", other),
+                });
+            }
+            Node::Comparator(comp) => {
+                self.compile_expr(&comp.lhs);
+                self.compile_expr(&comp.rhs);
+                match CompareOp::from_str(&comp.op) {
+                    Some(op) => {
+                        self.emit(Op::Compare(op));
+                    }
+                    None => {
+                        self.emit(Op::Pop);
+                        self.emit(Op::Pop);
+                        self.fault(format!("Comparator error: Unknown operator: {}", comp.op));
+                    }
+                }
+            }
+            Node::Identifier(ident) => self.compile_identifier(&ident.identifier_name),
+            Node::VarDeclaration(decl) => self.compile_var_declaration(decl),
+            Node::TypeCast(cast) => {
+                self.compile_expr(&cast.left);
+                // Casts to other types are checked by the typechecker and leave the value as it is
+                if let Some(target) = NumericType::from_type(&cast.target_type) {
+                    self.emit(Op::Convert(target));
+                }
+            }
+            Node::AssignmentExpr(asexp) => self.compile_assignment_expr(asexp),
+            Node::FunctionDefinition(def) => self.compile_function_definition(def),
+            Node::CallExpr(cexpr) => self.compile_call_expr(cexpr),
+            Node::MemberExpr(mem) => self.compile_member_expr(mem),
+            Node::IfStmt(if_stmt) => self.compile_if_stmt(if_stmt),
+            Node::WhileStmt(while_loop) => self.compile_while_stmt(while_loop),
+            Node::Iterator(it) => self.compile_iterator_expr(it),
+            Node::MatchExpr(mexpr) => self.compile_match_expr(mexpr),
+            Node::NullishCoalescing(nc) => {
+                self.compile_expr(&nc.left);
+                let jump = self.emit(Op::JumpIfNotNull(0));
+                self.compile_expr(&nc.right);
+                self.patch_jump(jump);
+            }
+            Node::Block(block) => {
+                self.begin_scope();
+                self.state()
+                    .return_targets
+                    .push(ReturnTarget::Block { exits: Vec::new() });
+                self.compile_body(&block.body, true);
+                let exits = match self.state().return_targets.pop() {
+                    Some(ReturnTarget::Block { exits }) => exits,
+                    _ => unreachable!(),
+                };
+                for exit in exits {
+                    self.patch_jump(exit);
+                }
+                self.end_scope();
+            }
+            Node::Return(ret) => {
+                self.compile_expr(&ret.return_statement);
+                let target = self.state().return_targets.last().map(|t| match t {
+                    ReturnTarget::Block { .. } => None,
+                    ReturnTarget::Loop { result_slot, .. } => Some(*result_slot),
+                });
+                match target {
+                    Some(result_slot) => {
+                        if let Some(slot) = result_slot {
+                            self.emit(Op::StoreLocal(slot));
+                        }
+                        let exit = self.emit(Op::Jump(0));
+                        match self.state().return_targets.last_mut().unwrap() {
+                            ReturnTarget::Block { exits } | ReturnTarget::Loop { exits, .. } => {
+                                exits.push(exit)
+                            }
+                        }
+                    }
+                    None => {
+                        // The interpreter never unwinds a return that reaches the top level, so it is left as a plain
+                        // expression there.
+                        if !self.state().is_entry {
+                            self.emit(Op::Return);
+                        }
+                    }
+                }
+            }
+            _ => {
+                self.fault(format!(
+                    "Evaluation match fault:\nThis node has not been set up for execution yet!\n\n{:#?}\n\n",
+                    node
+                ));
+            }
+        }
+    }
+
+    fn compile_identifier(&mut self, name: &str) {
+        if name == "__CALL_STACK" {
+            self.emit(Op::LoadCallStack);
+        } else if let Some((slot, _)) = self.resolve_local(name) {
+            self.emit(Op::LoadLocalOrName(slot));
+        } else if self.is_visible_global(name) {
+            let value = self.globals[name].clone();
+            let index = self.constant(value);
+            self.emit(Op::Constant(index));
+        } else {
+            let index = self.name(name);
+            self.emit(Op::LoadName(index));
+        }
+    }
+
+    /// Stores the value on top of the stack into `name`, following `SourceEnv::attempt_assignment`.
+    fn compile_store(&mut self, name: &str) {
+        if let Some((slot, _)) = self.resolve_local(name) {
+            // Mutability is checked when the store runs: if the declaration was skipped, another binding is assigned.
+            self.emit(Op::StoreLocalOrName(slot));
+        } else if self.is_visible_global(name) {
+            self.panic(format!("Cannot assign to immutable variable '{}'", name));
+        } else {
+            let index = self.name(name);
+            self.emit(Op::StoreName(index));
+        }
+    }
+
+    fn compile_var_declaration(&mut self, decl: &VarDeclaration) {
+        if self.in_global_scope() && self.globals.contains_key(&decl.var_identifier) {
+            self.fault(format!(
+                "Attempt to redeclare local binding \"{}\"",
+                decl.var_identifier
+            ));
+            self.emit(Op::Null);
+            return;
+        }
+
+        let (slot, shadows) = self.declare_local(&decl.var_identifier, decl.is_mutable);
+        if shadows {
+            self.emit(Op::CheckUnbound(slot));
+        }
+        self.compile_expr(&decl.var_value);
+        self.emit_adoption(&decl.var_type);
+        self.emit(Op::StoreLocal(slot));
+        self.emit(Op::Null);
+    }
+
+    /// Converts the value on top of the stack for a binding declared as `declared`; see `adopt_declared_type`.
+    fn emit_adoption(&mut self, declared: &T) {
+        if let Some(target) = NumericType::adopted_by(declared) {
+            self.emit(Op::Adopt(target));
+        } else if numeric::packs_numbers(declared) {
+            self.emit(Op::PackNumbers);
+        }
+    }
+
+    fn compile_assignment_expr(&mut self, asexp: &AssignmentExpr) {
+        self.compile_expr(&asexp.value);
+        match asexp.left.as_ref() {
+            Node::Identifier(ident) => self.compile_store(&ident.identifier_name),
+            _ => self.fault(String::from("Cannot assign to left-hand non-identifier")),
+        }
+        self.emit(Op::Null);
+    }
+
+    fn compile_function_definition(&mut self, def: &FunctionDefinition) {
+        self.begin_function(def.name.clone(), def.params.clone(), false);
+        for (param, declared) in &def.params {
+            let (slot, _) = self.declare_local(param, false);
+            if NumericType::adopted_by(declared).is_some() || numeric::packs_numbers(declared) {
+                self.emit(Op::LoadLocal(slot));
+                self.emit_adoption(declared);
+                self.emit(Op::StoreLocal(slot));
+            }
+        }
+        self.compile_body(&def.body, true);
+        self.emit(Op::Return);
+        let proto = self.end_function();
+
+        if self.in_global_scope() && self.globals.contains_key(&def.name) {
+            self.panic(format!(
+                "Attempt to redeclare binding {} to <function {} ({:?})> (non-assignment)",
+                def.name, def.name, def.params
+            ));
+        }
+
+        let functions = &mut self.state().chunk.functions;
+        functions.push(Rc::new(proto));
+        let index = (functions.len() - 1) as u32;
+        self.emit(Op::MakeFunction(index));
+        let (slot, shadows) = self.declare_local(&def.name, false);
+        if shadows {
+            self.emit(Op::CheckUnbound(slot));
+        }
+        self.emit(Op::StoreLocal(slot));
+        self.emit(Op::Null);
+    }
+
+    /// Member objects are restricted to identifiers and nested member expressions, as in the interpreter.
+    fn compile_member_object(&mut self, object: &Node) -> bool {
+        match object {
+            Node::Identifier(_) | Node::MemberExpr(_) => {
+                self.compile_expr(object);
+                true
+            }
+            _ => {
+                self.fault(String::from("Invalid object in member expression."));
+                self.emit(Op::Null);
+                false
+            }
+        }
+    }
+
+    fn compile_call_expr(&mut self, cexpr: &CallExpr) {
+        if let Node::MemberExpr(mem) = cexpr.caller.as_ref() {
+            if let (false, Node::Identifier(method)) = (mem.is_computed, mem.property.as_ref()) {
+                let method = self.name(&method.identifier_name);
+                // Bindings are called through ops that let mutating built-in methods write to the binding itself.
+                if let Node::Identifier(receiver) = mem.object.as_ref() {
+                    let argc = cexpr.args.len() as u32;
+                    let receiver = receiver.identifier_name.as_str();
+                    let op = match self.resolve_local(receiver) {
+                        Some((slot, _)) => Some(Op::CallMethodLocal { slot, method, argc }),
+                        None if receiver != "__CALL_STACK" && !self.is_visible_global(receiver) => {
+                            let name = self.name(receiver);
+                            Some(Op::CallMethodName { name, method, argc })
+                        }
+                        None => None,
+                    };
+                    if let Some(op) = op {
+                        for arg in &cexpr.args {
+                            self.compile_expr(arg);
+                        }
+                        self.emit(op);
+                        return;
+                    }
+                }
+
+                if !self.compile_member_object(&mem.object) {
+                    return;
+                }
+                for arg in &cexpr.args {
+                    self.compile_expr(arg);
+                }
+                self.emit(Op::CallMethod(method, cexpr.args.len() as u32));
+                return;
+            }
+        }
+
+        self.compile_expr(&cexpr.caller);
+        for arg in &cexpr.args {
+            self.compile_expr(arg);
+        }
+        self.emit(Op::Call(cexpr.args.len() as u32));
+    }
+
+    fn compile_member_expr(&mut self, mem: &MemberExpr) {
+        if !self.compile_member_object(&mem.object) {
+            return;
+        }
+
+        let property_key = match mem.property.as_ref() {
+            Node::Identifier(ident) => ident.identifier_name.clone(),
+            Node::NumericLiteral(numlit) => numlit.literal_value.clone(),
+            _ => "".into(),
+        };
+        let key = self.name(&property_key);
+
+        // Only lists evaluate a computed property; every other value is indexed by the property's spelling.
+        if mem.is_computed && property_key.parse::<usize>().is_err() {
+            let to_key = self.emit(Op::JumpIfNotList(0));
+            self.compile_expr(&mem.property);
+            self.emit(Op::GetIndex);
+            let to_end = self.emit(Op::Jump(0));
+            self.patch_jump(to_key);
+            self.emit_get_key(key);
+            self.patch_jump(to_end);
+        } else {
+            self.emit_get_key(key);
+        }
+    }
+
+    fn emit_get_key(&mut self, name: u32) {
+        let caches = &mut self.state().chunk.property_caches;
+        caches.push(PropertyCache::default());
+        let cache = (caches.len() - 1) as u32;
+        self.emit(Op::GetKey { name, cache });
+    }
+
+    fn compile_condition(&mut self, condition: &Node, message: &str) {
+        match condition {
+            Node::Comparator(_) => self.compile_expr(condition),
+            _ => {
+                self.fault(String::from(message));
+                self.emit(Op::Null);
+            }
+        }
+    }
+
+    fn compile_if_stmt(&mut self, if_stmt: &IfStmt) {
+        self.compile_condition(
+            &if_stmt.condition,
+            "If condition must be a comparator expression",
+        );
+        let to_else = self.emit(Op::JumpIfFalse(0));
+        // If bodies share the enclosing environment, so they do not open a scope.
+        self.compile_body(&if_stmt.body, true);
+        let to_end = self.emit(Op::Jump(0));
+        self.patch_jump(to_else);
+        self.emit(Op::Null);
+        self.patch_jump(to_end);
+    }
+
+    fn compile_while_stmt(&mut self, while_loop: &WhileStmt) {
+        let loop_start = self.offset();
+        self.compile_condition(
+            &while_loop.condition,
+            "While loop condition must be a comparator expression",
+        );
+        let to_end = self.emit(Op::JumpIfFalse(0));
+        self.begin_scope();
+        self.compile_body(&while_loop.body, false);
+        self.end_scope();
+        self.emit(Op::Jump(loop_start));
+        self.patch_jump(to_end);
+        self.emit(Op::Null);
+    }
+
+    fn compile_iterator_expr(&mut self, it: &Iterator) {
+        let first_slot = self.state().locals.len() as u32;
+        self.compile_expr(&it.right);
+        let iterator_slot = self.hidden_local();
+        let result_slot = self.hidden_local();
+        self.emit(Op::IterPrepare(iterator_slot));
+        self.emit(Op::Null);
+        self.emit(Op::StoreLocal(result_slot));
+
+        let loop_start = self.offset();
+        let to_end = self.emit(Op::IterNext {
+            slot: iterator_slot,
+            exit: 0,
+        });
+        self.begin_scope();
+        let (var_slot, _) = self.declare_local(&it.left.literal_value, false);
+        self.emit(Op::StoreLocal(var_slot));
+        // Release the previous iteration's result so values it shares are not copied on write by this one.
+        self.emit(Op::Null);
+        self.emit(Op::StoreLocal(result_slot));
+        self.state().return_targets.push(ReturnTarget::Loop {
+            result_slot,
+            exits: Vec::new(),
+        });
+        self.compile_body(&it.body, true);
+        self.emit(Op::StoreLocal(result_slot));
+        let exits = match self.state().return_targets.pop() {
+            Some(ReturnTarget::Loop { exits, .. }) => exits,
+            _ => unreachable!(),
+        };
+        self.end_scope();
+        self.emit(Op::Jump(loop_start));
+
+        self.patch_jump(to_end);
+        for exit in exits {
+            self.patch_jump(exit);
+        }
+        self.emit(Op::LoadLocal(result_slot));
+        let count = self.state().locals.len() as u32 - first_slot;
+        self.emit(Op::ClearLocals(first_slot, count));
+    }
+
+    fn compile_match_expr(&mut self, mexpr: &MatchExpr) {
+        self.compile_expr(&mexpr.target);
+        let target_slot = self.hidden_local();
+        self.emit(Op::StoreLocal(target_slot));
+
+        if let Some(table) = MatchTable::new(&mexpr.arms) {
+            self.compile_match_dispatch(mexpr, table, target_slot);
+            return;
+        }
+
+        let mut to_end = Vec::new();
+        for (pattern, body) in &mexpr.arms {
+            self.compile_match_arm_test(pattern, target_slot);
+            let to_next = self.emit(Op::JumpIfFalse(0));
+            self.compile_expr(body);
+            to_end.push(self.emit(Op::Jump(0)));
+            self.patch_jump(to_next);
+        }
+        self.emit(Op::Null);
+        for jump in to_end {
+            self.patch_jump(jump);
+        }
+    }
+
+    /// Compiles a match whose literal arms are looked up by `MatchJump`. The arm bodies are emitted once, after
+    /// three kinds of test sequences that jump to them: every arm in turn (for targets the table cannot look up),
+    /// the fallbacks ahead of each dispatched arm, and all the fallbacks (for targets equal to no literal).
+    fn compile_match_dispatch(&mut self, mexpr: &MatchExpr, table: MatchTable, target_slot: u32) {
+        let index = self.state().chunk.match_jumps.len() as u32;
+        self.emit(Op::LoadLocal(target_slot));
+        self.emit(Op::MatchJump(index));
+
+        let mut to_body = Vec::new();
+        let mut to_end = Vec::new();
+        let all: Vec<usize> = (0..mexpr.arms.len()).collect();
+        self.compile_match_tests(mexpr, &all, target_slot, &mut to_body);
+        self.emit(Op::Null);
+        to_end.push(self.emit(Op::Jump(0)));
+
+        let mut entries = vec![u32::MAX; mexpr.arms.len()];
+        for &arm in table.dispatched() {
+            let fallbacks = table.fallbacks_before(Some(arm));
+            if fallbacks.is_empty() {
+                continue;
+            }
+            entries[arm] = self.offset();
+            self.compile_match_tests(mexpr, fallbacks, target_slot, &mut to_body);
+            to_body.push((self.emit(Op::Jump(0)), arm));
+        }
+        let miss = self.offset();
+        self.compile_match_tests(
+            mexpr,
+            table.fallbacks_before(None),
+            target_slot,
+            &mut to_body,
+        );
+        self.emit(Op::Null);
+        to_end.push(self.emit(Op::Jump(0)));
+
+        let mut bodies = Vec::with_capacity(mexpr.arms.len());
+        for (_, body) in &mexpr.arms {
+            bodies.push(self.offset());
+            self.compile_expr(body);
+            to_end.push(self.emit(Op::Jump(0)));
+        }
+        for (jump, arm) in to_body {
+            self.patch_jump_to(jump, bodies[arm]);
+        }
+        for &arm in table.dispatched() {
+            if entries[arm] == u32::MAX {
+                entries[arm] = bodies[arm];
+            }
+        }
+        for jump in to_end {
+            self.patch_jump(jump);
+        }
+        self.state().chunk.match_jumps.push(MatchJumps {
+            table,
+            entries,
+            miss,
+        });
+    }
+
+    /// Tests `arms` in turn, recording a jump to the body of each into `to_body`; falls through if none matches.
+    fn compile_match_tests(
+        &mut self,
+        mexpr: &MatchExpr,
+        arms: &[usize],
+        target_slot: u32,
+        to_body: &mut Vec<(usize, usize)>,
+    ) {
+        for &arm in arms {
+            self.compile_match_arm_test(&mexpr.arms[arm].0, target_slot);
+            let to_next = self.emit(Op::JumpIfFalse(0));
+            to_body.push((self.emit(Op::Jump(0)), arm));
+            self.patch_jump(to_next);
+        }
+    }
+
+    /// Pushes whether `pattern` matches the target in `target_slot`.
+    fn compile_match_arm_test(&mut self, pattern: &Node, target_slot: u32) {
+        self.compile_expr(pattern);
+        let is_literal = matches!(
+            pattern,
+            Node::NumericLiteral(_)
+                | Node::FloatLiteral(_)
+                | Node::StringLiteral(_)
+                | Node::BoolLiteral(_)
+                | Node::NullLiteral(_)
+        );
+        if is_literal {
+            self.emit(Op::LoadLocal(target_slot));
+            self.emit(Op::MatchEq);
+        } else {
+            // Function patterns are called with the target as a predicate; anything else is compared against it.
+            let to_compare = self.emit(Op::JumpIfNotCallable(0));
+            self.emit(Op::LoadLocal(target_slot));
+            self.emit(Op::Call(1));
+            self.emit(Op::TestTrue);
+            let to_test = self.emit(Op::Jump(0));
+            self.patch_jump(to_compare);
+            self.emit(Op::LoadLocal(target_slot));
+            self.emit(Op::MatchEq);
+            self.patch_jump(to_test);
+        }
+    }
+}
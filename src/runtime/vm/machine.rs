@@ -0,0 +1,737 @@
+use core::fmt;
+use std::{cell::RefCell, rc::Rc};
+
+use crate::{
+    runtime::{
+        interpreter::report_runtime_error,
+        numeric,
+        source_environment::source_environment::SourceEnv,
+        values::{
+            BoolVal, BytecodeFunctionVal, IteratorVal, ListVal, MethodContext, NativeMethodVal,
+            NullVal, NumberVal, RuntimeVal, StringVal,
+        },
+        vm::bytecode::{FunctionProto, Op},
+    },
+    velvet_error,
+};
+
+struct CallFrame {
+    proto: Rc<FunctionProto>,
+    /// Where execution resumes once the frame above this one returns.
+    ip: usize,
+    /// Offset of this frame's slot 0 within `VirtualMachine::locals`.
+    base: usize,
+    /// Height of `VirtualMachine::stack` when the frame was entered, which a return unwinds the stack back to.
+    stack_base: usize,
+}
+
+/// Executes programs produced by the `BytecodeCompiler`.
+///
+/// Values are the interpreter's `RuntimeVal`s and the global environment is the same standard library `SourceEnv`,
+/// so programs behave (and fail) the same way under both execution techniques.
+pub struct VirtualMachine {
+    globals: Rc<RefCell<SourceEnv>>,
+    stack: Vec<RuntimeVal>,
+    locals: Vec<Option<RuntimeVal>>,
+    frames: Vec<CallFrame>,
+}
+
+impl VirtualMachine {
+    pub fn new(globals: Rc<RefCell<SourceEnv>>) -> Self {
+        Self {
+            globals,
+            stack: Vec::with_capacity(256),
+            locals: Vec::with_capacity(256),
+            frames: Vec::new(),
+        }
+    }
+
+    pub fn interpreter_error(&mut self, args: fmt::Arguments<'_>) -> ! {
+        let mut call_stack = vec![String::from("% velvet::entry_point::run(...)")];
+        for frame in self.frames.iter().skip(1) {
+            call_stack.push(format!("  {}({:?})", frame.proto.name, frame.proto.params));
+        }
+        report_runtime_error(args, &call_stack)
+    }
+
+    fn render_call_stack(&self) -> String {
+        let mut calls = vec![String::from("% velvet::entry_point::run(...)")];
+        for frame in self.frames.iter().skip(1) {
+            let args: Vec<String> = frame
+                .proto
+                .params
+                .iter()
+                .enumerate()
+                .map(|(i, (name, _))| match &self.locals[frame.base + i] {
+                    Some(value) => format!("{} = {:#?}", name, value),
+                    None => format!("{} = null", name),
+                })
+                .collect();
+            calls.push(format!("  {}({})", frame.proto.name, args.join(", ")));
+        }
+        calls.push(String::from(
+            "% velvet::internal_identifier_exceptions::call_stack_getter",
+        ));
+
+        let mut end_stack_string = format!(
+            "\n0 = latest call; {} = first call; % = Rust thread\nvelvet call stack:",
+            calls.len() - 1
+        );
+        for (index, call) in calls.iter().rev().enumerate() {
+            end_stack_string += &format!("\n {} → {}", index, call);
+        }
+        end_stack_string
+    }
+
+    fn pop(&mut self) -> RuntimeVal {
+        self.stack.pop().unwrap()
+    }
+
+    /// Finds the live local slot that `name` resolves to through the dynamic scope chain (the frames, innermost
+    /// first), along with whether the binding is mutable. Names that are not found belong to the globals.
+    fn locate_name(&self, name: &str) -> Option<(usize, bool)> {
+        for frame in self.frames.iter().rev() {
+            for (slot, info) in frame.proto.locals.iter().enumerate().rev() {
+                if info.name == name && self.locals[frame.base + slot].is_some() {
+                    return Some((frame.base + slot, info.is_mutable));
+                }
+            }
+        }
+        None
+    }
+
+    fn lookup_name(&self, name: &str) -> Option<RuntimeVal> {
+        match self.locate_name(name) {
+            Some((index, _)) => self.locals[index].clone(),
+            None => self
+                .globals
+                .borrow()
+                .fetch(&name.to_string())
+                .map(|v| v.value),
+        }
+    }
+
+    fn assign_name(&mut self, name: &str, value: RuntimeVal) {
+        match self.locate_name(name) {
+            Some((_, false)) => panic!("Cannot assign to immutable variable '{}'", name),
+            Some((index, true)) => self.locals[index] = Some(value),
+            None => self
+                .globals
+                .borrow_mut()
+                .attempt_assignment(name.to_string(), value),
+        }
+    }
+
+    fn is_callable(value: &RuntimeVal) -> bool {
+        matches!(
+            value,
+            RuntimeVal::FunctionVal(_)
+                | RuntimeVal::BytecodeFunctionVal(_)
+                | RuntimeVal::InternalFunctionVal(_)
+                | RuntimeVal::NativeMethodVal(_)
+        )
+    }
+
+    /// Calls `callee` with the top `argc` stack values. Returns the frame to continue in if a bytecode function was
+    /// entered; internal functions complete immediately and leave their result on the stack.
+    fn call_value(&mut self, callee: RuntimeVal, argc: usize) -> bool {
+        match callee {
+            RuntimeVal::BytecodeFunctionVal(function) => {
+                let proto = function.proto;
+                if argc != proto.params.len() {
+                    velvet_error!(
+                        self,
+                        "Invalid call expression: expected {} arg{} for function '{}', received {}",
+                        proto.params.len(),
+                        if proto.params.len() != 1 { "s" } else { "" },
+                        proto.name,
+                        argc
+                    );
+                }
+                let base = self.locals.len();
+                let args_start = self.stack.len() - argc;
+                self.locals.extend(self.stack.drain(args_start..).map(Some));
+                self.locals.resize(base + proto.locals.len(), None);
+                self.frames.push(CallFrame {
+                    proto,
+                    ip: 0,
+                    base,
+                    stack_base: self.stack.len(),
+                });
+                true
+            }
+            RuntimeVal::InternalFunctionVal(function) => {
+                let args_start = self.stack.len() - argc;
+                let args: Vec<RuntimeVal> = self.stack.drain(args_start..).collect();
+                let result = (function.internal_callback)(args, Rc::clone(&self.globals));
+                self.stack.push(result);
+                false
+            }
+            RuntimeVal::NativeMethodVal(bound) => {
+                let args_start = self.stack.len() - argc;
+                let args: Vec<RuntimeVal> = self.stack.drain(args_start..).collect();
+                let mut receiver = *bound.receiver;
+                let result = (bound.method.call)(&mut receiver, args, self);
+                self.stack.push(result);
+                false
+            }
+            other => {
+                velvet_error!(self, "Cannot call type \"{:#?}\"", Box::new(other))
+            }
+        }
+    }
+
+    fn get_key(&mut self, base_val: RuntimeVal, property_key: &str) -> RuntimeVal {
+        match base_val {
+            RuntimeVal::ObjectVal(obj) => match obj.get(property_key) {
+                Some(val) => val.clone(),
+                None => RuntimeVal::NullVal(NullVal {}),
+            },
+            RuntimeVal::ListVal(_) | RuntimeVal::NumberArrayVal(_) => {
+                if let Some(method) = base_val.get_method(property_key) {
+                    return RuntimeVal::NativeMethodVal(NativeMethodVal {
+                        receiver: Box::new(base_val),
+                        method,
+                    });
+                }
+                if let Ok(idx) = property_key.parse::<usize>() {
+                    match base_val.list_element(idx) {
+                        Some(val) => val,
+                        None => velvet_error!(self, "Index {} is out of bounds!", idx),
+                    }
+                } else {
+                    velvet_error!(self, "Invalid index access on list: {}", property_key);
+                }
+            }
+            RuntimeVal::StringVal(strvl) => {
+                if let Ok(idx) = property_key.parse::<usize>() {
+                    if idx > strvl.value.len() {
+                        velvet_error!(self, "Index out-of-bounds on string");
+                    }
+                    RuntimeVal::StringVal(StringVal {
+                        value: strvl.value.chars().nth(idx).unwrap().to_string().into(),
+                    })
+                } else {
+                    velvet_error!(self, "Invalid index access on string: {}", property_key);
+                }
+            }
+            RuntimeVal::IteratorVal(_) => match base_val.get_method(property_key) {
+                Some(method) => RuntimeVal::NativeMethodVal(NativeMethodVal {
+                    receiver: Box::new(base_val),
+                    method,
+                }),
+                None => velvet_error!(self, "Invalid member access on iterator: {}", property_key),
+            },
+            _ => {
+                velvet_error!(
+                    self,
+                    "Cannot access property '{}' on non-object value.",
+                    property_key
+                );
+            }
+        }
+    }
+
+    /// Calls `receiver.method(...)` with the top `argc` stack values, dispatching built-in methods directly and
+    /// anything else like `CallMethod`. Returns whether a bytecode frame was entered.
+    fn call_method(&mut self, mut receiver: RuntimeVal, method_name: &str, argc: usize) -> bool {
+        match receiver.get_method(method_name) {
+            Some(method) => {
+                let args_start = self.stack.len() - argc;
+                let args: Vec<RuntimeVal> = self.stack.drain(args_start..).collect();
+                let result = (method.call)(&mut receiver, args, self);
+                self.stack.push(result);
+                false
+            }
+            None => {
+                let callee = self.get_key(receiver, method_name);
+                self.call_value(callee, argc)
+            }
+        }
+    }
+
+    /// `call_method` on the binding held in `self.locals[index]`. A mutating built-in method is given the slot's value
+    /// itself, so it is modified without being copied.
+    fn call_method_in_slot(
+        &mut self,
+        index: usize,
+        name: &str,
+        is_mutable: bool,
+        method_name: &str,
+        argc: usize,
+    ) -> bool {
+        let Some(receiver) = &self.locals[index] else {
+            velvet_error!(
+                self,
+                "Unresolved identifier \"{}\" does not exist in this scope.",
+                name
+            );
+        };
+        match receiver.get_method(method_name) {
+            Some(method) if method.mutates => {
+                if !is_mutable {
+                    panic!("Cannot assign to immutable variable '{}'", name);
+                }
+                let args_start = self.stack.len() - argc;
+                let args: Vec<RuntimeVal> = self.stack.drain(args_start..).collect();
+                let mut value = self.locals[index].take().unwrap();
+                let result = (method.call)(&mut value, args, self);
+                self.locals[index] = Some(value);
+                self.stack.push(result);
+                false
+            }
+            _ => {
+                let receiver = receiver.clone();
+                self.call_method(receiver, method_name, argc)
+            }
+        }
+    }
+
+    fn arithmetic(&mut self, op: Op) {
+        let right = self.pop();
+        let left = self.pop();
+        let result = match (&left, &right) {
+            (RuntimeVal::NumberVal(l), RuntimeVal::NumberVal(r)) => {
+                RuntimeVal::NumberVal(NumberVal {
+                    value: match op {
+                        Op::Add => l.value + r.value,
+                        Op::Sub => l.value - r.value,
+                        Op::Mul => l.value * r.value,
+                        _ => l.value / r.value,
+                    },
+                })
+            }
+            (RuntimeVal::StringVal(l), RuntimeVal::StringVal(r)) => match op {
+                Op::Add => RuntimeVal::StringVal(StringVal {
+                    value: l.value.concat(&r.value),
+                }),
+                _ => velvet_error!(
+                    self,
+                    "Binary operator \"{}\" is not allowed on types String and String.",
+                    Self::operator_symbol(op)
+                ),
+            },
+            _ => match numeric::arithmetic(&left, Self::operator_symbol(op), &right) {
+                Some(Ok(result)) => result,
+                Some(Err(err)) => velvet_error!(self, "Binary expression error: {}", err),
+                None => velvet_error!(
+                    self,
+                    "Binary expression operands must be numbers, received {} and {} with operator {}.",
+                    left,
+                    right,
+                    Self::operator_symbol(op)
+                ),
+            },
+        };
+        self.stack.push(result);
+    }
+
+    fn operator_symbol(op: Op) -> &'static str {
+        match op {
+            Op::Add => "+",
+            Op::Sub => "-",
+            Op::Mul => "*",
+            _ => "/",
+        }
+    }
+
+    fn is_truthy(value: &RuntimeVal) -> bool {
+        match value {
+            RuntimeVal::NullVal(_) => false,
+            RuntimeVal::NumberVal(n) => n.value != 0,
+            RuntimeVal::IntegerVal(i) => i.value != 0,
+            RuntimeVal::FloatVal(n) => n.value != 0.0,
+            RuntimeVal::BoolVal(b) => b.value,
+            _ => true,
+        }
+    }
+
+    pub fn run(&mut self, entry: Rc<FunctionProto>) -> RuntimeVal {
+        let depth = self.frames.len();
+        let base = self.locals.len();
+        self.locals.resize(base + entry.locals.len(), None);
+        self.frames.push(CallFrame {
+            proto: entry,
+            ip: 0,
+            base,
+            stack_base: self.stack.len(),
+        });
+        self.execute(depth)
+    }
+
+    /// Runs the innermost frame, and whatever it calls, until it returns with `stop_depth` frames left. Native
+    /// methods re-enter here to call back into bytecode functions.
+    fn execute(&mut self, stop_depth: usize) -> RuntimeVal {
+        let frame = self.frames.last().unwrap();
+        let mut proto = Rc::clone(&frame.proto);
+        let mut ip = frame.ip;
+        let mut base = frame.base;
+
+        loop {
+            let op = proto.chunk.code[ip];
+            ip += 1;
+
+            match op {
+                Op::Constant(index) => {
+                    self.stack
+                        .push(proto.chunk.constants[index as usize].clone());
+                }
+                Op::Null => self.stack.push(RuntimeVal::NullVal(NullVal {})),
+                Op::Pop => {
+                    self.stack.pop();
+                }
+                Op::Dup => {
+                    let top = self.stack.last().unwrap().clone();
+                    self.stack.push(top);
+                }
+
+                Op::LoadLocal(slot) => match self.locals[base + slot as usize].clone() {
+                    Some(value) => self.stack.push(value),
+                    None => {
+                        velvet_error!(
+                            self,
+                            "Unresolved identifier \"{}\" does not exist in this scope.",
+                            proto.locals[slot as usize].name
+                        );
+                    }
+                },
+                Op::StoreLocal(slot) => {
+                    let value = self.pop();
+                    self.locals[base + slot as usize] = Some(value);
+                }
+                Op::LoadLocalOrName(slot) => {
+                    let value = match &self.locals[base + slot as usize] {
+                        Some(value) => Some(value.clone()),
+                        None => self.lookup_name(&proto.locals[slot as usize].name),
+                    };
+                    match value {
+                        Some(value) => self.stack.push(value),
+                        None => {
+                            velvet_error!(
+                                self,
+                                "Unresolved identifier \"{}\" does not exist in this scope.",
+                                proto.locals[slot as usize].name
+                            );
+                        }
+                    }
+                }
+                Op::StoreLocalOrName(slot) => {
+                    let value = self.pop();
+                    let info = &proto.locals[slot as usize];
+                    if self.locals[base + slot as usize].is_none() {
+                        self.assign_name(&info.name, value);
+                    } else if info.is_mutable {
+                        self.locals[base + slot as usize] = Some(value);
+                    } else {
+                        panic!("Cannot assign to immutable variable '{}'", info.name);
+                    }
+                }
+                Op::CheckUnbound(slot) => {
+                    if self.locals[base + slot as usize].is_some() {
+                        velvet_error!(
+                            self,
+                            "Attempt to redeclare local binding \"{}\"",
+                            proto.locals[slot as usize].name
+                        );
+                    }
+                }
+                Op::ClearLocals(start, count) => {
+                    let start = base + start as usize;
+                    for slot in &mut self.locals[start..start + count as usize] {
+                        *slot = None;
+                    }
+                }
+                Op::LoadName(index) => {
+                    let name = &proto.chunk.names[index as usize];
+                    match self.lookup_name(name) {
+                        Some(value) => self.stack.push(value),
+                        None => {
+                            velvet_error!(
+                                self,
+                                "Unresolved identifier \"{}\" does not exist in this scope.",
+                                name
+                            );
+                        }
+                    }
+                }
+                Op::StoreName(index) => {
+                    let value = self.pop();
+                    self.assign_name(&proto.chunk.names[index as usize], value);
+                }
+                Op::LoadCallStack => {
+                    let value = self.render_call_stack();
+                    self.stack.push(RuntimeVal::StringVal(StringVal {
+                        value: value.into(),
+                    }));
+                }
+
+                Op::Add | Op::Sub | Op::Mul | Op::Div => self.arithmetic(op),
+                Op::Compare(cmp) => {
+                    let rhs = self.pop();
+                    let lhs = self.pop();
+                    let result = lhs
+                        .compare(&rhs, cmp.as_str())
+                        .unwrap_or_else(|err| velvet_error!(self, "Comparator error: {}", err));
+                    self.stack
+                        .push(RuntimeVal::BoolVal(BoolVal { value: result }));
+                }
+                Op::Convert(target) => {
+                    let value = self.pop();
+                    let converted = numeric::convert(&value, target)
+                        .unwrap_or_else(|err| velvet_error!(self, "Type cast error: {}", err));
+                    self.stack.push(converted);
+                }
+                Op::Adopt(target) => {
+                    let value = self.pop();
+                    self.stack.push(numeric::adopt(value, target));
+                }
+                Op::PackNumbers => {
+                    let value = self.pop();
+                    self.stack.push(numeric::pack_numbers(value));
+                }
+                Op::MatchEq => {
+                    let target = self.pop();
+                    let pattern = self.pop();
+                    let value = target.compare(&pattern, "==").unwrap_or(false);
+                    self.stack.push(RuntimeVal::BoolVal(BoolVal { value }));
+                }
+                Op::TestTrue => {
+                    let value = self
+                        .pop()
+                        .compare(&RuntimeVal::BoolVal(BoolVal { value: true }), "==")
+                        .unwrap();
+                    self.stack.push(RuntimeVal::BoolVal(BoolVal { value }));
+                }
+
+                Op::MatchJump(index) => {
+                    let target = self.pop();
+                    let jumps = &proto.chunk.match_jumps[index as usize];
+                    if let Some(candidates) = jumps.table.candidates(&target) {
+                        ip = match candidates.literal {
+                            Some(arm) => jumps.entries[arm] as usize,
+                            None => jumps.miss as usize,
+                        };
+                    }
+                }
+
+                Op::Jump(target) => ip = target as usize,
+                Op::JumpIfFalse(target) => {
+                    if !Self::is_truthy(&self.pop()) {
+                        ip = target as usize;
+                    }
+                }
+                Op::JumpIfNotNull(target) => {
+                    if self.stack.last().unwrap().is_null() {
+                        self.stack.pop();
+                    } else {
+                        ip = target as usize;
+                    }
+                }
+                Op::JumpIfNotCallable(target) => {
+                    if !Self::is_callable(self.stack.last().unwrap()) {
+                        ip = target as usize;
+                    }
+                }
+                Op::JumpIfNotList(target) => {
+                    if !self.stack.last().unwrap().is_list() {
+                        ip = target as usize;
+                    }
+                }
+
+                Op::MakeList(count) => {
+                    let start = self.stack.len() - count as usize;
+                    let values: Vec<RuntimeVal> = self.stack.drain(start..).collect();
+                    self.stack.push(RuntimeVal::ListVal(ListVal {
+                        values: values.into(),
+                    }));
+                }
+                Op::MakeObject(index) => {
+                    let layout = &proto.chunk.layouts[index as usize];
+                    let start = self.stack.len() - layout.shape().keys().len();
+                    let object = layout.build(&mut self.stack[start..]);
+                    self.stack.truncate(start);
+                    self.stack.push(RuntimeVal::ObjectVal(object));
+                }
+                Op::MakeFunction(index) => {
+                    self.stack
+                        .push(RuntimeVal::BytecodeFunctionVal(BytecodeFunctionVal {
+                            proto: Rc::clone(&proto.chunk.functions[index as usize]),
+                        }));
+                }
+                Op::GetKey { name, cache } => {
+                    let base_val = self.pop();
+                    let key = &proto.chunk.names[name as usize];
+                    let value = match &base_val {
+                        RuntimeVal::ObjectVal(obj) => obj
+                            .get_cached(key, &proto.chunk.property_caches[cache as usize])
+                            .cloned()
+                            .unwrap_or(RuntimeVal::NullVal(NullVal {})),
+                        _ => self.get_key(base_val, key),
+                    };
+                    self.stack.push(value);
+                }
+                Op::GetIndex => {
+                    let computed_property = self.pop();
+                    let list = self.pop();
+                    let index = match computed_property {
+                        RuntimeVal::NumberVal(n) => {
+                            if n.value < 0 {
+                                velvet_error!(self, "List index must be a non-negative integer.");
+                            }
+                            n.value as usize
+                        }
+                        _ => velvet_error!(self, "Computed index must be a number."),
+                    };
+                    match list.list_element(index) {
+                        Some(value) => self.stack.push(value),
+                        None => velvet_error!(self, "Index {} is out of bounds!", index),
+                    }
+                }
+
+                Op::Call(argc) => {
+                    let argc = argc as usize;
+                    let callee_at = self.stack.len() - argc - 1;
+                    let callee = self.stack.remove(callee_at);
+                    self.frames.last_mut().unwrap().ip = ip;
+                    if self.call_value(callee, argc) {
+                        let frame = self.frames.last().unwrap();
+                        proto = Rc::clone(&frame.proto);
+                        ip = 0;
+                        base = frame.base;
+                    }
+                }
+                Op::CallMethod(method, argc)
+                | Op::CallMethodLocal { method, argc, .. }
+                | Op::CallMethodName { method, argc, .. } => {
+                    let argc = argc as usize;
+                    let method_name = &proto.chunk.names[method as usize];
+                    self.frames.last_mut().unwrap().ip = ip;
+                    let entered = match op {
+                        Op::CallMethodLocal { slot, .. }
+                            if self.locals[base + slot as usize].is_some() =>
+                        {
+                            let info = &proto.locals[slot as usize];
+                            self.call_method_in_slot(
+                                base + slot as usize,
+                                &info.name,
+                                info.is_mutable,
+                                method_name,
+                                argc,
+                            )
+                        }
+                        // An unbound local's declaration was skipped, so its name resolves through the scope chain.
+                        Op::CallMethodLocal { slot: index, .. }
+                        | Op::CallMethodName { name: index, .. } => {
+                            let name = match op {
+                                Op::CallMethodLocal { .. } => &proto.locals[index as usize].name,
+                                _ => &proto.chunk.names[index as usize],
+                            };
+                            match self.locate_name(name) {
+                                Some((index, is_mutable)) => self.call_method_in_slot(
+                                    index,
+                                    name,
+                                    is_mutable,
+                                    method_name,
+                                    argc,
+                                ),
+                                None => {
+                                    let Some(receiver) = self.lookup_name(name) else {
+                                        velvet_error!(
+                                            self,
+                                            "Unresolved identifier \"{}\" does not exist in this scope.",
+                                            name
+                                        );
+                                    };
+                                    if receiver.get_method(method_name).is_some_and(|m| m.mutates) {
+                                        panic!("Cannot assign to immutable variable '{}'", name);
+                                    }
+                                    self.call_method(receiver, method_name, argc)
+                                }
+                            }
+                        }
+                        _ => {
+                            let receiver_at = self.stack.len() - argc - 1;
+                            let receiver = self.stack.remove(receiver_at);
+                            if receiver.get_method(method_name).is_some_and(|m| m.mutates) {
+                                velvet_error!(
+                                    self,
+                                    "Auto-reassign for complex member expressions not implemented"
+                                );
+                            }
+                            self.call_method(receiver, method_name, argc)
+                        }
+                    };
+                    if entered {
+                        let frame = self.frames.last().unwrap();
+                        proto = Rc::clone(&frame.proto);
+                        ip = 0;
+                        base = frame.base;
+                    }
+                }
+                Op::Return => {
+                    let frame = self.frames.pop().unwrap();
+                    self.locals.truncate(frame.base);
+                    // A return from inside an expression leaves that expression's operands below the result.
+                    let result = self.pop();
+                    self.stack.truncate(frame.stack_base);
+                    if self.frames.len() == stop_depth {
+                        return result;
+                    }
+                    self.stack.push(result);
+                    let caller = self.frames.last().unwrap();
+                    proto = Rc::clone(&caller.proto);
+                    ip = caller.ip;
+                    base = caller.base;
+                }
+
+                Op::IterPrepare(slot) => {
+                    let iterator = match self.pop() {
+                        RuntimeVal::IteratorVal(iterator) => iterator,
+                        list if list.is_list() => IteratorVal::over_list(list),
+                        _ => velvet_error!(self, "Cannot loop through non-list type"),
+                    };
+                    self.locals[base + slot as usize] = Some(RuntimeVal::IteratorVal(iterator));
+                }
+                Op::IterNext { slot, exit } => {
+                    let slot = base + slot as usize;
+                    // Taken out of its slot while it runs, since `map` and `filter` call back into this machine
+                    let Some(RuntimeVal::IteratorVal(mut iterator)) = self.locals[slot].take()
+                    else {
+                        unreachable!();
+                    };
+                    let next = iterator.next(self);
+                    self.locals[slot] = Some(RuntimeVal::IteratorVal(iterator));
+                    match next {
+                        Some(value) => self.stack.push(value),
+                        None => ip = exit as usize,
+                    }
+                }
+
+                Op::Fault(index) => {
+                    let message = proto.chunk.constants[index as usize].to_string();
+                    velvet_error!(self, "{}", message);
+                }
+                Op::Panic(index) => {
+                    panic!("{}", proto.chunk.constants[index as usize]);
+                }
+            }
+        }
+    }
+}
+
+impl MethodContext for VirtualMachine {
+    fn call_function(&mut self, function: &RuntimeVal, args: Vec<RuntimeVal>) -> RuntimeVal {
+        let depth = self.frames.len();
+        let argc = args.len();
+        self.stack.extend(args);
+        if self.call_value(function.clone(), argc) {
+            self.execute(depth)
+        } else {
+            self.pop()
+        }
+    }
+
+    fn interpreter_error(&mut self, args: fmt::Arguments<'_>) -> ! {
+        VirtualMachine::interpreter_error(self, args)
+    }
+}
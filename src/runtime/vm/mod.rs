@@ -0,0 +1,3 @@
+pub mod bytecode;
+pub mod compiler;
+pub mod machine;
@@ -0,0 +1,207 @@
+use std::cell::{Cell, RefCell};
+use std::env;
+use std::io::{self, BufRead, BufReader, Read, Write};
+use std::panic::{self, AssertUnwindSafe};
+use std::rc::Rc;
+
+use crate::parser::parser::{ExecutionTechnique, Parser};
+use crate::runtime::interpreter::Interpreter;
+use crate::runtime::source_environment::source_environment::SourceEnv;
+use crate::runtime::vm::{compiler::BytecodeCompiler, machine::VirtualMachine};
+use crate::stdlib_interp::io::{capture_stdout, take_captured_stdout};
+use crate::stdlib_interp::process::{ProgramExit, contain_exits};
+use crate::stdlib_interp::task;
+use crate::typecheck::typecheck::TypeChecker;
+
+thread_local! {
+    /// Whether this thread is inside `Server::run_script`, whose panics are reported in the script's response.
+    static RUNNING_SCRIPT: Cell<bool> = const { Cell::new(false) };
+}
+
+/// Keeps the panic hook quiet for panics raised by a running script, which end up in its response instead. Every
+/// other panic, in the server itself or on another thread, still goes to the hook installed before.
+pub fn quiet_script_panics() {
+    let previous_hook = panic::take_hook();
+    panic::set_hook(Box::new(move |info| {
+        if !RUNNING_SCRIPT.with(Cell::get) {
+            previous_hook(info);
+        }
+    }));
+}
+
+#[derive(Debug, Clone)]
+pub struct ServeOptions {
+    pub inject_stdlib_snippets: bool,
+    pub sandboxed: bool,
+    /// Run scripts on the VM rather than the interpreter.
+    pub use_vm: bool,
+}
+
+/// Runs many scripts in one process, keeping what every run would otherwise build again warm between them: the
+/// global environment with the standard library's modules, and the parsed standard library snippets. Each script
+/// runs in a fresh scope under the globals, so nothing it binds is seen by the next.
+///
+/// Scripts arrive, and their results leave, framed as a header line followed by exactly as many bytes as it says:
+///
+/// - request: `run <length>\n<source>`
+/// - response: `done <exit code> <length>\n<output>`
+///
+/// The exit code is 0 when a script finishes, what it passed to `process.exit`, -1 after a runtime error (whose
+/// report ends the output), or 1 when it could not run to the end otherwise: a parse or type error, or a failing
+/// standard library call.
+pub struct Server {
+    options: ServeOptions,
+    globals: Rc<RefCell<SourceEnv>>,
+    current_dir: String,
+}
+
+impl Server {
+    pub fn new(options: ServeOptions) -> Self {
+        let server = Self {
+            globals: SourceEnv::create_global(options.sandboxed),
+            current_dir: env::current_dir().unwrap().to_str().unwrap().to_string(),
+            options,
+        };
+        // Parses the snippets now rather than during the first request
+        Parser::new(
+            "",
+            server.options.inject_stdlib_snippets,
+            server.technique(),
+        )
+        .produce_ast();
+        server
+    }
+
+    fn technique(&self) -> ExecutionTechnique {
+        if self.options.use_vm {
+            ExecutionTechnique::Bytecode
+        } else {
+            ExecutionTechnique::Interpretation
+        }
+    }
+
+    /// Runs one script, returning its exit code and everything it printed. Runtime errors, `process.exit` and panics
+    /// end the script, not the server.
+    pub fn run_script(&mut self, source: &str) -> (i32, Vec<u8>) {
+        task::set_program(
+            source,
+            self.options.inject_stdlib_snippets,
+            self.options.sandboxed,
+        );
+        contain_exits(true);
+        capture_stdout();
+        RUNNING_SCRIPT.with(|running| running.set(true));
+        let outcome = panic::catch_unwind(AssertUnwindSafe(|| self.execute(source)));
+        RUNNING_SCRIPT.with(|running| running.set(false));
+        let mut output = take_captured_stdout();
+        contain_exits(false);
+
+        let (code, message) = match outcome {
+            Ok(Ok(())) => (0, None),
+            Ok(Err(errors)) => (1, Some(errors)),
+            Err(payload) => match payload.downcast::<ProgramExit>() {
+                Ok(exit) => (exit.code, exit.error),
+                Err(payload) => (
+                    1,
+                    Some(
+                        payload
+                            .downcast_ref::<String>()
+                            .cloned()
+                            .or_else(|| payload.downcast_ref::<&str>().map(|s| s.to_string()))
+                            .unwrap_or_else(|| String::from("script panicked")),
+                    ),
+                ),
+            },
+        };
+        if let Some(message) = message {
+            output.extend_from_slice(message.as_bytes());
+            output.push(b'\n');
+        }
+        (code, output)
+    }
+
+    /// Parses, typechecks and runs `source`, or returns its type errors.
+    fn execute(&self, source: &str) -> Result<(), String> {
+        let mut ast = Parser::new(
+            source,
+            self.options.inject_stdlib_snippets,
+            self.technique(),
+        )
+        .produce_ast();
+        ast.fold_constants();
+        let mut checker = TypeChecker::new(
+            &ast.externals_used,
+            self.current_dir.clone(),
+            self.technique(),
+        );
+        checker.enter_scope();
+        checker.load_externs();
+        for node in &ast.nodes {
+            checker.check_expr(node, None, false, 0);
+        }
+        if !checker.errors.is_empty() {
+            let errors: Vec<String> = checker
+                .errors
+                .iter()
+                .map(|err| format!("tc-err: {}", err.message))
+                .collect();
+            return Err(format!("Typechecking failed\n{}", errors.join("\n")));
+        }
+
+        let scope = Rc::new(RefCell::new(SourceEnv::new(Some(Rc::clone(&self.globals)))));
+        if self.options.use_vm {
+            // The compiler only sees an environment's own bindings, which the fresh scope has none of yet
+            let program = BytecodeCompiler::new(&self.globals.borrow()).compile_program(&ast.nodes);
+            VirtualMachine::new(scope).run(program);
+        } else {
+            Interpreter::new(ast.nodes).evaluate_body(scope);
+        }
+        Ok(())
+    }
+
+    /// Answers requests from `reader` on `writer` until `reader` ends.
+    pub fn serve(&mut self, reader: impl Read, mut writer: impl Write) -> io::Result<()> {
+        let mut reader = BufReader::new(reader);
+        let mut header = String::new();
+        loop {
+            header.clear();
+            if reader.read_line(&mut header)? == 0 {
+                return Ok(());
+            }
+            let length = match header.trim_end().split_once(' ') {
+                Some(("run", length)) => length.parse::<usize>().ok(),
+                _ => None,
+            };
+            let Some(length) = length else {
+                return Err(io::Error::new(
+                    io::ErrorKind::InvalidData,
+                    format!("expected `run <length>`, received `{}`", header.trim_end()),
+                ));
+            };
+            let mut source = vec![0; length];
+            reader.read_exact(&mut source)?;
+
+            let (code, output) = self.run_script(&String::from_utf8_lossy(&source));
+            write!(writer, "done {} {}\n", code, output.len())?;
+            writer.write_all(&output)?;
+            writer.flush()?;
+        }
+    }
+
+    /// Serves one client at a time on a Unix socket at `path`, replacing a stale socket file left there.
+    #[cfg(unix)]
+    pub fn serve_socket(&mut self, path: &str) -> io::Result<()> {
+        use std::os::unix::net::UnixListener;
+
+        let _ = std::fs::remove_file(path);
+        let listener = UnixListener::bind(path)?;
+        for stream in listener.incoming() {
+            let stream = stream?;
+            // A client that hangs up or sends garbage ends its connection, not the server
+            if let Err(err) = self.serve(&stream, &stream) {
+                eprintln!("serve: {}", err);
+            }
+        }
+        Ok(())
+    }
+}
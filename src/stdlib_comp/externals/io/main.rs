@@ -1,38 +1,78 @@
 use std::ffi::CStr;
 use std::ffi::c_char;
-use std::io::{self, Write};
+use std::io::{self, IsTerminal, Write};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Mutex, Once};
+
+// Output goes through one process-wide buffer, written to stdout under a single lock: at the end of every line when
+// stdout is a terminal, once BUFFER_SIZE bytes have built up otherwise, on `write`, and at exit. Printing a line to a
+// pipe or file costs a copy rather than a write(2).
+
+const BUFFER_SIZE: usize = 64 * 1024;
+
+static BUFFER: Mutex<Vec<u8>> = Mutex::new(Vec::new());
+static LINE_BUFFERED: AtomicBool = AtomicBool::new(false);
+static SETUP: Once = Once::new();
+
+extern "C" {
+    fn atexit(callback: extern "C" fn()) -> i32;
+}
+
+extern "C" fn flush_at_exit() {
+    let mut buffer = BUFFER.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+    let _ = flush(&mut buffer);
+}
+
+fn flush(buffer: &mut Vec<u8>) -> io::Result<()> {
+    let mut out = io::stdout().lock();
+    let written = out.write_all(buffer).and_then(|_| out.flush());
+    buffer.clear();
+    written
+}
+
+fn write_out(text: &[u8], newline: bool, flush_now: bool) {
+    SETUP.call_once(|| {
+        LINE_BUFFERED.store(io::stdout().is_terminal(), Ordering::Relaxed);
+        unsafe {
+            atexit(flush_at_exit);
+        }
+    });
+    let mut buffer = BUFFER.lock().unwrap();
+    let start = buffer.len();
+    buffer.extend_from_slice(text);
+    if newline {
+        buffer.push(b'\n');
+    }
+    let due = if LINE_BUFFERED.load(Ordering::Relaxed) {
+        buffer[start..].contains(&b'\n')
+    } else {
+        buffer.len() >= BUFFER_SIZE
+    };
+    if flush_now || due {
+        flush(&mut buffer).unwrap();
+    }
+}
 
 #[no_mangle]
 pub unsafe extern "C" fn vel_write(a: *const c_char) {
     if a.is_null() {
         return;
     }
-    print!("{}", CStr::from_ptr(a).to_str().unwrap());
-    std::io::stdout().flush().unwrap();
+    write_out(CStr::from_ptr(a).to_bytes(), false, true);
 }
 
 #[no_mangle]
-pub unsafe extern "C" fn vel_print(a: *const c_char) {
+pub unsafe extern "C" fn vel_write_no_flush(a: *const c_char) {
     if a.is_null() {
         return;
     }
-    print!("{}", CStr::from_ptr(a).to_str().unwrap());
-    print!("{}", "\n");
-    std::io::stdout().flush().unwrap();
-    /*
-    unsafe {
-        let mut i = 0;
-        loop {
-            let ch = *a.add(i);
-            if ch == 0 {
-                break;
-            }
-            let c_str = unsafe { CStr::from_ptr(ch) };
-            print!("{}", ch);
-            i += 1;
-        }
-        std::io::stdout().flush().unwrap();
-        println!("");
+    write_out(CStr::from_ptr(a).to_bytes(), false, false);
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn vel_print(a: *const c_char) {
+    if a.is_null() {
+        return;
     }
-    */
+    write_out(CStr::from_ptr(a).to_bytes(), true, false);
 }
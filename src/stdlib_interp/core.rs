@@ -3,33 +3,55 @@ use std::rc::Rc;
 
 use crate::args;
 use crate::runtime::source_environment::source_environment::SourceEnv;
-use crate::runtime::values::{NullVal, RuntimeVal, StringVal};
+use crate::runtime::values::{IteratorVal, NullVal, RuntimeVal, StringVal};
 use crate::stdlib_interp::helpers::internal_fn;
+use crate::stdlib_interp::io::write_stdout;
 
 // TODO: Generate FFI for compiler instead of interpreter
 pub fn print_fn() -> RuntimeVal {
     internal_fn("print", |args, env: Rc<RefCell<SourceEnv>>| {
-        let output = args
-            .iter()
-            .map(|arg| arg.to_string())
-            .collect::<Vec<_>>()
-            .join(" ");
-
-        println!("{}", output);
+        write_stdout(&args, "\n", false);
         RuntimeVal::NullVal(NullVal {})
     })
 }
 
+/// `range(end)`, `range(start, end)` or `range(start, end, step)`: a lazy iterator over the numbers from `start`
+/// (default 0) up to `end`, exclusive, counting down for a negative `step`.
+pub fn range_fn() -> RuntimeVal {
+    internal_fn("range", |args, _env: Rc<RefCell<SourceEnv>>| {
+        let numbers: Vec<isize> = args
+            .iter()
+            .map(|arg| match arg {
+                RuntimeVal::NumberVal(n) => n.value,
+                other => panic!("range expects number arguments, found {:?}", other),
+            })
+            .collect();
+        let (start, end, step) = match numbers[..] {
+            [end] => (0, end, 1),
+            [start, end] => (start, end, 1),
+            [start, end, step] => (start, end, step),
+            _ => panic!("range expects 1 to 3 arguments, received {}", numbers.len()),
+        };
+        match IteratorVal::range(start, end, step) {
+            Ok(range) => RuntimeVal::IteratorVal(range),
+            Err(err) => panic!("{}", err),
+        }
+    })
+}
+
 pub fn infer_runtime_type(val: &RuntimeVal) -> String {
     match val {
         RuntimeVal::InternalFunctionVal(_) => "internal_fn",
         RuntimeVal::ObjectVal(_) => "internal_object",
         RuntimeVal::StringVal(_) => "string",
         RuntimeVal::NumberVal(_) => "number",
+        RuntimeVal::IntegerVal(i) => i.width.name(),
+        RuntimeVal::FloatVal(_) => "f64",
         RuntimeVal::BoolVal(_) => "bool",
         RuntimeVal::NullVal(_) => "null",
-        RuntimeVal::ListVal(_) => "list",
+        RuntimeVal::ListVal(_) | RuntimeVal::NumberArrayVal(_) => "list",
         RuntimeVal::FunctionVal(_) => "function",
+        RuntimeVal::BytecodeFunctionVal(_) => "function",
         RuntimeVal::ReturnVal(_) => "return",
         _ => "unknown",
     }
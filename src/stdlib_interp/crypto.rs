@@ -14,20 +14,18 @@ pub fn crypto_module() -> RuntimeVal {
             internal_fn("hash256", |args, _: Rc<RefCell<SourceEnv>>| {
                 args![args;
                     StringVal => input,
-                    Option<StringVal> => delim = StringVal { value: ",".to_string() }
+                    Option<StringVal> => delim = StringVal { value: ",".into() }
                 ];
 
                 let parts = input
                     .value
-                    .split(&delim.value)
-                    .map(|s| {
-                        RuntimeVal::StringVal(StringVal {
-                            value: s.to_string(),
-                        })
-                    })
+                    .split(&*delim.value)
+                    .map(|s| RuntimeVal::StringVal(StringVal { value: s.into() }))
                     .collect();
 
-                RuntimeVal::ListVal(ListVal { values: parts })
+                RuntimeVal::ListVal(ListVal {
+                    values: Rc::new(parts),
+                })
             }),
         )]),
     )])
@@ -19,7 +19,7 @@ pub fn debug_module() -> RuntimeVal {
                     end_printstr += " ";
                 }
                 RuntimeVal::StringVal(StringVal {
-                    value: end_printstr,
+                    value: end_printstr.into(),
                 })
             }),
         ),
@@ -34,16 +34,19 @@ pub fn debug_module() -> RuntimeVal {
                     RuntimeVal::StringVal(_) => "string",
                     RuntimeVal::BoolVal(_) => "bool",
                     RuntimeVal::NullVal(_) => "null",
-                    RuntimeVal::ListVal(_) => "list",
+                    RuntimeVal::ListVal(_) | RuntimeVal::NumberArrayVal(_) => "list",
                     RuntimeVal::ObjectVal(_) => "object",
                     RuntimeVal::FunctionVal(_) => "function",
+                    RuntimeVal::BytecodeFunctionVal(_) => "function",
                     RuntimeVal::InternalFunctionVal(_) => "internal_function",
                     RuntimeVal::NumberVal(_) => "number",
+                    RuntimeVal::IntegerVal(i) => i.width.name(),
+                    RuntimeVal::FloatVal(_) => "f64",
                     _ => "unknown",
                 };
 
                 RuntimeVal::StringVal(StringVal {
-                    value: type_name.to_string(),
+                    value: type_name.into(),
                 })
             }),
         ),
@@ -1,4 +1,4 @@
-use std::{cell::RefCell, collections::HashMap};
+use std::cell::RefCell;
 use std::rc::Rc;
 
 use crate::runtime::source_environment::source_environment::SourceEnv;
@@ -9,15 +9,13 @@ where
     F: Fn(Vec<RuntimeVal>, Rc<RefCell<SourceEnv>>) -> RuntimeVal + 'static,
 {
     RuntimeVal::InternalFunctionVal(InternalFunctionVal {
-        fn_name: name.to_string(),
+        fn_name: name.into(),
         internal_callback: Rc::new(callback),
     })
 }
 
-pub fn object_val(items: impl IntoIterator<Item = (impl Into<String>, RuntimeVal)>) -> RuntimeVal {
-    RuntimeVal::ObjectVal(ObjectVal {
-        values: items.into_iter().map(|(k, v)| (k.into(), v)).collect::<HashMap<_, _>>(),
-    })
+pub fn object_val(items: impl IntoIterator<Item = (impl Into<Rc<str>>, RuntimeVal)>) -> RuntimeVal {
+    RuntimeVal::ObjectVal(ObjectVal::new(items))
 }
 
 #[macro_export]
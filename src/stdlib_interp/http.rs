@@ -0,0 +1,655 @@
+use std::cell::RefCell;
+use std::collections::HashMap;
+use std::io::{self, Read, Write};
+use std::net::{TcpStream, ToSocketAddrs};
+use std::sync::mpsc;
+use std::thread;
+use std::time::{Duration, Instant};
+
+/// Requests in flight to one host at a time; the others wait for one of its connections to free up.
+const MAX_CONNECTIONS_PER_HOST: usize = 16;
+/// Requests in flight at once, keeping well clear of the open file limit.
+const MAX_IN_FLIGHT: usize = 256;
+/// Idle connections kept open per host for later requests.
+const MAX_IDLE_PER_HOST: usize = 16;
+/// Response heads larger than this are rejected rather than buffered without end.
+const MAX_HEAD_SIZE: usize = 64 * 1024;
+const READ_SIZE: usize = 16 * 1024;
+/// How often the event loop checks for connections established while it waits on sockets.
+const CONNECT_POLL_INTERVAL: Duration = Duration::from_millis(2);
+
+type HostKey = (String, u16);
+
+/// An `http://` URL. There is no TLS implementation to build `https://` on.
+#[derive(Debug, Clone)]
+struct Url {
+    host: String,
+    port: u16,
+    /// The path and query, starting with `/`.
+    target: String,
+}
+
+impl Url {
+    fn parse(url: &str) -> Result<Self, String> {
+        let rest = match url.split_once("://") {
+            Some(("http", rest)) => rest,
+            Some(("https", _)) => return Err(format!("{}: https is not supported", url)),
+            Some((scheme, _)) => return Err(format!("{}: unsupported scheme `{}`", url, scheme)),
+            None => return Err(format!("{}: expected an http:// URL", url)),
+        };
+        let (authority, target) = match rest.find(['/', '?']) {
+            Some(at) if rest[at..].starts_with('?') => (&rest[..at], format!("/{}", &rest[at..])),
+            Some(at) => (&rest[..at], rest[at..].to_string()),
+            None => (rest, String::from("/")),
+        };
+        let (host, port) = match authority.rsplit_once(':') {
+            Some((host, port)) => (
+                host,
+                port.parse()
+                    .map_err(|_| format!("{}: invalid port `{}`", url, port))?,
+            ),
+            None => (authority, 80),
+        };
+        if host.is_empty() {
+            return Err(format!("{}: missing host", url));
+        }
+        Ok(Self {
+            host: host.to_string(),
+            port,
+            target,
+        })
+    }
+
+    fn host_key(&self) -> HostKey {
+        (self.host.clone(), self.port)
+    }
+
+    fn request(&self) -> Vec<u8> {
+        let host = if self.port == 80 {
+            self.host.clone()
+        } else {
+            format!("{}:{}", self.host, self.port)
+        };
+        format!(
+            "GET {} HTTP/1.1\r\nHost: {}\r\nUser-Agent: velvet/{}\r\nAccept: */*\r\nConnection: keep-alive\r\n\r\n",
+            self.target,
+            host,
+            env!("CARGO_PKG_VERSION")
+        )
+        .into_bytes()
+    }
+}
+
+#[derive(Debug, Clone)]
+pub struct Response {
+    pub status: u16,
+    /// Lowercased names, in the order received.
+    pub headers: Vec<(String, String)>,
+    pub body: Vec<u8>,
+}
+
+thread_local! {
+    /// Connections whose last response left them open, by host, reused by later requests to skip the handshake.
+    static IDLE: RefCell<HashMap<HostKey, Vec<TcpStream>>> = RefCell::new(HashMap::new());
+}
+
+fn take_idle(host: &HostKey) -> Option<TcpStream> {
+    IDLE.with_borrow_mut(|idle| idle.get_mut(host)?.pop())
+}
+
+fn keep_idle(host: HostKey, stream: TcpStream) {
+    IDLE.with_borrow_mut(|idle| {
+        let streams = idle.entry(host).or_default();
+        if streams.len() < MAX_IDLE_PER_HOST {
+            streams.push(stream);
+        }
+    });
+}
+
+/// How the end of a response body is found.
+#[derive(Debug)]
+enum Framing {
+    Empty,
+    Length(usize),
+    Chunked(ChunkState),
+    /// The body lasts until the server closes the connection.
+    UntilClose,
+}
+
+#[derive(Debug, Clone, Copy)]
+enum ChunkState {
+    Size,
+    Data(usize),
+    DataEnd,
+    Trailers,
+}
+
+#[derive(Debug)]
+struct Head {
+    status: u16,
+    headers: Vec<(String, String)>,
+    keep_alive: bool,
+}
+
+/// Parses a response as it arrives, a read at a time.
+#[derive(Debug, Default)]
+struct ResponseParser {
+    /// Received bytes not parsed yet.
+    buffer: Vec<u8>,
+    head: Option<Head>,
+    framing: Option<Framing>,
+    body: Vec<u8>,
+    received_any: bool,
+}
+
+fn find(haystack: &[u8], needle: &[u8]) -> Option<usize> {
+    haystack
+        .windows(needle.len())
+        .position(|window| window == needle)
+}
+
+impl ResponseParser {
+    /// Whether the response is complete.
+    fn feed(&mut self, data: &[u8]) -> Result<bool, String> {
+        self.received_any = true;
+        self.buffer.extend_from_slice(data);
+        while self.head.is_none() {
+            let Some(end) = find(&self.buffer, b"\r\n\r\n") else {
+                if self.buffer.len() > MAX_HEAD_SIZE {
+                    return Err(String::from("response head too large"));
+                }
+                return Ok(false);
+            };
+            let head = Self::parse_head(&self.buffer[..end])?;
+            self.buffer.drain(..end + 4);
+            // Interim responses precede the real one
+            if (100..200).contains(&head.status) {
+                continue;
+            }
+            self.framing = Some(Self::framing(&head)?);
+            self.head = Some(head);
+        }
+        self.parse_body()
+    }
+
+    /// Completes a response whose body lasts until the connection closes; anything else is cut short.
+    fn finish_at_eof(&mut self) -> Result<(), String> {
+        match self.framing {
+            Some(Framing::UntilClose) => {
+                self.body.append(&mut self.buffer);
+                Ok(())
+            }
+            _ => Err(String::from(
+                "connection closed before the response was complete",
+            )),
+        }
+    }
+
+    fn parse_head(head: &[u8]) -> Result<Head, String> {
+        let head = String::from_utf8_lossy(head);
+        let mut lines = head.split("\r\n");
+        let status_line = lines.next().unwrap_or_default();
+        let mut parts = status_line.splitn(3, ' ');
+        let version = parts.next().unwrap_or_default();
+        let status = parts
+            .next()
+            .and_then(|status| status.parse::<u16>().ok())
+            .filter(|_| version.starts_with("HTTP/"))
+            .ok_or_else(|| format!("malformed status line `{}`", status_line))?;
+        let headers: Vec<(String, String)> = lines
+            .filter_map(|line| line.split_once(':'))
+            .map(|(name, value)| (name.trim().to_ascii_lowercase(), value.trim().to_string()))
+            .collect();
+        let connection = headers
+            .iter()
+            .find(|(name, _)| name == "connection")
+            .map(|(_, value)| value.to_ascii_lowercase());
+        let keep_alive = match connection.as_deref() {
+            Some(value) if value.contains("close") => false,
+            Some(value) if value.contains("keep-alive") => true,
+            _ => version != "HTTP/1.0",
+        };
+        Ok(Head {
+            status,
+            headers,
+            keep_alive,
+        })
+    }
+
+    fn framing(head: &Head) -> Result<Framing, String> {
+        let header = |wanted: &str| {
+            head.headers
+                .iter()
+                .find(|(name, _)| name == wanted)
+                .map(|(_, value)| value.as_str())
+        };
+        if head.status == 204 || head.status == 304 {
+            return Ok(Framing::Empty);
+        }
+        if header("transfer-encoding")
+            .is_some_and(|value| value.to_ascii_lowercase().contains("chunked"))
+        {
+            return Ok(Framing::Chunked(ChunkState::Size));
+        }
+        match header("content-length") {
+            Some(length) => length
+                .parse()
+                .map(Framing::Length)
+                .map_err(|_| format!("invalid content-length `{}`", length)),
+            None => Ok(Framing::UntilClose),
+        }
+    }
+
+    fn parse_body(&mut self) -> Result<bool, String> {
+        let framing = self.framing.as_mut().unwrap();
+        match framing {
+            Framing::Empty => Ok(true),
+            Framing::Length(length) => {
+                let wanted = (*length - self.body.len()).min(self.buffer.len());
+                self.body.extend(self.buffer.drain(..wanted));
+                Ok(self.body.len() == *length)
+            }
+            Framing::UntilClose => {
+                self.body.append(&mut self.buffer);
+                Ok(false)
+            }
+            Framing::Chunked(state) => loop {
+                match *state {
+                    ChunkState::Size => {
+                        let Some(end) = find(&self.buffer, b"\r\n") else {
+                            return Ok(false);
+                        };
+                        let line = String::from_utf8_lossy(&self.buffer[..end]);
+                        let size = line.split(';').next().unwrap_or_default().trim();
+                        let size = usize::from_str_radix(size, 16)
+                            .map_err(|_| format!("invalid chunk size `{}`", size))?;
+                        self.buffer.drain(..end + 2);
+                        *state = if size == 0 {
+                            ChunkState::Trailers
+                        } else {
+                            ChunkState::Data(size)
+                        };
+                    }
+                    ChunkState::Data(remaining) => {
+                        let taken = remaining.min(self.buffer.len());
+                        self.body.extend(self.buffer.drain(..taken));
+                        if taken < remaining {
+                            *state = ChunkState::Data(remaining - taken);
+                            return Ok(false);
+                        }
+                        *state = ChunkState::DataEnd;
+                    }
+                    ChunkState::DataEnd => {
+                        if self.buffer.len() < 2 {
+                            return Ok(false);
+                        }
+                        self.buffer.drain(..2);
+                        *state = ChunkState::Size;
+                    }
+                    // Trailer fields are skipped up to the empty line that ends them
+                    ChunkState::Trailers => {
+                        let Some(end) = find(&self.buffer, b"\r\n") else {
+                            return Ok(false);
+                        };
+                        self.buffer.drain(..end + 2);
+                        if end == 0 {
+                            return Ok(true);
+                        }
+                    }
+                }
+            },
+        }
+    }
+
+    fn into_response(self) -> (Response, bool) {
+        let head = self.head.unwrap();
+        let reusable = head.keep_alive && !matches!(self.framing, Some(Framing::UntilClose));
+        (
+            Response {
+                status: head.status,
+                headers: head.headers,
+                body: self.body,
+            },
+            reusable,
+        )
+    }
+}
+
+#[derive(Debug)]
+enum Stage {
+    /// Waiting for room under the connection limits.
+    Queued,
+    Connecting,
+    Writing(usize),
+    Reading,
+    Done(Result<Response, String>),
+}
+
+/// One request and its response, driven by `get_many`'s event loop.
+struct Exchange {
+    url: Url,
+    stage: Stage,
+    stream: Option<TcpStream>,
+    /// Whether `stream` came from the idle pool, where the server may have closed it in the meantime.
+    reused: bool,
+    parser: ResponseParser,
+    deadline: Instant,
+}
+
+impl Exchange {
+    fn is_active(&self) -> bool {
+        matches!(
+            self.stage,
+            Stage::Connecting | Stage::Writing(_) | Stage::Reading
+        )
+    }
+
+    /// Writes or reads as far as the socket allows without blocking.
+    fn make_progress(&mut self, request: &[u8]) -> Result<(), io::Error> {
+        let stream = self.stream.as_mut().unwrap();
+        while let Stage::Writing(written) = self.stage {
+            match stream.write(&request[written..]) {
+                Ok(0) => return Err(io::ErrorKind::WriteZero.into()),
+                Ok(n) if written + n == request.len() => self.stage = Stage::Reading,
+                Ok(n) => self.stage = Stage::Writing(written + n),
+                Err(err) if err.kind() == io::ErrorKind::WouldBlock => return Ok(()),
+                Err(err) if err.kind() == io::ErrorKind::Interrupted => {}
+                Err(err) => return Err(err),
+            }
+        }
+        let mut buffer = [0; READ_SIZE];
+        loop {
+            match stream.read(&mut buffer) {
+                Ok(0) => {
+                    if self.reused && !self.parser.received_any {
+                        return Err(io::ErrorKind::ConnectionAborted.into());
+                    }
+                    let outcome = self.parser.finish_at_eof().map(|_| {
+                        let (response, _) = std::mem::take(&mut self.parser).into_response();
+                        response
+                    });
+                    self.stream = None;
+                    self.stage = Stage::Done(outcome);
+                    return Ok(());
+                }
+                Ok(n) => match self.parser.feed(&buffer[..n]) {
+                    Ok(true) => {
+                        let (response, reusable) = std::mem::take(&mut self.parser).into_response();
+                        let stream = self.stream.take().unwrap();
+                        if reusable {
+                            keep_idle(self.url.host_key(), stream);
+                        }
+                        self.stage = Stage::Done(Ok(response));
+                        return Ok(());
+                    }
+                    Ok(false) => {}
+                    Err(err) => {
+                        self.stream = None;
+                        self.stage = Stage::Done(Err(err));
+                        return Ok(());
+                    }
+                },
+                Err(err) if err.kind() == io::ErrorKind::WouldBlock => return Ok(()),
+                Err(err) if err.kind() == io::ErrorKind::Interrupted => {}
+                Err(err) => return Err(err),
+            }
+        }
+    }
+}
+
+fn connect(host: &str, port: u16, timeout: Duration) -> io::Result<TcpStream> {
+    let mut last_error = io::Error::new(io::ErrorKind::NotFound, "host has no addresses");
+    for address in (host, port).to_socket_addrs()? {
+        match TcpStream::connect_timeout(&address, timeout) {
+            Ok(stream) => return Ok(stream),
+            Err(err) => last_error = err,
+        }
+    }
+    Err(last_error)
+}
+
+/// Fetches every URL with a GET request, many at once: a single-threaded event loop keeps up to
+/// `MAX_CONNECTIONS_PER_HOST` requests per host and `MAX_IN_FLIGHT` overall on non-blocking sockets. Connections
+/// are kept alive and reused by later requests to the same host. Redirects are returned as they are.
+///
+/// The standard library has no non-blocking connect, so new connections are opened on short-lived threads and
+/// handed to the loop once established. Each result is the response or why there is none.
+pub fn get_many(urls: &[&str], timeout: Duration) -> Vec<Result<Response, String>> {
+    let start = Instant::now();
+    let mut requests = Vec::with_capacity(urls.len());
+    let mut exchanges: Vec<Exchange> = urls
+        .iter()
+        .map(|url| {
+            let (url, stage) = match Url::parse(url) {
+                Ok(url) => (url, Stage::Queued),
+                Err(err) => (
+                    Url {
+                        host: String::new(),
+                        port: 0,
+                        target: String::new(),
+                    },
+                    Stage::Done(Err(err)),
+                ),
+            };
+            requests.push(url.request());
+            Exchange {
+                url,
+                stage,
+                stream: None,
+                reused: false,
+                parser: ResponseParser::default(),
+                deadline: start + timeout,
+            }
+        })
+        .collect();
+
+    let (connected, connections) = mpsc::channel::<(usize, io::Result<TcpStream>)>();
+    let mut per_host: HashMap<HostKey, usize> = HashMap::new();
+    let mut in_flight = 0;
+    let mut ready = vec![true; exchanges.len()];
+    loop {
+        for (index, exchange) in exchanges.iter_mut().enumerate() {
+            if !matches!(exchange.stage, Stage::Queued) || in_flight >= MAX_IN_FLIGHT {
+                continue;
+            }
+            let active = per_host.entry(exchange.url.host_key()).or_default();
+            if *active >= MAX_CONNECTIONS_PER_HOST {
+                continue;
+            }
+            *active += 1;
+            in_flight += 1;
+            match take_idle(&exchange.url.host_key()) {
+                Some(stream) => {
+                    exchange.stream = Some(stream);
+                    exchange.reused = true;
+                    exchange.stage = Stage::Writing(0);
+                    ready[index] = true;
+                }
+                None => start_connect(index, exchange, &connected),
+            }
+        }
+
+        while let Ok((index, stream)) = connections.try_recv() {
+            let exchange = &mut exchanges[index];
+            if !matches!(exchange.stage, Stage::Connecting) {
+                continue;
+            }
+            let stream = stream.and_then(|stream| {
+                stream.set_nonblocking(true)?;
+                stream.set_nodelay(true)?;
+                Ok(stream)
+            });
+            match stream {
+                Ok(stream) => {
+                    exchange.stream = Some(stream);
+                    exchange.stage = Stage::Writing(0);
+                    ready[index] = true;
+                }
+                Err(err) => {
+                    exchange.stage = Stage::Done(Err(format!(
+                        "failed to connect to {}: {}",
+                        exchange.url.host, err
+                    )))
+                }
+            }
+        }
+
+        let now = Instant::now();
+        let mut freed = false;
+        for (index, exchange) in exchanges.iter_mut().enumerate() {
+            if !exchange.is_active() {
+                continue;
+            }
+            if now >= exchange.deadline {
+                exchange.stream = None;
+                exchange.stage =
+                    Stage::Done(Err(format!("request to {} timed out", exchange.url.host)));
+            } else if exchange.stream.is_some() && ready[index] {
+                if let Err(err) = exchange.make_progress(&requests[index]) {
+                    exchange.stream = None;
+                    if exchange.reused {
+                        // The server closed the idle connection; the request is repeated on a new one
+                        exchange.reused = false;
+                        exchange.parser = ResponseParser::default();
+                        start_connect(index, exchange, &connected);
+                    } else {
+                        exchange.stage = Stage::Done(Err(format!(
+                            "request to {} failed: {}",
+                            exchange.url.host, err
+                        )));
+                    }
+                }
+            }
+            if let Stage::Done(_) = exchange.stage {
+                *per_host.get_mut(&exchange.url.host_key()).unwrap() -= 1;
+                in_flight -= 1;
+                freed = true;
+            }
+        }
+
+        if exchanges
+            .iter()
+            .all(|exchange| matches!(exchange.stage, Stage::Done(_)))
+        {
+            break;
+        }
+        let connecting = exchanges
+            .iter()
+            .any(|exchange| matches!(exchange.stage, Stage::Connecting));
+        let deadline = exchanges
+            .iter()
+            .filter(|exchange| exchange.is_active())
+            .map(|exchange| exchange.deadline)
+            .min()
+            .unwrap_or(now);
+        let mut wait = deadline.saturating_duration_since(Instant::now());
+        if connecting {
+            wait = wait.min(CONNECT_POLL_INTERVAL);
+        }
+        // A finished request makes room for a queued one, which should start without waiting on the others
+        if freed {
+            wait = Duration::ZERO;
+        }
+        let interests: Vec<(usize, &TcpStream, bool)> = exchanges
+            .iter()
+            .enumerate()
+            .filter_map(|(index, exchange)| {
+                let writing = matches!(exchange.stage, Stage::Writing(_));
+                Some((index, exchange.stream.as_ref()?, writing))
+            })
+            .collect();
+        ready.iter_mut().for_each(|ready| *ready = false);
+        for index in poll::wait(&interests, wait) {
+            ready[index] = true;
+        }
+    }
+
+    exchanges
+        .into_iter()
+        .map(|exchange| match exchange.stage {
+            Stage::Done(outcome) => outcome,
+            _ => unreachable!(),
+        })
+        .collect()
+}
+
+/// Opens a connection for `exchange` on a new thread, which sends it to the loop through `connected`. Results for
+/// exchanges no longer connecting (those that timed out meanwhile) are ignored by the loop.
+fn start_connect(
+    index: usize,
+    exchange: &mut Exchange,
+    connected: &mpsc::Sender<(usize, io::Result<TcpStream>)>,
+) {
+    exchange.stage = Stage::Connecting;
+    let (host, port) = exchange.url.host_key();
+    let timeout = exchange.deadline.saturating_duration_since(Instant::now());
+    let connected = connected.clone();
+    thread::spawn(move || {
+        let stream = connect(&host, port, timeout.max(Duration::from_millis(1)));
+        // The loop may have given up on the request already
+        let _ = connected.send((index, stream));
+    });
+}
+
+#[cfg(unix)]
+mod poll {
+    use std::net::TcpStream;
+    use std::os::fd::AsRawFd;
+    use std::time::Duration;
+
+    const POLLIN: i16 = 0x1;
+    const POLLOUT: i16 = 0x4;
+
+    #[repr(C)]
+    struct PollFd {
+        fd: i32,
+        events: i16,
+        revents: i16,
+    }
+
+    #[cfg(target_os = "linux")]
+    type NFds = std::ffi::c_ulong;
+    #[cfg(not(target_os = "linux"))]
+    type NFds = std::ffi::c_uint;
+
+    unsafe extern "C" {
+        fn poll(fds: *mut PollFd, nfds: NFds, timeout: i32) -> i32;
+    }
+
+    /// Waits up to `timeout` for any of the sockets to become readable (or writable, when flagged), returning the
+    /// indices of those that did. Errors and hangups count as ready, for the next read or write to report them.
+    pub fn wait(interests: &[(usize, &TcpStream, bool)], timeout: Duration) -> Vec<usize> {
+        let mut fds: Vec<PollFd> = interests
+            .iter()
+            .map(|(_, stream, writing)| PollFd {
+                fd: stream.as_raw_fd(),
+                events: if *writing { POLLOUT } else { POLLIN },
+                revents: 0,
+            })
+            .collect();
+        let timeout = timeout.as_millis().min(i32::MAX as u128) as i32;
+        // An interrupted wait just returns early; every socket is tried again
+        if unsafe { poll(fds.as_mut_ptr(), fds.len() as NFds, timeout) } < 0 {
+            return interests.iter().map(|(index, _, _)| *index).collect();
+        }
+        interests
+            .iter()
+            .zip(&fds)
+            .filter(|(_, fd)| fd.revents != 0)
+            .map(|((index, _, _), _)| *index)
+            .collect()
+    }
+}
+
+/// Without `poll(2)` the loop sleeps briefly and tries every socket, which the non-blocking reads make harmless.
+#[cfg(not(unix))]
+mod poll {
+    use std::net::TcpStream;
+    use std::thread;
+    use std::time::Duration;
+
+    pub fn wait(interests: &[(usize, &TcpStream, bool)], timeout: Duration) -> Vec<usize> {
+        thread::sleep(timeout.min(Duration::from_millis(1)));
+        interests.iter().map(|(index, _, _)| *index).collect()
+    }
+}
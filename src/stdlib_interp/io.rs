@@ -0,0 +1,366 @@
+use std::cell::RefCell;
+use std::fs::{self, File, OpenOptions};
+use std::io::{self, BufReader, BufWriter, IsTerminal, Stdin, Write};
+use std::mem;
+use std::rc::{Rc, Weak};
+use std::sync::{LazyLock, Mutex, MutexGuard, PoisonError, TryLockError};
+
+use crate::args;
+use crate::runtime::iterators::LineReader;
+use crate::runtime::source_environment::source_environment::SourceEnv;
+use crate::runtime::values::*;
+use crate::stdlib_interp::helpers::{internal_fn, object_val};
+
+/// Reads and writes move data in blocks of this many bytes, rather than a syscall per line.
+const IO_BUFFER_SIZE: usize = 64 * 1024;
+
+type SharedWriter = Rc<RefCell<BufWriter<File>>>;
+
+/// When `print` and the `io.write` functions hand what they have buffered to stdout.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum Buffering {
+    /// At the end of every line, the default when stdout is a terminal.
+    Line,
+    /// Once `IO_BUFFER_SIZE` bytes have built up, the default when stdout is a pipe or a file.
+    Block,
+}
+
+/// The program's stdout. Output is collected here and written under a single stdout lock per flush, so printing a
+/// line costs a copy rather than a `write(2)`. There is one sink for the whole process, so lines printed by tasks on
+/// other threads keep their order with the rest and are flushed by the same exit paths.
+struct StdoutSink {
+    buffer: Vec<u8>,
+    buffering: Buffering,
+    destination: Destination,
+}
+
+/// Where the sink's output goes when flushed.
+enum Destination {
+    Stdout,
+    /// Thrown away, for `bench` runs that time the program rather than the terminal.
+    Discarded,
+    /// Kept for `serve` to send to whoever asked for the program to run.
+    Captured(Vec<u8>),
+}
+
+impl StdoutSink {
+    fn new() -> Self {
+        Self {
+            buffer: Vec::with_capacity(IO_BUFFER_SIZE),
+            buffering: if io::stdout().is_terminal() {
+                Buffering::Line
+            } else {
+                Buffering::Block
+            },
+            destination: Destination::Stdout,
+        }
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        match &mut self.destination {
+            Destination::Stdout => {}
+            Destination::Discarded => {
+                self.buffer.clear();
+                return Ok(());
+            }
+            Destination::Captured(captured) => {
+                captured.append(&mut self.buffer);
+                return Ok(());
+            }
+        }
+        let mut stdout = io::stdout().lock();
+        let written = stdout.write_all(&self.buffer).and_then(|_| stdout.flush());
+        self.buffer.clear();
+        written
+    }
+}
+
+static STDOUT: LazyLock<Mutex<StdoutSink>> = LazyLock::new(|| Mutex::new(StdoutSink::new()));
+
+/// A panic while printing leaves nothing half-written in the sink worth refusing the rest of the output for.
+fn stdout_sink() -> MutexGuard<'static, StdoutSink> {
+    STDOUT.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+/// One buffer over stdin for the whole process, so `read_line` and `stdin_lines`, on any thread, never lose input
+/// buffered by another.
+static STDIN_BUFFER: LazyLock<Mutex<BufReader<Stdin>>> =
+    LazyLock::new(|| Mutex::new(BufReader::with_capacity(IO_BUFFER_SIZE, io::stdin())));
+
+thread_local! {
+    /// This thread's reader of `STDIN_BUFFER`, reusing its line buffer across reads.
+    static STDIN: Rc<LineReader> = Rc::new(LineReader::shared(&*STDIN_BUFFER));
+
+    /// The writers still alive, flushed by `flush_output` when the program ends.
+    static OPEN_WRITERS: RefCell<Vec<Weak<RefCell<BufWriter<File>>>>> = RefCell::new(Vec::new());
+}
+
+/// Writes `values` to stdout as `print` does, followed by `end`, flushing as the current `Buffering` asks or
+/// immediately when `flush` is set.
+pub fn write_stdout(values: &[RuntimeVal], end: &str, flush: bool) {
+    let mut sink = stdout_sink();
+    let start = sink.buffer.len();
+    // Writes to a `Vec` cannot fail
+    write_values(&mut sink.buffer, values, end).unwrap();
+    let due = match sink.buffering {
+        Buffering::Line => sink.buffer[start..].contains(&b'\n'),
+        Buffering::Block => sink.buffer.len() >= IO_BUFFER_SIZE,
+    };
+    if flush || due {
+        let flushed = sink.flush();
+        // Not while holding the sink, which the panic hook flushes
+        drop(sink);
+        flushed.unwrap_or_else(|err| panic!("Failed to write to stdout: {}", err));
+    }
+}
+
+/// Hands everything buffered for stdout to it.
+pub fn flush_stdout() {
+    let flushed = stdout_sink().flush();
+    flushed.unwrap_or_else(|err| panic!("Failed to write to stdout: {}", err));
+}
+
+/// Flushes what is buffered, then has later output thrown away, or written again, as `discarded` says.
+pub fn discard_stdout(discarded: bool) {
+    flush_stdout();
+    stdout_sink().destination = if discarded {
+        Destination::Discarded
+    } else {
+        Destination::Stdout
+    };
+}
+
+/// Flushes what is buffered, then keeps later output aside until `take_captured_stdout`.
+pub fn capture_stdout() {
+    flush_stdout();
+    stdout_sink().destination = Destination::Captured(Vec::new());
+}
+
+/// Everything written since `capture_stdout`, after which output goes to stdout again.
+pub fn take_captured_stdout() -> Vec<u8> {
+    let mut sink = stdout_sink();
+    // Flushing into a capture cannot fail
+    sink.flush().unwrap();
+    match mem::replace(&mut sink.destination, Destination::Stdout) {
+        Destination::Captured(captured) => captured,
+        _ => Vec::new(),
+    }
+}
+
+/// Flushes stdout and every open file writer, for the program's exit paths: the sink and writers bound in the global
+/// scope may never be dropped, and `process.exit` skips destructors altogether. Errors are reported rather than
+/// raised, and a sink that is locked (by a panic while writing) is skipped.
+pub fn flush_output() {
+    let sink = match STDOUT.try_lock() {
+        Ok(sink) => Some(sink),
+        Err(TryLockError::Poisoned(poisoned)) => Some(poisoned.into_inner()),
+        Err(TryLockError::WouldBlock) => None,
+    };
+    if let Some(mut sink) = sink {
+        if let Err(err) = sink.flush() {
+            eprintln!("Failed to write to stdout: {}", err);
+        }
+    }
+    OPEN_WRITERS.with(|writers| {
+        for writer in writers.borrow().iter().filter_map(Weak::upgrade) {
+            let Ok(mut writer) = writer.try_borrow_mut() else {
+                continue;
+            };
+            if let Err(err) = writer.flush() {
+                eprintln!("Failed to flush file writer: {}", err);
+            }
+        }
+    });
+}
+
+/// The file functions are left out of sandboxed programs; stdin stays available.
+pub fn io_module(sandboxed: bool) -> RuntimeVal {
+    let mut items = vec![
+        (
+            "stdin_lines",
+            internal_fn("stdin_lines", |_args, _env: Rc<RefCell<SourceEnv>>| {
+                RuntimeVal::IteratorVal(IteratorVal::lines(STDIN.with(Rc::clone)))
+            }),
+        ),
+        (
+            // The next line of stdin, without its line ending, or null at the end of the input
+            "read_line",
+            internal_fn("read_line", |_args, _env: Rc<RefCell<SourceEnv>>| {
+                // A prompt written without a newline must show before the program waits on it
+                flush_stdout();
+                let line = STDIN.with(|stdin| stdin.read_line());
+                match line {
+                    Some(line) => RuntimeVal::StringVal(StringVal { value: line }),
+                    None => RuntimeVal::NullVal(NullVal {}),
+                }
+            }),
+        ),
+        (
+            // Like `print` without the newline, flushing what has been written
+            "write",
+            internal_fn("write", |args, _env: Rc<RefCell<SourceEnv>>| {
+                write_stdout(&args, "", true);
+                RuntimeVal::NullVal(NullVal {})
+            }),
+        ),
+        (
+            // `write` without the flush
+            "write_nf",
+            internal_fn("write_nf", |args, _env: Rc<RefCell<SourceEnv>>| {
+                write_stdout(&args, "", false);
+                RuntimeVal::NullVal(NullVal {})
+            }),
+        ),
+        (
+            "flush",
+            internal_fn("flush", |_args, _env: Rc<RefCell<SourceEnv>>| {
+                flush_stdout();
+                RuntimeVal::NullVal(NullVal {})
+            }),
+        ),
+        (
+            // `"line"` or `"block"`; see `Buffering`
+            "set_buffering",
+            internal_fn("set_buffering", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => mode
+                ];
+
+                let buffering = match &*mode.value {
+                    "line" => Buffering::Line,
+                    "block" => Buffering::Block,
+                    other => panic!(
+                        "Unknown buffering mode `{}`, expected `line` or `block`",
+                        other
+                    ),
+                };
+                flush_stdout();
+                stdout_sink().buffering = buffering;
+                RuntimeVal::NullVal(NullVal {})
+            }),
+        ),
+    ];
+    if sandboxed {
+        return object_val(items);
+    }
+
+    items.extend([
+        (
+            // The lines of a file as a lazy iterator, read a block at a time however large the file is
+            "lines",
+            internal_fn("lines", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => path
+                ];
+
+                let file = File::open(&*path.value)
+                    .unwrap_or_else(|err| panic!("Failed to open {}: {}", path.value, err));
+                RuntimeVal::IteratorVal(IteratorVal::lines(Rc::new(LineReader::new(
+                    BufReader::with_capacity(IO_BUFFER_SIZE, file),
+                ))))
+            }),
+        ),
+        (
+            "read",
+            internal_fn("read", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => path
+                ];
+
+                let contents = fs::read_to_string(&*path.value)
+                    .unwrap_or_else(|err| panic!("Failed to read {}: {}", path.value, err));
+                RuntimeVal::StringVal(StringVal {
+                    value: contents.into(),
+                })
+            }),
+        ),
+        (
+            // A buffered writer that truncates the file
+            "writer",
+            internal_fn("writer", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => path
+                ];
+
+                writer_val(
+                    &path.value,
+                    OpenOptions::new().write(true).create(true).truncate(true),
+                )
+            }),
+        ),
+        (
+            // A buffered writer that appends to the file
+            "appender",
+            internal_fn("appender", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => path
+                ];
+
+                writer_val(&path.value, OpenOptions::new().append(true).create(true))
+            }),
+        ),
+    ]);
+    object_val(items)
+}
+
+/// An object with `write`, `write_line` and `flush` functions sharing one buffered handle to `path`.
+fn writer_val(path: &str, options: &OpenOptions) -> RuntimeVal {
+    let file = options
+        .open(path)
+        .unwrap_or_else(|err| panic!("Failed to open {}: {}", path, err));
+    let writer: SharedWriter =
+        Rc::new(RefCell::new(BufWriter::with_capacity(IO_BUFFER_SIZE, file)));
+    OPEN_WRITERS.with(|writers| {
+        let mut writers = writers.borrow_mut();
+        writers.retain(|writer| writer.strong_count() > 0);
+        writers.push(Rc::downgrade(&writer));
+    });
+
+    let write = Rc::clone(&writer);
+    let write_line = Rc::clone(&writer);
+    object_val([
+        (
+            "write",
+            internal_fn("write", move |args, _env: Rc<RefCell<SourceEnv>>| {
+                write_file(&write, &args, "");
+                RuntimeVal::NullVal(NullVal {})
+            }),
+        ),
+        (
+            "write_line",
+            internal_fn("write_line", move |args, _env: Rc<RefCell<SourceEnv>>| {
+                write_file(&write_line, &args, "\n");
+                RuntimeVal::NullVal(NullVal {})
+            }),
+        ),
+        (
+            "flush",
+            internal_fn("flush", move |_args, _env: Rc<RefCell<SourceEnv>>| {
+                writer
+                    .borrow_mut()
+                    .flush()
+                    .unwrap_or_else(|err| panic!("Failed to flush file writer: {}", err));
+                RuntimeVal::NullVal(NullVal {})
+            }),
+        ),
+    ])
+}
+
+fn write_file(writer: &SharedWriter, values: &[RuntimeVal], end: &str) {
+    write_values(&mut *writer.borrow_mut(), values, end)
+        .unwrap_or_else(|err| panic!("Failed to write to file: {}", err));
+}
+
+/// Writes `values` separated by spaces, like `print`, followed by `end`. Strings are copied straight into the buffer.
+fn write_values(writer: &mut impl Write, values: &[RuntimeVal], end: &str) -> io::Result<()> {
+    for (i, value) in values.iter().enumerate() {
+        if i > 0 {
+            writer.write_all(b" ")?;
+        }
+        match value {
+            RuntimeVal::StringVal(s) => writer.write_all(s.value.as_bytes())?,
+            other => write!(writer, "{}", other)?,
+        }
+    }
+    writer.write_all(end.as_bytes())
+}
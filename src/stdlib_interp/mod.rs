@@ -1,10 +1,13 @@
 pub mod core;
 pub mod crypto;
 pub mod debug;
+pub mod http;
+pub mod io;
 pub mod network;
 pub mod process;
 pub mod rand;
 pub mod string;
+pub mod task;
 #[macro_use]
 pub mod helpers;
 
@@ -19,7 +22,7 @@ pub fn standard_library_values(sandboxed: bool) -> HashMap<String, RuntimeVal> {
     values.insert(
         "__VELVET_VERSION".to_string(),
         RuntimeVal::StringVal(StringVal {
-            value: env!("CARGO_PKG_VERSION").to_string(),
+            value: env!("CARGO_PKG_VERSION").into(),
         }),
     );
 
@@ -29,14 +32,17 @@ pub fn standard_library_values(sandboxed: bool) -> HashMap<String, RuntimeVal> {
     );
 
     values.insert("print".to_string(), core::print_fn());
+    values.insert("range".to_string(), core::range_fn());
     // values.insert("itypeof".to_string(), core::itypeof_fn());
 
     values.insert("string".to_string(), string::string_module());
     values.insert("debug".to_string(), debug::debug_module());
     values.insert("rand".to_string(), rand::rand_module());
     values.insert("process".to_string(), process::process_module());
-    values.insert("network".to_string(), network::network_module());
+    values.insert("io".to_string(), io::io_module(sandboxed));
+    values.insert("network".to_string(), network::network_module(sandboxed));
     values.insert("crypto".to_string(), crypto::crypto_module());
+    values.insert("task".to_string(), task::task_module());
 
     values
 }
@@ -1,18 +1,119 @@
 use std::cell::RefCell;
 use std::rc::Rc;
+use std::time::Duration;
 
 use crate::args;
 use crate::runtime::source_environment::source_environment::SourceEnv;
 use crate::runtime::values::*;
 use crate::stdlib_interp::helpers::{internal_fn, object_val};
+use crate::stdlib_interp::http::{self, Response};
 
-pub fn network_module() -> RuntimeVal {
-    object_val([(
-        "get",
-        internal_fn("get", |args, env: Rc<RefCell<SourceEnv>>| {
-            args![args;];
+/// How long a request may take, connecting included, unless the call asks otherwise.
+const DEFAULT_TIMEOUT_MS: isize = 30_000;
 
-            RuntimeVal::NullVal(NullVal {})
-        }),
-    )])
+/// Sandboxed programs get the module without its functions, as they cannot reach the network.
+pub fn network_module(sandboxed: bool) -> RuntimeVal {
+    if sandboxed {
+        return object_val(Vec::<(&str, RuntimeVal)>::new());
+    }
+
+    object_val([
+        (
+            // `get(url, timeout_ms?)` fetches one URL; see `response_val`
+            "get",
+            internal_fn("get", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => url,
+                    Option<NumberVal> => timeout_ms = NumberVal { value: DEFAULT_TIMEOUT_MS }
+                ];
+
+                let mut responses = http::get_many(&[&url.value], timeout(&timeout_ms));
+                response_val(responses.pop().unwrap())
+            }),
+        ),
+        (
+            // `get_many(urls, timeout_ms?)` fetches every URL at once, returning the responses in the same order.
+            // The timeout applies to each request from the time of the call.
+            "get_many",
+            internal_fn("get_many", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    ListVal => urls,
+                    Option<NumberVal> => timeout_ms = NumberVal { value: DEFAULT_TIMEOUT_MS }
+                ];
+
+                let urls: Vec<&str> = urls
+                    .values
+                    .iter()
+                    .map(|url| match url {
+                        RuntimeVal::StringVal(url) => &*url.value,
+                        other => {
+                            panic!("network.get_many expects a list of URLs, found {:?}", other)
+                        }
+                    })
+                    .collect();
+                let responses = http::get_many(&urls, timeout(&timeout_ms))
+                    .into_iter()
+                    .map(response_val)
+                    .collect();
+                RuntimeVal::ListVal(ListVal {
+                    values: Rc::new(responses),
+                })
+            }),
+        ),
+    ])
+}
+
+fn timeout(timeout_ms: &NumberVal) -> Duration {
+    Duration::from_millis(timeout_ms.value.max(0) as u64)
+}
+
+/// A response as `{ status, headers, body, error }`, with header names lowercased and `error` null. A request that
+/// got no response has status 0 and says why in `error`, so one failure among many leaves the rest readable.
+fn response_val(response: Result<Response, String>) -> RuntimeVal {
+    let (response, error) = match response {
+        Ok(response) => (response, RuntimeVal::NullVal(NullVal {})),
+        Err(err) => (
+            Response {
+                status: 0,
+                headers: Vec::new(),
+                body: Vec::new(),
+            },
+            RuntimeVal::StringVal(StringVal { value: err.into() }),
+        ),
+    };
+    // A repeated header keeps every value, joined as a single field would list them
+    let mut headers: Vec<(String, String)> = Vec::new();
+    for (name, value) in response.headers {
+        match headers.iter_mut().find(|(existing, _)| *existing == name) {
+            Some((_, joined)) => {
+                joined.push_str(", ");
+                joined.push_str(&value);
+            }
+            None => headers.push((name, value)),
+        }
+    }
+    let headers = headers.into_iter().map(|(name, value)| {
+        (
+            name,
+            RuntimeVal::StringVal(StringVal {
+                value: value.into(),
+            }),
+        )
+    });
+    object_val([
+        (
+            "status",
+            RuntimeVal::NumberVal(NumberVal {
+                value: response.status as isize,
+            }),
+        ),
+        ("headers", object_val(headers)),
+        (
+            "body",
+            RuntimeVal::StringVal(StringVal {
+                value: String::from_utf8_lossy(&response.body).into_owned().into(),
+            }),
+        ),
+        ("error", error),
+    ])
 }
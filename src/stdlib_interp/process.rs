@@ -1,10 +1,42 @@
 use std::cell::RefCell;
+use std::panic;
 use std::rc::Rc;
+use std::sync::atomic::{AtomicBool, Ordering};
 
 use crate::args;
 use crate::runtime::source_environment::source_environment::SourceEnv;
 use crate::runtime::values::*;
 use crate::stdlib_interp::helpers::{internal_fn, object_val};
+use crate::stdlib_interp::io::flush_output;
+
+/// Whether ending a program unwinds to whoever ran it instead of ending the process.
+static EXITS_CONTAINED: AtomicBool = AtomicBool::new(false);
+
+/// The panic payload a program unwinds with in place of ending the process, while exits are contained.
+#[derive(Debug, Clone)]
+pub struct ProgramExit {
+    pub code: i32,
+    /// The report of the runtime error that ended the program, if one did.
+    pub error: Option<String>,
+}
+
+/// Makes `exit_program` unwind with a `ProgramExit` rather than exit, for `serve`, which runs many programs in one
+/// process. The unwind skips the panic hook.
+pub fn contain_exits(contained: bool) {
+    EXITS_CONTAINED.store(contained, Ordering::Relaxed);
+}
+
+/// Ends the running program with `code`, printing `error` first if given. Output is flushed before the process exits.
+pub fn exit_program(code: i32, error: Option<String>) -> ! {
+    if EXITS_CONTAINED.load(Ordering::Relaxed) {
+        panic::resume_unwind(Box::new(ProgramExit { code, error }));
+    }
+    flush_output();
+    if let Some(error) = error {
+        println!("{}", error);
+    }
+    std::process::exit(code);
+}
 
 pub fn process_module() -> RuntimeVal {
     object_val([(
@@ -14,7 +46,7 @@ pub fn process_module() -> RuntimeVal {
                 Option<NumberVal> => exit_code = NumberVal { value: 0 }
             ];
 
-            std::process::exit(exit_code.value.try_into().unwrap());
+            exit_program(exit_code.value.try_into().unwrap(), None);
         }),
     )])
 }
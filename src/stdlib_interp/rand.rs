@@ -22,7 +22,8 @@ pub fn rand_module() -> RuntimeVal {
                 RuntimeVal::StringVal(StringVal {
                     value: rng
                         .random_range(min.value as usize..max.value as usize)
-                        .to_string(),
+                        .to_string()
+                        .into(),
                 })
             }),
         ),
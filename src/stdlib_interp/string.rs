@@ -2,30 +2,179 @@ use std::cell::RefCell;
 use std::rc::Rc;
 
 use crate::args;
+use crate::runtime::interpreter::report_runtime_error;
 use crate::runtime::source_environment::source_environment::SourceEnv;
+use crate::runtime::strings::{self, SharedStr};
 use crate::runtime::values::*;
 use crate::stdlib_interp::helpers::{internal_fn, object_val};
 
+fn string_val(value: SharedStr) -> RuntimeVal {
+    RuntimeVal::StringVal(StringVal { value })
+}
+
 pub fn string_module() -> RuntimeVal {
-    object_val([(
-        "split",
-        internal_fn("split", |args, env: Rc<RefCell<SourceEnv>>| {
-            args![args;
-                StringVal => input,
-                Option<StringVal> => delim = StringVal { value: ",".to_string() }
-            ];
-
-            let parts = input
-                .value
-                .split(&delim.value)
-                .map(|s| {
-                    RuntimeVal::StringVal(StringVal {
-                        value: s.to_string(),
+    object_val([
+        (
+            "split",
+            internal_fn("split", |args, env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => input,
+                    Option<StringVal> => delim = StringVal { value: ",".into() }
+                ];
+
+                // Pieces are slices of the input, not copies
+                let parts = input
+                    .value
+                    .split(&*delim.value)
+                    .map(|piece| {
+                        let start = piece.as_ptr() as usize - input.value.as_ptr() as usize;
+                        string_val(input.value.slice(start..start + piece.len()))
                     })
+                    .collect();
+
+                RuntimeVal::ListVal(ListVal {
+                    values: Rc::new(parts),
+                })
+            }),
+        ),
+        (
+            // `split` as a lazy iterator, producing each piece only when it is pulled
+            "split_iter",
+            internal_fn("split_iter", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => input,
+                    Option<StringVal> => delim = StringVal { value: ",".into() }
+                ];
+
+                RuntimeVal::IteratorVal(IteratorVal::split(input.value.clone(), delim.value))
+            }),
+        ),
+        (
+            // The strings of `list` with `separator` between them, written into one buffer of their total length
+            "join",
+            internal_fn("join", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    ListVal => list,
+                    Option<StringVal> => separator = StringVal { value: "".into() }
+                ];
+
+                let pieces: Vec<SharedStr> = list
+                    .values
+                    .iter()
+                    .map(|value| match value {
+                        RuntimeVal::StringVal(s) => s.value.clone(),
+                        // A runtime error ends only the script in `serve`, where a panic would take the server down
+                        other => report_runtime_error(
+                            format_args!(
+                                "string.join expected a list of strings, found {:?}",
+                                other
+                            ),
+                            &[],
+                        ),
+                    })
+                    .collect();
+                let separators = pieces.len().saturating_sub(1) * separator.value.len();
+                let mut joined = String::with_capacity(
+                    pieces.iter().map(|p| p.len()).sum::<usize>() + separators,
+                );
+                for (index, piece) in pieces.iter().enumerate() {
+                    if index > 0 {
+                        joined.push_str(&separator.value);
+                    }
+                    joined.push_str(piece);
+                }
+
+                string_val(joined.into())
+            }),
+        ),
+        (
+            // Every `from` in `input` replaced by `to`. A string without `from` is returned as is, sharing its buffer
+            "replace",
+            internal_fn("replace", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => input,
+                    StringVal => from,
+                    StringVal => to
+                ];
+
+                if from.value.is_empty() {
+                    return string_val(input.value.clone());
+                }
+                let Some(first) = strings::find(&input.value, &from.value) else {
+                    return string_val(input.value.clone());
+                };
+                let mut replaced = String::with_capacity(input.value.len());
+                let mut rest = 0;
+                let mut at = Some(first);
+                while let Some(offset) = at {
+                    let start = rest + offset;
+                    replaced.push_str(&input.value[rest..start]);
+                    replaced.push_str(&to.value);
+                    rest = start + from.value.len();
+                    at = strings::find(&input.value[rest..], &from.value);
+                }
+                replaced.push_str(&input.value[rest..]);
+
+                string_val(replaced.into())
+            }),
+        ),
+        (
+            // The character index of the first `needle` in `input`, as strings are indexed, or -1 without one
+            "find",
+            internal_fn("find", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => input,
+                    StringVal => needle
+                ];
+
+                let index = match strings::find(&input.value, &needle.value) {
+                    Some(at) => input.value[..at].chars().count() as isize,
+                    None => -1,
+                };
+                RuntimeVal::NumberVal(NumberVal { value: index })
+            }),
+        ),
+        (
+            "starts_with",
+            internal_fn("starts_with", |args, _env: Rc<RefCell<SourceEnv>>| {
+                args![args;
+                    StringVal => input,
+                    StringVal => prefix
+                ];
+
+                RuntimeVal::BoolVal(BoolVal {
+                    value: input.value.starts_with(&*prefix.value),
                 })
-                .collect();
+            }),
+        ),
+        (
+            // A string built up piece by piece. `append` writes into spare room of one growing buffer, and `finish`
+            // shares that buffer rather than copying it, so the builder can keep being appended to afterwards.
+            "builder",
+            internal_fn("builder", |_args, _env: Rc<RefCell<SourceEnv>>| {
+                let built = Rc::new(RefCell::new(SharedStr::from("")));
+                let appending = Rc::clone(&built);
+                object_val([
+                    (
+                        "append",
+                        internal_fn("append", move |args, _env: Rc<RefCell<SourceEnv>>| {
+                            args![args;
+                                StringVal => piece
+                            ];
 
-            RuntimeVal::ListVal(ListVal { values: parts })
-        }),
-    )])
+                            let appended = appending.borrow().concat(&piece.value);
+                            *appending.borrow_mut() = appended;
+                            RuntimeVal::NullVal(NullVal {})
+                        }),
+                    ),
+                    (
+                        "finish",
+                        internal_fn("finish", move |_args, _env: Rc<RefCell<SourceEnv>>| {
+                            string_val(built.borrow().clone())
+                        }),
+                    ),
+                ])
+            }),
+        ),
+    ])
 }
@@ -0,0 +1,492 @@
+use std::cell::{Cell, RefCell};
+use std::collections::VecDeque;
+use std::env;
+use std::panic::{self, AssertUnwindSafe};
+use std::rc::Rc;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard, OnceLock, PoisonError};
+use std::thread;
+use std::time::Duration;
+
+use crate::parser::nodetypes::Node;
+use crate::parser::parser::{ExecutionTechnique, Parser};
+use crate::runtime::interpreter::Interpreter;
+use crate::runtime::numeric::IntWidth;
+use crate::runtime::source_environment::source_environment::SourceEnv;
+use crate::runtime::values::*;
+use crate::stdlib_interp::helpers::{internal_fn, object_val};
+use crate::stdlib_interp::process::ProgramExit;
+
+/// Overrides the number of worker threads, which is otherwise the number of cores.
+const WORKERS_VAR: &str = "VELVET_WORKERS";
+
+/// Worker threads run deeply recursive programs as readily as the main thread does.
+const WORKER_STACK_SIZE: usize = 64 * 1024 * 1024;
+
+/// The program whose functions tasks run. Syntax trees and values are built on `Rc` and cannot cross threads, so
+/// every worker parses the source itself and defines the program's top-level functions in an environment of its own.
+pub struct TaskProgram {
+    source: String,
+    inject_stdlib_snippets: bool,
+    sandboxed: bool,
+}
+
+/// A value copied out of one thread's heap so it can be rebuilt in another's. Functions and iterators hold
+/// environments and syntax trees, and so have no such copy.
+#[derive(Debug, Clone)]
+enum Sendable {
+    Null,
+    Number(isize),
+    Integer(i128, IntWidth),
+    Float(f64),
+    Bool(bool),
+    String(Box<str>),
+    List(Vec<Sendable>),
+    Numbers(Vec<isize>),
+    Object(Vec<(Box<str>, Sendable)>),
+}
+
+impl Sendable {
+    fn from_value(value: &RuntimeVal) -> Result<Self, String> {
+        Ok(match value {
+            RuntimeVal::NullVal(_) => Self::Null,
+            RuntimeVal::NumberVal(n) => Self::Number(n.value),
+            RuntimeVal::IntegerVal(i) => Self::Integer(i.value, i.width),
+            RuntimeVal::FloatVal(f) => Self::Float(f.value),
+            RuntimeVal::BoolVal(b) => Self::Bool(b.value),
+            RuntimeVal::StringVal(s) => Self::String((*s.value).into()),
+            RuntimeVal::ListVal(list) => Self::List(
+                list.values
+                    .iter()
+                    .map(Self::from_value)
+                    .collect::<Result<_, _>>()?,
+            ),
+            RuntimeVal::NumberArrayVal(array) => Self::Numbers(array.values.to_vec()),
+            RuntimeVal::ObjectVal(object) => Self::Object(
+                object
+                    .iter()
+                    .map(|(key, value)| Ok((key.as_ref().into(), Self::from_value(value)?)))
+                    .collect::<Result<_, String>>()?,
+            ),
+            RuntimeVal::ReturnVal(ret) => Self::from_value(&ret.value)?,
+            other => {
+                return Err(format!(
+                    "Only numbers, strings, bools, null, lists and objects can be passed between tasks, found {:?}",
+                    other
+                ));
+            }
+        })
+    }
+
+    fn into_value(self) -> RuntimeVal {
+        match self {
+            Self::Null => RuntimeVal::NullVal(NullVal {}),
+            Self::Number(value) => RuntimeVal::NumberVal(NumberVal { value }),
+            Self::Integer(value, width) => RuntimeVal::IntegerVal(IntegerVal { value, width }),
+            Self::Float(value) => RuntimeVal::FloatVal(FloatVal { value }),
+            Self::Bool(value) => RuntimeVal::BoolVal(BoolVal { value }),
+            Self::String(value) => RuntimeVal::StringVal(StringVal {
+                value: String::from(value).into(),
+            }),
+            Self::List(values) => RuntimeVal::ListVal(ListVal {
+                values: Rc::new(values.into_iter().map(Self::into_value).collect()),
+            }),
+            Self::Numbers(values) => RuntimeVal::NumberArrayVal(NumberArrayVal {
+                values: Rc::new(values),
+            }),
+            Self::Object(fields) => RuntimeVal::ObjectVal(ObjectVal::new(
+                fields
+                    .into_iter()
+                    .map(|(key, value)| (Rc::<str>::from(key), value.into_value())),
+            )),
+        }
+    }
+}
+
+/// A top-level function of the program, by name. The id of its definition, when there is one, makes sure a worker
+/// calls the same definition and not one that shadows it.
+#[derive(Debug, Clone)]
+struct TaskFunction {
+    name: String,
+    definition_id: Option<usize>,
+}
+
+impl TaskFunction {
+    fn from_value(value: &RuntimeVal) -> Self {
+        match value {
+            RuntimeVal::FunctionVal(function) => Self {
+                name: function.fn_name.to_string(),
+                definition_id: function.definition_id,
+            },
+            RuntimeVal::BytecodeFunctionVal(function) => Self {
+                name: function.proto.name.clone(),
+                definition_id: None,
+            },
+            other => panic!(
+                "Tasks run functions defined in the program, found {:?}",
+                other
+            ),
+        }
+    }
+}
+
+type Job = Box<dyn FnOnce() + Send>;
+
+/// A work-stealing thread pool with one worker per core. Each worker keeps its own deque of jobs: the jobs it spawns
+/// go on the back, where it also takes its next job from, so nested tasks run depth first and stay in its cache.
+/// Workers that run out steal from the front of the others' deques, taking the oldest (and usually largest) work.
+struct Pool {
+    queues: Box<[Mutex<VecDeque<Job>>]>,
+    /// Jobs spawned by threads outside the pool.
+    injector: Mutex<VecDeque<Job>>,
+    /// Jobs pushed and not yet taken, so idle workers only sleep when there is nothing to steal.
+    queued: AtomicUsize,
+    sleep: Mutex<()>,
+    wake: Condvar,
+}
+
+static POOL: OnceLock<Pool> = OnceLock::new();
+
+thread_local! {
+    /// The program tasks spawned from this thread belong to; a worker takes on the program of the job it runs.
+    static PROGRAM: RefCell<Option<Arc<TaskProgram>>> = const { RefCell::new(None) };
+    /// The index of this thread's deque, on the pool's threads.
+    static WORKER_INDEX: Cell<Option<usize>> = const { Cell::new(None) };
+    /// The interpreter this worker last ran tasks with, kept for the next task of the same program.
+    static RUNTIME: RefCell<Option<WorkerRuntime>> = const { RefCell::new(None) };
+}
+
+/// Jobs hold nothing a panic could leave inconsistent for others, so a poisoned lock is still usable.
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+fn pool() -> &'static Pool {
+    let mut started = false;
+    let pool = POOL.get_or_init(|| {
+        started = true;
+        let workers = env::var(WORKERS_VAR)
+            .ok()
+            .map(|workers| match workers.parse::<usize>() {
+                Ok(workers) if workers > 0 => workers,
+                _ => panic!(
+                    "`{}` expects a positive number, found `{}`",
+                    WORKERS_VAR, workers
+                ),
+            })
+            .unwrap_or_else(|| thread::available_parallelism().map_or(1, |n| n.get()));
+        Pool {
+            queues: (0..workers).map(|_| Mutex::new(VecDeque::new())).collect(),
+            injector: Mutex::new(VecDeque::new()),
+            queued: AtomicUsize::new(0),
+            sleep: Mutex::new(()),
+            wake: Condvar::new(),
+        }
+    });
+    if started {
+        for index in 0..pool.queues.len() {
+            thread::Builder::new()
+                .name(format!("velvet-worker-{}", index))
+                .stack_size(WORKER_STACK_SIZE)
+                .spawn(move || pool.work(index))
+                .expect("Failed to start a task worker thread");
+        }
+    }
+    pool
+}
+
+impl Pool {
+    fn push(&self, job: Job) {
+        // Counted first, so a worker never takes a job that is not counted yet
+        self.queued.fetch_add(1, Ordering::SeqCst);
+        match WORKER_INDEX.get() {
+            Some(index) => lock(&self.queues[index]).push_back(job),
+            None => lock(&self.injector).push_back(job),
+        }
+        let _sleep = lock(&self.sleep);
+        self.wake.notify_one();
+    }
+
+    /// The next job for the worker `index` (or for a thread outside the pool): its own newest, then the oldest
+    /// spawned from outside, then the oldest of another worker.
+    fn find_job(&self, index: Option<usize>) -> Option<Job> {
+        let own = index.and_then(|index| lock(&self.queues[index]).pop_back());
+        let job = own
+            .or_else(|| lock(&self.injector).pop_front())
+            .or_else(|| {
+                let start = index.map_or(0, |index| index + 1);
+                (0..self.queues.len())
+                    .map(|offset| (start + offset) % self.queues.len())
+                    .filter(|&victim| Some(victim) != index)
+                    .find_map(|victim| lock(&self.queues[victim]).pop_front())
+            })?;
+        self.queued.fetch_sub(1, Ordering::SeqCst);
+        Some(job)
+    }
+
+    fn work(&self, index: usize) {
+        WORKER_INDEX.set(Some(index));
+        loop {
+            match self.find_job(Some(index)) {
+                Some(job) => job(),
+                None => {
+                    let sleep = lock(&self.sleep);
+                    if self.queued.load(Ordering::SeqCst) == 0 {
+                        drop(self.wake.wait(sleep));
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// Where a spawned job leaves its results.
+struct TaskResult {
+    outcome: Mutex<Option<Result<Vec<Sendable>, String>>>,
+    done: Condvar,
+}
+
+impl TaskResult {
+    /// Waits for the job to finish and takes its results. A worker runs other jobs meanwhile instead of blocking, so
+    /// tasks that wait on tasks of their own cannot tie up every worker.
+    fn take(&self) -> Result<Vec<Sendable>, String> {
+        let worker = WORKER_INDEX.get();
+        loop {
+            let mut outcome = lock(&self.outcome);
+            if let Some(outcome) = outcome.take() {
+                return outcome;
+            }
+            if worker.is_none() {
+                drop(self.done.wait(outcome));
+                continue;
+            }
+            drop(outcome);
+            match pool().find_job(worker) {
+                Some(job) => job(),
+                // The job is running elsewhere; check back shortly in case it spawns work we could help with
+                None => {
+                    let outcome = lock(&self.outcome);
+                    if outcome.is_none() {
+                        drop(self.done.wait_timeout(outcome, Duration::from_millis(1)));
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// Queues a job calling `function` once for each argument list of `calls`, in order.
+fn spawn(function: TaskFunction, calls: Vec<Vec<Sendable>>) -> Arc<TaskResult> {
+    let program = PROGRAM
+        .with_borrow(Option::clone)
+        .unwrap_or_else(|| panic!("Tasks can only be spawned by a program run from a source file"));
+    let result = Arc::new(TaskResult {
+        outcome: Mutex::new(None),
+        done: Condvar::new(),
+    });
+    let job_result = Arc::clone(&result);
+    pool().push(Box::new(move || {
+        let outcome = run_calls(&program, &function, calls);
+        *lock(&job_result.outcome) = Some(outcome);
+        job_result.done.notify_all();
+    }));
+    result
+}
+
+/// The interpreter of a worker thread, with the top-level functions of `program` defined in `env`.
+struct WorkerRuntime {
+    program: Arc<TaskProgram>,
+    interpreter: Interpreter,
+    env: Rc<RefCell<SourceEnv>>,
+}
+
+impl WorkerRuntime {
+    fn new(program: Arc<TaskProgram>) -> Self {
+        let mut ast = Parser::new(
+            &program.source,
+            program.inject_stdlib_snippets,
+            ExecutionTechnique::Interpretation,
+        )
+        .produce_ast();
+        ast.fold_constants();
+        let definitions: Vec<Node> = ast
+            .nodes
+            .into_iter()
+            .filter(|node| matches!(node, Node::FunctionDefinition(_)))
+            .collect();
+        let env = SourceEnv::create_global(program.sandboxed);
+        let mut interpreter = Interpreter::new(definitions);
+        interpreter.evaluate_body(Rc::clone(&env));
+        Self {
+            program,
+            interpreter,
+            env,
+        }
+    }
+
+    fn call(&mut self, function: &TaskFunction, args: Vec<Sendable>) -> Result<Sendable, String> {
+        let callee = self
+            .env
+            .borrow()
+            .fetch(&function.name)
+            .map(|binding| binding.value);
+        let callee = match callee {
+            Some(RuntimeVal::FunctionVal(callee))
+                if function.definition_id.is_none()
+                    || callee.definition_id == function.definition_id =>
+            {
+                RuntimeVal::FunctionVal(callee)
+            }
+            _ => {
+                return Err(format!(
+                    "`{}` is not a function defined at the top level of the program, so tasks cannot run it",
+                    function.name
+                ));
+            }
+        };
+        let args = args.into_iter().map(Sendable::into_value).collect();
+        let result = self.interpreter.call_function(&callee, args, &self.env);
+        Sendable::from_value(&result)
+    }
+}
+
+/// Runs the calls of a job on this thread, reusing its interpreter when it last ran the same program. The
+/// interpreter is taken out for the duration, so a job run while this one waits on a task builds its own.
+fn run_calls(
+    program: &Arc<TaskProgram>,
+    function: &TaskFunction,
+    calls: Vec<Vec<Sendable>>,
+) -> Result<Vec<Sendable>, String> {
+    PROGRAM.set(Some(Arc::clone(program)));
+    let outcome = panic::catch_unwind(AssertUnwindSafe(|| {
+        let mut runtime = RUNTIME
+            .take()
+            .filter(|runtime| Arc::ptr_eq(&runtime.program, program))
+            .unwrap_or_else(|| WorkerRuntime::new(Arc::clone(program)));
+        let results = calls
+            .into_iter()
+            .map(|args| runtime.call(function, args))
+            .collect::<Result<Vec<_>, _>>();
+        (runtime, results)
+    }));
+    match outcome {
+        Ok((runtime, results)) => {
+            RUNTIME.set(Some(runtime));
+            results
+        }
+        // A panic can leave the interpreter mid-call, so it is not reused
+        Err(payload) => Err(payload
+            .downcast_ref::<String>()
+            .cloned()
+            .or_else(|| payload.downcast_ref::<&str>().map(|s| s.to_string()))
+            .or_else(|| {
+                let exit = payload.downcast_ref::<ProgramExit>()?;
+                Some(
+                    exit.error
+                        .clone()
+                        .unwrap_or_else(|| format!("task exited with code {}", exit.code)),
+                )
+            })
+            .unwrap_or_else(|| String::from("task panicked"))),
+    }
+}
+
+/// Makes the program's functions available to tasks. Called once the program is known to parse and typecheck.
+pub fn set_program(source: &str, inject_stdlib_snippets: bool, sandboxed: bool) {
+    PROGRAM.set(Some(Arc::new(TaskProgram {
+        source: source.to_string(),
+        inject_stdlib_snippets,
+        sandboxed,
+    })));
+}
+
+fn to_sendable(value: &RuntimeVal) -> Sendable {
+    Sendable::from_value(value).unwrap_or_else(|err| panic!("{}", err))
+}
+
+fn join(result: &TaskResult) -> Vec<RuntimeVal> {
+    result
+        .take()
+        .unwrap_or_else(|err| panic!("Task failed: {}", err))
+        .into_iter()
+        .map(Sendable::into_value)
+        .collect()
+}
+
+/// Tasks call top-level functions of the program on a pool of worker threads, one per core. Arguments and results
+/// are copied between threads, and a task sees the program's functions but none of its other bindings.
+pub fn task_module() -> RuntimeVal {
+    object_val([
+        (
+            "workers",
+            internal_fn("workers", |_args, _env: Rc<RefCell<SourceEnv>>| {
+                RuntimeVal::NumberVal(NumberVal {
+                    value: pool().queues.len() as isize,
+                })
+            }),
+        ),
+        (
+            // `spawn(function, args...)` starts calling `function` and returns a handle whose `join()` waits for
+            // the result
+            "spawn",
+            internal_fn("spawn", |args, _env: Rc<RefCell<SourceEnv>>| {
+                let Some((function, args)) = args.split_first() else {
+                    panic!("Argument `function` is missing");
+                };
+                let result = spawn(
+                    TaskFunction::from_value(function),
+                    vec![args.iter().map(to_sendable).collect()],
+                );
+                // The first join takes the result; later ones return it again
+                let joined = RefCell::new(None);
+                object_val([(
+                    "join",
+                    internal_fn("join", move |_args, _env: Rc<RefCell<SourceEnv>>| {
+                        joined
+                            .borrow_mut()
+                            .get_or_insert_with(|| join(&result).pop().unwrap())
+                            .clone()
+                    }),
+                )])
+            }),
+        ),
+        (
+            // `map(list, function)` calls `function` on every element in parallel and returns the results in order
+            "map",
+            internal_fn("map", |args, _env: Rc<RefCell<SourceEnv>>| {
+                let (Some(list), Some(function)) = (args.first(), args.get(1)) else {
+                    panic!("task.map expects a list and a function");
+                };
+                let elements: Vec<Sendable> = match to_sendable(list) {
+                    Sendable::List(elements) => elements,
+                    Sendable::Numbers(numbers) => {
+                        numbers.into_iter().map(Sendable::Number).collect()
+                    }
+                    _ => panic!("task.map expects a list, found {:?}", list),
+                };
+                let function = TaskFunction::from_value(function);
+
+                // A few chunks per worker, so workers that finish early have something left to steal
+                let chunks = (pool().queues.len() * 4).min(elements.len()).max(1);
+                let chunk_size = elements.len().div_ceil(chunks).max(1);
+                let mut elements = elements.into_iter();
+                let mut results = Vec::new();
+                loop {
+                    let calls: Vec<Vec<Sendable>> = elements
+                        .by_ref()
+                        .take(chunk_size)
+                        .map(|e| vec![e])
+                        .collect();
+                    if calls.is_empty() {
+                        break;
+                    }
+                    results.push(spawn(function.clone(), calls));
+                }
+                let values: Vec<RuntimeVal> = results.iter().flat_map(|r| join(r)).collect();
+                RuntimeVal::ListVal(ListVal {
+                    values: Rc::new(values),
+                })
+            }),
+        ),
+    ])
+}
@@ -3,3 +3,4 @@ pub mod test_interpreter;
 pub mod test_parser;
 pub mod test_tokenizer;
 pub mod test_typechecker;
+pub mod test_vm;
@@ -4,4 +4,20 @@
 #[test]
 fn intermediate_all_nodes_can_be_serialized() {
     
-}
\ No newline at end of file
+}
+
+#[test]
+fn intermediate_compile_cache_keys() {
+    use crate::codegen::cache::CompileCache;
+
+    let cwd = std::env::current_dir().unwrap();
+    let key = |source: &str, do_coerce: bool, snippets: bool| {
+        CompileCache::new(source, do_coerce, snippets, "O3", &[], &cwd).key
+    };
+
+    let source = "bind a as i32 = 1";
+    assert_eq!(key(source, false, true), key(source, false, true));
+    assert_ne!(key(source, false, true), key("bind a as i32 = 2", false, true));
+    assert_ne!(key(source, false, true), key(source, true, true));
+    assert_ne!(key(source, false, true), key(source, false, false));
+}
@@ -149,16 +149,16 @@ fn test_interpreter_objectval() {
     match res {
         RuntimeVal::ObjectVal(obj) => {
             assert_eq!(obj.values.len(), 2);
-            assert!(obj.values.get("a").is_some());
-            match obj.values.get("a").unwrap() {
+            assert!(obj.get("a").is_some());
+            match obj.get("a").unwrap() {
                 RuntimeVal::ObjectVal(obj2) => {
                     assert_eq!(obj2.values.len(), 1);
-                    assert!(obj2.values.get("sub_object").is_some())
+                    assert!(obj2.get("sub_object").is_some())
                 }
                 _ => panic!("Incorrect transformation for sub-object: expected ObjectVal"),
             }
-            assert!(obj.values.get("b").is_some());
-            match obj.values.get("b").unwrap() {
+            assert!(obj.get("b").is_some());
+            match obj.get("b").unwrap() {
                 RuntimeVal::NumberVal(num) => {
                     assert_eq!(num.value, 10);
                 }
@@ -168,3 +168,444 @@ fn test_interpreter_objectval() {
         _ => panic!("Incorrect transformation: expected ObjectVal"),
     }
 }
+
+/**
+ * Resolved bindings
+ */
+
+#[test]
+fn test_resolved_bindings_keep_dynamic_scope() {
+    let res = *quick_setup(
+        "bind x as number = 1\n-> read_x() => number { ; x }\n-> shadow() => number {\n  bind x as number = 5\n  ; read_x()\n}\n[read_x(), shadow()]",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(format!("{:?}", list.values), "[1, 5]");
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_resolved_binding_skipped_declaration() {
+    let res = *quick_setup(
+        "bindm x as number = 1\n-> cond(c as number) => number {\n  if c == 1 {\n    bindm x as number = 9\n  }\n  x = x + 1\n  ; x\n}\n[cond(1), cond(0), x]",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(format!("{:?}", list.values), "[10, 2, 2]");
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_list_copy_on_write() {
+    let res = *quick_setup(
+        "bindm a as inferred = [1]\nbindm b as inferred = a\nb.push(2)\n-> grow(l as inferred) => inferred {\n  bindm local as inferred = l\n  local.push(3)\n  ; local\n}\nbind grown as inferred = grow(b)\n[a.len(), b.len(), grown.len(), b.len()]",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(format!("{:?}", list.values), "[1, 2, 3, 2]");
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_list_methods() {
+    let res = *quick_setup(
+        "bindm xs as inferred = [5, 3, 8]\nbind last as number = xs.pop()\nxs.insert(0, last)\nxs.push(1)\nxs.sort()\n-> dbl(v as number) => number { ; v * 2 }\n-> big(v as number) => bool { ; v > 4 }\n-> add(a as number, b as number) => number { ; a + b }\nbind mapped as inferred = xs.map(dbl)\nbind kept as inferred = xs.filter(big)\n[xs, xs.slice(1, 3), mapped, kept, xs.reduce(add, 0)]",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(
+                format!("{:?}", list.values),
+                "[[1, 3, 5, 8], [3, 5], [2, 6, 10, 16], [5, 8], 17]"
+            );
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_profiler_counts_calls_and_nodes() {
+    let mut interp = Interpreter::new(
+        Parser::new(
+            "-> fib(n as number) => number {\n  if n < 2 {\n    ; n\n  }\n  ; fib(n - 1) + fib(n - 2)\n}\nfib(10)",
+            false,
+            ExecutionTechnique::Interpretation,
+        )
+        .produce_ast()
+        .nodes,
+    );
+    interp.enable_profiling();
+    interp.evaluate_body(SourceEnv::create_global(false));
+
+    let profiler = interp.profiler().unwrap();
+    let fib = profiler.function("fib").unwrap();
+    assert_eq!(fib.calls, 177);
+    assert!(fib.exclusive <= fib.inclusive);
+    let program = profiler.function("<program>").unwrap();
+    assert!(fib.inclusive <= program.inclusive);
+    assert_eq!(profiler.node_kind("IfStmt").unwrap().calls, 177);
+}
+
+#[test]
+fn test_call_stack_renders_bound_arguments() {
+    let res = *quick_setup(
+        "-> inner(a as number, s as string) => string {\n  ; __CALL_STACK\n}\n-> outer(n as number) => string {\n  if n > 0 {\n    ; '' + outer(n - 1)\n  }\n  ; inner(5, 'hi')\n}\nouter(150)",
+    );
+
+    match res {
+        RuntimeVal::StringVal(stack) => {
+            assert!(stack.value.contains("→   inner(a = 5, s = \"hi\")"));
+            assert!(stack.value.contains("→   outer(n = 150)"));
+            // Deep recursion no longer drops the oldest entries
+            assert!(stack.value.contains("% velvet::entry_point::evaluate_body(...)"));
+        }
+        _ => panic!("Expected StringVal"),
+    }
+}
+
+#[test]
+fn test_self_tail_calls_run_in_constant_stack() {
+    let res = *quick_setup(
+        "-> count(n as number, acc as number) => number {\n  if n == 0 {\n    ; acc\n  }\n  ; count(n - 1, acc + 2)\n}\ncount(200000, 0)",
+    );
+
+    match res {
+        RuntimeVal::NumberVal(nv) => assert_eq!(nv.value, 400000),
+        _ => panic!("Expected NumberVal"),
+    }
+}
+
+#[test]
+fn test_tail_calls_keep_dynamically_visible_frames() {
+    // `seen` is declared at one depth of the recursion and read, by name, by a helper called further down it
+    let res = *quick_setup(
+        "-> helper(n as number) => number {\n  ; seen + n\n}\n-> walk(n as number) => number {\n  if n == 3 {\n    bind seen as number = 40\n  }\n  if n == 0 {\n    ; helper(2)\n  }\n  ; walk(n - 1)\n}\nwalk(5)",
+    );
+
+    match res {
+        RuntimeVal::NumberVal(nv) => assert_eq!(nv.value, 42),
+        _ => panic!("Expected NumberVal"),
+    }
+}
+
+#[test]
+fn test_return_leaves_if_and_while_bodies() {
+    let res = *quick_setup(
+        "-> first_over(limit as number) => number {\n  bindm i as number = 0\n  while i < 100 do {\n    i = i + 1\n    if i > limit {\n      ; i\n      i = 1000\n    }\n  }\n  ; 0 - 1\n}\nfirst_over(41)",
+    );
+
+    match res {
+        RuntimeVal::NumberVal(nv) => assert_eq!(nv.value, 42),
+        _ => panic!("Expected NumberVal"),
+    }
+}
+
+#[test]
+fn test_float_and_sized_integer_arithmetic() {
+    let res = *quick_setup(
+        "bind half as f64 = 0.5\nbind whole as f64 = 3\nbind small as i8 = 120\nbind wide as i64 = 3000000000\n-> scale(x as f64) => f64 { ; x * 4 }\n[half + whole, whole / 2, scale(2), small + 10, wide * 4, 1 / 3.0]",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(
+                format!("{:?}", list.values),
+                "[3.5, 1.5, 8.0, -126, 12000000000, 0.3333333333333333]"
+            );
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_numeric_casts() {
+    let res = *quick_setup("[2.9@i32, 300@i8, 7@f64, 1.5@f64, 4294967297@i32]");
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(format!("{:?}", list.values), "[2, 44, 7.0, 1.5, 1]");
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_number_array_kernels() {
+    let res = *quick_setup(
+        "bind xs as number[] = [3, 1, 4, 1, 5]\nbind ys as number[] = [2, 2, 2, 2, 2]\nbind empty as number[] = []\n-> double(x as number) => number { ; x * 2 }\n-> label(x as number) => string { ; \"n\" }\n[xs.sum(), xs.min(), xs.max(), xs.dot(ys), xs.add(ys), xs.mul(3), xs.map(double), xs.map(label), empty.min(), xs[2]]",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(
+                format!("{:?}", list.values),
+                "[14, 1, 5, 28, [5, 3, 6, 3, 7], [9, 3, 12, 3, 15], [6, 2, 8, 2, 10], [n, n, n, n, n], null, 4]"
+            );
+            assert!(matches!(list.values[6], RuntimeVal::NumberArrayVal(_)));
+            assert!(matches!(list.values[7], RuntimeVal::ListVal(_)));
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_loop_iterations_get_fresh_scopes() {
+    let res = *quick_setup(
+        "bindm out as inferred = []\n-> twice(v as number) => number { bind d as number = v * 2\n; d }\nbindm i as number = 0\nwhile i < 3 do { bind sq as number = i * i\nfor x of [sq, i] do { bind y as number = twice(x)\nout.push(y) }\ni = i + 1 }\nout",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(format!("{:?}", list.values), "[0, 0, 2, 2, 8, 4]");
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_lazy_iterators() {
+    let res = *quick_setup(
+        "bindm total as number = 0\nfor i of range(0, 1000) do { total = total + i }\n-> sq(x as number) => number { ; x * x }\n-> odd(x as number) => bool { ; x > x / 2 * 2 }\nbind numbers as inferred = range(100)\nbind odds as inferred = numbers.filter(odd)\nbind squares as inferred = odds.map(sq)\nbind firsts as inferred = squares.take(3)\nbind down as inferred = range(5, 0, 0 - 2)\nbind pieces as inferred = string.split_iter(\"a,b,,c\")\n[total, firsts.collect(), down.collect(), pieces.collect(), numbers]",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(
+                format!("{:?}", list.values),
+                "[499500, [1, 9, 25], [5, 3, 1], [a, b, , c], <iterator range>]"
+            );
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_string_module_bulk_operations() {
+    use crate::runtime::strings::{self, SharedStr};
+
+    let res = *quick_setup(
+        "bindm s as string = \"\"\nfor i of range(0, 5) do { s = s + \"ab\" }\nbind b as inferred = string.builder()\nb.append(\"x\")\nb.append(\"yz\")\nbind built as string = b.finish()\nb.append(\"!\")\n[s, string.join([\"a\", \"b\", \"c\"], \", \"), string.replace(\"one two two\", \"two\", \"2\"), string.find(\"héllo world\", \"world\"), string.find(\"abc\", \"d\"), string.starts_with(s, \"aba\"), built, b.finish()]",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(
+                format!("{:?}", list.values),
+                "[\"ababababab\", \"a, b, c\", \"one 2 2\", 6, -1, true, \"xyz\", \"xyz!\"]"
+            );
+        }
+        _ => panic!("Expected ListVal"),
+    }
+
+    // Concatenating onto the end of a buffer appends in place, without disturbing strings that share it
+    let ab = SharedStr::from("a").concat("b");
+    let abc = ab.concat("c");
+    let abd = ab.concat("d");
+    assert_eq!((&*ab, &*abc, &*abd), ("ab", "abc", "abd"));
+    assert_eq!(&*abc.slice(1..3), "bc");
+
+    let haystack = "the quick brown fox jumps over the lazy dog";
+    for needle in ["the", "dog", "fox j", "g", "cat", "", haystack] {
+        assert_eq!(strings::find(haystack, needle), haystack.find(needle), "{}", needle);
+    }
+}
+
+#[test]
+fn test_io_file_lines() {
+    let path = std::env::temp_dir().join("velvet_test_io_file_lines.txt");
+    let path = path.to_str().unwrap();
+    let res = *quick_setup(&format!(
+        "bind w as inferred = io.writer(\"{path}\")\nfor i of range(3) do {{ w.write_line(\"row\", i) }}\nw.write(\"last\")\nw.flush()\nbindm rows as number = 0\nfor line of io.lines(\"{path}\") do {{ rows = rows + 1 }}\nbind lines as inferred = io.lines(\"{path}\")\nbind firsts as inferred = lines.take(2)\n[rows, firsts.collect(), io.read(\"{path}\")]"
+    ));
+    std::fs::remove_file(path).unwrap();
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            assert_eq!(
+                format!("{:?}", list.values),
+                "[4, [row 0, row 1], \"row 0\nrow 1\nrow 2\nlast\"]"
+            );
+        }
+        _ => panic!("Expected ListVal"),
+    }
+}
+
+#[test]
+fn test_objects_share_shapes() {
+    let res = *quick_setup(
+        "-> point(px as number, py as number) => inferred { ; { x: px, y: py } }\n[point(1, 2), { y: 4, x: 3 }, { x: 5 }]",
+    );
+
+    match res {
+        RuntimeVal::ListVal(list) => {
+            let shape_of = |value: &RuntimeVal| match value {
+                RuntimeVal::ObjectVal(obj) => Rc::clone(&obj.shape),
+                _ => panic!("Expected ObjectVal"),
+            };
+            assert!(Rc::ptr_eq(&shape_of(&list.values[0]), &shape_of(&list.values[1])));
+            assert!(!Rc::ptr_eq(&shape_of(&list.values[0]), &shape_of(&list.values[2])));
+            match &list.values[1] {
+                RuntimeVal::ObjectVal(obj) => {
+                    assert_eq!(format!("{:?}", obj.values), "[3, 4]");
+                    assert_eq!(format!("{:?}", obj.get("y")), "Some(4)");
+                }
+                _ => panic!("Expected ObjectVal"),
+            }
+        }
+        _ => panic!("Expected ListVal"),
+    }
+
+    // Shapes are freed with the last object holding them, so programs run one after another don't accumulate them
+    let before = crate::runtime::shapes::Shape::interned_count();
+    for run in 0..3 {
+        quick_setup(&format!("[{{ only_in_run_{}: 1 }}, {{ a: 1, b: 2 }}]", run));
+    }
+    assert_eq!(crate::runtime::shapes::Shape::interned_count(), before);
+}
+
+#[test]
+fn test_match_dispatch_keeps_arm_order() {
+    let res = *quick_setup(
+        "bindm seen as inferred = []\n-> watch(n as number) => bool { seen.push(n)\n; false }\nbind a as inferred = match 2 { 1 => \"one\", watch => \"watched\", 2 => \"two\", watch => \"late\", 3 => \"three\" }\nbind b as inferred = match 4 { 1 => \"one\", watch => \"watched\", 2 => \"two\" }\nbind result as inferred = [a, b, seen]\nresult",
+    );
+
+    assert_eq!(format!("{:?}", res), "[two, null, [2, 4]]");
+}
+
+#[test]
+fn test_task_map_and_spawn() {
+    use crate::stdlib_interp::task;
+
+    let source = "-> sq(n as number) => number { ; n * n }\n-> sums(n as number) => number { bind parts as inferred = task.map([1, 2, n], sq)\nbindm total as number = 0\nfor p of parts do { total = total + p }\n; total }\nbind handle as inferred = task.spawn(sums, 10)\nbind mapped as inferred = task.map([3, 4, 5], sums)\nbind result as inferred = [mapped, handle.join(), handle.join()]\nresult";
+    task::set_program(source, false, false);
+    let res = *quick_setup(source);
+
+    assert_eq!(format!("{:?}", res), "[[14, 21, 30], 105, 105]");
+}
+
+#[test]
+fn test_network_get_and_get_many() {
+    use std::io::{Read, Write};
+    use std::net::TcpListener;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    use std::sync::Arc;
+
+    // A keep-alive server answering `/length` with a sized body and `/chunked` with a chunked one
+    let listener = TcpListener::bind("127.0.0.1:0").unwrap();
+    let port = listener.local_addr().unwrap().port();
+    let accepted = Arc::new(AtomicUsize::new(0));
+    let counter = Arc::clone(&accepted);
+    std::thread::spawn(move || {
+        for stream in listener.incoming() {
+            let mut stream = stream.unwrap();
+            counter.fetch_add(1, Ordering::SeqCst);
+            std::thread::spawn(move || {
+                let mut request = Vec::new();
+                let mut buffer = [0; 1024];
+                while let Ok(n) = stream.read(&mut buffer) {
+                    if n == 0 {
+                        break;
+                    }
+                    request.extend_from_slice(&buffer[..n]);
+                    while let Some(end) = request.windows(4).position(|w| w == b"\r\n\r\n") {
+                        let head = String::from_utf8_lossy(&request[..end]).to_string();
+                        request.drain(..end + 4);
+                        let response: &[u8] = if head.starts_with("GET /chunked ") {
+                            b"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nwor\r\n2\r\nld\r\n0\r\n\r\n"
+                        } else {
+                            b"HTTP/1.1 201 Created\r\nContent-Length: 5\r\nX-Test: a\r\nX-Test: b\r\n\r\nhello"
+                        };
+                        stream.write_all(response).unwrap();
+                    }
+                }
+            });
+        }
+    });
+
+    let source = format!(
+        "bind one as inferred = network.get(\"http://127.0.0.1:{port}/length\")\nbind again as inferred = network.get(\"http://127.0.0.1:{port}/chunked\")\nbind urls as inferred = [\"http://127.0.0.1:{port}/chunked\", \"https://127.0.0.1/\", \"http://127.0.0.1:{port}/length\"]\nbind many as inferred = network.get_many(urls)\nbind result as inferred = [one.status, one.body, one.headers, again.body, many[0].body, many[1].status, many[1].error, many[2].body]\nresult"
+    );
+    let res = *quick_setup(&source);
+
+    assert_eq!(
+        format!("{:?}", res),
+        "[201, hello, {\n    content-length: 5,\n    x-test: a, b\n}, world, world, 0, https://127.0.0.1/: https is not supported, hello]"
+    );
+    // The two `get`s share a connection; `get_many` reuses it and opens one more
+    assert_eq!(accepted.load(Ordering::SeqCst), 2);
+}
+
+#[test]
+fn test_bench_times_every_stage() {
+    use crate::bench::{BenchBackend, BenchOptions, run_bench};
+
+    let options = BenchOptions {
+        runs: 3,
+        inject_stdlib_snippets: true,
+        sandboxed: false,
+        backend: BenchBackend::Vm,
+    };
+    let stages = run_bench("bindm t as number = 0\nfor i of range(100) do { t = t + i }\nprint(t)", "bench.vel", &options);
+
+    let names: Vec<&str> = stages.iter().map(|stage| stage.name).collect();
+    assert_eq!(names, ["tokenize", "parse", "typecheck", "bytecode", "vm"]);
+    for stage in &stages {
+        assert_eq!(stage.samples.len(), 3);
+        assert!(stage.percentile(0.0) <= stage.percentile(50.0));
+        assert!(stage.percentile(50.0) <= stage.percentile(100.0));
+        assert_eq!(stage.percentile(100.0), *stage.samples.iter().max().unwrap());
+    }
+}
+
+#[test]
+fn test_serve_runs_scripts_in_fresh_scopes() {
+    use crate::serve::{ServeOptions, Server};
+
+    let scripts = [
+        "bind x as number = 4\nprint(x * 2)",
+        "print(x)",
+        "print(\"before\")\nprocess.exit(3)\nprint(\"after\")",
+        "bindm xs as inferred = []\nxs.push(1)\nprint(string.join(xs))",
+        "bind x as number = 9\nprint(x)",
+    ];
+    let mut requests = Vec::new();
+    for script in scripts {
+        requests.extend(format!("run {}\n{}", script.len(), script).into_bytes());
+    }
+    let mut responses = Vec::new();
+    let mut server = Server::new(ServeOptions {
+        inject_stdlib_snippets: true,
+        sandboxed: false,
+        use_vm: false,
+    });
+    server.serve(&requests[..], &mut responses).unwrap();
+
+    // Other tests print while this one runs, and the capture is process-wide, so outputs are only checked to contain
+    let mut rest = &responses[..];
+    let mut results = Vec::new();
+    while !rest.is_empty() {
+        let end = rest.iter().position(|&b| b == b'\n').unwrap();
+        let header = String::from_utf8_lossy(&rest[..end]).to_string();
+        let fields: Vec<&str> = header.split(' ').collect();
+        let length: usize = fields[2].parse().unwrap();
+        let output = String::from_utf8_lossy(&rest[end + 1..end + 1 + length]).to_string();
+        results.push((fields[1].parse::<i32>().unwrap(), output));
+        rest = &rest[end + 1 + length..];
+    }
+    let codes: Vec<i32> = results.iter().map(|(code, _)| *code).collect();
+    assert_eq!(codes, [0, -1, 3, -1, 0]);
+    assert!(results[0].1.contains("8\n"));
+    assert!(results[1].1.contains("Unresolved identifier \"x\""));
+    assert!(results[2].1.contains("before\n") && !results[2].1.contains("after"));
+    assert!(results[3].1.contains("string.join expected a list of strings"));
+    assert!(results[4].1.contains("9\n"));
+}
@@ -260,3 +260,44 @@ fn parser_integration_member_cases() {
         parser.produce_ast();
     }
 }
+
+#[test]
+fn parser_fold_constants() {
+    let mut ast = Parser::new(
+        "15 * 11 / 1 + 2\n'a' + 'b' == 'ab'\nx + 1 * 2\n1 / 0\nif 1 + 1 == 2 { 1 }",
+        false,
+        ExecutionTechnique::Interpretation,
+    )
+    .produce_ast();
+    ast.fold_constants();
+
+    assert_eq!(ast.nodes.len(), 5);
+    match &ast.nodes[0] {
+        Node::NumericLiteral(lit) => assert_eq!(lit.value, 167),
+        _ => panic!("Expected the arithmetic to fold into a literal"),
+    }
+    match &ast.nodes[1] {
+        Node::BoolLiteral(lit) => assert!(lit.literal_value),
+        _ => panic!("Expected the comparison to fold into a bool literal"),
+    }
+    match &ast.nodes[2] {
+        Node::BinaryExpr(binop) => match &*binop.right {
+            Node::NumericLiteral(lit) => assert_eq!(lit.value, 2),
+            _ => panic!("Expected the constant operand to fold"),
+        },
+        _ => panic!("Expected an expression with an identifier to stay a BinaryExpr"),
+    }
+    assert!(
+        matches!(ast.nodes[3], Node::BinaryExpr(_)),
+        "Division by zero must be left for the runtime to report"
+    );
+    match &ast.nodes[4] {
+        Node::IfStmt(if_stmt) => match &*if_stmt.condition {
+            Node::Comparator(comp) => {
+                assert!(matches!(&*comp.lhs, Node::NumericLiteral(lit) if lit.value == 2))
+            }
+            _ => panic!("Expected the if condition to stay a comparator"),
+        },
+        _ => panic!("Expected an if statement"),
+    }
+}
@@ -1,5 +1,5 @@
 #[cfg(test)]
-use std::{collections::HashMap, vec};
+use std::{collections::HashMap, rc::Rc, vec};
 
 use crate::{
     parser::parser::ExecutionTechnique,
@@ -55,17 +55,27 @@ fn tokenizer_unit_multi_char() {
             "456",
             VelvetToken {
                 kind: VelvetTokenType::Number,
-                literal_value: String::from("456"),
+                literal_value: "456".into(),
                 real_size: 3,
                 line: 1,
                 column: 1,
             },
         ),
+        (
+            "4.25",
+            VelvetToken {
+                kind: VelvetTokenType::Number,
+                literal_value: "4.25".into(),
+                real_size: 4,
+                line: 1,
+                column: 1,
+            },
+        ),
         (
             "'single_.   123  str'",
             VelvetToken {
                 kind: VelvetTokenType::Str,
-                literal_value: String::from("single_.   123  str"),
+                literal_value: "single_.   123  str".into(),
                 real_size: ("single_.   123  str").len(),
                 line: 1,
                 column: 1,
@@ -143,3 +153,24 @@ fn tokenizer_unit_unexpected_eofs() {
         tokenize(case, false, ExecutionTechnique::Interpretation);
     }
 }
+
+#[test]
+fn tokenizer_unit_interned_utf8() {
+    let result = tokenize(
+        "bind naïve as string = 'é' naïve",
+        false,
+        ExecutionTechnique::Interpretation,
+    );
+    let tokens = &result.real_tokens;
+
+    assert_eq!(tokens.len(), 7);
+    assert_eq!(&*tokens[1].literal_value, "naïve");
+    assert_eq!(tokens[1].real_size, "naïve".len());
+    assert_eq!(&*tokens[5].literal_value, "é");
+    // Columns count characters, so the multi-byte characters before them count once
+    assert_eq!(tokens[6].column, 29);
+    assert!(Rc::ptr_eq(
+        &tokens[1].literal_value,
+        &tokens[6].literal_value
+    ));
+}
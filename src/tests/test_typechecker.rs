@@ -1,4 +1,7 @@
 #[cfg(test)]
+use crate::parser::nodetypes::Node;
+use crate::typecheck::cache::TypecheckCache;
+use crate::typecheck::escape::{ArrayPlan, ArrayStorage, STACK_ARRAY_LIMIT};
 use crate::typecheck::typecheck::T;
 use crate::{parser::parser::Parser, typecheck::typecheck::TypeChecker};
 
@@ -9,6 +12,7 @@ fn test_single_expr_basic_types() {
         ("10", T::Integer32),
         ("999999999999", T::Integer64),
         ("9223372036854775808", T::Integer128),
+        ("2.5", T::Float64),
         ("\"Hello World\"", T::String),
         ("true", T::Boolean),
         ("false", T::Boolean),
@@ -18,7 +22,11 @@ fn test_single_expr_basic_types() {
         let case_string = case.0;
         let should_equate_to = case.1;
 
-        let mut tc = TypeChecker::new(&vec![], String::new());
+        let mut tc = TypeChecker::new(
+            &vec![],
+            String::new(),
+            crate::parser::parser::ExecutionTechnique::Compilation,
+        );
         let ast = Parser::new(
             case_string,
             false,
@@ -40,6 +48,8 @@ fn test_typecast() {
         ("1@i32", T::Integer32),
         ("1@i64", T::Integer64),
         ("1@i128", T::Integer128),
+        ("1@f64", T::Float64),
+        ("2.5@i32", T::Integer32),
         ("2@inferred", T::Infer),
     ];
 
@@ -47,7 +57,11 @@ fn test_typecast() {
         let case_string = case.0;
         let should_equate_to = case.1;
 
-        let mut tc = TypeChecker::new(&vec![], String::new());
+        let mut tc = TypeChecker::new(
+            &vec![],
+            String::new(),
+            crate::parser::parser::ExecutionTechnique::Compilation,
+        );
         let ast = Parser::new(
             case_string,
             false,
@@ -60,3 +74,270 @@ fn test_typecast() {
         assert_eq!(t, should_equate_to);
     }
 }
+
+#[test]
+fn test_range_loops() {
+    let cases = vec![
+        ("for i of range(10) do { i }", 0),
+        ("for i of range(2, 10, 3) do { i + 1 }", 0),
+        ("for i of range(0, 10, 0) do { i }", 1),
+        ("for i of [1, 2] do { i }", 1),
+    ];
+
+    for (case_string, error_count) in cases {
+        let mut tc = TypeChecker::new(
+            &vec![],
+            String::new(),
+            crate::parser::parser::ExecutionTechnique::Compilation,
+        );
+        let ast = Parser::new(
+            case_string,
+            false,
+            crate::parser::parser::ExecutionTechnique::Compilation,
+        )
+        .produce_ast();
+
+        tc.check_expr(ast.nodes.first().unwrap(), None, false, 0);
+
+        assert_eq!(tc.errors.len(), error_count, "{}", case_string);
+    }
+}
+
+#[test]
+fn test_interpreted_loops_over_any_iterable() {
+    let cases = vec![
+        "for i of [1, 2] do { i }",
+        "bind xs as number[] = [1, 2, 3]\nbindm total as number = 0\nfor x of xs do { total = total + x }",
+        "for line of io.lines(\"input.txt\") do { print(line) }",
+        "bind n as inferred = 4\nfor i of range(0, n) do { i }",
+        "-> twice(x as number) => number { ; x * 2 }\nbind it as inferred = range(3)\nfor x of it.map(twice) do { x + 1 }",
+        "bindm squares as inferred = []\nfor i of range(10) do { squares.push(i * i) }\nbindm total as number = 0\nfor s of squares do { total = total + s }",
+    ];
+
+    for technique in [
+        crate::parser::parser::ExecutionTechnique::Interpretation,
+        crate::parser::parser::ExecutionTechnique::Bytecode,
+    ] {
+        for case_string in &cases {
+            let mut tc = TypeChecker::new(&vec![], String::new(), technique.clone());
+            let ast = Parser::new(case_string, false, technique.clone()).produce_ast();
+            tc.enter_scope();
+            for node in &ast.nodes {
+                tc.check_expr(node, None, false, 0);
+            }
+
+            assert!(tc.errors.is_empty(), "{}: {:?}", case_string, tc.errors);
+        }
+    }
+}
+
+#[test]
+fn test_array_reductions_by_technique() {
+    let cases = vec![
+        "bind xs as number[] = [3, 1, 4]\nxs.sum() + xs.dot(xs)",
+        "bind squares as inferred = []\nsquares.sum()",
+        "bind empty as number[] = []\nempty.min()",
+        "-> smallest(x as number) => number { ; x }\nbind stats as inferred = { min: smallest }\nstats.min(3)",
+    ];
+    // Compiled reductions need a known, non-empty integer array
+    let compiles = [true, false, false, false];
+
+    for (case_string, compiles) in cases.iter().zip(compiles) {
+        for technique in [
+            crate::parser::parser::ExecutionTechnique::Compilation,
+            crate::parser::parser::ExecutionTechnique::Interpretation,
+        ] {
+            let compiling = technique == crate::parser::parser::ExecutionTechnique::Compilation;
+            let mut tc = TypeChecker::new(&vec![], String::new(), technique.clone());
+            let ast = Parser::new(case_string, false, technique).produce_ast();
+            tc.enter_scope();
+            for node in &ast.nodes {
+                tc.check_expr(node, None, false, 0);
+            }
+
+            assert_eq!(
+                tc.errors.is_empty(),
+                compiles || !compiling,
+                "{}: {:?}",
+                case_string,
+                tc.errors
+            );
+        }
+    }
+}
+
+#[test]
+fn test_array_escape_analysis() {
+    // Literals are declared to names at the top level or at the top of a function
+    fn declared_literals(nodes: &[Node], ids: &mut Vec<usize>) {
+        for node in nodes {
+            match node {
+                Node::VarDeclaration(decl) => {
+                    if let Node::ListLiteral(list) = decl.var_value.as_ref() {
+                        ids.push(list.id.unwrap());
+                    }
+                }
+                Node::FunctionDefinition(def) => declared_literals(&def.body, ids),
+                _ => {}
+            }
+        }
+    }
+
+    let large = vec!["1"; STACK_ARRAY_LIMIT / 4 + 1].join(", ");
+    let cases = vec![
+        (
+            String::from("bind xs as number[] = [1, 2, 3]\nxs[0] + xs.sum()"),
+            vec![ArrayStorage::Stack],
+        ),
+        // Externals only read their arguments while the call runs
+        (
+            String::from("bind a as number = 1\nbind xs as number[] = [a, 2, 3]\nprint(xs)"),
+            vec![ArrayStorage::Stack],
+        ),
+        // Escaping literals of constants share a constant global, unless the program stores into an array
+        (
+            String::from("-> f() => inferred { bind xs as number[] = [1, 2, 3]\n; xs }"),
+            vec![ArrayStorage::Constant],
+        ),
+        (
+            String::from(
+                "-> f() => inferred { bind ys as number[] = [1, 2]\n; ys }\nbindm xs as number[] = [3]\nxs[0] = 4",
+            ),
+            vec![ArrayStorage::Escaping, ArrayStorage::Stack],
+        ),
+        (
+            String::from("-> f() => number { bind xs as number[] = [1, 2, 3]\n; xs[1] }"),
+            vec![ArrayStorage::Stack],
+        ),
+        // Passing an array to a function that only reads it in place doesn't let it escape
+        (
+            String::from(
+                "-> f(ys as number[]) => number { ; ys[0] }\n-> g(a as number) => number { bind xs as number[] = [a, 2, 3]\n; f(xs) }",
+            ),
+            vec![ArrayStorage::Stack],
+        ),
+        (
+            String::from(
+                "-> f(ys as number[], n as number) => number { ; f(ys, n - 1) + ys[0] }\n-> g(a as number) => number { bind xs as number[] = [a, 2]\n; f(xs, 3) }",
+            ),
+            vec![ArrayStorage::Stack],
+        ),
+        (
+            String::from(
+                "-> f(ys as number[]) => number { print(ys)\n; 0 }\n-> g(a as number) => number { bind xs as number[] = [a, 2]\n; f(xs) }",
+            ),
+            vec![ArrayStorage::Stack],
+        ),
+        (
+            String::from(
+                "-> f(ys as number[]) => inferred { ; ys }\n-> g(a as number) => number { bind xs as number[] = [a, 2]\nbind zs as number[] = f(xs)\n; zs[0] }",
+            ),
+            vec![ArrayStorage::Escaping],
+        ),
+        // The top level builds a literal outside of loops only once
+        (
+            String::from(
+                "bind a as number = 1\nbind xs as number[] = [a, 2]\n-> f() => number { ; xs[0] }",
+            ),
+            vec![ArrayStorage::Global],
+        ),
+        (
+            String::from(
+                "bind xs as number[] = [1, 2]\nbind ys as number[] = [3, 4]\nbind zs as number[] = xs\nys.dot(zs)",
+            ),
+            vec![ArrayStorage::Constant, ArrayStorage::Stack],
+        ),
+        (
+            format!("bind xs as number[] = [{}]\nxs[0]", large),
+            vec![ArrayStorage::Arena],
+        ),
+    ];
+
+    for (case_string, expected) in cases {
+        let mut tc = TypeChecker::new(
+            &vec![],
+            String::new(),
+            crate::parser::parser::ExecutionTechnique::Compilation,
+        );
+        let ast = Parser::new(
+            &case_string,
+            false,
+            crate::parser::parser::ExecutionTechnique::Compilation,
+        )
+        .produce_ast();
+        tc.enter_scope();
+        for node in &ast.nodes {
+            tc.check_expr(node, None, false, 0);
+        }
+
+        let plan = ArrayPlan::analyze(&ast.nodes, &mut tc.type_table);
+        let mut literals = Vec::new();
+        declared_literals(&ast.nodes, &mut literals);
+        let storage: Vec<ArrayStorage> = literals.iter().map(|&id| plan.storage(id)).collect();
+        assert_eq!(storage, expected, "{}", case_string);
+
+        let arenas: Vec<usize> = literals
+            .iter()
+            .copied()
+            .filter(|&id| plan.storage(id) == ArrayStorage::Arena)
+            .collect();
+        assert_eq!(plan.arenas(None), arenas.as_slice(), "{}", case_string);
+        for id in literals {
+            let Some(T::Array {
+                is_stack_alloca, ..
+            }) = tc.type_table.get(&id)
+            else {
+                panic!("literal {} was not typed as an array", id);
+            };
+            assert_eq!(*is_stack_alloca, plan.storage(id) == ArrayStorage::Stack);
+        }
+    }
+}
+
+#[test]
+fn test_type_table_interning_and_cache() {
+    let source = "bind xs as number[] = [1, 2, 3]\n-> f(x as number) => number { ; x + 1 }\nbind b as bool = true\nf(xs[0])";
+    let mut tc = TypeChecker::new(
+        &vec![],
+        String::new(),
+        crate::parser::parser::ExecutionTechnique::Compilation,
+    );
+    let ast = Parser::new(
+        source,
+        false,
+        crate::parser::parser::ExecutionTechnique::Compilation,
+    )
+    .produce_ast();
+    tc.enter_scope();
+    for node in &ast.nodes {
+        tc.check_expr(node, None, false, 0);
+    }
+    assert!(tc.errors.is_empty());
+
+    // Nodes of the same type share one entry
+    assert!(tc.type_table.type_count() < tc.type_table.len());
+    let i32_id = tc.type_table.lookup(&T::Integer32).unwrap();
+    assert_eq!(tc.type_table.resolve(i32_id), &T::Integer32);
+
+    let dir = std::env::temp_dir().join("velvet_test_typecheck_cache");
+    let cache = TypecheckCache::new(
+        source,
+        false,
+        &crate::parser::parser::ExecutionTechnique::Compilation,
+        &[],
+        std::env::current_dir().unwrap().as_path(),
+    )
+    .in_dir(&dir);
+    cache.store(&tc.type_table);
+    let restored = cache.restore();
+    let changed = TypecheckCache::new(
+        &format!("{}\n1", source),
+        false,
+        &crate::parser::parser::ExecutionTechnique::Compilation,
+        &[],
+        std::env::current_dir().unwrap().as_path(),
+    );
+    assert_ne!(cache.key, changed.key);
+    assert_eq!(restored, Some(tc.type_table));
+    std::fs::remove_dir_all(&dir).unwrap();
+}
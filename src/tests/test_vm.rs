@@ -0,0 +1,207 @@
+#[cfg(test)]
+use crate::runtime::values::RuntimeVal;
+
+#[cfg(test)]
+fn quick_setup(source: &str) -> RuntimeVal {
+    use crate::{
+        parser::parser::{ExecutionTechnique, Parser},
+        runtime::{
+            source_environment::source_environment::SourceEnv,
+            vm::{compiler::BytecodeCompiler, machine::VirtualMachine},
+        },
+    };
+
+    let nodes = Parser::new(source, false, ExecutionTechnique::Bytecode)
+        .produce_ast()
+        .nodes;
+    let env = SourceEnv::create_global(false);
+    let program = BytecodeCompiler::new(&env.borrow()).compile_program(&nodes);
+    VirtualMachine::new(env).run(program)
+}
+
+/// Runs `source` through both the interpreter and the VM, asserting they produce the same value.
+#[cfg(test)]
+fn assert_parity(source: &str) -> RuntimeVal {
+    use crate::{
+        parser::parser::{ExecutionTechnique, Parser},
+        runtime::{interpreter::Interpreter, source_environment::source_environment::SourceEnv},
+    };
+
+    let interpreted = Interpreter::new(
+        Parser::new(source, false, ExecutionTechnique::Interpretation)
+            .produce_ast()
+            .nodes,
+    )
+    .evaluate_body(SourceEnv::create_global(false));
+    let executed = quick_setup(source);
+
+    assert_eq!(
+        format!("{:?}", interpreted),
+        format!("{:?}", executed),
+        "Interpreter and VM disagree"
+    );
+    executed
+}
+
+#[cfg(test)]
+fn expect_number(value: RuntimeVal, expected: isize) {
+    match value {
+        RuntimeVal::NumberVal(nv) => assert_eq!(nv.value, expected),
+        other => panic!("Expected NumberVal, got {:?}", other),
+    }
+}
+
+#[test]
+fn test_vm_bindings() {
+    expect_number(
+        assert_parity("bindm x as number = 1\nbind y as number = 40\nx = x + y + 1\nx"),
+        42,
+    );
+}
+
+#[test]
+fn test_vm_while_loop() {
+    expect_number(
+        assert_parity(
+            "bindm i as number = 0\nbindm total as number = 0\nwhile i < 100 do {\n  i = i + 1\n  bind step as number = i * 2\n  total = total + step\n}\ntotal",
+        ),
+        10100,
+    );
+}
+
+#[test]
+fn test_vm_recursion() {
+    expect_number(
+        assert_parity(
+            "-> fib(n as number) => number {\n  if n < 2 {\n    ; n\n  }\n  ; fib(n - 1) + fib(n - 2)\n}\nfib(15)",
+        ),
+        610,
+    );
+}
+
+#[test]
+fn test_vm_dynamic_scope() {
+    expect_number(
+        assert_parity(
+            "-> read_x() => number { ; x }\n-> caller() => number {\n  bind x as number = 7\n  ; read_x()\n}\ncaller()",
+        ),
+        7,
+    );
+}
+
+#[test]
+fn test_vm_lists() {
+    expect_number(
+        assert_parity(
+            "bindm squares as inferred = []\nfor n of [1, 2, 3, 4] do {\n  squares.push(n * n)\n}\nsquares[2] + squares.len()",
+        ),
+        13,
+    );
+}
+
+#[test]
+fn test_vm_for_loop_return() {
+    expect_number(
+        assert_parity("for n of [1, 2, 3] do {\n  if n == 2 {\n    ; n * 10\n  }\n  n\n}"),
+        20,
+    );
+}
+
+#[test]
+fn test_vm_match_expr() {
+    assert_parity(
+        "-> is_big(n as number) => bool { ; n > 10 }\n[match 3 { 1 => \"one\", 3 => \"three\" }, match 50 { is_big => \"big\", 50 => \"fifty\" }, match 4 { 1 => \"one\" } ! \"none\"]",
+    );
+}
+
+#[test]
+fn test_vm_objects() {
+    expect_number(
+        quick_setup("bind o as inferred = { a: 1, b: { c: 2 } }\no.b.c + o.a"),
+        3,
+    );
+}
+
+#[test]
+#[should_panic(expected = "Cannot assign to immutable variable 'test_var'")]
+fn test_vm_mutation_on_immutable_binding() {
+    quick_setup("bind test_var as number = 10\ntest_var = 5");
+}
+
+#[test]
+fn test_vm_list_copy_on_write() {
+    assert_parity(
+        "bindm a as inferred = [1]\nbindm b as inferred = a\nb.push(2)\nfor n of b do {\n  b.push(n * 10)\n}\nbind result as inferred = [a, b]\nresult",
+    );
+}
+
+#[test]
+fn test_vm_list_methods() {
+    assert_parity(
+        "bindm xs as inferred = [4, 2]\n-> grow() => number {\n  xs.push(9)\n  ; xs.len()\n}\nbind n as number = grow()\nxs.sort()\n-> add(a as number, b as number) => number { ; a + b }\nbind len as inferred = xs.len\nbind result as inferred = [n, xs.pop(), xs, xs.reduce(add), len()]\nresult",
+    );
+}
+
+#[test]
+fn test_vm_numeric_types() {
+    let res = assert_parity(
+        "bind half as f64 = 0.5\nbind small as i8 = 120\n-> scale(x as f64) => f64 { ; x * 4 }\n[half + 1, scale(3), small + 10, 2.9@i32, 300@i8, 0.1 + 0.2 == 0.3]",
+    );
+    assert_eq!(format!("{:?}", res), "[1.5, 12.0, -126, 2, 44, false]");
+}
+
+#[test]
+fn test_vm_number_arrays() {
+    let res = assert_parity(
+        "bindm xs as number[] = [3, 1, 4]\n-> square(x as number) => number { bind y as number = x + 1\n; y * y }\nbindm total as number = 0\nfor x of xs do { total = total + x }\nxs.push(9)\nbind middle as number[] = xs.slice(1, 3)\n[xs.map(square), xs.sort(), middle.sum(), total, xs.len()]",
+    );
+    assert_eq!(
+        format!("{:?}", res),
+        "[[16, 4, 25, 100], [1, 3, 4, 9], 5, 8, 4]"
+    );
+}
+
+#[test]
+fn test_vm_lazy_iterators() {
+    let res = assert_parity(
+        "bindm out as inferred = []\n-> sq(x as number) => number { ; x * x }\nbind xs as number[] = [4, 5, 6]\nbind it as inferred = xs.iter()\nbind mapped as inferred = it.map(sq)\nfor x of mapped do { out.push(x) }\nfor w of string.split_iter(\"ab\", \"\") do { out.push(w) }\nfor i of range(3) do { out.push(i) }\nout",
+    );
+    assert_eq!(format!("{:?}", res), "[16, 25, 36, a, b, 0, 1, 2]");
+}
+
+#[test]
+fn test_vm_object_shapes() {
+    let res = assert_parity(
+        "bindm out as inferred = []\nbind a as inferred = { x: 1, y: 2 }\nbind b as inferred = { y: 20, x: 10 }\nbind c as inferred = { y: 7, z: 8 }\nfor o of [a, b, c, a] do { out.push(o.y)\nout.push(o.x) }\nout",
+    );
+    assert_eq!(format!("{:?}", res), "[2, 1, 20, 10, 7, null, 2, 1]");
+}
+
+#[test]
+fn test_vm_match_dispatch() {
+    let res = assert_parity(
+        "-> small(n as number) => bool { ; n < 2 }\nbindm out as inferred = []\nfor i of [0, 1, 2, 3, 5, 9] do { out.push(match i { 0 => \"zero\", small => \"small\", 1 => \"one\", 2 => \"two\", 3 => \"three\", 2 => \"dup\", 9 => \"nine\" } ! \"none\") }\nfor s of [\"a\", \"b\", \"c\"] do { out.push(match s { \"a\" => 1, \"b\" => 2 } ! 0) }\nout.push(match true { false => \"f\", true => \"t\" })\nbind w as i64 = 2\nout.push(match w { 1 => \"one\", 2 => \"two\" })\nout",
+    );
+    assert_eq!(
+        format!("{:?}", res),
+        "[zero, small, two, three, none, nine, 1, 2, 0, t, two]"
+    );
+}
+
+#[test]
+fn test_vm_skipped_declaration() {
+    let res = assert_parity(
+        "bindm x as number = 1\n-> cond(c as number) => number {\n  if c == 1 {\n    bindm x as number = 9\n  }\n  x = x + 1\n  ; x\n}\n-> peek(c as number) => number {\n  if c == 1 {\n    bind x as number = 9\n  }\n  ; x\n}\nbindm out as inferred = []\n-> fill(c as number) => number {\n  if c == 1 {\n    bindm out as inferred = []\n  }\n  out.push(c)\n  ; out.len()\n}\n[cond(1), cond(0), x, peek(0), peek(1), fill(0), fill(1), out.len()]",
+    );
+    assert_eq!(format!("{:?}", res), "[10, 2, 2, 2, 9, 1, 1, 1]");
+}
+
+#[test]
+fn test_vm_return_unwinds_operands() {
+    // The interpreter does not unwind a return nested in an expression, so this only runs on the VM: the operands
+    // below the returned value must not be left on the caller's stack.
+    let res = quick_setup(
+        "-> early(c as number) => number {\n  [1, 2, if c == 1 { ; 8 }]\n  ; 0\n}\n[2 * early(1), 3 + early(1), early(0)]",
+    );
+    assert_eq!(format!("{:?}", res), "[16, 11, 0]");
+}
@@ -1,5 +1,5 @@
 use core::fmt;
-use std::convert::TryFrom;
+use std::{convert::TryFrom, rc::Rc};
 
 #[derive(Debug)]
 pub struct TryFromPrimitiveError {
@@ -112,13 +112,16 @@ impl fmt::Display for VelvetTokenType {
     }
 }
 
+/// An interned spelling handed out by `SymbolTable`; cloning one never copies the text.
+pub type Symbol = Rc<str>;
+
 #[derive(Debug, Clone)]
 pub struct VelvetToken {
     pub kind: VelvetTokenType,
     pub real_size: usize,
     pub line: usize,
     pub column: usize,
-    pub literal_value: String,
+    pub literal_value: Symbol,
 }
 
 impl TryFrom<u8> for VelvetTokenType {
@@ -1,4 +1,4 @@
-use std::collections::HashMap;
+use std::{collections::HashSet, rc::Rc};
 
 use colored::Colorize;
 
@@ -6,63 +6,61 @@ use crate::parser::parser::ExecutionTechnique;
 
 use super::token::*;
 
-use std::{env, fs};
+/// Peeks `amount` bytes ahead of `cur_idx`. Only used to look past ASCII characters, so byte and character offsets
+/// agree.
+fn t_peek(bytes: &[u8], cur_idx: usize, amount: usize) -> Option<u8> {
+    bytes.get(cur_idx + amount).copied()
+}
 
-fn t_peek(characters: &Vec<char>, cur_idx: usize, amount: usize) -> Option<char> {
-    if cur_idx + amount >= characters.len() {
-        None
-    } else {
-        Some(characters[cur_idx + amount])
+fn reserved_token(ident: &str) -> Option<VelvetTokenType> {
+    match ident {
+        "bind" => Some(VelvetTokenType::Keywrd_Bind),
+        "bindm" => Some(VelvetTokenType::Keywrd_Bindmutable),
+        "as" => Some(VelvetTokenType::Keywrd_As),
+        "while" => Some(VelvetTokenType::Keywrd_While),
+        "do" => Some(VelvetTokenType::Keywrd_Do),
+        "if" => Some(VelvetTokenType::Keywrd_If),
+        "for" => Some(VelvetTokenType::Keywrd_For),
+        "of" => Some(VelvetTokenType::Keywrd_Of),
+        "match" => Some(VelvetTokenType::Keywrd_Match),
+        "extern" | "ext" => Some(VelvetTokenType::Keywrd_External),
+        _ => None,
     }
 }
 
-pub fn join_tokenizer_output(output: TokenizerOutput) -> Vec<VelvetToken> {
-    let cloned_real = output.real_tokens.clone();
-    let mut basin_snippets: Vec<VelvetToken> = Vec::new();
+/// Hands out one shared `Symbol` per distinct spelling, so repeated identifiers and keywords are allocated once per
+/// `tokenize` call, standard library snippets included.
+#[derive(Default)]
+pub struct SymbolTable {
+    symbols: HashSet<Symbol>,
+}
 
-    for snippet_tgroup in output.snippet_tokens {
-        for t in snippet_tgroup {
-            basin_snippets.push(t)
+impl SymbolTable {
+    pub fn intern(&mut self, spelling: &str) -> Symbol {
+        if let Some(symbol) = self.symbols.get(spelling) {
+            return Rc::clone(symbol);
         }
+        let symbol: Symbol = spelling.into();
+        self.symbols.insert(Rc::clone(&symbol));
+        symbol
     }
-
-    for joined_snippet_token in cloned_real {
-        basin_snippets.push(joined_snippet_token);
-    }
-
-    basin_snippets
 }
 
-// Notice; fix from 0.1.15 and up, uses a static path based on EXE rather than CWD due to Bug 004.
-// Jul 14 patch
-pub fn load_snippet_sources(etech: ExecutionTechnique) -> Vec<String> {
-    let mut sources = Vec::new();
-
-    let exe_path = env::current_exe().expect("Failed to get current exe path");
-    let snippets_path = match etech {
-        ExecutionTechnique::Interpretation => exe_path
-            .parent()
-            .unwrap()
-            .join("../../src/stdlib_interp/snippets"),
-        ExecutionTechnique::Compilation => exe_path
-            .parent()
-            .unwrap()
-            .join("../../src/stdlib_comp/snippets"),
-    };
-    let snippets_path = snippets_path.canonicalize().unwrap_or(snippets_path);
-
-    if let Ok(entries) = fs::read_dir(&snippets_path) {
-        for entry in entries.flatten() {
-            let path = entry.path();
-            if path.extension().and_then(|ext| ext.to_str()) == Some("vel") {
-                if let Ok(source) = fs::read_to_string(&path) {
-                    sources.push(source);
-                }
-            }
+/// The standard library snippets, embedded into the binary so that starting Velvet reads nothing from disk.
+const INTERP_SNIPPET_SOURCES: [&str; 3] = [
+    include_str!("../stdlib_interp/snippets/error.vel"),
+    include_str!("../stdlib_interp/snippets/math.vel"),
+    include_str!("../stdlib_interp/snippets/misc.vel"),
+];
+const COMP_SNIPPET_SOURCES: [&str; 1] = [include_str!("../stdlib_comp/snippets/error.vel")];
+
+pub fn snippet_sources(etech: &ExecutionTechnique) -> &'static [&'static str] {
+    match etech {
+        ExecutionTechnique::Interpretation | ExecutionTechnique::Bytecode => {
+            &INTERP_SNIPPET_SOURCES
         }
+        ExecutionTechnique::Compilation => &COMP_SNIPPET_SOURCES,
     }
-
-    sources
 }
 
 pub struct TokenizerOutput {
@@ -97,37 +95,33 @@ pub fn tokenize(
     inject_stdlib_snippets: bool,
     etech: ExecutionTechnique,
 ) -> TokenizerOutput {
+    let mut symbols = SymbolTable::default();
     // Represent standard lib snippets as separate groups to not mess up idx/line/col source backtracking
     let mut snippet_tokens: Vec<Vec<VelvetToken>> = Vec::new();
     if inject_stdlib_snippets {
-        let snippets = load_snippet_sources(etech.clone());
-
-        for snippet in snippets {
-            snippet_tokens.push(tokenize(&snippet, false, etech.clone()).real_tokens);
+        for snippet in snippet_sources(&etech) {
+            snippet_tokens.push(tokenize_source(snippet, &mut symbols));
         }
     }
-    let input_characters: Vec<char> = input.chars().clone().collect();
+
+    TokenizerOutput {
+        real_tokens: tokenize_source(input, &mut symbols),
+        snippet_tokens: snippet_tokens,
+    }
+}
+
+/// Tokenizes `input` in place: the scanner walks UTF-8 byte offsets, and a token's literal value is its span of the
+/// source (without the quotes, for strings) interned into `symbols`. Columns count characters, not bytes.
+pub fn tokenize_source(input: &str, symbols: &mut SymbolTable) -> Vec<VelvetToken> {
+    let input_bytes = input.as_bytes();
+    let char_at = |index: usize| input[index..].chars().next().unwrap();
     let mut tokenizer_index = 0;
     let mut tokenizer_line: usize = 1;
     let mut tokenizer_column: usize = 0;
     let mut end_tokens: Vec<VelvetToken> = Vec::new();
 
-    let reserved_tokens: HashMap<&'static str, VelvetTokenType> = HashMap::from([
-        ("bind", VelvetTokenType::Keywrd_Bind),
-        ("bindm", VelvetTokenType::Keywrd_Bindmutable),
-        ("as", VelvetTokenType::Keywrd_As),
-        ("while", VelvetTokenType::Keywrd_While),
-        ("do", VelvetTokenType::Keywrd_Do),
-        ("if", VelvetTokenType::Keywrd_If),
-        ("for", VelvetTokenType::Keywrd_For),
-        ("of", VelvetTokenType::Keywrd_Of),
-        ("match", VelvetTokenType::Keywrd_Match),
-        ("extern", VelvetTokenType::Keywrd_External),
-        ("ext", VelvetTokenType::Keywrd_External),
-    ]);
-
-    while tokenizer_index < input_characters.len() {
-        let mut current_char = input_characters[tokenizer_index];
+    while tokenizer_index < input.len() {
+        let current_char = char_at(tokenizer_index);
 
         tokenizer_column += 1;
 
@@ -139,20 +133,19 @@ pub fn tokenize(
         }
 
         if current_char.is_whitespace() {
-            tokenizer_index += 1;
+            tokenizer_index += current_char.len_utf8();
             continue;
         }
 
-        // Single char mapping
-        let mut prefix_literal_value = "".to_owned();
+        // Single char mapping; the token's span starts here, and ends with the character at `tokenizer_index`
+        let mut span_start = tokenizer_index;
         let token_result: Option<VelvetTokenType> = match current_char {
             '@' => Some(VelvetTokenType::At),
-            '|' => match t_peek(&input_characters, tokenizer_index, 1) {
-                Some('-') => match t_peek(&input_characters, tokenizer_index, 2) {
-                    Some('>') => {
+            '|' => match t_peek(input_bytes, tokenizer_index, 1) {
+                Some(b'-') => match t_peek(input_bytes, tokenizer_index, 2) {
+                    Some(b'>') => {
                         tokenizer_index += 2;
                         tokenizer_column += 2;
-                        prefix_literal_value = "|-".to_owned();
                         Some(VelvetTokenType::WallArrow)
                     }
                     _ => None,
@@ -160,28 +153,25 @@ pub fn tokenize(
                 _ => None,
             },
             '+' => Some(VelvetTokenType::Plus),
-            '-' => match t_peek(&input_characters, tokenizer_index, 1) {
-                Some('>') => {
+            '-' => match t_peek(input_bytes, tokenizer_index, 1) {
+                Some(b'>') => {
                     tokenizer_index += 1;
                     tokenizer_column += 1;
-                    prefix_literal_value = "-".to_owned();
                     Some(VelvetTokenType::Arrow)
                 }
                 _ => Some(VelvetTokenType::Minus),
             },
             '*' => Some(VelvetTokenType::Asterisk),
             '/' => Some(VelvetTokenType::Slash),
-            '=' => match t_peek(&input_characters, tokenizer_index, 1) {
-                Some('>') => {
+            '=' => match t_peek(input_bytes, tokenizer_index, 1) {
+                Some(b'>') => {
                     tokenizer_index += 1;
                     tokenizer_column += 1;
-                    prefix_literal_value = "=".to_owned();
                     Some(VelvetTokenType::EqArrow)
                 }
-                Some('=') => {
+                Some(b'=') => {
                     tokenizer_index += 1;
                     tokenizer_column += 1;
-                    prefix_literal_value = "=".to_owned();
                     Some(VelvetTokenType::DoubleEq)
                 }
                 _ => Some(VelvetTokenType::Eq),
@@ -195,18 +185,17 @@ pub fn tokenize(
             '}' => Some(VelvetTokenType::RBrace),
             '!' => Some(VelvetTokenType::Exclaimation),
             ';' => {
-                if let Some(t) = t_peek(&input_characters, tokenizer_index, 1) {
-                    if t == ';' {
-                        // It's a comment, skip until newline
-                        while current_char != '\n' {
-                            tokenizer_index += 1;
-                            tokenizer_column += 1;
-                            current_char = input_characters[tokenizer_index];
+                if t_peek(input_bytes, tokenizer_index, 1) == Some(b';') {
+                    // It's a comment, skip until newline; the newline itself becomes the NoOp token
+                    while tokenizer_index < input.len() && input_bytes[tokenizer_index] != b'\n' {
+                        tokenizer_index += 1;
+                        if !input.is_char_boundary(tokenizer_index) {
+                            continue;
                         }
-                        Some(VelvetTokenType::NoOp)
-                    } else {
-                        Some(VelvetTokenType::Semicolon)
+                        tokenizer_column += 1;
                     }
+                    span_start = tokenizer_index;
+                    Some(VelvetTokenType::NoOp)
                 } else {
                     Some(VelvetTokenType::Semicolon)
                 }
@@ -220,35 +209,51 @@ pub fn tokenize(
             '$' => Some(VelvetTokenType::DollarSign),
             _ => None,
         };
-        if token_result.is_some() {
+        if let Some(kind) = token_result {
+            // Every character that ends a token is ASCII, except at the end of an unterminated comment
+            let span_end = (tokenizer_index + 1).min(input.len());
             end_tokens.push(VelvetToken {
-                kind: token_result.expect(""),
-                literal_value: prefix_literal_value
-                    + &input_characters[tokenizer_index].to_string(),
+                kind,
+                literal_value: symbols.intern(&input[span_start..span_end]),
                 real_size: 1,
                 line: tokenizer_line,
                 column: start_col,
             });
-            tokenizer_index += 1;
+            tokenizer_index = span_end;
             continue;
         }
 
         // Multi char processing
         // Numbers
         if current_char.is_numeric() {
-            let mut final_number = "".to_owned();
+            let number_start = tokenizer_index;
 
-            while tokenizer_index < input_characters.len()
-                && input_characters[tokenizer_index].is_numeric()
+            while tokenizer_index < input.len() && char_at(tokenizer_index).is_numeric() {
+                tokenizer_index += char_at(tokenizer_index).len_utf8();
+                tokenizer_column += 1;
+            }
+
+            // A fraction makes it a float literal, unless the number is itself a member name, as in `a.0.1`
+            let after_dot = end_tokens
+                .last()
+                .is_some_and(|token| token.kind == VelvetTokenType::Dot);
+            if !after_dot
+                && t_peek(input_bytes, tokenizer_index, 0) == Some(b'.')
+                && t_peek(input_bytes, tokenizer_index, 1).is_some_and(|byte| byte.is_ascii_digit())
             {
-                final_number.push(input_characters[tokenizer_index]);
                 tokenizer_index += 1;
                 tokenizer_column += 1;
+                while tokenizer_index < input.len() && input_bytes[tokenizer_index].is_ascii_digit()
+                {
+                    tokenizer_index += 1;
+                    tokenizer_column += 1;
+                }
             }
 
+            let final_number = &input[number_start..tokenizer_index];
             end_tokens.push(VelvetToken {
                 kind: VelvetTokenType::Number,
-                literal_value: final_number.clone(),
+                literal_value: symbols.intern(final_number),
                 real_size: final_number.len(),
                 line: tokenizer_line,
                 column: start_col,
@@ -258,88 +263,64 @@ pub fn tokenize(
 
         // Identifiers
         if current_char.is_alphabetic() || current_char == '_' {
-            let mut final_ident: String = "".to_owned();
+            let ident_start = tokenizer_index;
+            tokenizer_index += current_char.len_utf8();
 
-            while current_char.is_alphanumeric() || current_char == '_' || current_char == '#' {
-                final_ident = final_ident + &current_char.to_string();
-                if tokenizer_index + 1 >= input_characters.len() {
-                    tokenizer_index += 1;
+            while tokenizer_index < input.len() {
+                let next_char = char_at(tokenizer_index);
+                if !(next_char.is_alphanumeric() || next_char == '_' || next_char == '#') {
                     break;
                 }
-                tokenizer_index += 1;
+                tokenizer_index += next_char.len_utf8();
                 tokenizer_column += 1;
-                current_char = input_characters[tokenizer_index]
-            }
-
-            tokenizer_index -= 1;
-            tokenizer_column -= 1;
-
-            let reserved_check = reserved_tokens.get(final_ident.as_str());
-            if let Some(x) = reserved_check {
-                end_tokens.push(VelvetToken {
-                    kind: x.to_owned(),
-                    literal_value: final_ident.clone(),
-                    real_size: final_ident.len(),
-                    line: tokenizer_line,
-                    column: start_col,
-                });
-                tokenizer_index += 1;
-                continue;
             }
 
+            let final_ident = &input[ident_start..tokenizer_index];
             end_tokens.push(VelvetToken {
-                kind: VelvetTokenType::Identifier,
-                literal_value: final_ident.clone(),
+                kind: reserved_token(final_ident).unwrap_or(VelvetTokenType::Identifier),
+                literal_value: symbols.intern(final_ident),
                 real_size: final_ident.len(),
                 line: tokenizer_line,
                 column: start_col,
             });
-            tokenizer_index += 1;
             continue;
         }
 
         if current_char == '\'' || current_char == '"' {
-            let end_quote_char = current_char;
-            let mut end_string = "".to_owned();
-
-            if tokenizer_index + 1 >= input_characters.len() {
-                tokenizer_error(
-                    input,
-                    "Unexpected EOF: Expected string end sequence, got EOF.",
-                    tokenizer_line - 1,
-                    tokenizer_column,
-                );
-            }
-            tokenizer_index += 1;
-            tokenizer_column += 1;
-            current_char = input_characters[tokenizer_index];
+            let end_quote = current_char as u8;
+            let string_start = tokenizer_index + 1;
 
-            while current_char != end_quote_char {
-                if current_char == '\n' || current_char == '\r' {
+            tokenizer_index = string_start;
+            tokenizer_column += 1;
+            loop {
+                let Some(&byte) = input_bytes.get(tokenizer_index) else {
                     tokenizer_error(
                         input,
-                        "Unexpected Newline: Strings cannot span multiple lines.",
+                        "Unexpected EOF: Expected string end sequence, got EOF.",
                         tokenizer_line - 1,
                         tokenizer_column,
                     );
+                    unreachable!();
+                };
+                if byte == end_quote {
+                    break;
                 }
-                end_string += &current_char.to_string();
-                if tokenizer_index + 1 >= input_characters.len() {
+                if byte == b'\n' || byte == b'\r' {
                     tokenizer_error(
                         input,
-                        "Unexpected EOF: Expected string end sequence, got EOF.",
+                        "Unexpected Newline: Strings cannot span multiple lines.",
                         tokenizer_line - 1,
                         tokenizer_column,
                     );
                 }
-                tokenizer_index += 1;
+                tokenizer_index += char_at(tokenizer_index).len_utf8();
                 tokenizer_column += 1;
-                current_char = input_characters[tokenizer_index];
             }
 
+            let end_string = &input[string_start..tokenizer_index];
             end_tokens.push(VelvetToken {
                 kind: VelvetTokenType::Str,
-                literal_value: end_string.clone(),
+                literal_value: symbols.intern(end_string),
                 real_size: end_string.len() + 2, // +2 for start and end sequences
                 line: tokenizer_line,
                 column: start_col,
@@ -361,8 +342,5 @@ pub fn tokenize(
         );
     }
 
-    return TokenizerOutput {
-        real_tokens: end_tokens,
-        snippet_tokens: snippet_tokens,
-    };
+    end_tokens
 }
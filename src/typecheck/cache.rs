@@ -0,0 +1,104 @@
+use std::{
+    fs,
+    path::{Path, PathBuf},
+};
+
+use crate::{
+    codegen::cache::{CACHE_DIR, Fnv64},
+    parser::parser::ExecutionTechnique,
+    tokenizer::tokenizer::snippet_sources,
+    typecheck::{
+        table::TypeTable,
+        typecheck::{SubmoduleFetchResult, try_fetch_submodule},
+    },
+};
+
+/// The sources a table depends on besides the program: the checker's, which infers the types, and the tokenizer's
+/// and parser's, which number the nodes they are stored under. A table is never reused by a build that would number
+/// or infer it differently, even within one version.
+const INFERENCE_SOURCES: [&str; 7] = [
+    include_str!("typecheck.rs"),
+    include_str!("table.rs"),
+    include_str!("../tokenizer/tokenizer.rs"),
+    include_str!("../tokenizer/token.rs"),
+    include_str!("../parser/parser.rs"),
+    include_str!("../parser/fold.rs"),
+    include_str!("../parser/nodetypes.rs"),
+];
+
+/// The type tables of files that typechecked cleanly, under `velvet_tmp/cache/typecheck`.
+///
+/// Each file is keyed on its own: the Velvet version and `INFERENCE_SOURCES`, its source, the standard library
+/// snippets parsed with it and the `meta.toml` of every external it uses, which is all its types are inferred from.
+/// Node ids are allocated in parse order, so an unchanged file's table fits its freshly parsed nodes. Once local
+/// submodules can be imported, each gets its own entry, and a project only rechecks the files that changed.
+pub struct TypecheckCache {
+    pub key: u64,
+    path: PathBuf,
+}
+
+impl TypecheckCache {
+    pub fn new(
+        source: &str,
+        inject_stdlib_snippets: bool,
+        technique: &ExecutionTechnique,
+        externals: &[String],
+        importer_path: &Path,
+    ) -> Self {
+        let mut hasher = Fnv64::new();
+        hasher.field(env!("CARGO_PKG_VERSION").as_bytes());
+        for inference_source in INFERENCE_SOURCES {
+            hasher.field(inference_source.as_bytes());
+        }
+        hasher.field(source.as_bytes());
+        hasher.field(&[inject_stdlib_snippets as u8]);
+        if inject_stdlib_snippets {
+            for snippet in snippet_sources(technique) {
+                hasher.field(snippet.as_bytes());
+            }
+        }
+        for external in externals {
+            hasher.field(external.as_bytes());
+            if let Ok(SubmoduleFetchResult::Valid { entry, .. }) =
+                try_fetch_submodule(external, importer_path)
+            {
+                hasher.field(&fs::read(entry.with_file_name("meta.toml")).unwrap_or_default());
+            }
+        }
+
+        let key = hasher.0;
+        Self {
+            key,
+            path: Path::new(CACHE_DIR)
+                .join("typecheck")
+                .join(format!("{:016x}.toml", key)),
+        }
+    }
+
+    /// Keeps this entry in `dir` instead of under `velvet_tmp`.
+    pub fn in_dir(self, dir: &Path) -> Self {
+        Self {
+            path: dir.join(self.path.file_name().unwrap()),
+            ..self
+        }
+    }
+
+    /// The table stored under this key, if there is a readable one.
+    pub fn restore(&self) -> Option<TypeTable> {
+        toml::from_str(&fs::read_to_string(&self.path).ok()?).ok()
+    }
+
+    /// Stores `table` under this key. A failed store only costs a recheck next time.
+    pub fn store(&self, table: &TypeTable) {
+        let stored = toml::to_string(table)
+            .map_err(|err| err.to_string())
+            .and_then(|contents| {
+                fs::create_dir_all(self.path.parent().unwrap())
+                    .and_then(|_| fs::write(&self.path, contents))
+                    .map_err(|err| err.to_string())
+            });
+        if let Err(err) = stored {
+            eprintln!("Failed to cache the type table: {}", err);
+        }
+    }
+}
@@ -0,0 +1,430 @@
+use std::collections::{HashMap, HashSet};
+
+use crate::parser::nodetypes::{FunctionDefinition, ListLiteral, Node};
+use crate::typecheck::table::TypeTable;
+use crate::typecheck::typecheck::{T, array_reduction};
+
+/// The most bytes of elements a compiled array keeps in its function's stack frame. Larger arrays that don't escape
+/// go to the function's arena instead, so deep recursion over them can't overflow the stack.
+pub const STACK_ARRAY_LIMIT: usize = 16 * 1024;
+
+/// Where compiled code allocates an array literal.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum ArrayStorage {
+    /// In the frame of the function that builds it.
+    Stack,
+    /// Too large for the frame, but still not outliving its function: allocated on the heap the first time a call
+    /// builds it, and freed when that call returns.
+    Arena,
+    /// Outlives its function, but its elements are all constants and compiled code never stores into an array, so
+    /// every evaluation shares one constant global.
+    Constant,
+    /// Outlives its function, but is built by the top level outside of any loop, so the one evaluation it gets can
+    /// fill a global.
+    Global,
+    /// Outlives its function, and may be built any number of times. Compiled code has nothing that could free it, so
+    /// codegen refuses it rather than leak an allocation on every evaluation.
+    Escaping,
+}
+
+/// Where every array literal of a program is allocated. An array can stay with the function that builds it as long
+/// as it is only ever indexed or reduced there, in place or through the name it is declared to, or passed to a
+/// function that does the same with it or to an external; anything else, such as returning it, passing it to any
+/// other call, assigning it or reading it from a nested function, lets it escape.
+#[derive(Debug, Default)]
+pub struct ArrayPlan {
+    storage: HashMap<usize, ArrayStorage>,
+    /// The arena literals of each function, by the id of its definition; `None` is the program's top level.
+    arenas: HashMap<Option<usize>, Vec<usize>>,
+    /// Escaping literals of constant elements, which become `Constant` once the whole program is seen not to store
+    /// into arrays.
+    constant: Vec<usize>,
+}
+
+impl ArrayPlan {
+    /// Plans the literals of `nodes`, recording each decision in its array type in `type_table` as well.
+    pub fn analyze(nodes: &[Node], type_table: &mut TypeTable) -> Self {
+        let mut plan = Self::default();
+        let kept_params = kept_params(nodes);
+        let mut stores_elements = false;
+        let mut pending: Vec<(Option<usize>, &[Node])> = vec![(None, nodes)];
+        while let Some((function, body)) = pending.pop() {
+            let mut uses = FunctionUses::default();
+            for node in body {
+                uses.visit(node, false);
+            }
+            uses.settle(&kept_params);
+            stores_elements |= uses.stores_elements;
+            pending.extend(uses.nested.drain(..));
+
+            let mut kept = uses.in_place;
+            for (name, literals) in uses.bound {
+                if !uses.escaping.contains(&name) {
+                    kept.extend(literals);
+                }
+            }
+            for &literal in &uses.literals {
+                let storage = if function.is_none() && uses.once.contains(&literal) {
+                    ArrayStorage::Global
+                } else {
+                    ArrayStorage::Escaping
+                };
+                plan.storage.insert(literal, storage);
+            }
+            plan.constant.extend(
+                uses.constant
+                    .iter()
+                    .filter(|literal| !kept.contains(literal)),
+            );
+            kept.sort_unstable();
+            for literal in kept {
+                let storage = if array_bytes(type_table.get(&literal)) > STACK_ARRAY_LIMIT {
+                    plan.arenas.entry(function).or_default().push(literal);
+                    ArrayStorage::Arena
+                } else {
+                    ArrayStorage::Stack
+                };
+                plan.storage.insert(literal, storage);
+            }
+        }
+
+        if !stores_elements {
+            for literal in std::mem::take(&mut plan.constant) {
+                plan.storage.insert(literal, ArrayStorage::Constant);
+            }
+        }
+        for (literal, storage) in &plan.storage {
+            if let Some(T::Array {
+                array_t,
+                element_count,
+                ..
+            }) = type_table.get(literal)
+            {
+                let planned = T::Array {
+                    is_stack_alloca: *storage == ArrayStorage::Stack,
+                    becomes_heap_at: STACK_ARRAY_LIMIT / element_bytes(array_t),
+                    array_t: array_t.clone(),
+                    element_count: *element_count,
+                };
+                type_table.insert(*literal, &planned);
+            }
+        }
+        plan
+    }
+
+    /// Where the literal with id `literal` is allocated. Literals the plan never saw are assumed to escape.
+    pub fn storage(&self, literal: usize) -> ArrayStorage {
+        self.storage
+            .get(&literal)
+            .copied()
+            .unwrap_or(ArrayStorage::Escaping)
+    }
+
+    /// The arena literals of the function defined by `function`, or of the top level for `None`.
+    pub fn arenas(&self, function: Option<usize>) -> &[usize] {
+        self.arenas.get(&function).map_or(&[], Vec::as_slice)
+    }
+}
+
+/// Which arguments of the functions a program calls by name stay with the call.
+struct KeptParams {
+    /// For every function name that is defined once, whether each of its parameters stays.
+    defined_once: HashMap<String, Vec<bool>>,
+    /// Every function name the program defines. Calls to any other name go to externals.
+    defined: HashSet<String>,
+}
+
+impl KeptParams {
+    /// Externals keep every argument: compiled code calls them for their effect and drops what they return, so an
+    /// argument is only read while the call runs.
+    fn keeps(&self, function: &str, index: usize) -> bool {
+        match self.defined_once.get(function) {
+            Some(kept) => kept.get(index).copied().unwrap_or(false),
+            None => !self.defined.contains(function),
+        }
+    }
+}
+
+/// For every function name that is defined once, whether each of its parameters stays with the call: the function
+/// only indexes or reduces it, or passes it on to a parameter that stays in turn. Starting from every parameter
+/// staying, parameters are struck off until no function's body lets one more escape, so recursion that only passes
+/// an array along doesn't make it escape.
+fn kept_params(nodes: &[Node]) -> KeptParams {
+    fn definitions<'a>(nodes: &'a [Node], found: &mut Vec<&'a FunctionDefinition>) {
+        for node in nodes {
+            match node {
+                Node::FunctionDefinition(def) => {
+                    found.push(def);
+                    definitions(&def.body, found);
+                }
+                Node::WhileStmt(ws) => definitions(&ws.body, found),
+                Node::IfStmt(ifs) => definitions(&ifs.body, found),
+                Node::Iterator(it) => definitions(&it.body, found),
+                Node::Block(block) => definitions(&block.body, found),
+                _ => {}
+            }
+        }
+    }
+
+    let mut defs = Vec::new();
+    definitions(nodes, &mut defs);
+    let defined = defs.iter().map(|def| def.name.clone()).collect();
+    let mut counts: HashMap<&str, usize> = HashMap::new();
+    for def in &defs {
+        *counts.entry(&def.name).or_default() += 1;
+    }
+    // A name defined twice can't be told apart at its calls, so its parameters are never assumed to stay
+    defs.retain(|def| counts[def.name.as_str()] == 1);
+
+    let mut kept = KeptParams {
+        defined_once: defs
+            .iter()
+            .map(|def| (def.name.clone(), vec![true; def.params.len()]))
+            .collect(),
+        defined,
+    };
+    loop {
+        let mut changed = false;
+        for def in &defs {
+            let mut uses = FunctionUses::default();
+            uses.visit_all(&def.body);
+            uses.settle(&kept);
+            for (index, (param, _)) in def.params.iter().enumerate() {
+                if kept.defined_once[&def.name][index] && uses.escaping.contains(param) {
+                    kept.defined_once.get_mut(&def.name).unwrap()[index] = false;
+                    changed = true;
+                }
+            }
+        }
+        if !changed {
+            return kept;
+        }
+    }
+}
+
+fn element_bytes(t: &T) -> usize {
+    match t {
+        T::Integer8 | T::Boolean => 1,
+        T::Integer16 => 2,
+        T::Integer32 => 4,
+        T::Integer128 => 16,
+        _ => 8,
+    }
+}
+
+fn array_bytes(t: Option<&T>) -> usize {
+    match t {
+        Some(T::Array {
+            array_t,
+            element_count,
+            ..
+        }) => element_bytes(array_t) * element_count,
+        _ => 0,
+    }
+}
+
+/// How the body of one function uses its array literals.
+#[derive(Default)]
+struct FunctionUses<'a> {
+    /// Every literal of the body.
+    literals: Vec<usize>,
+    /// Literals that are indexed or reduced where they are written.
+    in_place: Vec<usize>,
+    /// Literals declared straight to a name, by that name.
+    bound: HashMap<String, Vec<usize>>,
+    /// Names read as a whole value somewhere, or read at all by a nested function.
+    escaping: HashSet<String>,
+    /// Every name the body reads.
+    mentioned: HashSet<String>,
+    /// Nested function definitions, which are planned on their own.
+    nested: Vec<(Option<usize>, &'a [Node])>,
+    /// Names and literals passed straight to a named function, with the function and the argument's position.
+    passed: Vec<(Passed, String, usize)>,
+    /// Literals whose elements are all constants.
+    constant: Vec<usize>,
+    /// Literals outside of every loop of the body, which are built at most once per run of it.
+    once: Vec<usize>,
+    /// How many loops the node being visited is in.
+    loop_depth: usize,
+    /// Whether the body stores into an element of an array.
+    stores_elements: bool,
+}
+
+enum Passed {
+    Name(String),
+    Literal(usize),
+}
+
+impl<'a> FunctionUses<'a> {
+    /// Records the uses under `node`, which is indexed or reduced when `in_place`, and read as a value otherwise.
+    fn visit(&mut self, node: &'a Node, in_place: bool) {
+        match node {
+            Node::Identifier(ident) => {
+                self.mentioned.insert(ident.identifier_name.clone());
+                if !in_place {
+                    self.escaping.insert(ident.identifier_name.clone());
+                }
+            }
+            Node::ListLiteral(list) => {
+                self.literal(list);
+                if in_place {
+                    self.in_place.push(list.id.unwrap());
+                }
+            }
+            Node::VarDeclaration(decl) => match decl.var_value.as_ref() {
+                Node::ListLiteral(list) => {
+                    self.literal(list);
+                    self.bound
+                        .entry(decl.var_identifier.clone())
+                        .or_default()
+                        .push(list.id.unwrap());
+                }
+                value => self.visit(value, false),
+            },
+            Node::MemberExpr(member) if member.is_computed => {
+                self.visit(&member.object, true);
+                self.visit(&member.property, false);
+            }
+            Node::MemberExpr(member) => self.visit(&member.object, false),
+            Node::CallExpr(call) => {
+                if let Some((_, receiver)) = array_reduction(call) {
+                    // `dot`'s argument is read in place just like its receiver
+                    self.visit(receiver, true);
+                    for arg in &call.args {
+                        self.visit(arg, true);
+                    }
+                } else if let Node::Identifier(function) = call.caller.as_ref() {
+                    self.mentioned.insert(function.identifier_name.clone());
+                    for (index, arg) in call.args.iter().enumerate() {
+                        let passed = match arg {
+                            Node::Identifier(ident) => {
+                                self.mentioned.insert(ident.identifier_name.clone());
+                                Passed::Name(ident.identifier_name.clone())
+                            }
+                            Node::ListLiteral(list) => {
+                                self.literal(list);
+                                Passed::Literal(list.id.unwrap())
+                            }
+                            arg => {
+                                self.visit(arg, false);
+                                continue;
+                            }
+                        };
+                        self.passed
+                            .push((passed, function.identifier_name.clone(), index));
+                    }
+                } else {
+                    self.visit(&call.caller, false);
+                    self.visit_all(&call.args);
+                }
+            }
+            Node::AssignmentExpr(assign) => {
+                // Rebinding a name doesn't leak the array it held, and storing an element doesn't leak the array
+                self.stores_elements |= matches!(assign.left.as_ref(), Node::MemberExpr(_));
+                self.visit(&assign.left, true);
+                self.visit(&assign.value, false);
+            }
+            Node::FunctionDefinition(def) => {
+                self.nested.push((def.id, &def.body[..]));
+                let mut inner = FunctionUses::default();
+                inner.visit_all(&def.body);
+                self.stores_elements |= inner.stores_elements;
+                self.escaping.extend(inner.mentioned.iter().cloned());
+                self.mentioned.extend(inner.mentioned);
+            }
+            Node::BinaryExpr(bin) => {
+                self.visit(&bin.left, false);
+                self.visit(&bin.right, false);
+            }
+            Node::Comparator(comp) => {
+                self.visit(&comp.lhs, false);
+                self.visit(&comp.rhs, false);
+            }
+            Node::NullishCoalescing(nc) => {
+                self.visit(&nc.left, false);
+                self.visit(&nc.right, false);
+            }
+            Node::ObjectLiteral(obj) => {
+                for value in obj.props.values() {
+                    self.visit(value, false);
+                }
+            }
+            Node::Return(ret) => self.visit(&ret.return_statement, false),
+            Node::OptionalArg(opt) => self.visit(&opt.arg, false),
+            Node::TypeCast(cast) => self.visit(&cast.left, false),
+            Node::WhileStmt(ws) => {
+                self.loop_depth += 1;
+                self.visit(&ws.condition, false);
+                self.visit_all(&ws.body);
+                self.loop_depth -= 1;
+            }
+            Node::IfStmt(ifs) => {
+                self.visit(&ifs.condition, false);
+                self.visit_all(&ifs.body);
+            }
+            Node::Iterator(it) => {
+                self.visit(&it.right, false);
+                self.loop_depth += 1;
+                self.visit_all(&it.body);
+                self.loop_depth -= 1;
+            }
+            Node::MatchExpr(m) => {
+                self.visit(&m.target, false);
+                for (pattern, arm) in &m.arms {
+                    self.visit(pattern, false);
+                    self.visit(arm, false);
+                }
+            }
+            Node::Block(block) => self.visit_all(&block.body),
+            Node::InterpreterBlock(block) => {
+                for node in &block.body {
+                    self.visit(node, false);
+                }
+            }
+            Node::NumericLiteral(_)
+            | Node::FloatLiteral(_)
+            | Node::StringLiteral(_)
+            | Node::BoolLiteral(_)
+            | Node::NullLiteral(_)
+            | Node::NoOpNode(_)
+            | Node::Eof(_) => {}
+        }
+    }
+
+    fn literal(&mut self, list: &'a ListLiteral) {
+        self.literals.push(list.id.unwrap());
+        if self.loop_depth == 0 {
+            self.once.push(list.id.unwrap());
+        }
+        if list.props.iter().all(|prop| {
+            matches!(
+                prop,
+                Node::NumericLiteral(_) | Node::FloatLiteral(_) | Node::BoolLiteral(_)
+            )
+        }) {
+            self.constant.push(list.id.unwrap());
+        }
+        self.visit_all(&list.props);
+    }
+
+    /// Decides the arguments passed to named functions: one passed to a parameter `kept_params` keeps is read in
+    /// place, and any other lets its name escape.
+    fn settle(&mut self, kept_params: &KeptParams) {
+        for (passed, function, index) in self.passed.drain(..) {
+            let kept = kept_params.keeps(&function, index);
+            match passed {
+                Passed::Literal(literal) if kept => self.in_place.push(literal),
+                Passed::Name(name) if !kept => {
+                    self.escaping.insert(name);
+                }
+                _ => {}
+            }
+        }
+    }
+
+    fn visit_all(&mut self, nodes: &'a [Node]) {
+        for node in nodes {
+            self.visit(node, false);
+        }
+    }
+}
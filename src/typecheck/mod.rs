@@ -1 +1,4 @@
+pub mod cache;
+pub mod escape;
+pub mod table;
 pub mod typecheck;
@@ -0,0 +1,101 @@
+use std::collections::HashMap;
+
+use serde::{Deserialize, Serialize};
+
+use crate::typecheck::typecheck::T;
+
+/// A type interned in a `TypeTable`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, Serialize, Deserialize)]
+pub struct TypeId(u32);
+
+/// The type the checker inferred for every node, by node id. Each distinct type is stored once, and nodes refer to it
+/// by `TypeId`: most nodes share a handful of types, so recording one never clones a boxed `Array` or `Function`.
+#[derive(Debug, Default, Clone, PartialEq, Serialize, Deserialize)]
+#[serde(from = "StoredTable", into = "StoredTable")]
+pub struct TypeTable {
+    types: Vec<T>,
+    ids: HashMap<T, TypeId>,
+    nodes: HashMap<usize, TypeId>,
+}
+
+impl TypeTable {
+    /// The id of `t`, storing it first if the table hasn't seen it.
+    pub fn intern(&mut self, t: &T) -> TypeId {
+        if let Some(id) = self.ids.get(t) {
+            return *id;
+        }
+        let id = TypeId(self.types.len() as u32);
+        self.types.push(t.clone());
+        self.ids.insert(t.clone(), id);
+        id
+    }
+
+    /// The id of `t`, if any node has that type.
+    pub fn lookup(&self, t: &T) -> Option<TypeId> {
+        self.ids.get(t).copied()
+    }
+
+    pub fn resolve(&self, id: TypeId) -> &T {
+        &self.types[id.0 as usize]
+    }
+
+    /// Records `t` as the type of `node`, replacing what it had.
+    pub fn insert(&mut self, node: usize, t: &T) {
+        let id = self.intern(t);
+        self.nodes.insert(node, id);
+    }
+
+    pub fn get(&self, node: &usize) -> Option<&T> {
+        self.nodes.get(node).map(|id| self.resolve(*id))
+    }
+
+    /// Every node and the id of its type.
+    pub fn nodes(&self) -> impl Iterator<Item = (usize, TypeId)> + '_ {
+        self.nodes.iter().map(|(node, id)| (*node, *id))
+    }
+
+    /// The number of nodes with a type.
+    pub fn len(&self) -> usize {
+        self.nodes.len()
+    }
+
+    /// The number of distinct types.
+    pub fn type_count(&self) -> usize {
+        self.types.len()
+    }
+}
+
+/// How a `TypeTable` is written out: the lookup from types to their ids is rebuilt on reading, and nodes are listed
+/// as pairs since the formats it is written in only key maps by strings.
+#[derive(Serialize, Deserialize)]
+struct StoredTable {
+    types: Vec<T>,
+    nodes: Vec<(usize, TypeId)>,
+}
+
+impl From<StoredTable> for TypeTable {
+    fn from(stored: StoredTable) -> Self {
+        let ids = stored
+            .types
+            .iter()
+            .enumerate()
+            .map(|(index, t)| (t.clone(), TypeId(index as u32)))
+            .collect();
+        Self {
+            types: stored.types,
+            ids,
+            nodes: stored.nodes.into_iter().collect(),
+        }
+    }
+}
+
+impl From<TypeTable> for StoredTable {
+    fn from(table: TypeTable) -> Self {
+        let mut nodes: Vec<(usize, TypeId)> = table.nodes.into_iter().collect();
+        nodes.sort_unstable_by_key(|(node, _)| *node);
+        Self {
+            types: table.types,
+            nodes,
+        }
+    }
+}
@@ -1,22 +1,59 @@
 use core::fmt;
 use std::{
+    cell::RefCell,
     collections::HashMap,
     fs,
     path::{self, Path, PathBuf},
+    rc::Rc,
+    time::SystemTime,
 };
 
 use colored::Colorize;
 use serde::{Deserialize, Serialize};
 
 use crate::parser::nodetypes::{CallExpr, Node};
+use crate::parser::parser::ExecutionTechnique;
+use crate::typecheck::table::TypeTable;
+
+/// The array methods compiled code supports, as LLVM vector reductions: `xs.sum()`, `xs.min()`, `xs.max()` and
+/// `xs.dot(ys)`.
+pub const ARRAY_REDUCTIONS: [&str; 4] = ["sum", "min", "max", "dot"];
+
+/// The method name and receiver of a call to one of `ARRAY_REDUCTIONS`.
+pub fn array_reduction(cexpr: &CallExpr) -> Option<(&str, &Node)> {
+    let Node::MemberExpr(callee) = cexpr.caller.as_ref() else {
+        return None;
+    };
+    let Node::Identifier(method) = callee.property.as_ref() else {
+        return None;
+    };
+    if callee.is_computed || !ARRAY_REDUCTIONS.contains(&method.identifier_name.as_str()) {
+        return None;
+    }
+    Some((&method.identifier_name, &callee.object))
+}
 
-#[derive(Clone, Debug, PartialEq, Eq)]
+/// The arguments of a `range(end)`, `range(start, end)` or `range(start, end, step)` call, the only iterable of
+/// compiled `for` loops, which run as counted loops.
+pub fn range_call(node: &Node) -> Option<&[Node]> {
+    let Node::CallExpr(cexpr) = node else {
+        return None;
+    };
+    let Node::Identifier(callee) = cexpr.caller.as_ref() else {
+        return None;
+    };
+    (callee.identifier_name == "range" && (1..=3).contains(&cexpr.args.len()))
+        .then_some(&cexpr.args[..])
+}
+
+#[derive(Clone, Debug, PartialEq, Eq, Hash, Serialize, Deserialize)]
 pub enum T {
     Integer8,
     Integer16,
     Integer32,
     Integer64,
     Integer128,
+    Float64,
     Boolean,
     Void,
     String,
@@ -24,6 +61,8 @@ pub enum T {
     ExternWildcard, // a wildcard similar to `any` only used in external functions
     Array {
         array_t: Box<T>,
+        // Where compiled code allocates the array, as planned by `escape::ArrayPlan`, and how many elements fit under
+        // `escape::STACK_ARRAY_LIMIT`. These describe one allocation site, not the type, so they never affect a match.
         is_stack_alloca: bool,
         becomes_heap_at: usize,
         element_count: usize,
@@ -72,6 +111,7 @@ impl fmt::Display for T {
             T::Integer32 => write!(f, "i32"),
             T::Integer64 => write!(f, "i64"),
             T::Integer128 => write!(f, "i128"),
+            T::Float64 => write!(f, "f64"),
             T::Boolean => write!(f, "bool"),
             T::Void => write!(f, "void"),
             T::String => write!(f, "string"),
@@ -135,7 +175,7 @@ pub struct MetaSubmoduleArg {
 #[derive(Debug)]
 pub enum SubmoduleFetchResult {
     Valid {
-        meta: MetaStdlibExternal,
+        meta: Rc<MetaStdlibExternal>,
         entry: PathBuf,
     },
     Invalid,
@@ -188,6 +228,13 @@ impl SubmodulePath {
     }
 }
 
+thread_local! {
+    /// Every `meta.toml` parsed so far, by path, with the modification time it was parsed at. The checker, the compile
+    /// cache and codegen each fetch every external of a program, and a server fetches them again for every script.
+    static PARSED_META: RefCell<HashMap<PathBuf, (SystemTime, Rc<MetaStdlibExternal>)>> =
+        RefCell::new(HashMap::new());
+}
+
 pub fn try_fetch_submodule(
     pathstr: &str,
     importer_path: &Path,
@@ -199,10 +246,20 @@ pub fn try_fetch_submodule(
             let meta_path = dir.join("meta.toml");
             let main = dir.join("main.rs");
 
-            let meta_exists = fs::metadata(&meta_path).is_ok();
+            let meta_modified = fs::metadata(&meta_path).and_then(|meta| meta.modified());
             let main_exists = fs::metadata(&main).is_ok();
 
-            if meta_exists && main_exists {
+            if let (Ok(modified), true) = (meta_modified, main_exists) {
+                let cached = PARSED_META.with_borrow(|parsed| {
+                    parsed
+                        .get(&meta_path)
+                        .filter(|(parsed_at, _)| *parsed_at == modified)
+                        .map(|(_, meta)| Rc::clone(meta))
+                });
+                if let Some(meta) = cached {
+                    return Ok(SubmoduleFetchResult::Valid { meta, entry: main });
+                }
+
                 let contents = match fs::read_to_string(&meta_path) {
                     Ok(s) => s,
                     Err(e) => return Err(PathParseErrors::Io(e)),
@@ -212,11 +269,12 @@ pub fn try_fetch_submodule(
                     Ok(meta) => meta,
                     Err(_) => return Ok(SubmoduleFetchResult::Invalid),
                 };
+                let meta = Rc::new(parsed_meta);
+                PARSED_META.with_borrow_mut(|parsed| {
+                    parsed.insert(meta_path, (modified, Rc::clone(&meta)));
+                });
 
-                Ok(SubmoduleFetchResult::Valid {
-                    meta: parsed_meta,
-                    entry: main,
-                })
+                Ok(SubmoduleFetchResult::Valid { meta, entry: main })
             } else {
                 Ok(SubmoduleFetchResult::Invalid)
             }
@@ -236,19 +294,42 @@ pub struct TypeError {
 pub struct TypeChecker {
     pub scopes: Vec<HashMap<String, T>>,
     pub errors: Vec<TypeError>,
-    pub type_table: HashMap<usize, T>,
+    pub type_table: TypeTable,
     pub externals_used: Vec<String>,
     pub path_at: String,
+    /// What the checked program runs on. Rules that only exist because of what codegen can lower are enforced only
+    /// when compiling; the interpreter and the VM run the same programs dynamically.
+    pub technique: ExecutionTechnique,
 }
 
 impl TypeChecker {
-    pub fn new(externals_used: &Vec<String>, path_at: String) -> Self {
+    pub fn new(
+        externals_used: &Vec<String>,
+        path_at: String,
+        technique: ExecutionTechnique,
+    ) -> Self {
         Self {
             scopes: Vec::new(),
             errors: Vec::new(),
-            type_table: HashMap::new(),
+            type_table: TypeTable::default(),
             externals_used: externals_used.clone(),
             path_at,
+            technique,
+        }
+    }
+
+    fn compiling(&self) -> bool {
+        self.technique == ExecutionTechnique::Compilation
+    }
+
+    /// Whether `t` is only known at runtime. Compiled code needs every type, but interpreted values that the checker
+    /// can't see into (a call's result, an iterator's element, an `inferred` list's contents) are checked when used.
+    fn is_dynamic(&self, t: &T) -> bool {
+        match t {
+            T::Unknown | T::Infer => !self.compiling(),
+            // An empty literal's elements, say
+            T::Array { array_t, .. } => self.is_dynamic(array_t),
+            _ => false,
         }
     }
 
@@ -274,6 +355,7 @@ impl TypeChecker {
             "i32" | "number" => T::Integer32,
             "i64" => T::Integer64,
             "i128" => T::Integer128,
+            "f64" | "float" => T::Float64,
             "bool" => T::Boolean,
             "string" => T::String,
             "inferred" => T::Infer,
@@ -343,27 +425,80 @@ impl TypeChecker {
             (
                 T::Array {
                     array_t: e_ty,
-                    is_stack_alloca: e_stack,
-                    becomes_heap_at: e_heap,
                     element_count: e_len,
+                    ..
                 },
                 T::Array {
                     array_t: a_ty,
-                    is_stack_alloca: a_stack,
-                    becomes_heap_at: a_heap,
                     element_count: a_len,
+                    ..
                 },
-            ) => {
-                e_ty == a_ty
-                    && e_stack == a_stack
-                    && e_heap == a_heap
-                    && (*e_len == 0 || *e_len == *a_len)
-            }
+            ) => e_ty == a_ty && (*e_len == 0 || *e_len == *a_len),
 
             _ => expected == actual,
         }
     }
 
+    /// Checks a call of one of `ARRAY_REDUCTIONS`. The receiver's type is recorded under the callee, where codegen
+    /// reads the array's length from.
+    fn check_array_reduction(&mut self, cexpr: &CallExpr, vb: bool, ts: usize) -> T {
+        let (method, receiver) = array_reduction(cexpr).unwrap();
+        let receiver_ty = self.check_expr(receiver, None, vb, ts + 1);
+        let Node::MemberExpr(callee) = cexpr.caller.as_ref() else {
+            unreachable!();
+        };
+        self.type_table.insert(callee.id.unwrap(), &receiver_ty);
+
+        let T::Array {
+            array_t,
+            element_count,
+            ..
+        } = &receiver_ty
+        else {
+            self.type_error(&format!(
+                "`{}` is only supported on integer arrays, got `{}`",
+                method, receiver_ty
+            ));
+            return T::Unknown;
+        };
+        if !matches!(
+            **array_t,
+            T::Integer8 | T::Integer16 | T::Integer32 | T::Integer64 | T::Integer128
+        ) {
+            self.type_error(&format!(
+                "`{}` is only supported on integer arrays, got `{}`",
+                method, receiver_ty
+            ));
+            return T::Unknown;
+        }
+        if *element_count == 0 {
+            self.type_error(&format!(
+                "`{}` needs an array of known, non-zero length",
+                method
+            ));
+        }
+
+        let expected_args = if method == "dot" { 1 } else { 0 };
+        if cexpr.args.len() != expected_args {
+            self.type_error(&format!(
+                "`{}` expected {} arguments, received {}",
+                method,
+                expected_args,
+                cexpr.args.len()
+            ));
+        }
+        for arg in &cexpr.args {
+            let arg_ty = self.check_expr(arg, Some(&receiver_ty), vb, ts + 1);
+            if arg_ty != receiver_ty {
+                self.type_error(&format!(
+                    "`{}` expects an array of the same type and length, `{}`, got `{}`",
+                    method, receiver_ty, arg_ty
+                ));
+            }
+        }
+        *array_t.clone()
+    }
+
     fn can_coerce(&self, from: &T, to: &T) -> bool {
         use T::*;
         match (from, to) {
@@ -390,18 +525,33 @@ impl TypeChecker {
     // Check if all inferred types have been resolved
     // If not, this method will push a tc error to prevent lowering Inferred types to the compiler
     pub fn check_all_type_resolutions(&mut self) {
-        for entry in &self.type_table.clone() {
-            if matches!(entry.1, T::Infer) {
-                self.type_error(&format!(
-                    "Node {} requires type annotations; expected a constant type, got `inferred`",
-                    entry.0
-                ));
-            }
+        // Unresolved `inferred` types only matter once they are lowered to LLVM types; interpreted programs are
+        // dynamically typed and would otherwise be rejected for every call into the standard library.
+        if !self.compiling() {
+            return;
+        }
+        let Some(infer) = self.type_table.lookup(&T::Infer) else {
+            return;
+        };
+        let mut unresolved: Vec<usize> = self
+            .type_table
+            .nodes()
+            .filter(|(_, id)| *id == infer)
+            .map(|(node, _)| node)
+            .collect();
+        unresolved.sort_unstable();
+        for node in unresolved {
+            self.type_error(&format!(
+                "Node {} requires type annotations; expected a constant type, got `inferred`",
+                node
+            ));
         }
     }
 
     pub fn enforce_equality(&mut self, given: &T, expected: &T) -> T {
-        if (given == expected) || self.can_coerce(given, expected) {
+        if self.is_dynamic(given) || self.is_dynamic(expected) {
+            expected.clone()
+        } else if (given == expected) || self.can_coerce(given, expected) {
             expected.clone()
         } else if self.can_coerce(expected, given) {
             self.type_error(&format!("Cannot coerce {} to {}", given, expected));
@@ -505,6 +655,8 @@ impl TypeChecker {
                 let parent_type = self.check_expr(&m.object, None, vb, ts + 1);
 
                 match &parent_type {
+                    // A named member of a list is one of its methods, which interpreted lists have
+                    T::Array { .. } if !m.is_computed && !self.compiling() => T::Unknown,
                     T::Array {
                         array_t,
                         is_stack_alloca,
@@ -513,7 +665,7 @@ impl TypeChecker {
                     } => {
                         let index_ty =
                             self.check_expr(&m.property, Some(&T::Integer32), vb, ts + 1);
-                        if index_ty != T::Integer32 {
+                        if index_ty != T::Integer32 && !self.is_dynamic(&index_ty) {
                             self.type_error(&format!("Array index must be i32, got {}", index_ty));
                         }
                         if let Node::NumericLiteral(n) = m.property.as_ref() {
@@ -530,17 +682,23 @@ impl TypeChecker {
                     _ => T::Unknown,
                 }
             }
+            Node::FloatLiteral(_) => T::Float64,
             Node::NumericLiteral(n) => match expected {
                 Some(ty)
                     if matches!(
                         ty,
-                        T::Integer8 | T::Integer16 | T::Integer32 | T::Integer64 | T::Integer128
+                        T::Integer8
+                            | T::Integer16
+                            | T::Integer32
+                            | T::Integer64
+                            | T::Integer128
+                            | T::Float64
                     ) =>
                 {
                     ty.clone()
                 }
                 _ => {
-                    let val = n.literal_value.parse::<i128>().unwrap();
+                    let val = n.value;
                     if val > i64::MAX.into() {
                         T::Integer128
                     } else if val > i32::MAX.into() {
@@ -554,6 +712,10 @@ impl TypeChecker {
                     }
                 }
             },
+            // Interpreted lists and objects have methods of these names too, with none of the compiled restrictions
+            Node::CallExpr(cexpr) if self.compiling() && array_reduction(cexpr).is_some() => {
+                self.check_array_reduction(cexpr, vb, ts)
+            }
             Node::CallExpr(cexpr) => {
                 let callee_ty = self.check_expr(&cexpr.caller, None, vb, ts + 1);
                 let f_clone = callee_ty.clone();
@@ -582,6 +744,7 @@ impl TypeChecker {
 
                             if !self.types_match(&expected_ty.1, &arg_ty)
                                 && !self.can_coerce(&arg_ty, &expected_ty.1)
+                                && !self.is_dynamic(&arg_ty)
                             {
                                 self.type_error(&format!(
                                     "call to fn `{}` arg #{} type mismatch: expected `{}`, got `{}`\n{}",
@@ -631,7 +794,7 @@ impl TypeChecker {
                         saw_return = true;
                         let val_ty =
                             self.check_expr(&ret.return_statement, Some(&return_type), vb, ts + 1);
-                        if val_ty != return_type {
+                        if val_ty != return_type && !self.is_dynamic(&val_ty) {
                             self.type_error(&format!(
                                 "Function `{}` returns `{}`, expected `{}`",
                                 fdef.name, val_ty, return_type
@@ -673,7 +836,7 @@ impl TypeChecker {
                 let resolved_ty = expected_ty.resolve_with_hint(&expr_ty);
 
                 if !self.types_match(&resolved_ty, &expr_ty) {
-                    if !self.can_coerce(&expr_ty, &resolved_ty) {
+                    if !self.can_coerce(&expr_ty, &resolved_ty) && !self.is_dynamic(&expr_ty) {
                         self.type_error(&format!(
                             "Cannot assign value of type `{}` to variable of type `{}`",
                             expr_ty, resolved_ty
@@ -698,7 +861,21 @@ impl TypeChecker {
                 let left_val = self.check_expr(&tc.left, None, vb, ts + 1);
                 let to_type = tc.target_type.clone();
 
-                if !self.can_coerce(&left_val, &to_type) {
+                // Numbers convert to any other numeric type, truncating or rounding toward zero
+                let is_numeric = |t: &T| {
+                    matches!(
+                        t,
+                        T::Integer8
+                            | T::Integer16
+                            | T::Integer32
+                            | T::Integer64
+                            | T::Integer128
+                            | T::Float64
+                    )
+                };
+                if !self.can_coerce(&left_val, &to_type)
+                    && !(is_numeric(&left_val) && is_numeric(&to_type))
+                {
                     self.type_error(&format!("Cannot cast from {} to {}", left_val, to_type));
                 }
 
@@ -708,7 +885,11 @@ impl TypeChecker {
                 let lhs_ty = self.check_expr(&bin.left, None, vb, ts + 1);
                 let rhs_ty = self.check_expr(&bin.right, Some(&lhs_ty), vb, ts + 1);
 
-                if lhs_ty != rhs_ty {
+                if lhs_ty != rhs_ty && self.is_dynamic(&lhs_ty) {
+                    rhs_ty
+                } else if lhs_ty != rhs_ty && self.is_dynamic(&rhs_ty) {
+                    lhs_ty
+                } else if lhs_ty != rhs_ty {
                     self.type_error(&format!(
                         "Cannot use `{}` operation on {} and {}.",
                         bin.op, lhs_ty, rhs_ty
@@ -743,6 +924,63 @@ impl TypeChecker {
                 }
                 last_val
             }
+            Node::Iterator(it) if !self.compiling() => {
+                // Any iterable goes; the loop variable takes the element type when the checker knows it
+                let iterable = self.check_expr(&it.right, None, vb, ts + 1);
+                let element = match iterable {
+                    _ if range_call(&it.right).is_some() => T::Integer32,
+                    T::Array { array_t, .. } => *array_t,
+                    _ => T::Unknown,
+                };
+
+                self.enter_scope();
+                self.scopes
+                    .last_mut()
+                    .unwrap()
+                    .insert(it.left.literal_value.to_string(), element);
+                let mut last_val = T::Unknown;
+                for sub_node in &it.body {
+                    last_val = self.check_expr(sub_node, None, vb, ts + 1)
+                }
+                self.exit_scope();
+                last_val
+            }
+            Node::Iterator(it) => {
+                match range_call(&it.right) {
+                    Some(bounds) => {
+                        for bound in bounds {
+                            let bound_ty = self.check_expr(bound, Some(&T::Integer32), vb, ts + 1);
+                            if bound_ty != T::Integer32 {
+                                self.type_error(&format!(
+                                    "range bounds must be i32, got `{}`",
+                                    bound_ty
+                                ));
+                            }
+                        }
+                        if let [_, _, Node::NumericLiteral(step)] = bounds {
+                            if step.value == 0 {
+                                self.type_error("range step cannot be zero");
+                            }
+                        }
+                    }
+                    None => self.type_error(&format!(
+                        "compiled `for` loops can only iterate over `range(...)`, got `{}`",
+                        it.right
+                    )),
+                }
+
+                self.enter_scope();
+                self.scopes
+                    .last_mut()
+                    .unwrap()
+                    .insert(it.left.literal_value.to_string(), T::Integer32);
+                let mut last_val = T::Unknown;
+                for sub_node in &it.body {
+                    last_val = self.check_expr(sub_node, None, vb, ts + 1)
+                }
+                self.exit_scope();
+                last_val
+            }
             Node::Comparator(comp) => {
                 let l = self.check_expr(&comp.lhs, None, vb, ts + 1);
                 self.check_expr(&comp.rhs, Some(&l), vb, ts + 1);
@@ -768,7 +1006,14 @@ impl TypeChecker {
                 last_right
             }
             Node::NullishCoalescing(n) => self.check_expr(&n.left, None, vb, ts + 1),
-            Node::NoOpNode(_) => T::Unknown,
+            Node::NoOpNode(_) | Node::NullLiteral(_) => T::Unknown,
+            // Objects have no static type yet; their values are still checked
+            Node::ObjectLiteral(o) => {
+                for value in o.props.values() {
+                    self.check_expr(value, None, vb, ts + 1);
+                }
+                T::Unknown
+            }
             _ => unimplemented!("{:?}", node),
         };
         let node_id = match node {
@@ -791,6 +1036,7 @@ impl TypeChecker {
             Node::NullLiteral(v) => v.id,
             Node::NullishCoalescing(v) => v.id,
             Node::NumericLiteral(v) => v.id,
+            Node::FloatLiteral(v) => v.id,
             Node::ObjectLiteral(v) => v.id,
             Node::OptionalArg(v) => v.id,
             Node::Return(v) => v.id,
@@ -804,7 +1050,7 @@ impl TypeChecker {
             println!("{}└ typecheck resolution to `{}`", "│  ".repeat(ts * 2), ty);
         }
 
-        self.type_table.insert(node_id.unwrap(), ty.clone());
+        self.type_table.insert(node_id.unwrap(), &ty);
 
         ty
     }